@@ -6,6 +6,9 @@
     nodePackages.pnpm
     alsa-utils
     pulseaudio
+    cmake
+    gtest
+    gbenchmark
   ];
 
   enterShell = ''
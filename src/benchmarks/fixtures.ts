@@ -0,0 +1,293 @@
+/**
+ * Outputs of the command line tools recorded on a desktop with a few nodes (src/benchmarks/fixtures), scaled to any
+ * number of nodes and replayed in place of the tools.
+ *
+ * A recorded output is scaled by repeating its node entries with new IDs and names, so the scaled outputs keep the
+ * layout, the properties and the size per node of the real ones. `pnpm bench:replay record` records them again from
+ * the tools installed on the machine, which needs at least one sink, one source and one stream playing.
+ */
+import { mkdirSync, readFileSync, writeFileSync } from 'fs';
+import { basename, dirname, join } from 'path';
+import { Status, VsNode } from '@/types';
+import { CommandExecutor, execCommand } from '@/utils/commands';
+import { PactlDevice, PactlInfo, PactlSinkInput } from '@/utils/pactlJson';
+
+// Realistic to extreme, from a laptop to a machine running hundreds of streams
+export const FIXTURE_SIZES = [5, 50, 500];
+
+const FIXTURES_DIR = join(__dirname, 'fixtures');
+const VS_EXEC_PATH = join(__dirname, '..', 'platforms', 'windows', 'vsExec.exe');
+
+// Commands answered from the recordings, by tool and arguments
+const RECORDINGS: { file: string; command: string; args: string[] }[] = [
+  { file: 'pactl/info.txt', command: 'pactl', args: ['info'] },
+  { file: 'pactl/info.json', command: 'pactl', args: ['-f', 'json', 'info'] },
+  { file: 'pactl/get-default-sink.txt', command: 'pactl', args: ['get-default-sink'] },
+  { file: 'pactl/get-default-source.txt', command: 'pactl', args: ['get-default-source'] },
+  { file: 'pactl/list-sinks.txt', command: 'pactl', args: ['list', 'sinks'] },
+  { file: 'pactl/list-sinks.json', command: 'pactl', args: ['-f', 'json', 'list', 'sinks'] },
+  { file: 'pactl/list-sources.txt', command: 'pactl', args: ['list', 'sources'] },
+  { file: 'pactl/list-sources.json', command: 'pactl', args: ['-f', 'json', 'list', 'sources'] },
+  { file: 'pactl/list-sink-inputs.txt', command: 'pactl', args: ['list', 'sink-inputs'] },
+  { file: 'pactl/list-sink-inputs.json', command: 'pactl', args: ['-f', 'json', 'list', 'sink-inputs'] },
+  { file: 'wpctl/status.txt', command: 'wpctl', args: ['status'] },
+  { file: 'wpctl/get-volume.txt', command: 'wpctl', args: ['get-volume', '@DEFAULT_AUDIO_SINK@'] },
+  { file: 'amixer/sget-Master.txt', command: 'amixer', args: ['sget', 'Master'] },
+  { file: 'vsExec/getStatus.json', command: VS_EXEC_PATH, args: ['getStatus'] },
+];
+
+export type NodeCounts = {
+  sinks: number;
+  sources: number;
+  streams: number;
+};
+
+export type Fixture = {
+  size: number;
+  counts: NodeCounts;
+  // Output of each command, by tool name and arguments
+  outputs: Map<string, string>;
+};
+
+function getKey(command: string, args: string[]) {
+  return [basename(command), ...args].join(' ');
+}
+
+function readRecording(file: string) {
+  return readFileSync(join(FIXTURES_DIR, file), 'utf8');
+}
+
+/**
+ * Nodes of a fixture by type: a tenth of sinks, a tenth of sources, the streams making the rest.
+ */
+export function getNodeCounts(size: number): NodeCounts {
+  const devices = Math.max(1, Math.round(size / 10));
+  return { sinks: devices, sources: devices, streams: Math.max(0, size - 2 * devices) };
+}
+
+function repeat<T, R>(templates: T[], count: number, what: string, scale: (template: T, i: number) => R): R[] {
+  if (templates.length === 0) throw new Error(`No ${what} in the recording to scale`);
+
+  return Array.from({ length: count }, (_, i) => scale(templates[i % templates.length], i));
+}
+
+// A pactl text listing, one block per node
+function scalePactlText(output: string, count: number, scale: (block: string, i: number) => string) {
+  const blocks = output.trim().split(/\n\n(?=\S)/).filter((block) => block);
+  return repeat(blocks, count, 'node', scale).map((block) => block + '\n').join('\n');
+}
+
+type PactlNames = {
+  sinks: string[];
+  sources: string[];
+};
+
+function scalePactl(outputs: Map<string, string>, counts: NodeCounts) {
+  const sinkIds = Array.from({ length: counts.sinks }, (_, i) => 1000 + i);
+  const sourceIds = Array.from({ length: counts.sources }, (_, i) => 2000 + i);
+  const streamIds = Array.from({ length: counts.streams }, (_, i) => 3000 + i);
+  const names: PactlNames = { sinks: [], sources: [] };
+
+  const scaleDevice = (type: 'sinks' | 'sources', ids: number[]) => (block: string, i: number) => {
+    const name = `${block.match(/^\tName: (.+)$/m)?.[1]}-${i}`;
+    names[type].push(name);
+    return block
+      .replace(/#\d+/, `#${ids[i]}`)
+      .replace(/^\tName: .+$/m, `\tName: ${name}`)
+      .replace(/^\tDescription: (.+)$/m, `\tDescription: $1 ${i + 1}`);
+  };
+  outputs.set('pactl list sinks', scalePactlText(readRecording('pactl/list-sinks.txt'), counts.sinks,
+    scaleDevice('sinks', sinkIds)));
+  outputs.set('pactl list sources', scalePactlText(readRecording('pactl/list-sources.txt'), counts.sources,
+    scaleDevice('sources', sourceIds)));
+  outputs.set('pactl list sink-inputs', scalePactlText(readRecording('pactl/list-sink-inputs.txt'), counts.streams,
+    (block, i) => block
+      .replace(/#\d+/, `#${streamIds[i]}`)
+      .replace(/^\tSink: \d+$/m, `\tSink: ${sinkIds[i % sinkIds.length]}`)
+      .replace(/^\t\tapplication\.name = "(.+)"$/m, `\t\tapplication.name = "$1 ${i + 1}"`)));
+
+  const scaleDevices = (devices: PactlDevice[], ids: number[], names: string[]) => JSON.stringify(
+    repeat(devices, ids.length, 'node', (device, i) => ({
+      ...device,
+      index: ids[i],
+      name: names[i],
+      description: `${device.description} ${i + 1}`,
+    })),
+  ) + '\n';
+  outputs.set('pactl -f json list sinks', scaleDevices(
+    JSON.parse(readRecording('pactl/list-sinks.json')), sinkIds, names.sinks));
+  outputs.set('pactl -f json list sources', scaleDevices(
+    JSON.parse(readRecording('pactl/list-sources.json')), sourceIds, names.sources));
+
+  const sinkInputs: PactlSinkInput[] = JSON.parse(readRecording('pactl/list-sink-inputs.json'));
+  outputs.set('pactl -f json list sink-inputs', JSON.stringify(
+    repeat(sinkInputs, streamIds.length, 'stream', (sinkInput, i) => ({
+      ...sinkInput,
+      index: streamIds[i],
+      sink: sinkIds[i % sinkIds.length],
+      properties: {
+        ...sinkInput.properties,
+        'application.name': `${sinkInput.properties?.['application.name']} ${i + 1}`,
+      },
+    })),
+  ) + '\n');
+
+  // The defaults are the first sink and source
+  const info: PactlInfo = JSON.parse(readRecording('pactl/info.json'));
+  outputs.set('pactl -f json info', JSON.stringify({
+    ...info,
+    default_sink_name: names.sinks[0],
+    default_source_name: names.sources[0],
+  }) + '\n');
+  outputs.set('pactl info', readRecording('pactl/info.txt')
+    .replace(/^Default Sink: .+$/m, `Default Sink: ${names.sinks[0]}`)
+    .replace(/^Default Source: .+$/m, `Default Source: ${names.sources[0]}`));
+  outputs.set('pactl get-default-sink', names.sinks[0] + '\n');
+  outputs.set('pactl get-default-source', names.sources[0] + '\n');
+}
+
+function scaleWpctl(outputs: Map<string, string>, counts: NodeCounts) {
+  // wpctl IDs are shared by every object, the ports of the streams included
+  let nextId = 100;
+  const sinkNames: string[] = [];
+  const volume = readRecording('wpctl/get-volume.txt');
+
+  const scaleNodes = (lines: string[], count: number, names?: string[]) => repeat(
+    lines.filter((line) => /\d+\. .+\[vol: /.test(line)), count, 'node', (line, i) => {
+      const [, prefix, spaces, name, volumeInfo] = line.match(/^( │  )[* ](\s+)\d+\. (.+?)\s+(\[vol: .+)$/);
+      const id = nextId++;
+      outputs.set(`wpctl get-volume ${id}`, volume);
+      names?.push(`${name} ${i + 1}`);
+      return `${prefix}${i === 0 ? '*' : ' '}${spaces}${id}. ${`${name} ${i + 1}`.padEnd(35)} ${volumeInfo}`;
+    });
+
+  // A stream line followed by the lines of its ports
+  const scaleStreams = (lines: string[]) => {
+    const streams: string[][] = [];
+    for (const line of lines) {
+      if (/^ {8}\d+\. /.test(line)) streams.push([line]);
+      else if (/^ {9,}\d+\. /.test(line)) streams.at(-1)?.push(line);
+    }
+
+    return repeat(streams, counts.streams, 'stream', ([line, ...ports], i) => {
+      const id = nextId++;
+      outputs.set(`wpctl get-volume ${id}`, volume);
+      const sinkName = sinkNames[i % sinkNames.length];
+      return [
+        line.replace(/\d+\. (\S.*?)(\s*)$/, (_, name, spaces) => `${id}. ${name} ${i + 1}${spaces}`),
+        ...ports.map((port) => port
+          .replace(/\d+\./, `${nextId++}.`)
+          .replace(/> .+:playback_/, `> ${sinkName}:playback_`)),
+      ].join('\n');
+    });
+  };
+
+  const sections = readRecording('wpctl/status.txt').split('\n\n').map((section) => {
+    if (!section.startsWith('Audio\n')) return section;
+
+    // The lines of each sub section, by name, kept in order
+    const subSections: { header: string; lines: string[] }[] = [];
+    for (const line of section.split('\n').slice(1)) {
+      if (/^ [├└]─ /.test(line)) subSections.push({ header: line, lines: [] });
+      else subSections.at(-1)?.lines.push(line);
+    }
+
+    return ['Audio', ...subSections.flatMap(({ header, lines }) => {
+      const name = header.match(/─ (.+):/)?.[1];
+      if (name === 'Sinks') return [header, ...scaleNodes(lines, counts.sinks, sinkNames), ' │  '];
+      if (name === 'Sources') return [header, ...scaleNodes(lines, counts.sources), ' │  '];
+      if (name === 'Streams') return [header, ...scaleStreams(lines)];
+      return [header, ...lines];
+    })].join('\n');
+  });
+  outputs.set('wpctl status', sections.join('\n\n'));
+}
+
+// Layout of the JSON written by vsExec without --compact
+function formatVsExecStatus(status: Status) {
+  const formatNode = (node: VsNode) => `{\n${Object.entries(node)
+    .map(([key, value]) => `  ${JSON.stringify(key)}: ${JSON.stringify(value)}`).join(',\n')}\n}`;
+  const formatNodes = (name: string, nodes: VsNode[]) => `"${name}": [\n${nodes.map(formatNode).join(',\n')}\n]`;
+
+  return `{\n${[
+    formatNodes('sinks', status.sinks),
+    formatNodes('sources', status.sources),
+    formatNodes('streams', status.streams),
+    `"defaultSink": ${JSON.stringify(status.defaultSink)}`,
+    `"defaultSource": ${JSON.stringify(status.defaultSource)}`,
+  ].join(',\n')}\n}\n`;
+}
+
+function scaleVsExec(outputs: Map<string, string>, counts: NodeCounts) {
+  const status: Status = JSON.parse(readRecording('vsExec/getStatus.json'));
+  // Endpoint IDs end with a GUID, numbered instead
+  const guid = (i: number) => `${i.toString(16).padStart(8, '0')}-0000-4000-8000-000000000000`;
+  const scaleDevices = (nodes: VsNode[], count: number, flow: number) => repeat(nodes, count, 'node', (node, i) => ({
+    ...node,
+    id: `{0.0.${flow}.00000000}.{${guid(i)}}`,
+    name: `${node.name} ${i + 1}`,
+    isDefault: i === 0,
+  }));
+
+  const sinks = scaleDevices(status.sinks, counts.sinks, 0);
+  const sources = scaleDevices(status.sources, counts.sources, 1);
+  const streams = repeat(status.streams, counts.streams, 'stream', (stream, i) => {
+    const destinationId = sinks[i % sinks.length].id;
+    const session = stream.id.slice(stream.id.indexOf('|'), stream.id.lastIndexOf('%b'));
+    const id = `${destinationId}${session}%b{${guid(i)}}`;
+    return { ...stream, id, name: `${stream.name} ${i + 1}`, destinationId };
+  });
+
+  outputs.set('vsExec.exe getStatus', formatVsExecStatus({
+    sinks,
+    sources,
+    streams,
+    defaultSink: sinks[0].id,
+    defaultSource: sources[0].id,
+  }));
+}
+
+/**
+ * Outputs of every tool for a machine with the given number of nodes. amixer only has its Master control, whatever
+ * the size.
+ */
+export function loadFixture(size: number): Fixture {
+  const counts = getNodeCounts(size);
+  const outputs = new Map<string, string>();
+
+  scalePactl(outputs, counts);
+  scaleWpctl(outputs, counts);
+  scaleVsExec(outputs, counts);
+  outputs.set('amixer sget Master', readRecording('amixer/sget-Master.txt'));
+
+  return { size, counts, outputs };
+}
+
+/**
+ * Executor answering the commands from a fixture, see setCommandExecutor. The other commands fail like an unknown
+ * command would, e.g. the setters.
+ */
+export function createReplayExecutor(fixture: Fixture): CommandExecutor {
+  return async (command, args) => {
+    const output = fixture.outputs.get(getKey(command, args));
+    if (output === undefined) throw `No recorded output for: ${getKey(command, args)}`;
+
+    return output;
+  };
+}
+
+/**
+ * Record the outputs of the tools installed on this machine as the new fixtures, the others are kept.
+ */
+export async function recordFixtures() {
+  for (const { file, command, args } of RECORDINGS) {
+    try {
+      const output = await execCommand(command, args);
+      mkdirSync(dirname(join(FIXTURES_DIR, file)), { recursive: true });
+      writeFileSync(join(FIXTURES_DIR, file), output);
+      console.log(`Recorded ${file}`);
+    } catch (e) {
+      console.log(`Kept ${file}, ${getKey(command, args)} failed`);
+    }
+  }
+}
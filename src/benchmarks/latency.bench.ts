@@ -0,0 +1,78 @@
+/**
+ * Per call latency of the native addon against the vsExec protocol, through a `serve` process and a process per call.
+ *
+ * Usage: pnpm bench:latency [executable] [addon]
+ * Defaults to the helper of the platform (vsExec.exe, or vsPulse on Linux) and the addon built with node-gyp.
+ * The fake backend compares the transports alone: `_gate_build/vsExecFake` and `_gate_build/vsAddonFake.node`.
+ */
+import { join, resolve } from 'path';
+import { performance } from 'perf_hooks';
+import { loadAddon, VsAddon } from '@/utils/addon';
+import { execCommand } from '@/utils/commands';
+import { VsExecServer } from '@/utils/vsExecServer';
+import { requestJson, requestVolume } from '@/utils/vsExecHelper';
+
+const ITERATIONS = Number.parseInt(process.env.ITERATIONS ?? '1000', 10);
+// Spawning is orders of magnitude slower, fewer iterations are enough
+const SPAWN_ITERATIONS = Math.max(1, Math.floor(ITERATIONS / 20));
+const WARMUP = 20;
+
+type Case = {
+  name: string;
+  iterations: number;
+  call: () => Promise<unknown>;
+};
+
+function percentile(sorted: number[], p: number) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+async function measure({ name, iterations, call }: Case) {
+  for (let i = 0; i < Math.min(WARMUP, iterations); i++) await call();
+
+  const durations: number[] = [];
+  for (let i = 0; i < iterations; i++) {
+    const start = performance.now();
+    await call();
+    durations.push(performance.now() - start);
+  }
+  durations.sort((a, b) => a - b);
+
+  const mean = durations.reduce((sum, duration) => sum + duration, 0) / durations.length;
+  const us = (ms: number) => (ms * 1000).toFixed(1).padStart(10);
+  console.log(`${name.padEnd(36)}${us(mean)}${us(percentile(durations, 0.5))}${us(percentile(durations, 0.99))}`);
+}
+
+async function main() {
+  const defaultExecutable = process.platform === 'win32'
+    ? join(__dirname, '..', 'platforms', 'windows', 'vsExec.exe')
+    : join(__dirname, '..', 'platforms', 'linux', 'vsPulse');
+  const executable = resolve(process.argv[2] ?? defaultExecutable);
+  const addon: VsAddon | null = process.argv[3] ? require(resolve(process.argv[3])) : loadAddon();
+
+  const server = new VsExecServer(executable);
+  const cases: Case[] = [
+    { name: 'serve getGlobalVolume', iterations: ITERATIONS, call: () => requestVolume(server, ['getGlobalVolume']) },
+    { name: 'serve getStatus', iterations: ITERATIONS, call: () => requestJson(server, ['getStatus']) },
+    { name: 'spawn getGlobalVolume', iterations: SPAWN_ITERATIONS, call: () => execCommand(executable, ['getGlobalVolume']) },
+    { name: 'spawn getStatus', iterations: SPAWN_ITERATIONS, call: () => execCommand(executable, ['getStatus']) },
+  ];
+  if (addon) {
+    cases.unshift(
+      { name: `addon (${addon.backend}) getGlobalVolume`, iterations: ITERATIONS, call: () => addon.getGlobalVolume() },
+      { name: `addon (${addon.backend}) getStatus`, iterations: ITERATIONS, call: () => addon.getStatus() },
+    );
+  } else {
+    console.log('The addon is not built, only the vsExec protocol is measured');
+  }
+
+  console.log(`${'Call'.padEnd(36)}${'mean µs'.padStart(10)}${'p50 µs'.padStart(10)}${'p99 µs'.padStart(10)}`);
+  for (const benchCase of cases) {
+    await measure(benchCase);
+  }
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
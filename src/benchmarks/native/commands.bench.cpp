@@ -0,0 +1,123 @@
+#include "audio.h"
+#include "commands.h"
+#include "fakeBackend.h"
+#include "taskPool.h"
+#include <benchmark/benchmark.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// The command dispatch and output against the fake backend holding thousands of streams, the way vsExec runs them in
+// serve mode. The latency cases add a simulated round trip to the audio service per call and per node enumerated.
+
+namespace {
+
+void initializeFake(size_t streamCount, long latencyUs = 0) {
+    FakeBackendOptions options;
+    options.sinkCount = 4;
+    options.sourceCount = 2;
+    options.streamCount = streamCount;
+    options.latency = std::chrono::microseconds(latencyUs);
+    configureFakeBackend(options);
+    initialize();
+}
+
+void uninitializeFake() {
+    uninitialize();
+    configureFakeBackend(FakeBackendOptions());
+}
+
+std::string getLastStreamId() {
+    std::vector<VsNode> streams;
+    StringArena strings;
+    getStreams(&streams, strings);
+    return toString(streams.back().id);
+}
+
+}
+
+static void BM_GetStatusCommand(benchmark::State &state) {
+    initializeFake(state.range(0));
+    std::vector<std::string> args = {"vsExec", "--compact", "getStatus"};
+    std::istringstream in;
+
+    for (auto _: state) {
+        std::ostringstream out;
+        runCommand(args, in, out);
+        benchmark::DoNotOptimize(out.str().size());
+    }
+    uninitializeFake();
+}
+BENCHMARK(BM_GetStatusCommand)->Arg(100)->Arg(1000)->Arg(4000);
+
+static void BM_GetVolumeByIdCommand(benchmark::State &state) {
+    initializeFake(state.range(0));
+    std::vector<std::string> args = {"vsExec", "getVolumeById", getLastStreamId()};
+    std::istringstream in;
+
+    for (auto _: state) {
+        std::ostringstream out;
+        runCommand(args, in, out);
+        benchmark::DoNotOptimize(out.str().size());
+    }
+    uninitializeFake();
+}
+BENCHMARK(BM_GetVolumeByIdCommand)->Arg(100)->Arg(1000)->Arg(4000);
+
+// 100 volume changes over the streams in a single batch
+static void BM_BatchCommand(benchmark::State &state) {
+    initializeFake(state.range(0));
+    std::vector<std::string> args = {"vsExec", "--compact", "batch", "100"};
+    std::string input;
+    for (int i = 0; i < 100; i++) {
+        input += "setVolume\t{0.0.0.00000000}.{sink-" + std::to_string(i % 4) + "}\t" + std::to_string(i) + "\n";
+    }
+
+    for (auto _: state) {
+        std::istringstream in(input);
+        std::ostringstream out;
+        runCommand(args, in, out);
+        benchmark::DoNotOptimize(out.str().size());
+    }
+    uninitializeFake();
+}
+BENCHMARK(BM_BatchCommand)->Arg(1000);
+
+static void BM_GetStatusCommandWithLatency(benchmark::State &state) {
+    initializeFake(state.range(0), 20);
+    std::vector<std::string> args = {"vsExec", "--compact", "getStatus"};
+    std::istringstream in;
+
+    for (auto _: state) {
+        std::ostringstream out;
+        runCommand(args, in, out);
+        benchmark::DoNotOptimize(out.str().size());
+    }
+    uninitializeFake();
+}
+BENCHMARK(BM_GetStatusCommandWithLatency)->Arg(100)->Arg(400)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// getStatus over 1 to 16 sinks of 4 streams each, with the devices read one after another (1 thread) or on the
+// enumeration pool (4 threads): the round trips of the devices overlap
+static void BM_GetStatusCommandAcrossDevices(benchmark::State &state) {
+    FakeBackendOptions options;
+    options.sinkCount = state.range(0);
+    options.streamCount = state.range(0) * 4;
+    options.latency = std::chrono::microseconds(200);
+    configureFakeBackend(options);
+    initialize();
+    setEnumerationThreads(state.range(1));
+
+    std::vector<std::string> args = {"vsExec", "--compact", "getStatus"};
+    std::istringstream in;
+
+    for (auto _: state) {
+        std::ostringstream out;
+        runCommand(args, in, out);
+        benchmark::DoNotOptimize(out.str().size());
+    }
+    setEnumerationThreads(0);
+    uninitializeFake();
+}
+BENCHMARK(BM_GetStatusCommandAcrossDevices)->ArgNames({"devices", "threads"})
+        ->ArgsProduct({{1, 2, 4, 8, 16}, {1, 4}})->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,100 @@
+#include "commands.h"
+#include <benchmark/benchmark.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Writing the status of a system with many streams, the former field by field printing against the JSON writer.
+// The former printing mirrors printVsNode before the writer: a stream write and a UTF-8 conversion per field, with
+// the names left unescaped. The output goes to /dev/null, so the stream writes are counted but not the terminal.
+
+namespace {
+
+VsStatus makeStatus(size_t streamCount) {
+    VsStatus status;
+    auto copyString = [&status](const std::wstring &str) { return status.strings.copy(str); };
+    status.sinks.push_back({copyString(L"{0.0.0.00000000}.{sink-speakers}"), copyString(L"Speakers"), 50, false,
+                            true, nullptr});
+    status.sources.push_back({copyString(L"{0.0.1.00000000}.{source-microphone}"), copyString(L"Microphone"), 80,
+                              false, true, nullptr});
+    for (size_t i = 0; i < streamCount; i++) {
+        // Product names from the version resources are often non-ASCII, sometimes quoted
+        status.streams.push_back({copyString(L"{0.0.0.00000000}.{sink-speakers}|\\Device\\HarddiskVolume3\\Program "
+                                             L"Files\\App" + std::to_wstring(i) + L"\\app.exe%b{stream-" +
+                                             std::to_wstring(i) + L"}"),
+                                  copyString(L"Lecteur « Média » \"" + std::to_wstring(i) + L"\""), (int) (i % 101),
+                                  i % 2 == 0, false, copyString(L"{0.0.0.00000000}.{sink-speakers}")});
+    }
+    status.defaultSink = copyString(L"{0.0.0.00000000}.{sink-speakers}");
+    status.defaultSource = copyString(L"{0.0.1.00000000}.{source-microphone}");
+    return status;
+}
+
+void printFormerNode(std::ostream &out, VsNode &node, const char *type, bool last) {
+    out << "{\n";
+    out << "  \"type\": \"" << type << "\",\n";
+    out << "  \"id\": \"" << toString(node.id) << "\",\n";
+    out << "  \"name\": \"" << toString(node.name) << "\",\n";
+    out << "  \"volume\": " << node.volume << ",\n";
+    out << "  \"muted\": " << (node.muted ? "true" : "false") << ",\n";
+    out << "  \"isDefault\": " << (node.isDefault ? "true" : "false") << (node.destinationId != nullptr ? "," : "")
+        << "\n";
+    if (node.destinationId != nullptr) {
+        out << "  \"destinationId\": \"" << toString(node.destinationId) << "\"\n";
+    }
+    out << "}" << (last ? "" : ",") << "\n";
+}
+
+void printFormerNodeVector(std::ostream &out, std::vector<VsNode> &nodes, const char *type) {
+    out << "[\n";
+    for (size_t i = 0; i < nodes.size(); i++) {
+        printFormerNode(out, nodes[i], type, i == nodes.size() - 1);
+    }
+    out << "]";
+}
+
+void printFormerStatus(std::ostream &out, VsStatus &status) {
+    out << "{\n\"sinks\": ";
+    printFormerNodeVector(out, status.sinks, "sink");
+    out << ",\n\"sources\": ";
+    printFormerNodeVector(out, status.sources, "source");
+    out << ",\n\"streams\": ";
+    printFormerNodeVector(out, status.streams, "stream");
+    out << ",\n\"defaultSink\": \"" << toString(status.defaultSink) << "\"";
+    out << ",\n\"defaultSource\": \"" << toString(status.defaultSource) << "\"";
+    out << "\n}" << std::endl;
+}
+
+}
+
+static void BM_FormerPrint(benchmark::State &state) {
+    VsStatus status = makeStatus(state.range(0));
+    std::ofstream out("/dev/null");
+
+    for (auto _: state) {
+        printFormerStatus(out, status);
+    }
+}
+BENCHMARK(BM_FormerPrint)->Arg(1000);
+
+static void BM_JsonWriter(benchmark::State &state) {
+    VsStatus status = makeStatus(state.range(0));
+    std::ofstream out("/dev/null");
+
+    for (auto _: state) {
+        printVsStatus(out, status, false);
+        out.flush();
+    }
+}
+BENCHMARK(BM_JsonWriter)->Arg(1000);
+
+static void BM_JsonWriterCompact(benchmark::State &state) {
+    VsStatus status = makeStatus(state.range(0));
+    std::ofstream out("/dev/null");
+
+    for (auto _: state) {
+        printVsStatus(out, status, true);
+        out.flush();
+    }
+}
+BENCHMARK(BM_JsonWriterCompact)->Arg(1000);
@@ -0,0 +1,43 @@
+#include "levels.h"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+// Peak and RMS of the blocks recorded from the monitor sources, with SSE2 or NEON against one sample at a time.
+// A block of 4096 samples is half a second of the 8 kHz mono meters, or a 85 ms fragment of 48 kHz stereo.
+
+namespace {
+
+std::vector<float> makeSamples(size_t count) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> sample(-1, 1);
+
+    std::vector<float> samples(count);
+    for (float &value: samples) value = sample(random);
+    return samples;
+}
+
+void BM_LevelsVectorized(benchmark::State &state) {
+    std::vector<float> samples = makeSamples((size_t) state.range(0));
+    for (auto _: state) {
+        LevelAccumulator accumulator;
+        accumulator.add(samples.data(), samples.size());
+        benchmark::DoNotOptimize(accumulator);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_LevelsScalar(benchmark::State &state) {
+    std::vector<float> samples = makeSamples((size_t) state.range(0));
+    for (auto _: state) {
+        LevelAccumulator accumulator;
+        addSamplesScalar(accumulator, samples.data(), samples.size());
+        benchmark::DoNotOptimize(accumulator);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}
+
+BENCHMARK(BM_LevelsVectorized)->Arg(80)->Arg(4096);
+BENCHMARK(BM_LevelsScalar)->Arg(80)->Arg(4096);
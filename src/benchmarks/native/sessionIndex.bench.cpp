@@ -0,0 +1,107 @@
+#include "sessionIndex.h"
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+// Lookup of a session by ID among thousands of sessions, the old linear walk against the session index.
+// The linear walk mirrors what getSessionById did per session: fetch the ID into a heap buffer and compare it to the
+// requested one.
+
+namespace {
+
+struct SyntheticSession {
+    std::wstring rawId;
+};
+
+std::vector<SyntheticSession> makeSessions(size_t count) {
+    std::vector<SyntheticSession> sessions;
+    sessions.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        sessions.push_back({L"{0.0.0.00000000}.{8f2a5c61-0d1e-4f5b-9a3c-" + std::to_wstring(100000000000 + i) +
+                            L"}|\\Device\\HarddiskVolume3\\Program Files\\App" + std::to_wstring(i) +
+                            L"\\app.exe%b{00000000-0000-0000-0000-000000000000}"});
+    }
+    return sessions;
+}
+
+// Stand-in for GetSessionInstanceIdentifier, which hands out a newly allocated copy of the ID
+wchar_t *copyId(const std::wstring &id) {
+    auto *copy = new wchar_t[id.size() + 1];
+    std::wmemcpy(copy, id.c_str(), id.size() + 1);
+    return copy;
+}
+
+const SyntheticSession *findLinear(const std::vector<SyntheticSession> &sessions, const std::wstring &id) {
+    for (const SyntheticSession &session: sessions) {
+        wchar_t *rawId = copyId(session.rawId);
+        bool found = id == rawId;
+        delete[] rawId;
+
+        if (found) {
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+void releaseNothing(const SyntheticSession *&) {
+}
+
+void buildIndex(SessionIndex<const SyntheticSession *> &index, const std::vector<SyntheticSession> &sessions) {
+    for (const SyntheticSession &session: sessions) {
+        wchar_t *rawId = copyId(session.rawId);
+        index.insert(rawId, &session, releaseNothing);
+        delete[] rawId;
+    }
+    index.markBuilt();
+}
+
+// Looks up IDs spread over the whole list, so the linear walk averages half of it
+std::vector<std::wstring> makeLookups(const std::vector<SyntheticSession> &sessions) {
+    std::vector<std::wstring> lookups;
+    for (size_t i = 0; i < 16; i++) {
+        lookups.push_back(sessions[(sessions.size() - 1) * i / 15].rawId);
+    }
+    return lookups;
+}
+
+}
+
+static void BM_LinearLookup(benchmark::State &state) {
+    std::vector<SyntheticSession> sessions = makeSessions(state.range(0));
+    std::vector<std::wstring> lookups = makeLookups(sessions);
+
+    size_t i = 0;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(findLinear(sessions, lookups[i++ % lookups.size()]));
+    }
+}
+BENCHMARK(BM_LinearLookup)->Arg(1000)->Arg(4000)->Arg(16000);
+
+static void BM_IndexedLookup(benchmark::State &state) {
+    std::vector<SyntheticSession> sessions = makeSessions(state.range(0));
+    std::vector<std::wstring> lookups = makeLookups(sessions);
+    SessionIndex<const SyntheticSession *> index;
+    buildIndex(index, sessions);
+
+    size_t i = 0;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(index.find(lookups[i++ % lookups.size()]));
+    }
+}
+BENCHMARK(BM_IndexedLookup)->Arg(1000)->Arg(4000)->Arg(16000);
+
+// One-time cost paid by the first lookup, and again on a rebuild after a miss
+static void BM_IndexBuild(benchmark::State &state) {
+    std::vector<SyntheticSession> sessions = makeSessions(state.range(0));
+
+    for (auto _: state) {
+        SessionIndex<const SyntheticSession *> index;
+        buildIndex(index, sessions);
+        benchmark::DoNotOptimize(index.size());
+        index.clear(releaseNothing);
+    }
+}
+BENCHMARK(BM_IndexBuild)->Arg(1000)->Arg(4000)->Arg(16000);
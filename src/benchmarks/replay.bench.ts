@@ -0,0 +1,235 @@
+/**
+ * Status path of every backend, from outputs recorded at 5 to 500 nodes replayed in place of the tools, or end to end
+ * against a local PulseAudio server. The results are compared to a baseline so that regressions stand out.
+ *
+ * Usage: pnpm bench:replay [replay|e2e|record] [--update-baseline]
+ * replay (default): the commands are answered from the fixtures (see fixtures.ts) through the command queue, without
+ *   any process. The numbers only depend on the parsing and the status code of each backend, and are reproducible
+ *   on any platform.
+ * e2e: a null sink and sine streams on it are loaded in the running PulseAudio (or pipewire-pulse) server, so that
+ *   it has as many nodes as each size on top of its own, the real pactl is measured, then the modules are unloaded.
+ * record: the outputs of the tools installed on this machine replace the recorded fixtures.
+ *
+ * The iterations of each case run in rounds, and the p50 of the quietest round is compared to replay.baseline.json,
+ * the run failing when a case is more than REGRESSION_THRESHOLD (0.25 by default) slower. `--update-baseline` saves
+ * the results of the run as the new baseline, which is only meaningful on the machine it was recorded on. SIZES (e.g.
+ * `SIZES=5,50`) and ITERATIONS change the sizes and the iterations per case.
+ */
+import { existsSync, readFileSync, writeFileSync } from 'fs';
+import { join } from 'path';
+import { performance } from 'perf_hooks';
+import { createReplayExecutor, Fixture, FIXTURE_SIZES, loadFixture, recordFixtures } from '@/benchmarks/fixtures';
+import { execCommand, setCommandExecutor } from '@/utils/commands';
+import { fromPactlDevices, fromPactlSinkInputs, PactlDevice, PactlInfo, PactlSinkInput } from '@/utils/pactlJson';
+import { getJsonStatus, getTextStatus } from '@/platforms/linux/pulseaudio';
+import { linuxWireplumber } from '@/platforms/linux/wireplumber';
+import { linuxAmixer } from '@/platforms/linux/amixer';
+import { windowsExec } from '@/platforms/windows';
+
+const BASELINE_PATH = join(__dirname, 'replay.baseline.json');
+const ITERATIONS = Number.parseInt(process.env.ITERATIONS ?? '100', 10);
+const WARMUP = 10;
+// The iterations are split in rounds, the load of the machine rarely slows all of them down
+const ROUNDS = 5;
+const REGRESSION_THRESHOLD = Number.parseFloat(process.env.REGRESSION_THRESHOLD ?? '0.25');
+// Below this, a difference is timer and scheduling noise
+const MIN_REGRESSION_MS = 0.05;
+// Sine streams keep the server busy, the extreme size is left to SIZES
+const E2E_SIZES = [5, 50];
+
+type Mode = 'replay' | 'e2e';
+
+type Case = {
+  name: string;
+  call: () => Promise<unknown>;
+};
+
+type Result = {
+  mean: number;
+  // Of the quietest round, the one compared to the baseline
+  p50: number;
+  p99: number;
+};
+
+type Baseline = Partial<Record<Mode, Record<string, Result>>>;
+
+function percentile(sorted: number[], p: number) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+async function measure({ call }: Case): Promise<Result> {
+  for (let i = 0; i < Math.min(WARMUP, ITERATIONS); i++) await call();
+
+  const durations: number[] = [];
+  const medians: number[] = [];
+  for (let round = 0; round < ROUNDS; round++) {
+    const roundDurations: number[] = [];
+    for (let i = 0; i < Math.ceil(ITERATIONS / ROUNDS); i++) {
+      const start = performance.now();
+      await call();
+      roundDurations.push(performance.now() - start);
+    }
+    durations.push(...roundDurations);
+    medians.push(percentile(roundDurations.sort((a, b) => a - b), 0.5));
+  }
+  durations.sort((a, b) => a - b);
+
+  const mean = durations.reduce((sum, duration) => sum + duration, 0) / durations.length;
+  return { mean, p50: Math.min(...medians), p99: percentile(durations, 0.99) };
+}
+
+function getSizes(defaults: number[]) {
+  return process.env.SIZES ? process.env.SIZES.split(',').map((size) => Number.parseInt(size, 10)) : defaults;
+}
+
+function readBaseline(): Baseline {
+  return existsSync(BASELINE_PATH) ? JSON.parse(readFileSync(BASELINE_PATH, 'utf8')) : {};
+}
+
+function printHeader() {
+  const columns = ['mean ms', 'p50 ms', 'p99 ms', 'base p50', 'change'].map((column) => column.padStart(10)).join('');
+  console.log(`${'Case'.padEnd(32)}${columns}`);
+}
+
+/**
+ * Print a result against its baseline.
+ * @returns {boolean} Whether it regressed.
+ */
+function report(name: string, result: Result, baseline?: Result) {
+  const ms = (value: number) => value.toFixed(3).padStart(10);
+  let comparison = `${'-'.padStart(10)}${'-'.padStart(10)}`;
+  let regressed = false;
+
+  if (baseline) {
+    const change = (result.p50 - baseline.p50) / baseline.p50;
+    regressed = change > REGRESSION_THRESHOLD && result.p50 - baseline.p50 > MIN_REGRESSION_MS;
+    comparison = `${ms(baseline.p50)}${`${change >= 0 ? '+' : ''}${(change * 100).toFixed(1)}%`.padStart(10)}`;
+  }
+
+  console.log(`${name.padEnd(32)}${ms(result.mean)}${ms(result.p50)}${ms(result.p99)}${comparison}`
+    + (regressed ? '  REGRESSION' : ''));
+  return regressed;
+}
+
+function getReplayCases(fixture: Fixture): Case[] {
+  const parse = <T>(key: string) => JSON.parse(fixture.outputs.get(key)) as T;
+
+  return [
+    {
+      // The JSON parsing alone, without the command queue
+      name: 'pactl json parse',
+      call: async () => {
+        const info = parse<PactlInfo>('pactl -f json info');
+        fromPactlDevices('sink', parse<PactlDevice[]>('pactl -f json list sinks'), info.default_sink_name);
+        fromPactlDevices('source', parse<PactlDevice[]>('pactl -f json list sources'), info.default_source_name);
+        fromPactlSinkInputs(parse<PactlSinkInput[]>('pactl -f json list sink-inputs'));
+      },
+    },
+    { name: 'pactl json status', call: getJsonStatus },
+    { name: 'pactl text status', call: getTextStatus },
+    { name: 'wpctl status', call: () => linuxWireplumber.getStatus() },
+    { name: 'amixer volume', call: () => linuxAmixer.getGlobalVolume() },
+    { name: 'vsExec status', call: () => windowsExec.getStatus() },
+  ];
+}
+
+async function runReplay(baseline: Record<string, Result>, results: Record<string, Result>) {
+  let regressions = 0;
+
+  for (const size of getSizes(FIXTURE_SIZES)) {
+    const fixture = loadFixture(size);
+    const { sinks, sources, streams } = fixture.counts;
+    console.log(`\n${size} nodes: ${sinks} sinks, ${sources} sources, ${streams} streams`);
+    printHeader();
+
+    setCommandExecutor(createReplayExecutor(fixture));
+    for (const benchCase of getReplayCases(fixture)) {
+      const name = `${benchCase.name} (${size})`;
+      results[name] = await measure(benchCase);
+      if (report(name, results[name], baseline[name])) regressions++;
+    }
+    setCommandExecutor(null);
+  }
+
+  return regressions;
+}
+
+// A null sink with sine streams on it, the sink and its monitor counting as two nodes. The indexes of the modules are
+// added as they load, so that they are all unloaded even if one fails.
+async function loadNullSink(size: number, modules: string[]) {
+  modules.push((await execCommand('pactl', ['load-module', 'module-null-sink', 'sink_name=vs_bench'])).trim());
+  for (let i = 0; i < size - 2; i++) {
+    const args = ['load-module', 'module-sine', 'sink=vs_bench', `frequency=${200 + i}`];
+    modules.push((await execCommand('pactl', args)).trim());
+  }
+}
+
+async function unloadModules(modules: string[]) {
+  for (const module of modules.reverse()) {
+    await execCommand('pactl', ['unload-module', module]).catch((e) => console.error(e));
+  }
+}
+
+async function runEndToEnd(baseline: Record<string, Result>, results: Record<string, Result>) {
+  try {
+    await execCommand('pactl', ['info']);
+  } catch (e) {
+    throw new Error(`No PulseAudio server answers pactl: ${e}`);
+  }
+
+  let regressions = 0;
+  for (const size of getSizes(E2E_SIZES)) {
+    const modules: string[] = [];
+    try {
+      await loadNullSink(size, modules);
+      const status = await getTextStatus();
+      console.log(`\n${size} nodes added: ${status.sinks.length} sinks, ${status.sources.length} sources, `
+        + `${status.streams.length} streams in total`);
+      printHeader();
+
+      const cases: Case[] = [{ name: 'pactl text status', call: getTextStatus }];
+      if (await getJsonStatus()) cases.unshift({ name: 'pactl json status', call: getJsonStatus });
+
+      for (const benchCase of cases) {
+        const name = `${benchCase.name} (${size})`;
+        results[name] = await measure(benchCase);
+        if (report(name, results[name], baseline[name])) regressions++;
+      }
+    } finally {
+      await unloadModules(modules);
+    }
+  }
+
+  return regressions;
+}
+
+async function main() {
+  const mode = process.argv.slice(2).find((arg) => !arg.startsWith('--')) ?? 'replay';
+  const updateBaseline = process.argv.includes('--update-baseline');
+
+  if (mode === 'record') return recordFixtures();
+  if (mode !== 'replay' && mode !== 'e2e') throw new Error(`Unknown mode: ${mode}`);
+
+  const baseline = readBaseline();
+  const results: Record<string, Result> = {};
+  const regressions = mode === 'replay'
+    ? await runReplay(baseline[mode] ?? {}, results)
+    : await runEndToEnd(baseline[mode] ?? {}, results);
+
+  if (updateBaseline) {
+    // Microseconds are enough against the noise
+    const rounded = JSON.parse(JSON.stringify(results, (key, value) => typeof value === 'number'
+      ? Math.round(value * 1000) / 1000
+      : value));
+    writeFileSync(BASELINE_PATH, JSON.stringify({ ...baseline, [mode]: rounded }, null, 2) + '\n');
+    console.log(`\nBaseline saved to ${BASELINE_PATH}`);
+  } else if (regressions > 0) {
+    console.log(`\n${regressions} case(s) more than ${REGRESSION_THRESHOLD * 100}% slower than the baseline`);
+    process.exitCode = 1;
+  }
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
@@ -0,0 +1,53 @@
+/**
+ * Import time of the library and latency of its first calls on Linux, where the backend is selected on the first call.
+ *
+ * Usage: pnpm bench:startup [cold]
+ * With `cold`, the saved backend selection is removed first so the first call probes the servers. Without it, a
+ * previous run saved the selection and the first call reuses it. The former detection at import, running
+ * `command -v` through a shell for pactl and wpctl, is measured for comparison.
+ */
+import { execSync } from 'child_process';
+import { rmSync } from 'fs';
+import { performance } from 'perf_hooks';
+
+function elapsed(start: number) {
+  return `${(performance.now() - start).toFixed(2).padStart(10)} ms`;
+}
+
+async function main() {
+  const cold = process.argv[2] === 'cold';
+  const { getBackendCachePath } = await import('@/utils/backendSelection');
+  if (cold) rmSync(getBackendCachePath(), { force: true });
+
+  let start = performance.now();
+  for (const command of ['wpctl', 'pactl']) {
+    try {
+      execSync(`command -v ${command} 2>/dev/null`);
+    } catch (e) {
+      // Not installed, still a shell spawned
+    }
+  }
+  console.log(`${'former detection at import'.padEnd(36)}${elapsed(start)}`);
+
+  start = performance.now();
+  const { volumeControl } = await import('@/index');
+  console.log(`${'import'.padEnd(36)}${elapsed(start)}`);
+
+  for (const call of ['first', 'second']) {
+    start = performance.now();
+    try {
+      await volumeControl.getGlobalVolume();
+    } catch (e) {
+      // The selected backend has no server either, its failure is part of the latency
+    }
+    console.log(`${`${call} getGlobalVolume (${cold ? 'cold' : 'saved'})`.padEnd(36)}${elapsed(start)}`);
+  }
+
+  const { linuxSelection } = await import('@/platforms/linux');
+  console.log(`Selected backend: ${linuxSelection.getSelected()?.name}`);
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
@@ -0,0 +1,80 @@
+/**
+ * Wall time of the pactl status of the Linux implementation, from the JSON and the text output, against the former
+ * sequential queries.
+ *
+ * Usage: pnpm bench:status
+ * Measured against the running PulseAudio (or pipewire-pulse) server. Comparable numbers need a fixed set of nodes,
+ * e.g. a null sink with 50 sink inputs:
+ *   pactl load-module module-null-sink sink_name=bench
+ *   for i in $(seq 50); do pactl load-module module-sine sink=bench frequency=$((200 + i)); done
+ * Unload them afterwards with `pactl unload-module module-sine` and `pactl unload-module module-null-sink`.
+ */
+import { performance } from 'perf_hooks';
+import { execCommand } from '@/utils/commands';
+import { getJsonStatus, getTextStatus } from '@/platforms/linux/pulseaudio';
+
+const ITERATIONS = Number.parseInt(process.env.ITERATIONS ?? '50', 10);
+const WARMUP = 5;
+
+type Case = {
+  name: string;
+  call: () => Promise<unknown>;
+};
+
+function percentile(sorted: number[], p: number) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+async function measure({ name, call }: Case) {
+  for (let i = 0; i < Math.min(WARMUP, ITERATIONS); i++) await call();
+
+  const durations: number[] = [];
+  for (let i = 0; i < ITERATIONS; i++) {
+    const start = performance.now();
+    await call();
+    durations.push(performance.now() - start);
+  }
+  durations.sort((a, b) => a - b);
+
+  const mean = durations.reduce((sum, duration) => sum + duration, 0) / durations.length;
+  const ms = (value: number) => value.toFixed(2).padStart(10);
+  console.log(`${name.padEnd(36)}${ms(mean)}${ms(percentile(durations, 0.5))}${ms(percentile(durations, 0.99))}`);
+}
+
+// The queries of the former status, one after the other (their parsing is left out)
+async function getSequentialStatus() {
+  for (const args of [
+    ['info'],
+    ['list', 'sinks'],
+    ['get-default-sink'],
+    ['list', 'sources'],
+    ['get-default-source'],
+    ['list', 'sink-inputs'],
+  ]) {
+    await execCommand('pactl', args);
+  }
+}
+
+async function main() {
+  const status = await getJsonStatus();
+  const cases: Case[] = [
+    { name: 'former sequential text queries', call: getSequentialStatus },
+    { name: 'concurrent text status', call: getTextStatus },
+  ];
+  if (status) {
+    cases.push({ name: 'concurrent JSON status', call: getJsonStatus });
+    console.log(`${status.sinks.length} sinks, ${status.sources.length} sources, ${status.streams.length} streams`);
+  } else {
+    console.log('pactl does not print JSON, only the text output is measured');
+  }
+
+  console.log(`${'Status'.padEnd(36)}${'mean ms'.padStart(10)}${'p50 ms'.padStart(10)}${'p99 ms'.padStart(10)}`);
+  for (const benchCase of cases) {
+    await measure(benchCase);
+  }
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
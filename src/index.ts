@@ -2,6 +2,10 @@ import * as os from 'os';
 import { PlatformImplementation } from '@/types';
 import { linux } from '@/platforms/linux';
 import { windows } from '@/platforms/windows';
+import { CommandStats, getCommandStats } from '@/utils/commands';
+import { getParsedBytes, getProcessStarts, MethodLatencies, MethodMetrics } from '@/utils/metrics';
+import { StatusCache, StatusCacheStats } from '@/utils/statusCache';
+import { WriteCoalescer, WriteCoalescerStats } from '@/utils/writeCoalescer';
 
 const osType = os.type();
 
@@ -18,4 +22,68 @@ switch (osType) {
     throw new Error('Unsupported OS found: ' + osType);
 }
 
-export const volumeControl = platformImplementation;
\ No newline at end of file
+// Concurrent reads are shared, node reads answered from a recent status
+const statusCache = new StatusCache(platformImplementation);
+// vsExec and the addon apply a batch in a single call, the volume and mute of a node are then written together
+const writeCoalescer = new WriteCoalescer(statusCache.implementation, osType === 'Windows_NT');
+
+// Latency of the calls as seen by the caller, coalescing and cache included
+const latencies = new MethodLatencies(writeCoalescer.implementation);
+
+export type Metrics = {
+  // Latency of each method of the API called so far
+  methods: Record<string, MethodMetrics>;
+  // Runs of each command line tool
+  commands: Record<string, CommandStats>;
+  // Long-lived processes started, e.g. helper servers and subscriptions
+  processes: Record<string, number>;
+  // Bytes of output parsed, by format
+  parsedBytes: Record<string, number>;
+  statusCache: StatusCacheStats;
+  writes: WriteCoalescerStats;
+};
+
+export type VolumeControl = PlatformImplementation & {
+  getMetrics: () => Metrics;
+};
+
+export const volumeControl: VolumeControl = {
+  ...latencies.implementation,
+  getMetrics: () => ({
+    methods: latencies.getMetrics(),
+    commands: getCommandStats(),
+    processes: getProcessStarts(),
+    parsedBytes: getParsedBytes(),
+    statusCache: statusCache.getStats(),
+    writes: writeCoalescer.getStats(),
+  }),
+};
+
+/**
+ * Set for how long, in milliseconds, a status answers the node volume reads (200 by default, 0 to always read them).
+ */
+export function setStatusCacheMaxAge(maxAgeMs: number) {
+  statusCache.setMaxAge(maxAgeMs);
+}
+
+/**
+ * Number of status and node volume reads answered from the cache, read from the backend, or shared with a read in
+ * flight.
+ */
+export function getStatusCacheStats() {
+  return statusCache.getStats();
+}
+
+/**
+ * Number of volume and mute changes asked for, and of the backend writes applying them once coalesced.
+ */
+export function getWriteStats() {
+  return writeCoalescer.getStats();
+}
+
+export type { CommandExecutor, CommandStats } from '@/utils/commands';
+export type { LatencyBucket, MethodMetrics, TraceEvent, TraceHook } from '@/utils/metrics';
+export type { StatusCacheStats } from '@/utils/statusCache';
+export type { WriteCoalescerStats } from '@/utils/writeCoalescer';
+export { setTraceHook } from '@/utils/metrics';
+export { getCommandStats, resetCommandStats, setCommandConcurrency, setCommandExecutor } from '@/utils/commands';
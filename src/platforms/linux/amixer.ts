@@ -1,6 +1,66 @@
-import { PlatformImplementation } from '@/types';
+import { PlatformImplementation, VsNode } from '@/types';
 import { execCommand } from '@/utils/commands';
 import { throwCompatibilityError } from '@/utils/errors';
+import { countParsedBytes } from '@/utils/metrics';
+import { createWatch, Emit, KeepAlive, NodeStates } from '@/utils/watch';
+
+// amixer has no events, it is polled faster right after a change and slower and slower while nothing changes
+const WATCH_MIN_INTERVAL = 250;
+const WATCH_MAX_INTERVAL = 4000;
+
+async function getMasterNode(): Promise<VsNode> {
+  const stdout = await execCommand('amixer', ['sget', 'Master']);
+  if (!stdout) throw new Error('Failed to get volume');
+  countParsedBytes('amixer', stdout);
+
+  const channels = stdout.match(/(?<=\[)(\d+)(?=%\])/g);
+  if (!channels?.length) throw new Error('Failed to get volume');
+
+  const volume = Math.round(channels.reduce((acc, channel) => acc + parseInt(channel), 0) / channels.length);
+  const muted = stdout.match(/\[(on|off)\]/g)?.some((state) => state === '[off]') ?? false;
+
+  return { type: 'sink', id: 'Master', name: 'Master', volume, muted, isDefault: true };
+}
+
+function startWatch(emit: Emit, keepAlive: KeepAlive) {
+  const states = new NodeStates();
+  let interval = WATCH_MIN_INTERVAL;
+  let stopped = false;
+  let timer: NodeJS.Timeout | null = null;
+  let polled = false;
+
+  const poll = async () => {
+    keepAlive.release(timer);
+    try {
+      const node = await getMasterNode();
+      if (!polled) {
+        // Only the changes after the first reading are emitted
+        states.reset({ sinks: [node], sources: [], streams: [], defaultSink: node.id });
+        polled = true;
+      }
+
+      let changed = false;
+      states.update('sink', [node], (event) => {
+        changed = true;
+        emit(event);
+      }, [node.id]);
+      interval = changed ? WATCH_MIN_INTERVAL : Math.min(interval * 2, WATCH_MAX_INTERVAL);
+    } catch (e) {
+      console.error(e);
+      interval = WATCH_MAX_INTERVAL;
+    }
+
+    if (!stopped) timer = keepAlive.hold(setTimeout(poll, interval));
+  };
+
+  poll();
+
+  return () => {
+    stopped = true;
+    if (timer) clearTimeout(timer);
+    keepAlive.release(timer);
+  };
+}
 
 export const linuxAmixer: PlatformImplementation = {
   getPlatformCompatibility: () => ({
@@ -13,11 +73,15 @@ export const linuxAmixer: PlatformImplementation = {
     setSourceVolume: false,
     getStreamDestination: false,
     setStreamDestination: false,
+    watch: true,
+    watchEvents: false,
+    levels: false,
   }),
   async getGlobalVolume() {
 
     const stdout = await execCommand('amixer', ['sget', 'Master']);
     if (!stdout) throw new Error('Failed to get volume');
+    countParsedBytes('amixer', stdout);
 
     const channels = stdout.match(/(?<=\[)(\d+)(?=%\])/g); // This regex finds a digit(s) which is prefixed with "[" and suffixed with "%]"
     if (!channels.length) throw new Error('Failed to get volume');
@@ -36,6 +100,7 @@ export const linuxAmixer: PlatformImplementation = {
   isGlobalMuted: async function () {
     const stdout = await execCommand('amixer', ['sget', 'Master']);
     if (!stdout) throw new Error('Failed to get mute state');
+    countParsedBytes('amixer', stdout);
 
     return stdout
       .match(/\[(on|off)\]/)
@@ -49,4 +114,9 @@ export const linuxAmixer: PlatformImplementation = {
   setNodeVolumeById: throwCompatibilityError,
   setNodeMutedById: throwCompatibilityError,
   setStreamDestination: throwCompatibilityError,
+  applyBatch: throwCompatibilityError,
+  rampNodeVolume: throwCompatibilityError,
+  watch: createWatch(startWatch),
+  getLevels: throwCompatibilityError,
+  watchLevels: throwCompatibilityError,
 };
\ No newline at end of file
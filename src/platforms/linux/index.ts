@@ -1,24 +1,13 @@
-import * as child_process from 'child_process';
-import { PlatformImplementation } from '@/types';
 import { linuxWireplumber } from '@/platforms/linux/wireplumber';
 import { linuxPulseAudio } from '@/platforms/linux/pulseaudio';
 import { linuxAmixer } from '@/platforms/linux/amixer';
+import { BackendSelection, createLazyImplementation } from '@/utils/backendSelection';
 
-function testCommand(command: string): boolean {
-  try {
-    child_process.execSync(`command -v ${command} 2>/dev/null` +
-      ' && { echo >&1 wpctl; exit 0; }').toString();
-    return true;
-  } catch (e) {
-    return false;
-  }
-}
-
-const wpctlCompatible = testCommand('wpctl');
-const pactlCompatible = testCommand('pactl');
-
-export const linux: PlatformImplementation =
-  pactlCompatible ? linuxPulseAudio :
-    wpctlCompatible ? linuxWireplumber :
-      linuxAmixer;
+// In order of preference, amixer being used when no server answers
+export const linuxSelection = new BackendSelection([
+  { name: 'pulseaudio', command: 'pactl', probeArgs: ['info'], implementation: linuxPulseAudio },
+  { name: 'wireplumber', command: 'wpctl', probeArgs: ['status'], implementation: linuxWireplumber },
+  { name: 'amixer', command: 'amixer', probeArgs: ['sget', 'Master'], implementation: linuxAmixer },
+]);
 
+export const linux = createLazyImplementation(linuxSelection);
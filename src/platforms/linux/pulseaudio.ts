@@ -1,5 +1,11 @@
 import {
+  BatchOperation,
+  BatchResult,
+  LevelsListener,
+  NodeLevel,
   PlatformImplementation,
+  RampCurve,
+  RampResult,
   SinkStatus,
   SourceStatus,
   Status,
@@ -8,11 +14,38 @@ import {
   VsNode,
   VsNodeTypes,
   VsStreamNode,
+  WatchListener,
+  WatchOptions,
 } from '@/types';
-import { execCommand } from '@/utils/commands';
+import { execCommand, watchCommand } from '@/utils/commands';
+import { applyBatchWrites, getBatchIds, resolveBatchResults, toBatchInput } from '@/utils/batch';
+import { createWatch, Emit, KeepAlive, NodeStates } from '@/utils/watch';
+import ToElectronPath from '@/utils/toEletcronPath';
+import { requestJson, requestVolume, VsExecHelper } from '@/utils/vsExecHelper';
+import { join } from 'path';
+import { withAddon } from '@/utils/addon';
+import { getRampArgs, rampWithSteps, validateRamp } from '@/utils/ramp';
+import { getLevelsArgs } from '@/utils/levels';
+import { ListedNode, NodeTypeCache } from '@/utils/nodeTypeCache';
+import { CompatibilityError } from '@/utils/errors';
+import { countParsedBytes } from '@/utils/metrics';
+import {
+  fromPactlDevices,
+  fromPactlSinkInputs,
+  isPactlFormatUnsupported,
+  PactlDevice,
+  PactlInfo,
+  PactlSinkInput,
+} from '@/utils/pactlJson';
 
 const DEFAULT_SINK_NAME = '@DEFAULT_SINK@';
 const DEFAULT_SOURCE_NAME = '@DEFAULT_SOURCE@';
+// Events come in bursts, e.g. while a volume slider is dragged, they are handled together after this delay
+const WATCH_DEBOUNCE = 50;
+const WATCH_RESTART_DELAY = 1000;
+
+// Native helper built from src/platforms/windows against libpulse (see COMPILE.md), pactl is used without it
+const helper = new VsExecHelper(ToElectronPath(join(__dirname, 'vsPulse')));
 
 function extractVolume(stdout: string) {
   const nodeRegex = /[a-zA-Z0-9\-]+:\s*\S* \/\s*(\d{1,3})% \/\s+\S+ dB/g;
@@ -39,13 +72,7 @@ function extractMuted(stdout: string) {
 }
 
 async function getTypeVolumeById(type: VsNodeTypes, id: string) {
-  if (type === 'stream') {
-    const streamStatus = await getStreamStatus();
-    const stream = streamStatus.streams.find((stream) => stream.id === id);
-    if (!stream) throw new Error('Failed to get volume');
-
-    return stream.volume;
-  }
+  if (type === 'stream') return (await getTypeVolumeInfoById(type, id)).volume;
 
   const stdout = await execCommand('pactl', [`get-${type}-volume`, id]);
   if (!stdout) throw new Error('Failed to get volume');
@@ -61,13 +88,7 @@ async function setTypeVolumeById(type: VsNodeTypes, id: string, volume: number)
 }
 
 async function getTypeMutedById(type: VsNodeTypes, id: string) {
-  if (type === 'stream') {
-    const streamStatus = await getStreamStatus();
-    const stream = streamStatus.streams.find((stream) => stream.id === id);
-    if (!stream) throw new Error('Failed to get volume');
-
-    return stream.muted;
-  }
+  if (type === 'stream') return (await getTypeVolumeInfoById(type, id)).muted;
 
   const stdout = await execCommand('pactl', [`get-${type}-mute`, id]);
   if (!stdout) throw new Error('Failed to get volume');
@@ -82,6 +103,7 @@ async function setTypeMuteById(type: VsNodeTypes, id: string, muted: boolean) {
 }
 
 function exportStatusOutput(stdout: string) {
+  countParsedBytes('pactl', stdout);
   const lines = stdout.split('\n');
   const linesWithLevel = lines.map((line) => {
     const startSpaces = line.search(/\S/);
@@ -136,31 +158,18 @@ function exportStatusOutput(stdout: string) {
   return obj;
 }
 
-async function getSinkStatus(): Promise<SinkStatus> {
-  const stdout = await execCommand('pactl', ['list', 'sinks']);
-  if (!stdout) return { sinks: [] };
-
-  const stdoutDefaultSink = await execCommand('pactl', ['get-default-sink']);
-  if (!stdoutDefaultSink) throw new Error('Failed to get default sink');
-  const defaultSinkName = stdoutDefaultSink.trim();
-
-  let defaultSink: string | undefined = undefined;
-
+function exportDeviceNodes(stdout: string, type: 'sink' | 'source', defaultName?: string): VsNode[] {
   const obj = exportStatusOutput(stdout);
-  const sinks: VsNode[] = Object.keys(obj).map((key) => {
+  return Object.keys(obj).map((key) => {
     const properties = obj[key];
     const name = properties['Description'];
     const volume = extractVolume(properties['Volume']);
     const muted = properties['Mute'] === 'yes';
-    const isDefault = properties['Name'] === defaultSinkName;
+    const isDefault = properties['Name'] === defaultName;
     const id = key.split(' ').at(-1).substring(1);
 
-    if (isDefault) {
-      defaultSink = id;
-    }
-
     return {
-      type: 'sink',
+      type,
       id,
       name,
       volume,
@@ -168,49 +177,39 @@ async function getSinkStatus(): Promise<SinkStatus> {
       isDefault,
     };
   });
+}
+
+async function getSinkStatus(): Promise<SinkStatus> {
+  const [stdout, stdoutDefaultSink] = await Promise.all([
+    execCommand('pactl', ['list', 'sinks']),
+    execCommand('pactl', ['get-default-sink']).catch(() => ''),
+  ]);
+  if (!stdout) return { sinks: [] };
+  if (!stdoutDefaultSink) throw new Error('Failed to get default sink');
+  const defaultSinkName = stdoutDefaultSink.trim();
+
+  const sinks = exportDeviceNodes(stdout, 'sink', defaultSinkName);
 
   return {
     sinks,
-    defaultSink,
+    defaultSink: sinks.find((sink) => sink.isDefault)?.id,
   };
 }
 
 async function getSourceStatus(): Promise<SourceStatus> {
-  const stdout = await execCommand('pactl', ['list', 'sources']);
+  const [stdout, stdoutDefaultSource] = await Promise.all([
+    execCommand('pactl', ['list', 'sources']),
+    execCommand('pactl', ['get-default-source']).catch(() => ''),
+  ]);
   if (!stdout) return { sources: [] };
-
-  const stdoutDefaultSource = await execCommand('pactl', ['get-default-source']);
   if (!stdoutDefaultSource) throw new Error('Failed to get default source');
   const defaultSourceName = stdoutDefaultSource.trim();
 
-  let defaultSource: string | undefined = undefined;
-
-  const obj = exportStatusOutput(stdout);
-  const sources: VsNode[] = Object.keys(obj).map((key) => {
-    const properties = obj[key];
-    const name = properties['Description'];
-    const volume = extractVolume(properties['Volume']);
-    const muted = properties['Mute'] === 'yes';
-    const isDefault = properties['Name'] === defaultSourceName;
-    const id = key.split(' ').at(-1).substring(1);
-
-    if (isDefault) {
-      defaultSource = id;
-    }
-
-    return {
-      type: 'source',
-      id,
-      name,
-      volume,
-      muted,
-      isDefault,
-    };
-  });
+  const sources = exportDeviceNodes(stdout, 'source', defaultSourceName);
 
   return {
     sources,
-    defaultSource,
+    defaultSource: sources.find((source) => source.isDefault)?.id,
   };
 }
 
@@ -243,34 +242,118 @@ async function getStreamStatus(): Promise<StreamStatus> {
   };
 }
 
-async function isType(id: string, type: VsNodeTypes) {
+const SUBSCRIBE_TYPES: Record<string, VsNodeTypes> = {
+  'sink': 'sink',
+  'source': 'source',
+  'sink-input': 'stream',
+};
+
+async function listShortNodesOfType(type: VsNodeTypes): Promise<ListedNode[]> {
   const convertedType = type === 'stream' ? 'sink-input' : type;
 
   const stdout = await execCommand('pactl', ['list', 'short', convertedType + 's']);
-  if (!stdout) return false;
+  if (!stdout) return [];
 
-  return stdout.split('\n').map((line) => line.split('\t')[0]).includes(id);
+  countParsedBytes('pactl', stdout);
+  return stdout.split('\n').filter((line) => line.trim()).map((line) => ({ id: line.split('\t')[0] }));
 }
 
-async function getNodeTypeById(id: string) {
-  if (await isType(id, 'sink')) {
-    return 'sink';
-  } else if (await isType(id, 'source')) {
-    return 'source';
-  } else if (await isType(id, 'stream')) {
-    return 'stream';
-  } else {
-    return null;
+// Types of the nodes by ID, in the order pactl lookups always resolved them, so a lookup only spawns on a miss
+const nodeTypes = new NodeTypeCache(['sink', 'source', 'stream'], listShortNodesOfType);
+let nodeTypesSubscribed = false;
+let nodeTypesSubscriptionExit = 0;
+
+// Added and removed nodes are dropped from the cache as pactl subscribe reports them. The subscription doesn't keep
+// the process alive, and is started again by a later lookup if it exits.
+function followNodeTypes() {
+  if (nodeTypesSubscribed || Date.now() - nodeTypesSubscriptionExit < WATCH_RESTART_DELAY) return;
+
+  nodeTypesSubscribed = true;
+  watchCommand('pactl', ['subscribe'], (line) => {
+    const match = line.match(/^Event '(new|remove)' on ([a-z-]+)/);
+    if (match && SUBSCRIBE_TYPES[match[2]]) nodeTypes.invalidate(SUBSCRIBE_TYPES[match[2]]);
+  }, () => {
+    nodeTypesSubscribed = false;
+    nodeTypesSubscriptionExit = Date.now();
+    nodeTypes.invalidate();
+  }, false);
+}
+
+function withNodeType<T>(id: string, operation: (type: VsNodeTypes) => Promise<T>) {
+  followNodeTypes();
+  return nodeTypes.run(id, operation);
+}
+
+function fillNodeTypes(type: VsNodeTypes, nodes: VsNode[]) {
+  nodeTypes.fill(type, nodes.map((node) => ({ id: node.id, name: node.name })));
+}
+
+// Whether pactl prints JSON, unknown until the first JSON query answers
+let pactlJson: boolean | undefined;
+
+/**
+ * Run a pactl query with JSON output.
+ * @returns {Promise<T | undefined>} The parsed output, undefined when pactl only prints text (older than 16).
+ */
+async function execPactlJson<T>(args: string[]): Promise<T | undefined> {
+  if (pactlJson === false) return undefined;
+
+  let stdout: string;
+  try {
+    stdout = await execCommand('pactl', ['-f', 'json', ...args]);
+  } catch (e) {
+    if (!isPactlFormatUnsupported(e)) throw e;
+    pactlJson = false;
+    return undefined;
+  }
+  pactlJson = true;
+
+  countParsedBytes('pactl json', stdout);
+  try {
+    return JSON.parse(stdout) as T;
+  } catch (e) {
+    // Some releases print invalid JSON for unusual property values, the text output is parsed instead
+    return undefined;
   }
 }
 
-async function getStatus(): Promise<Status> {
-  const stdout = await execCommand('pactl', ['info']);
-  if (!stdout) throw new Error('Failed to get status');
+/**
+ * Status from the JSON output, its queries are independent and run concurrently. The defaults come with the server
+ * info, instead of a query each.
+ * @returns {Promise<Status | undefined>} The status, undefined when pactl doesn't print JSON.
+ */
+export async function getJsonStatus(): Promise<Status | undefined> {
+  const [info, sinks, sources, sinkInputs] = await Promise.all([
+    execPactlJson<PactlInfo>(['info']),
+    execPactlJson<PactlDevice[]>(['list', 'sinks']),
+    execPactlJson<PactlDevice[]>(['list', 'sources']),
+    execPactlJson<PactlSinkInput[]>(['list', 'sink-inputs']),
+  ]);
+  if (!info || !sinks || !sources || !sinkInputs) return undefined;
+
+  const sinkNodes = fromPactlDevices('sink', sinks, info.default_sink_name);
+  const sourceNodes = fromPactlDevices('source', sources, info.default_source_name);
 
-  const sinkStatus = await getSinkStatus();
-  const sourceStatus = await getSourceStatus();
-  const streamStatus = await getStreamStatus();
+  return {
+    streams: fromPactlSinkInputs(sinkInputs),
+    sinks: sinkNodes,
+    sources: sourceNodes,
+    defaultSink: sinkNodes.find((sink) => sink.isDefault)?.id,
+    defaultSource: sourceNodes.find((source) => source.isDefault)?.id,
+  };
+}
+
+/**
+ * Status from the text output of pactl, for versions without JSON output.
+ */
+export async function getTextStatus(): Promise<Status> {
+  const [stdout, sinkStatus, sourceStatus, streamStatus] = await Promise.all([
+    execCommand('pactl', ['info']),
+    getSinkStatus(),
+    getSourceStatus(),
+    getStreamStatus(),
+  ]);
+  if (!stdout) throw new Error('Failed to get status');
 
   return {
     streams: streamStatus.streams,
@@ -281,11 +364,184 @@ async function getStatus(): Promise<Status> {
   };
 }
 
+async function getStatus(): Promise<Status> {
+  const status = await getJsonStatus() ?? await getTextStatus();
+  fillNodeTypes('sink', status.sinks);
+  fillNodeTypes('source', status.sources);
+  fillNodeTypes('stream', status.streams);
+
+  return status;
+}
+
+async function listJsonNodesOfType(type: VsNodeTypes): Promise<VsNode[] | undefined> {
+  if (type === 'stream') {
+    const sinkInputs = await execPactlJson<PactlSinkInput[]>(['list', 'sink-inputs']);
+    return sinkInputs && fromPactlSinkInputs(sinkInputs);
+  }
+
+  const devices = await execPactlJson<PactlDevice[]>(['list', type + 's']);
+  return devices && fromPactlDevices(type, devices);
+}
+
+async function listTextNodesOfType(type: VsNodeTypes): Promise<VsNode[]> {
+  if (type === 'stream') return (await getStreamStatus()).streams;
+
+  const stdout = await execCommand('pactl', ['list', type + 's']);
+  return stdout ? exportDeviceNodes(stdout, type) : [];
+}
+
+async function listNodesOfType(type: VsNodeTypes): Promise<VsNode[]> {
+  const nodes = await listJsonNodesOfType(type) ?? await listTextNodesOfType(type);
+
+  fillNodeTypes(type, nodes);
+  return nodes;
+}
+
+// Volume and mute from a single listing of the type, instead of a query for each
+async function getTypeVolumeInfoById(type: VsNodeTypes, id: string): Promise<VolumeInfo> {
+  const node = (await listNodesOfType(type)).find((node) => node.id === id);
+  // Recognized by the node type cache, which then looks for the node in the other types
+  if (!node) throw new Error('Failed to get volume: node not found');
+
+  return { volume: node.volume, muted: node.muted };
+}
+
+async function applyBatch(operations: BatchOperation[]) {
+  const ids = getBatchIds(operations);
+  const nodes = new Map<string, VsNode>();
+
+  // One listing per type instead of a type lookup and a get per operation, in the same order as the node type cache
+  for (const type of ['sink', 'source', 'stream'] as VsNodeTypes[]) {
+    if (ids.every((id) => nodes.has(id))) break;
+
+    for (const node of await listNodesOfType(type)) {
+      if (ids.includes(node.id) && !nodes.has(node.id)) nodes.set(node.id, node);
+    }
+  }
+
+  const errors = await applyBatchWrites(
+    operations,
+    nodes,
+    (id, volume) => setTypeVolumeById(nodes.get(id).type, id, volume),
+    (id, muted) => setTypeMuteById(nodes.get(id).type, id, muted),
+  );
+
+  return resolveBatchResults(operations, nodes, errors);
+}
+
+// The type is resolved once for all the steps
+async function rampNodeVolume(id: string, volume: number, durationMs: number, curve: RampCurve) {
+  followNodeTypes();
+  const node = await nodeTypes.resolve(id);
+  if (!node) throw new Error('Failed to get node type');
+  const type = node.type;
+
+  return rampWithSteps(
+    id, volume, durationMs, curve,
+    (id) => getTypeVolumeById(type, id),
+    (id, volume) => setTypeVolumeById(type, id, volume),
+  );
+}
+
 async function setStreamDestination(streamId: string, destinationId: string) {
   await execCommand('pactl', ['move-sink-input', streamId, destinationId]);
 }
 
-export const linuxPulseAudio: PlatformImplementation = {
+function startWatch(emit: Emit, keepAlive: KeepAlive) {
+  const states = new NodeStates();
+  const dirty = new Map<VsNodeTypes, Set<string>>();
+  let serverChanged = false;
+  let ready = false;
+  let stopped = false;
+  let flushTimer: NodeJS.Timeout | null = null;
+  let restartTimer: NodeJS.Timeout | null = null;
+  let updates = Promise.resolve();
+  let stopSubscribe: () => void;
+
+  // Re-list only the types with affected nodes, the updates are chained so their events stay in order
+  const flush = () => {
+    keepAlive.release(flushTimer);
+    flushTimer = null;
+    const types = [...dirty];
+    const server = serverChanged;
+    dirty.clear();
+    serverChanged = false;
+
+    updates = updates.then(async () => {
+      if (server) {
+        states.updateDefault('sink', (await getSinkStatus()).defaultSink, emit);
+        states.updateDefault('source', (await getSourceStatus()).defaultSource, emit);
+      }
+
+      for (const [type, ids] of types) {
+        states.update(type, await listNodesOfType(type), emit, ids);
+      }
+    }).catch((e) => console.error(e));
+  };
+
+  const schedule = () => {
+    if (ready && !stopped && !flushTimer) flushTimer = keepAlive.hold(setTimeout(flush, WATCH_DEBOUNCE));
+  };
+
+  const onLine = (line: string) => {
+    const match = line.match(/^Event '(new|change|remove)' on ([a-z-]+)(?: #(\d+))?/);
+    if (!match) return;
+
+    const [, , facility, id] = match;
+    if (facility === 'server') {
+      serverChanged = true;
+    } else if (SUBSCRIBE_TYPES[facility] && id !== undefined) {
+      const type = SUBSCRIBE_TYPES[facility];
+      if (!dirty.has(type)) dirty.set(type, new Set());
+      dirty.get(type).add(id);
+    } else {
+      return;
+    }
+
+    schedule();
+  };
+
+  const subscribe = () => {
+    stopSubscribe = watchCommand('pactl', ['subscribe'], onLine, () => {
+      if (stopped) return;
+
+      // Changes made while the subscription was down are caught by comparing the whole status once restarted
+      ready = false;
+      restartTimer = keepAlive.hold(setTimeout(() => {
+        keepAlive.release(restartTimer);
+        restartTimer = null;
+        subscribe();
+        updates = updates.then(async () => states.updateStatus(await getStatus(), emit)).catch((e) => console.error(e));
+        updates.then(() => {
+          ready = true;
+          schedule();
+        });
+      }, WATCH_RESTART_DELAY));
+    }, keepAlive);
+  };
+
+  // Subscribed before reading the status, so no change is missed in between
+  subscribe();
+  updates = getStatus().then((status) => states.reset(status)).catch((e) => console.error(e));
+  updates.then(() => {
+    ready = true;
+    schedule();
+  });
+
+  return () => {
+    stopped = true;
+    if (flushTimer) clearTimeout(flushTimer);
+    if (restartTimer) clearTimeout(restartTimer);
+    keepAlive.release(flushTimer);
+    keepAlive.release(restartTimer);
+    stopSubscribe();
+  };
+}
+
+const pactlWatch = createWatch(startWatch);
+
+// vsPulse or pactl implementation, used as is when the native addon isn't built
+export const linuxPulseAudioExec: PlatformImplementation = {
   getPlatformCompatibility: () => ({
     status: true,
     listStreams: true,
@@ -296,40 +552,104 @@ export const linuxPulseAudio: PlatformImplementation = {
     setSourceVolume: true,
     getStreamDestination: true,
     setStreamDestination: true,
+    watch: true,
+    watchEvents: true,
+    // Metered by record streams of the helper, pactl has nothing like it
+    levels: helper.hasLevels(),
   }),
   async getGlobalVolume() {
-    return getTypeVolumeById('sink', DEFAULT_SINK_NAME);
+    return helper.run(
+      (server) => requestVolume(server, ['getGlobalVolume']),
+      () => getTypeVolumeById('sink', DEFAULT_SINK_NAME),
+    );
   },
   async setGlobalVolume(volume: number) {
-    await setTypeVolumeById('sink', DEFAULT_SINK_NAME, volume);
+    if (volume < 0 || volume > 100) throw new Error('Volume must be between 0 and 100');
+
+    await helper.run(
+      (server) => server.request(['setGlobalVolume', volume.toString()]),
+      () => setTypeVolumeById('sink', DEFAULT_SINK_NAME, volume),
+    );
   },
   isGlobalMuted: async function () {
-    return getTypeMutedById('sink', DEFAULT_SINK_NAME);
+    return helper.run(
+      async (server) => (await server.request(['isGlobalMuted'])).trim() === '1',
+      () => getTypeMutedById('sink', DEFAULT_SINK_NAME),
+    );
   },
   async setGlobalMuted(muted: boolean) {
-    await setTypeMuteById('sink', DEFAULT_SINK_NAME, muted);
+    await helper.run(
+      (server) => server.request(['setGlobalMuted', muted ? '1' : '0']),
+      () => setTypeMuteById('sink', DEFAULT_SINK_NAME, muted),
+    );
+  },
+  async getStatus() {
+    return helper.run((server) => requestJson<Status>(server, ['getStatus']), getStatus);
   },
-  getStatus: getStatus,
   async getNodeVolumeInfoById(id: string): Promise<VolumeInfo> {
-    const type = await getNodeTypeById(id);
-    if (!type) throw new Error('Failed to get node type');
-
-    return {
-      volume: await getTypeVolumeById(type, id),
-      muted: await getTypeMutedById(type, id),
-    };
+    return helper.run(async (server) => {
+      // Pipelined, both answers come back from the same process
+      const [volume, muted] = await Promise.all([
+        requestVolume(server, ['getVolumeById', id]),
+        server.request(['isMutedById', id]),
+      ]);
+
+      return { volume, muted: muted.trim() === '1' };
+    }, () => withNodeType(id, (type) => getTypeVolumeInfoById(type, id)));
   },
   async setNodeVolumeById(id: string, volume: number) {
-    const type = await getNodeTypeById(id);
-    if (!type) throw new Error('Failed to get node type');
+    if (volume < 0 || volume > 100) throw new Error('Volume must be between 0 and 100');
 
-    await setTypeVolumeById(type, id, volume);
+    await helper.run(async (server) => {
+      await server.request(['setVolumeById', id, volume.toString()]);
+    }, async () => {
+      await withNodeType(id, (type) => setTypeVolumeById(type, id, volume));
+    });
   },
   async setNodeMutedById(id: string, muted: boolean) {
-    const type = await getNodeTypeById(id);
-    if (!type) throw new Error('Failed to get node type');
+    await helper.run(async (server) => {
+      await server.request(['setMutedById', id, muted ? '1' : '0']);
+    }, async () => {
+      await withNodeType(id, (type) => setTypeMuteById(type, id, muted));
+    });
+  },
+  async setStreamDestination(streamId: string, destinationId: string) {
+    await helper.run(
+      async (server) => {
+        await server.request(['setStreamDestination', streamId, destinationId]);
+      },
+      () => setStreamDestination(streamId, destinationId),
+    );
+  },
+  async applyBatch(operations: BatchOperation[]) {
+    return helper.run(
+      (server) => requestJson<BatchResult[]>(server, ['batch', operations.length.toString()], toBatchInput(operations)),
+      () => applyBatch(operations),
+    );
+  },
+  async rampNodeVolume(id: string, volume: number, durationMs: number, curve: RampCurve = 'linear') {
+    validateRamp(volume, durationMs, curve);
 
-    await setTypeMuteById(type, id, muted);
+    return helper.run(
+      (server) => requestJson<RampResult>(server, getRampArgs(id, volume, durationMs, curve)),
+      () => rampNodeVolume(id, volume, durationMs, curve),
+    );
   },
-  setStreamDestination,
-};
\ No newline at end of file
+  watch(listener: WatchListener, options?: WatchOptions) {
+    // The helper subscribes to the server itself, pactl subscribe is only used without it
+    return helper.watch(listener, pactlWatch, options);
+  },
+  async getLevels(intervalMs?: number) {
+    const args = getLevelsArgs(intervalMs);
+
+    return helper.run(
+      (server) => requestJson<NodeLevel[]>(server, args),
+      () => Promise.reject(new CompatibilityError()),
+    );
+  },
+  watchLevels(listener: LevelsListener, rateHz?: number) {
+    return helper.watchLevels(listener, rateHz);
+  },
+};
+
+export const linuxPulseAudio = withAddon(linuxPulseAudioExec, 'pulse');
@@ -1,6 +1,35 @@
-import { VsNode, VsNodeTypes, PlatformImplementation, Status, VolumeInfo, VsStreamNode } from '@/types';
-import { execCommand } from '@/utils/commands';
+import {
+  BatchOperation,
+  BatchResult,
+  VsNode,
+  VsNodeTypes,
+  PlatformImplementation,
+  RampCurve,
+  RampResult,
+  Status,
+  VolumeInfo,
+  VsStreamNode,
+  WatchListener,
+  WatchOptions,
+} from '@/types';
+import { execCommand, mapWithConcurrency, watchCommand } from '@/utils/commands';
 import { throwCompatibilityError } from '@/utils/errors';
+import { countParsedBytes } from '@/utils/metrics';
+import { applyBatchWrites, getBatchIds, resolveBatchResults, toBatchInput } from '@/utils/batch';
+import { createWatch, Emit, KeepAlive, NodeStates } from '@/utils/watch';
+import ToElectronPath from '@/utils/toEletcronPath';
+import { requestJson, requestVolume, VsExecHelper } from '@/utils/vsExecHelper';
+import { join } from 'path';
+import { getRampArgs, rampWithSteps, validateRamp } from '@/utils/ramp';
+
+// Events come in bursts, e.g. while a volume slider is dragged, they are handled together after this delay
+const WATCH_DEBOUNCE = 50;
+const WATCH_RESTART_DELAY = 1000;
+// Stream volumes are a query each, a status of many streams leaves slots of the command queue to other calls
+const STREAM_QUERY_CONCURRENCY = 4;
+
+// Native helper built from src/platforms/windows against libpipewire (see COMPILE.md), wpctl is used without it
+const helper = new VsExecHelper(ToElectronPath(join(__dirname, 'vsPipewire')));
 
 const SUB_SECTION_TO_EXTRACT: {
   name: string;
@@ -64,6 +93,7 @@ function exportStreams(lines: string[]) {
 }
 
 function exportStatus(stdout: string) {
+  countParsedBytes('wpctl', stdout);
   const status: Status = {
     sinks: [],
     sources: [],
@@ -139,7 +169,7 @@ async function updateStreamStatus(stream: VsNode) {
 }
 
 async function updateStreamsStatus(streams: VsNode[]) {
-  await Promise.all(streams.map(updateStreamStatus));
+  await mapWithConcurrency(streams, STREAM_QUERY_CONCURRENCY, updateStreamStatus);
 }
 
 async function getStatus() {
@@ -162,6 +192,148 @@ async function setNodeMutedById(id: string, muted: boolean) {
   await execCommand('wpctl', ['set-mute', id, muted ? '1' : '0']);
 }
 
+async function applyBatch(operations: BatchOperation[]) {
+  const ids = getBatchIds(operations);
+  const nodes = new Map<string, VolumeInfo>();
+
+  // A single status gives the volume of every sink and source, worth it as soon as there is more than one node
+  if (ids.length > 1) {
+    const stdout = await execCommand('wpctl', ['status']);
+    if (!stdout) throw new Error('Failed to get status');
+
+    const status = exportStatus(stdout);
+    for (const node of [...status.sinks, ...status.sources]) {
+      if (ids.includes(node.id)) nodes.set(node.id, node);
+    }
+  }
+
+  // Stream volumes are not part of the status, they are read one by one
+  await Promise.all(ids.filter((id) => !nodes.has(id)).map(async (id) => {
+    try {
+      nodes.set(id, await getNodeVolumeInfoById(id));
+    } catch (e) {
+      // Not found, reported in the results
+    }
+  }));
+
+  const errors = await applyBatchWrites(operations, nodes, setNodeVolumeById, setNodeMutedById);
+
+  return resolveBatchResults(operations, nodes, errors);
+}
+
+function startWatch(emit: Emit, keepAlive: KeepAlive) {
+  const states = new NodeStates();
+  const dirty = new Set<string>();
+  let resync = false;
+  let ready = false;
+  let stopped = false;
+  let flushTimer: NodeJS.Timeout | null = null;
+  let restartTimer: NodeJS.Timeout | null = null;
+  let updates = Promise.resolve();
+  let stopMonitor: () => void;
+  // pw-mon prints each event as a block: a header line, then the ID and the type of the object
+  let blockEvent: string | null = null;
+  let blockId: string | null = null;
+
+  // Changed nodes only need their volume, added and removed ones a whole status to know their type and name
+  const flush = () => {
+    keepAlive.release(flushTimer);
+    flushTimer = null;
+    const ids = [...dirty];
+    const all = resync;
+    dirty.clear();
+    resync = false;
+
+    updates = updates.then(async () => {
+      if (all) {
+        states.updateStatus(await getStatus(), emit);
+        return;
+      }
+
+      const volumeInfos = await Promise.all(ids.map((id) => getNodeVolumeInfoById(id).catch(() => null)));
+      ids.forEach((id, i) => {
+        const node = states.find(id);
+        const volumeInfo = volumeInfos[i];
+        if (node && volumeInfo) states.updateVolume(node.type, id, volumeInfo.volume, volumeInfo.muted, emit);
+      });
+    }).catch((e) => console.error(e));
+  };
+
+  const schedule = () => {
+    if (ready && !stopped && !flushTimer) flushTimer = keepAlive.hold(setTimeout(flush, WATCH_DEBOUNCE));
+  };
+
+  const onLine = (line: string) => {
+    const header = line.match(/^(added|changed|removed):/);
+    if (header) {
+      blockEvent = header[1];
+      blockId = null;
+      return;
+    }
+
+    const id = line.match(/^\s+id: (\d+)/);
+    if (id) {
+      blockId = id[1];
+      // Removed blocks have no type, only the known nodes matter
+      if (blockEvent === 'removed' && states.find(blockId)) {
+        resync = true;
+        schedule();
+      }
+      return;
+    }
+
+    const type = line.match(/^\s+type: PipeWire:Interface:(\w+)/);
+    if (!type || !blockId) return;
+
+    if (type[1] === 'Metadata' || (type[1] === 'Node' && blockEvent === 'added')) {
+      // Metadata holds the default nodes
+      resync = true;
+    } else if (type[1] === 'Node' && blockEvent === 'changed' && states.find(blockId)) {
+      dirty.add(blockId);
+    } else {
+      return;
+    }
+
+    schedule();
+  };
+
+  const monitor = () => {
+    stopMonitor = watchCommand('pw-mon', [], onLine, () => {
+      if (stopped) return;
+
+      // Changes made while the monitor was down are caught by the whole status compared once restarted
+      ready = false;
+      restartTimer = keepAlive.hold(setTimeout(() => {
+        keepAlive.release(restartTimer);
+        restartTimer = null;
+        resync = true;
+        monitor();
+        ready = true;
+        schedule();
+      }, WATCH_RESTART_DELAY));
+    }, keepAlive);
+  };
+
+  // Monitored before reading the status, so no change is missed in between
+  monitor();
+  updates = getStatus().then((status) => states.reset(status)).catch((e) => console.error(e));
+  updates.then(() => {
+    ready = true;
+    schedule();
+  });
+
+  return () => {
+    stopped = true;
+    if (flushTimer) clearTimeout(flushTimer);
+    if (restartTimer) clearTimeout(restartTimer);
+    keepAlive.release(flushTimer);
+    keepAlive.release(restartTimer);
+    stopMonitor();
+  };
+}
+
+const wpctlWatch = createWatch(startWatch);
+
 export const linuxWireplumber: PlatformImplementation = {
   getPlatformCompatibility: () => ({
     status: true,
@@ -171,24 +343,90 @@ export const linuxWireplumber: PlatformImplementation = {
     setStreamVolume: true,
     setSinkVolume: true,
     setSourceVolume: true,
-    getStreamDestination: false,
-    setStreamDestination: false,
+    // Links are only followed by the helper
+    getStreamDestination: helper.isAvailable(),
+    setStreamDestination: helper.isAvailable(),
+    watch: true,
+    watchEvents: true,
+    // vsPipewire has no meters, vsPulse meters PipeWire through pipewire-pulse
+    levels: false,
   }),
   async getGlobalVolume() {
-    return getNodeVolumeInfoById('@DEFAULT_AUDIO_SINK@').then((volumeInfo) => volumeInfo.volume);
+    return helper.run(
+      (server) => requestVolume(server, ['getGlobalVolume']),
+      () => getNodeVolumeInfoById('@DEFAULT_AUDIO_SINK@').then((volumeInfo) => volumeInfo.volume),
+    );
   },
   async setGlobalVolume(volume: number) {
-    await setNodeVolumeById('@DEFAULT_AUDIO_SINK@', volume);
+    if (volume < 0 || volume > 100) throw new Error('Volume must be between 0 and 100');
+
+    await helper.run(async (server) => {
+      await server.request(['setGlobalVolume', volume.toString()]);
+    }, () => setNodeVolumeById('@DEFAULT_AUDIO_SINK@', volume));
   },
   async isGlobalMuted() {
-    return getNodeVolumeInfoById('@DEFAULT_AUDIO_SINK@').then((volumeInfo) => volumeInfo.muted);
+    return helper.run(
+      async (server) => (await server.request(['isGlobalMuted'])).trim() === '1',
+      () => getNodeVolumeInfoById('@DEFAULT_AUDIO_SINK@').then((volumeInfo) => volumeInfo.muted),
+    );
   },
   async setGlobalMuted(muted: boolean) {
-    await setNodeMutedById('@DEFAULT_AUDIO_SINK@', muted);
+    await helper.run(async (server) => {
+      await server.request(['setGlobalMuted', muted ? '1' : '0']);
+    }, () => setNodeMutedById('@DEFAULT_AUDIO_SINK@', muted));
+  },
+  async getStatus() {
+    // A single registry snapshot instead of wpctl status and one wpctl get-volume per stream
+    return helper.run((server) => requestJson<Status>(server, ['getStatus']), getStatus);
+  },
+  async getNodeVolumeInfoById(id: string): Promise<VolumeInfo> {
+    return helper.run(async (server) => {
+      const [volume, muted] = await Promise.all([
+        requestVolume(server, ['getVolumeById', id]),
+        server.request(['isMutedById', id]),
+      ]);
+
+      return { volume, muted: muted.trim() === '1' };
+    }, () => getNodeVolumeInfoById(id));
+  },
+  async setNodeVolumeById(id: string, volume: number) {
+    if (volume < 0 || volume > 100) throw new Error('Volume must be between 0 and 100');
+
+    await helper.run(async (server) => {
+      await server.request(['setVolumeById', id, volume.toString()]);
+    }, () => setNodeVolumeById(id, volume));
+  },
+  async setNodeMutedById(id: string, muted: boolean) {
+    await helper.run(async (server) => {
+      await server.request(['setMutedById', id, muted ? '1' : '0']);
+    }, () => setNodeMutedById(id, muted));
+  },
+  async setStreamDestination(streamId: string, destinationId: string) {
+    await helper.run(async (server) => {
+      await server.request(['setStreamDestination', streamId, destinationId]);
+    }, async () => throwCompatibilityError());
+  },
+  async applyBatch(operations: BatchOperation[]) {
+    return helper.run(
+      (server) => requestJson<BatchResult[]>(server, ['batch', operations.length.toString()], toBatchInput(operations)),
+      () => applyBatch(operations),
+    );
+  },
+  async rampNodeVolume(id: string, volume: number, durationMs: number, curve: RampCurve = 'linear') {
+    validateRamp(volume, durationMs, curve);
+
+    return helper.run(
+      (server) => requestJson<RampResult>(server, getRampArgs(id, volume, durationMs, curve)),
+      () => rampWithSteps(
+        id, volume, durationMs, curve,
+        async (id) => (await getNodeVolumeInfoById(id)).volume,
+        setNodeVolumeById,
+      ),
+    );
+  },
+  watch(listener: WatchListener, options?: WatchOptions) {
+    return helper.watch(listener, wpctlWatch, options);
   },
-  getStatus,
-  getNodeVolumeInfoById,
-  setNodeVolumeById,
-  setNodeMutedById,
-  setStreamDestination: throwCompatibilityError,
+  getLevels: throwCompatibilityError,
+  watchLevels: throwCompatibilityError,
 };
\ No newline at end of file
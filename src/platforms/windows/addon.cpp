@@ -0,0 +1,578 @@
+// Node-API addon running the audio backend in the Node process, without spawning vsExec and parsing its output
+#include "audio.h"
+#include "commands.h"
+#include "ramp.h"
+#include <node_api.h>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+// Name of the backend the addon is built with, e.g. "wasapi" or "pulse", the JS side only uses a matching addon
+#ifndef VS_ADDON_BACKEND
+#define VS_ADDON_BACKEND "unknown"
+#endif
+
+// The backends are not thread safe, the calls run on the libuv threadpool one at a time under the backend mutex
+bool backendInitialized = false;
+
+struct AddonCall {
+    napi_async_work work = nullptr;
+    napi_deferred deferred = nullptr;
+    // Runs on the threadpool with the backend locked, errors are reported on std::cerr as with vsExec
+    std::function<void()> run;
+    // Builds the resolved value on the main thread, undefined when not set, null when the call settles its promise
+    // later by itself
+    std::function<napi_value(napi_env)> resolve;
+    // Called on the main thread when the call is rejected instead
+    std::function<void(napi_env)> reject;
+    std::string error;
+};
+
+// Utils
+napi_value getUndefined(napi_env env) {
+    napi_value value;
+    napi_get_undefined(env, &value);
+    return value;
+}
+
+napi_value toJsString(napi_env env, const std::string &str) {
+    napi_value value;
+    napi_create_string_utf8(env, str.c_str(), str.size(), &value);
+    return value;
+}
+
+napi_value toJsBoolean(napi_env env, bool boolean) {
+    napi_value value;
+    napi_get_boolean(env, boolean, &value);
+    return value;
+}
+
+napi_value toJsNumber(napi_env env, int number) {
+    napi_value value;
+    napi_create_int32(env, number, &value);
+    return value;
+}
+
+void setProperty(napi_env env, napi_value object, const char *name, napi_value value) {
+    napi_set_named_property(env, object, name, value);
+}
+
+napi_value toJsNode(napi_env env, VsNode &node, const char *type) {
+    napi_value object;
+    napi_create_object(env, &object);
+    setProperty(env, object, "type", toJsString(env, type));
+    setProperty(env, object, "id", toJsString(env, toString(node.id)));
+    setProperty(env, object, "name", toJsString(env, toString(node.name)));
+    setProperty(env, object, "volume", toJsNumber(env, node.volume));
+    setProperty(env, object, "muted", toJsBoolean(env, node.muted));
+    setProperty(env, object, "isDefault", toJsBoolean(env, node.isDefault));
+    if (node.destinationId != nullptr) {
+        setProperty(env, object, "destinationId", toJsString(env, toString(node.destinationId)));
+    }
+
+    return object;
+}
+
+napi_value toJsNodes(napi_env env, std::vector<VsNode> &nodes, const char *type) {
+    napi_value array;
+    napi_create_array_with_length(env, nodes.size(), &array);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        napi_set_element(env, array, (uint32_t) i, toJsNode(env, nodes[i], type));
+    }
+
+    return array;
+}
+
+napi_value toJsStatus(napi_env env, VsStatus &status) {
+    napi_value object;
+    napi_create_object(env, &object);
+    setProperty(env, object, "sinks", toJsNodes(env, status.sinks, "sink"));
+    setProperty(env, object, "sources", toJsNodes(env, status.sources, "source"));
+    setProperty(env, object, "streams", toJsNodes(env, status.streams, "stream"));
+    if (status.defaultSink != nullptr) {
+        setProperty(env, object, "defaultSink", toJsString(env, toString(status.defaultSink)));
+    }
+    if (status.defaultSource != nullptr) {
+        setProperty(env, object, "defaultSource", toJsString(env, toString(status.defaultSource)));
+    }
+
+    return object;
+}
+
+bool getStringArg(napi_env env, napi_value value, std::wstring &result) {
+    size_t length;
+    if (napi_get_value_string_utf8(env, value, nullptr, 0, &length) != napi_ok) return false;
+
+    std::string str(length, '\0');
+    napi_get_value_string_utf8(env, value, &str[0], length + 1, &length);
+    result = fromUtf8(str);
+    return true;
+}
+
+bool getVolumeArg(napi_env env, napi_value value, int &result) {
+    double volume;
+    if (napi_get_value_double(env, value, &volume) != napi_ok || volume < 0 || volume > 100) return false;
+
+    result = (int) volume;
+    return true;
+}
+
+bool getBooleanArg(napi_env env, napi_value value, bool &result) {
+    return napi_get_value_bool(env, value, &result) == napi_ok;
+}
+
+// Get the arguments of a call, missing ones are undefined
+template<size_t Count>
+void getArgs(napi_env env, napi_callback_info info, napi_value (&args)[Count]) {
+    size_t count = Count;
+    napi_get_cb_info(env, info, &count, args, nullptr, nullptr);
+    for (size_t i = count; i < Count; i++) {
+        args[i] = getUndefined(env);
+    }
+}
+
+napi_value rejectWith(napi_env env, const std::string &message) {
+    napi_value promise;
+    napi_deferred deferred;
+    napi_value error;
+    napi_create_promise(env, &deferred, &promise);
+    napi_create_error(env, nullptr, toJsString(env, message), &error);
+    napi_reject_deferred(env, deferred, error);
+    return promise;
+}
+
+// Async calls
+void executeCall(napi_env, void *data) {
+    auto call = (AddonCall *) data;
+    std::lock_guard<std::mutex> lock(getBackendMutex());
+
+    std::ostringstream error;
+    std::streambuf *cerrBuffer = std::cerr.rdbuf(error.rdbuf());
+
+    // The backend lives as long as the process, its caches follow the changes as in the serve mode
+    initializeThread();
+    if (!backendInitialized) {
+        initialize();
+        if (error.str().empty()) {
+            enableChangeTracking();
+            backendInitialized = true;
+        } else {
+            // e.g. no server to connect to, tried again on the next call
+            uninitialize();
+        }
+    }
+
+    if (backendInitialized) {
+        try {
+            call->run();
+        } catch (const std::exception &e) {
+            error << e.what() << std::endl;
+        }
+    }
+
+    std::cerr.rdbuf(cerrBuffer);
+    clearRequestState();
+    call->error = error.str();
+}
+
+void completeCall(napi_env env, napi_status status, void *data) {
+    std::unique_ptr<AddonCall> call((AddonCall *) data);
+
+    if (status == napi_ok && call->error.empty()) {
+        napi_value value = call->resolve ? call->resolve(env) : getUndefined(env);
+        if (value != nullptr) {
+            napi_resolve_deferred(env, call->deferred, value);
+        }
+    } else {
+        if (call->reject) {
+            call->reject(env);
+        }
+
+        std::string message = status == napi_ok ? call->error : "Call cancelled";
+        while (!message.empty() && (message.back() == '\n' || message.back() == '\r')) {
+            message.pop_back();
+        }
+
+        napi_value error;
+        napi_create_error(env, nullptr, toJsString(env, message), &error);
+        napi_reject_deferred(env, call->deferred, error);
+    }
+
+    napi_delete_async_work(env, call->work);
+}
+
+napi_value queueCall(napi_env env, std::function<void()> run, std::function<napi_value(napi_env)> resolve = nullptr,
+                     std::function<void(napi_env)> reject = nullptr, napi_deferred *deferred = nullptr) {
+    auto call = new AddonCall();
+    call->run = std::move(run);
+    call->resolve = std::move(resolve);
+    call->reject = std::move(reject);
+
+    napi_value promise;
+    napi_value name = toJsString(env, "volume_supervisor");
+    napi_create_promise(env, &call->deferred, &promise);
+    if (deferred != nullptr) {
+        *deferred = call->deferred;
+    }
+    napi_create_async_work(env, nullptr, name, executeCall, completeCall, call, &call->work);
+    napi_queue_async_work(env, call->work);
+    return promise;
+}
+
+// Default device functions
+napi_value addonGetGlobalVolume(napi_env env, napi_callback_info) {
+    auto volume = std::make_shared<int>(0);
+    return queueCall(env, [volume]() {
+        *volume = getGlobalVolume();
+        if (*volume == -1) {
+            std::cerr << "Failed to get volume" << std::endl;
+        }
+    }, [volume](napi_env env) {
+        return toJsNumber(env, *volume);
+    });
+}
+
+napi_value addonSetGlobalVolume(napi_env env, napi_callback_info info) {
+    napi_value args[1];
+    getArgs(env, info, args);
+
+    int volume;
+    if (!getVolumeArg(env, args[0], volume)) return rejectWith(env, "Volume must be between 0 and 100");
+
+    return queueCall(env, [volume]() {
+        setGlobalVolume(volume);
+    });
+}
+
+napi_value addonIsGlobalMuted(napi_env env, napi_callback_info) {
+    auto muted = std::make_shared<bool>(false);
+    return queueCall(env, [muted]() {
+        *muted = isGlobalMuted();
+    }, [muted](napi_env env) {
+        return toJsBoolean(env, *muted);
+    });
+}
+
+napi_value addonSetGlobalMuted(napi_env env, napi_callback_info info) {
+    napi_value args[1];
+    getArgs(env, info, args);
+
+    bool muted;
+    if (!getBooleanArg(env, args[0], muted)) return rejectWith(env, "Muted must be a boolean");
+
+    return queueCall(env, [muted]() {
+        setGlobalMuted(muted);
+    });
+}
+
+// Status
+napi_value addonGetStatus(napi_env env, napi_callback_info) {
+    // The strings of the status are freed with it
+    auto status = std::make_shared<VsStatus>();
+
+    return queueCall(env, [status]() {
+        getStatus(status.get());
+    }, [status](napi_env env) {
+        return toJsStatus(env, *status);
+    });
+}
+
+// By ID functions
+napi_value addonGetNodeVolumeInfoById(napi_env env, napi_callback_info info) {
+    napi_value args[1];
+    getArgs(env, info, args);
+
+    auto id = std::make_shared<std::wstring>();
+    if (!getStringArg(env, args[0], *id)) return rejectWith(env, "ID must be a string");
+
+    auto volumeInfo = std::make_shared<std::pair<int, bool>>(0, false);
+    return queueCall(env, [id, volumeInfo]() {
+        volumeInfo->first = getVolumeById(&(*id)[0]);
+        volumeInfo->second = isMutedById(&(*id)[0]);
+    }, [volumeInfo](napi_env env) {
+        napi_value object;
+        napi_create_object(env, &object);
+        setProperty(env, object, "volume", toJsNumber(env, volumeInfo->first));
+        setProperty(env, object, "muted", toJsBoolean(env, volumeInfo->second));
+        return object;
+    });
+}
+
+napi_value addonSetNodeVolumeById(napi_env env, napi_callback_info info) {
+    napi_value args[2];
+    getArgs(env, info, args);
+
+    auto id = std::make_shared<std::wstring>();
+    int volume;
+    if (!getStringArg(env, args[0], *id)) return rejectWith(env, "ID must be a string");
+    if (!getVolumeArg(env, args[1], volume)) return rejectWith(env, "Volume must be between 0 and 100");
+
+    return queueCall(env, [id, volume]() {
+        setVolumeById(&(*id)[0], volume);
+    });
+}
+
+napi_value addonSetNodeMutedById(napi_env env, napi_callback_info info) {
+    napi_value args[2];
+    getArgs(env, info, args);
+
+    auto id = std::make_shared<std::wstring>();
+    bool muted;
+    if (!getStringArg(env, args[0], *id)) return rejectWith(env, "ID must be a string");
+    if (!getBooleanArg(env, args[1], muted)) return rejectWith(env, "Muted must be a boolean");
+
+    return queueCall(env, [id, muted]() {
+        setMutedById(&(*id)[0], muted);
+    });
+}
+
+napi_value addonSetStreamDestination(napi_env env, napi_callback_info info) {
+    napi_value args[2];
+    getArgs(env, info, args);
+
+    auto id = std::make_shared<std::wstring>();
+    auto destinationId = std::make_shared<std::wstring>();
+    if (!getStringArg(env, args[0], *id) || !getStringArg(env, args[1], *destinationId)) {
+        return rejectWith(env, "IDs must be strings");
+    }
+
+    return queueCall(env, [id, destinationId]() {
+        setStreamDestination(&(*id)[0], &(*destinationId)[0]);
+    });
+}
+
+// Batch, the operations are validated here with the same errors as the batch command
+VsBatchOperation toBatchOperation(napi_env env, napi_value value, std::wstring &id) {
+    VsBatchOperation operation;
+    operation.type = VsBatchOperationType::GetVolumeInfo;
+
+    napi_value op;
+    napi_value idValue;
+    napi_get_named_property(env, value, "op", &op);
+    napi_get_named_property(env, value, "id", &idValue);
+    if (!getStringArg(env, idValue, id)) {
+        operation.error = "Invalid operation";
+    }
+    operation.id = &id[0];
+
+    std::wstring type;
+    getStringArg(env, op, type);
+    if (operation.error != nullptr) {
+        return operation;
+    } else if (type == L"getVolumeInfo") {
+        operation.type = VsBatchOperationType::GetVolumeInfo;
+    } else if (type == L"setVolume") {
+        napi_value volume;
+        napi_get_named_property(env, value, "volume", &volume);
+        operation.type = VsBatchOperationType::SetVolume;
+        if (!getVolumeArg(env, volume, operation.volume)) {
+            operation.error = "Volume must be between 0 and 100";
+        }
+    } else if (type == L"setMuted") {
+        napi_value muted;
+        napi_get_named_property(env, value, "muted", &muted);
+        operation.type = VsBatchOperationType::SetMuted;
+        if (!getBooleanArg(env, muted, operation.muted)) {
+            operation.error = "Mute must be 1 or 0";
+        }
+    } else {
+        operation.error = "Invalid operation";
+    }
+
+    return operation;
+}
+
+napi_value toJsBatchResult(napi_env env, VsBatchOperation &operation) {
+    napi_value object;
+    napi_create_object(env, &object);
+    setProperty(env, object, "id", toJsString(env, toString(operation.id)));
+    setProperty(env, object, "ok", toJsBoolean(env, operation.error == nullptr));
+    if (operation.error != nullptr) {
+        setProperty(env, object, "error", toJsString(env, operation.error));
+    } else if (operation.type == VsBatchOperationType::GetVolumeInfo) {
+        setProperty(env, object, "volume", toJsNumber(env, operation.volume));
+        setProperty(env, object, "muted", toJsBoolean(env, operation.muted));
+    }
+
+    return object;
+}
+
+struct AddonBatch {
+    // The operations point to these IDs, both are sized once
+    std::vector<std::wstring> ids;
+    std::vector<VsBatchOperation> operations;
+};
+
+napi_value addonApplyBatch(napi_env env, napi_callback_info info) {
+    napi_value args[1];
+    getArgs(env, info, args);
+
+    bool isArray = false;
+    uint32_t length = 0;
+    napi_is_array(env, args[0], &isArray);
+    if (!isArray) return rejectWith(env, "Operations must be an array");
+    napi_get_array_length(env, args[0], &length);
+
+    auto batch = std::make_shared<AddonBatch>();
+    batch->ids.resize(length);
+    for (uint32_t i = 0; i < length; i++) {
+        napi_value value;
+        napi_get_element(env, args[0], i, &value);
+        batch->operations.push_back(toBatchOperation(env, value, batch->ids[i]));
+    }
+
+    return queueCall(env, [batch]() {
+        applyBatch(batch->operations);
+    }, [batch](napi_env env) {
+        napi_value array;
+        napi_create_array_with_length(env, batch->operations.size(), &array);
+        for (size_t i = 0; i < batch->operations.size(); i++) {
+            napi_set_element(env, array, (uint32_t) i, toJsBatchResult(env, batch->operations[i]));
+        }
+        return array;
+    });
+}
+
+// Ramps, their promise is settled once the ramp ends, from the finalizer of a thread safe function released by both
+// the ramp thread and the completion of the call, whichever comes last
+struct AddonRamp {
+    std::wstring id;
+    RampOptions options;
+    napi_threadsafe_function ended = nullptr;
+    napi_deferred deferred = nullptr;
+    bool started = false;
+    // The call failed and rejected the promise
+    bool rejected = false;
+    // Set by the ramp thread before it releases the function
+    bool hasEnded = false;
+    RampReport report;
+};
+
+napi_value toJsRampReport(napi_env env, const AddonRamp &ramp) {
+    const RampReport &report = ramp.report;
+    napi_value object;
+    napi_create_object(env, &object);
+    setProperty(env, object, "id", toJsString(env, toString((LPWSTR) ramp.id.c_str())));
+    setProperty(env, object, "completed", toJsBoolean(env, report.completed));
+    setProperty(env, object, "volume", toJsNumber(env, report.volume));
+    setProperty(env, object, "steps", toJsNumber(env, (int) report.steps));
+    setProperty(env, object, "elapsedMs", toJsNumber(env, (int) (report.elapsed.count() / 1000)));
+    setProperty(env, object, "maxJitterUs", toJsNumber(env, (int) report.maxJitter.count()));
+    setProperty(env, object, "meanJitterUs", toJsNumber(env, (int) report.meanJitter.count()));
+
+    napi_value histogram;
+    napi_create_array_with_length(env, report.jitterHistogram.size(), &histogram);
+    for (size_t i = 0; i < report.jitterHistogram.size(); i++) {
+        napi_value bucket;
+        napi_create_object(env, &bucket);
+        if (i < RAMP_JITTER_BUCKETS_US.size()) {
+            setProperty(env, bucket, "underUs", toJsNumber(env, (int) RAMP_JITTER_BUCKETS_US[i]));
+        }
+        setProperty(env, bucket, "steps", toJsNumber(env, (int) report.jitterHistogram[i]));
+        napi_set_element(env, histogram, (uint32_t) i, bucket);
+    }
+    setProperty(env, object, "jitterHistogram", histogram);
+
+    return object;
+}
+
+void settleRamp(napi_env env, void *data, void *) {
+    std::unique_ptr<AddonRamp> ramp((AddonRamp *) data);
+    if (ramp->rejected || !ramp->hasEnded) return;
+
+    if (ramp->report.error != nullptr) {
+        napi_value error;
+        napi_create_error(env, nullptr, toJsString(env, ramp->report.error), &error);
+        napi_reject_deferred(env, ramp->deferred, error);
+    } else {
+        napi_resolve_deferred(env, ramp->deferred, toJsRampReport(env, *ramp));
+    }
+}
+
+napi_value addonRampNodeVolume(napi_env env, napi_callback_info info) {
+    napi_value args[4];
+    getArgs(env, info, args);
+
+    auto ramp = new AddonRamp();
+    std::unique_ptr<AddonRamp> pendingRamp(ramp);
+    double duration;
+    std::wstring curve = L"linear";
+    napi_valuetype curveType;
+    napi_typeof(env, args[3], &curveType);
+    if (!getStringArg(env, args[0], ramp->id)) return rejectWith(env, "ID must be a string");
+    if (!getVolumeArg(env, args[1], ramp->options.target)) return rejectWith(env, "Volume must be between 0 and 100");
+    if (napi_get_value_double(env, args[2], &duration) != napi_ok || duration < 0) {
+        return rejectWith(env, "Duration must not be negative");
+    }
+    if (curveType != napi_undefined && (!getStringArg(env, args[3], curve) || (curve != L"linear" && curve != L"db"))) {
+        return rejectWith(env, "Curve must be linear or db");
+    }
+    ramp->options.duration = std::chrono::milliseconds((long long) duration);
+    ramp->options.curve = curve == L"db" ? RampCurve::Decibel : RampCurve::Linear;
+
+    // Never called, only its finalizer settles the promise
+    napi_threadsafe_function_call_js callJs = [](napi_env, napi_value, void *, void *) {};
+    napi_create_threadsafe_function(env, nullptr, nullptr, toJsString(env, "volume_supervisor_ramp"), 0, 2,
+                                    pendingRamp.release(), settleRamp, nullptr, callJs, &ramp->ended);
+
+    return queueCall(env, [ramp]() {
+        VsVolumeControl *control = openVolumeControl(&ramp->id[0]);
+        if (control == nullptr) {
+            std::cerr << "Failed to find node by ID" << std::endl;
+            return;
+        }
+
+        ramp->started = true;
+        startRamp(ramp->id, control, ramp->options, [ramp](const RampReport &report) {
+            ramp->report = report;
+            ramp->hasEnded = true;
+            napi_release_threadsafe_function(ramp->ended, napi_tsfn_release);
+        });
+    }, [ramp](napi_env) -> napi_value {
+        napi_release_threadsafe_function(ramp->ended, napi_tsfn_release);
+        return nullptr;
+    }, [ramp](napi_env) {
+        ramp->rejected = true;
+        if (!ramp->started) {
+            napi_release_threadsafe_function(ramp->ended, napi_tsfn_release);
+        }
+        napi_release_threadsafe_function(ramp->ended, napi_tsfn_release);
+    }, &ramp->deferred);
+}
+
+// Module
+void cleanupBackend(void *) {
+    // The ramps close their controls with the backend mutex
+    stopRamps();
+
+    std::lock_guard<std::mutex> lock(getBackendMutex());
+    if (!backendInitialized) return;
+
+    initializeThread();
+    uninitialize();
+    backendInitialized = false;
+}
+
+NAPI_MODULE_INIT() {
+    napi_property_descriptor properties[] = {
+            {"backend",               nullptr, nullptr,                    nullptr, nullptr, toJsString(env, VS_ADDON_BACKEND), napi_enumerable, nullptr},
+            {"getGlobalVolume",       nullptr, addonGetGlobalVolume,       nullptr, nullptr, nullptr, napi_default, nullptr},
+            {"setGlobalVolume",       nullptr, addonSetGlobalVolume,       nullptr, nullptr, nullptr, napi_default, nullptr},
+            {"isGlobalMuted",         nullptr, addonIsGlobalMuted,         nullptr, nullptr, nullptr, napi_default, nullptr},
+            {"setGlobalMuted",        nullptr, addonSetGlobalMuted,        nullptr, nullptr, nullptr, napi_default, nullptr},
+            {"getStatus",             nullptr, addonGetStatus,             nullptr, nullptr, nullptr, napi_default, nullptr},
+            {"getNodeVolumeInfoById", nullptr, addonGetNodeVolumeInfoById, nullptr, nullptr, nullptr, napi_default, nullptr},
+            {"setNodeVolumeById",     nullptr, addonSetNodeVolumeById,     nullptr, nullptr, nullptr, napi_default, nullptr},
+            {"setNodeMutedById",      nullptr, addonSetNodeMutedById,      nullptr, nullptr, nullptr, napi_default, nullptr},
+            {"setStreamDestination",  nullptr, addonSetStreamDestination,  nullptr, nullptr, nullptr, napi_default, nullptr},
+            {"applyBatch",            nullptr, addonApplyBatch,            nullptr, nullptr, nullptr, napi_default, nullptr},
+            {"rampNodeVolume",        nullptr, addonRampNodeVolume,        nullptr, nullptr, nullptr, napi_default, nullptr},
+    };
+    napi_define_properties(env, exports, sizeof(properties) / sizeof(properties[0]), properties);
+    napi_add_env_cleanup_hook(env, cleanupBackend, nullptr);
+
+    return exports;
+}
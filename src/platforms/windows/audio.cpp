@@ -0,0 +1,80 @@
+#include "audio.h"
+
+LPWSTR copyVsString(StringArena *strings, const std::wstring &str) {
+    if (strings != nullptr) {
+        return strings->copy(str);
+    }
+
+    LPWSTR_FROM_WSTRING(copy, str);
+    return copy;
+}
+
+void clearVsNode(VsNode &node) {
+    delete[] node.id;
+    delete[] node.name;
+    delete[] node.destinationId;
+    node.id = nullptr;
+    node.name = nullptr;
+    node.destinationId = nullptr;
+}
+
+void clearVsStatus(VsStatus &status) {
+    status.sinks.clear();
+    status.sources.clear();
+    status.streams.clear();
+    status.defaultSink = nullptr;
+    status.defaultSource = nullptr;
+    status.strings.clear();
+}
+
+void clearVsEvents(std::vector<VsEvent> &events) {
+    for (VsEvent &event: events) {
+        clearVsNode(event.node);
+    }
+    events.clear();
+}
+
+VsNode copyVsNode(const VsNode &node, StringArena &strings) {
+    VsNode copy = node;
+    copy.id = strings.copy(node.id);
+    copy.name = strings.copy(node.name);
+    copy.destinationId = strings.copy(node.destinationId);
+    return copy;
+}
+
+void mergeDeviceNodes(const std::vector<DeviceNodes> &deviceNodes, std::vector<VsNode> *devices,
+                      std::vector<VsNode> *streams, StringArena &strings) {
+    bool streamsRead = true;
+    for (const DeviceNodes &device: deviceNodes) {
+        if (!device.deviceRead) break;
+
+        if (devices != nullptr) {
+            for (const VsNode &node: device.devices) {
+                devices->push_back(copyVsNode(node, strings));
+            }
+        }
+
+        if (streams != nullptr && streamsRead) {
+            // The streams of a device share its ID as their destination, so do their copies
+            LPWSTR destinationId = nullptr;
+            LPWSTR destinationIdCopy = nullptr;
+            for (const VsNode &node: device.streams) {
+                VsNode copy = node;
+                copy.id = strings.copy(node.id);
+                copy.name = strings.copy(node.name);
+                if (node.destinationId != destinationId) {
+                    destinationId = node.destinationId;
+                    destinationIdCopy = strings.copy(node.destinationId);
+                }
+                copy.destinationId = destinationIdCopy;
+                streams->push_back(copy);
+            }
+            streamsRead = device.streamsRead;
+        }
+    }
+}
+
+std::mutex &getBackendMutex() {
+    static std::mutex backendMutex;
+    return backendMutex;
+}
@@ -0,0 +1,176 @@
+#ifndef VSEXEC_AUDIO_H
+#define VSEXEC_AUDIO_H
+
+#include "stringArena.h"
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmdeviceapi.h>
+#else
+// Minimal stand-ins for the Windows types used by the audio API, so the command dispatch and the serve protocol
+// can be built and tested on other platforms against the fake backend
+typedef wchar_t WCHAR;
+typedef WCHAR *LPWSTR;
+
+enum EDataFlow {
+    eRender,
+    eCapture,
+    eAll,
+};
+#endif
+
+#define LPWSTR_FROM_WSTRING(lp, ws) LPWSTR lp = new WCHAR[ws.length() + 1]; std::copy(ws.begin(), ws.end(), lp); lp[ws.length()] = 0
+
+// Structures
+// The strings of enumerated nodes belong to the arena of the enumeration, the ones of event nodes to the event
+struct VsNode {
+    LPWSTR id;
+    LPWSTR name;
+    int volume;
+    bool muted;
+    bool isDefault;
+    LPWSTR destinationId;
+};
+
+struct VsStatus {
+    std::vector<VsNode> sinks;
+    std::vector<VsNode> sources;
+    std::vector<VsNode> streams;
+    LPWSTR defaultSink = nullptr;
+    LPWSTR defaultSource = nullptr;
+    // Strings of the nodes and default IDs
+    StringArena strings;
+};
+
+// Nodes read by the task of one device when the devices are enumerated in parallel, with their own strings
+struct DeviceNodes {
+    // Whether the device node, or its ID alone when the devices are not listed, could be read
+    bool deviceRead = false;
+    // Whether every stream of the device could be read, the streams read before a failure are kept
+    bool streamsRead = false;
+    std::vector<VsNode> devices;
+    std::vector<VsNode> streams;
+    StringArena strings;
+};
+
+enum class VsBatchOperationType {
+    GetVolumeInfo,
+    SetVolume,
+    SetMuted,
+};
+
+struct VsBatchOperation {
+    VsBatchOperationType type;
+    LPWSTR id;
+    // Value to set, or the value read by GetVolumeInfo
+    int volume = 0;
+    bool muted = false;
+    // Set when the operation is invalid or failed, operations already failing are skipped by applyBatch
+    const char *error = nullptr;
+};
+
+enum class VsEventType {
+    Changed,
+    Added,
+    Removed,
+    DefaultChanged,
+};
+
+struct VsEvent {
+    VsEventType type;
+    // "sink", "source" or "stream"
+    const char *nodeType;
+    // The whole node for Changed and Added, only its ID for Removed and DefaultChanged, null when there is no default
+    VsNode node;
+};
+
+// Level of a node, read from its meter
+struct VsLevel {
+    // "sink", "source" or "stream"
+    const char *nodeType;
+    LPWSTR id;
+    // Highest sample since the previous read, from 0 to 1
+    float peak;
+    // Root mean square of the samples since the previous read, negative when the backend only meters peaks
+    float rms;
+};
+
+// Lifecycle, implemented by the audio backend (wasapi.cpp, pulseBackend.cpp, pipewireBackend.cpp or fakeBackend.cpp)
+void initialize();
+void uninitialize();
+// Prepare the calling thread for backend calls, needed when the backend is used from several threads (the addon)
+void initializeThread();
+// Drop the state that must not outlive a single command, e.g. the cached default device
+void clearRequestState();
+// Keep the caches up to date from the backend notifications instead of trusting them for a single command
+void enableChangeTracking();
+
+// Held around the backend calls by the threads sharing the backend: the addon calls, the serve requests and the ramps
+// (audio.cpp)
+std::mutex &getBackendMutex();
+
+// Results, common to every backend (audio.cpp)
+// Copy a string of a node into the arena of the enumeration, or on the heap for an event node when there is none
+LPWSTR copyVsString(StringArena *strings, const std::wstring &str);
+// Free the strings of an event node
+void clearVsNode(VsNode &node);
+// Empty the status and free all its strings at once, it can be filled again afterward
+void clearVsStatus(VsStatus &status);
+void clearVsEvents(std::vector<VsEvent> &events);
+// Copy of a node whose strings belong to another arena
+VsNode copyVsNode(const VsNode &node, StringArena &strings);
+// Append the nodes read per device in the order of the devices, stopping where a serial walk would have stopped
+void mergeDeviceNodes(const std::vector<DeviceNodes> &deviceNodes, std::vector<VsNode> *devices,
+                      std::vector<VsNode> *streams, StringArena &strings);
+
+// Default device functions
+int getGlobalVolume();
+void setGlobalVolume(int volume);
+bool isGlobalMuted();
+void setGlobalMuted(bool mute);
+
+// Get VsNode functions, the strings of the nodes are allocated from the given arena
+void getVsNodeOfType(std::vector<VsNode> *nodes, StringArena &strings, EDataFlow dataFlow = eRender);
+void getStreams(std::vector<VsNode> *nodes, StringArena &strings);
+// Sinks, sources, streams and default devices in a single enumeration
+void getStatus(VsStatus *status);
+
+// By ID functions, the ID can be either a device or a session
+int getVolumeById(LPWSTR id);
+void setVolumeById(LPWSTR id, int volume);
+bool isMutedById(LPWSTR id);
+void setMutedById(LPWSTR id, bool mute);
+// Move a stream to another sink, not every backend can route streams
+void setStreamDestination(LPWSTR id, LPWSTR destinationId);
+
+// Resolve the IDs of all the operations at once, then apply them in order
+void applyBatch(std::vector<VsBatchOperation> &operations);
+
+// Volume control functions, a node resolved once so its volume can be set many times in a row, e.g. by a ramp.
+// The levels go from 0 to 1 on the scale of the volumes. Failures are returned instead of reported on std::cerr, the
+// steps of a ramp run outside of any request
+struct VsVolumeControl;
+// Null when there is no node of this ID
+VsVolumeControl *openVolumeControl(LPWSTR id);
+void closeVolumeControl(VsVolumeControl *control);
+bool getControlLevel(VsVolumeControl *control, float &level);
+bool setControlLevel(VsVolumeControl *control, float level);
+
+// Level functions, the meters of all the nodes are read together at the pace of the caller
+// Open a meter per node, called again to follow the added and removed nodes while the open meters are kept
+bool openLevelMeters();
+// Append the levels since the previous read of every open meter, their strings go to the arena
+void readLevels(std::vector<VsLevel> *levels, StringArena &strings);
+void closeLevelMeters();
+
+// Watch functions, the backend notifications are queued as events until they are waited for
+bool startWatch();
+// Wait up to timeoutMs for events and append them to events, false when the watch can't go on
+bool waitForEvents(std::vector<VsEvent> &events, int timeoutMs);
+void stopWatch();
+
+#endif
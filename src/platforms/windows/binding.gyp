@@ -0,0 +1,27 @@
+{
+  "targets": [
+    {
+      "target_name": "volume_supervisor",
+      "sources": ["addon.cpp", "audio.cpp", "commands.cpp", "jsonWriter.cpp", "levels.cpp", "processNameCache.cpp",
+                  "ramp.cpp", "stats.cpp", "stringArena.cpp", "taskPool.cpp"],
+      "cflags_cc!": ["-fno-exceptions"],
+      "cflags_cc": ["-std=c++17"],
+      "conditions": [
+        ["OS=='win'", {
+          "sources": ["wasapi.cpp"],
+          "defines": ["VS_ADDON_BACKEND=\"wasapi\""],
+          "libraries": ["ole32.lib", "version.lib"],
+          "msvs_settings": {
+            "VCCLCompilerTool": {"ExceptionHandling": 1, "AdditionalOptions": ["/std:c++17"]}
+          }
+        }],
+        ["OS=='linux'", {
+          "sources": ["pulseBackend.cpp"],
+          "defines": ["VS_ADDON_BACKEND=\"pulse\""],
+          "cflags_cc": ["<!@(pkg-config --cflags libpulse)"],
+          "libraries": ["<!@(pkg-config --libs libpulse)"]
+        }]
+      ]
+    }
+  ]
+}
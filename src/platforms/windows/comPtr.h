@@ -0,0 +1,145 @@
+#ifndef VSEXEC_COM_PTR_H
+#define VSEXEC_COM_PTR_H
+
+#include <utility>
+
+/**
+ * Owns a reference of a COM interface, released when the pointer goes out of scope or is replaced.
+ *
+ * Interfaces returned by the COM functions are already referenced and are attached with put() or the constructor,
+ * interfaces only borrowed, e.g. from a cache, are referenced again with share(). Copies add a reference.
+ * Only AddRef and Release are used, so it also holds the test doubles of other platforms.
+ */
+template<typename T>
+class ComPtr {
+public:
+    ComPtr() = default;
+
+    // Take the ownership of a reference
+    explicit ComPtr(T *pointer) : pointer(pointer) {
+    }
+
+    ComPtr(const ComPtr &other) : pointer(other.pointer) {
+        if (pointer != nullptr) pointer->AddRef();
+    }
+
+    ComPtr(ComPtr &&other) noexcept : pointer(other.pointer) {
+        other.pointer = nullptr;
+    }
+
+    ~ComPtr() {
+        reset();
+    }
+
+    ComPtr &operator=(ComPtr other) noexcept {
+        std::swap(pointer, other.pointer);
+        return *this;
+    }
+
+    // Add a reference to a borrowed interface
+    static ComPtr share(T *pointer) {
+        if (pointer != nullptr) pointer->AddRef();
+        return ComPtr(pointer);
+    }
+
+    T *get() const {
+        return pointer;
+    }
+
+    T *operator->() const {
+        return pointer;
+    }
+
+    explicit operator bool() const {
+        return pointer != nullptr;
+    }
+
+    // Release the interface and give the address to fill, for the out parameters of the COM functions
+    T **put() {
+        reset();
+        return &pointer;
+    }
+
+    // Same as put(), for the functions taking a void ** like QueryInterface or Activate
+    void **putVoid() {
+        return (void **) put();
+    }
+
+    void reset() {
+        if (pointer != nullptr) {
+            T *released = pointer;
+            pointer = nullptr;
+            released->Release();
+        }
+    }
+
+    // Give the ownership of the reference to the caller
+    T *detach() {
+        T *detached = pointer;
+        pointer = nullptr;
+        return detached;
+    }
+
+private:
+    T *pointer = nullptr;
+};
+
+#ifdef _WIN32
+#include <windows.h>
+#include <propidl.h>
+
+// String allocated by COM, e.g. a device ID, freed with CoTaskMemFree
+class CoTaskMemString {
+public:
+    CoTaskMemString() = default;
+    CoTaskMemString(const CoTaskMemString &) = delete;
+    CoTaskMemString &operator=(const CoTaskMemString &) = delete;
+
+    ~CoTaskMemString() {
+        CoTaskMemFree(str);
+    }
+
+    LPWSTR get() const {
+        return str;
+    }
+
+    LPWSTR *put() {
+        CoTaskMemFree(str);
+        str = nullptr;
+        return &str;
+    }
+
+private:
+    LPWSTR str = nullptr;
+};
+
+// Property value, cleared with PropVariantClear
+class PropVariant {
+public:
+    PropVariant() {
+        PropVariantInit(&value);
+    }
+
+    PropVariant(const PropVariant &) = delete;
+    PropVariant &operator=(const PropVariant &) = delete;
+
+    ~PropVariant() {
+        PropVariantClear(&value);
+    }
+
+    // The string value, null when the property is not a string
+    LPWSTR getString() const {
+        return value.vt == VT_LPWSTR ? value.pwszVal : nullptr;
+    }
+
+    PROPVARIANT *put() {
+        PropVariantClear(&value);
+        return &value;
+    }
+
+private:
+    PROPVARIANT value;
+};
+#endif
+
+#endif
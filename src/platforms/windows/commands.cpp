@@ -0,0 +1,537 @@
+#include "commands.h"
+#include "audio.h"
+#include "jsonWriter.h"
+#include "levels.h"
+#include "ramp.h"
+#include "stats.h"
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Leading option writing the JSON results on a single line (NDJSON), cheaper to parse than the indented output
+const std::string COMPACT_OPTION = "--compact";
+
+// Utils
+void printUsage(std::ostream &out, const std::string &program) {
+    out << "Usage: " << program << " [--stats] [--compact] [command] [args...]\n" << std::endl;
+    out << "Options:" << std::endl;
+    out << "  --stats - Print the time spent initializing, enumerating and writing the output on stderr, as JSON"
+        << std::endl;
+    out << "  --compact - Write the JSON results on a single line\n" << std::endl;
+
+    out << "Commands:" << std::endl;
+    out << "  getGlobalVolume - Get the global volume" << std::endl;
+    out << "  setGlobalVolume [volume] - Set the global volume, volume must be between 0 and 100" << std::endl;
+    out << "  isGlobalMuted - Check if the global volume is muted" << std::endl;
+    out << "  setGlobalMuted [mute] - Set the global mute, mute must be 1 or 0" << std::endl;
+    out << "  getSinks - Get the sinks" << std::endl;
+    out << "  getSources - Get the sources" << std::endl;
+    out << "  getStreams - Get the streams" << std::endl;
+    out << "  getStatus - Get the sinks, sources, streams and default devices at once" << std::endl;
+    out << "  getVolumeById [id] - Get the volume of a device by its ID" << std::endl;
+    out << "  setVolumeById [id] [volume] - Set the volume of a device by its ID, volume must be between 0 and 100"
+        << std::endl;
+    out << "  isMutedById [id] - Check if a device by its ID is muted" << std::endl;
+    out << "  setMutedById [id] [mute] - Set the mute of a device by its ID, mute must be 1 or 0" << std::endl;
+    out << "  setStreamDestination [id] [destinationId] - Move a stream to another sink" << std::endl;
+    out << "  ramp [id] [volume] [duration] [curve] - Fade the volume of a device by its ID to volume over duration ms, "
+           "curve must be linear (default) or db, a new ramp of the device replaces the running one" << std::endl;
+    out << "  getLevels [interval] - Get the peak and RMS levels of every node over interval ms (default "
+        << DEFAULT_LEVELS_INTERVAL_MS << ")" << std::endl;
+    out << "  batch [count] - Apply the operations read from stdin, one per line, or all of them until EOF" << std::endl;
+    out << "    getVolumeInfo\t[id] - Get the volume and mute of a node" << std::endl;
+    out << "    setVolume\t[id]\t[volume] - Set the volume of a node, volume must be between 0 and 100" << std::endl;
+    out << "    setMuted\t[id]\t[mute] - Set the mute of a node, mute must be 1 or 0" << std::endl;
+    out << "  serve - Read tab separated commands from stdin, one per line, and answer them on stdout" << std::endl;
+    out << "  watch - Print the volume, mute, device and session changes as JSON lines until stdin is closed"
+        << std::endl;
+    out << "  levels [rate] - Print the levels of every node as JSON lines, rate times per second (default "
+        << DEFAULT_LEVEL_RATE << ", up to " << MAX_LEVEL_RATE << "), until stdin is closed" << std::endl;
+}
+
+std::vector<std::string> splitFields(const std::string &line) {
+    std::vector<std::string> fields;
+
+    size_t start = 0;
+    size_t end;
+    while ((end = line.find('\t', start)) != std::string::npos) {
+        fields.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+    fields.push_back(line.substr(start));
+
+    return fields;
+}
+
+bool parseInteger(const std::string &str, long &value) {
+    if (str.empty()) return false;
+
+    char *end = nullptr;
+    errno = 0;
+    value = std::strtol(str.c_str(), &end, 10);
+    return errno != ERANGE && *end == '\0';
+}
+
+std::string toString(LPWSTR str) {
+    std::string utf8;
+    appendUtf8(utf8, str);
+    return utf8;
+}
+
+std::wstring fromUtf8(const std::string &str) {
+    std::wstring wide;
+    for (size_t i = 0; i < str.size();) {
+        unsigned char c = str[i];
+        int length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+        if (length == 0 || i + length > str.size()) {
+            // Invalid sequence, replaced instead of dropping the rest of the string
+            wide += (wchar_t) 0xFFFD;
+            i++;
+            continue;
+        }
+
+        unsigned long codePoint = length == 1 ? c : c & (0x7F >> length);
+        for (int j = 1; j < length; j++) {
+            codePoint = (codePoint << 6) | (str[i + j] & 0x3F);
+        }
+        i += length;
+
+        if (codePoint >= 0x10000 && sizeof(wchar_t) == 2) {
+            // UTF-16 surrogate pair on Windows
+            wide += (wchar_t) (0xD800 + ((codePoint - 0x10000) >> 10));
+            wide += (wchar_t) (0xDC00 + ((codePoint - 0x10000) & 0x3FF));
+        } else {
+            wide += (wchar_t) codePoint;
+        }
+    }
+
+    return wide;
+}
+
+void writeVsNode(JsonWriter &json, VsNode &node, const char *type) {
+    json.raw("{").newline();
+    json.indent().key("type").string(type).raw(",").newline();
+    json.indent().key("id").string(node.id).raw(",").newline();
+    json.indent().key("name").string(node.name).raw(",").newline();
+    json.indent().key("volume").number(node.volume).raw(",").newline();
+    json.indent().key("muted").boolean(node.muted).raw(",").newline();
+    json.indent().key("isDefault").boolean(node.isDefault);
+
+    if (node.destinationId != nullptr) {
+        json.raw(",").newline();
+        json.indent().key("destinationId").string(node.destinationId);
+    }
+
+    json.newline().raw("}");
+}
+
+void writeVsNodeVector(JsonWriter &json, std::vector<VsNode> &nodes, const char *type) {
+    json.raw("[").newline();
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (i > 0) json.raw(",").newline();
+        writeVsNode(json, nodes[i], type);
+    }
+    if (!nodes.empty()) json.newline();
+    json.raw("]");
+}
+
+void printVsNodeVector(std::ostream &out, std::vector<VsNode> &nodes, const char *type, bool compact) {
+    StatTimer timer(VsStat::Output);
+    JsonWriter json(compact);
+    writeVsNodeVector(json, nodes, type);
+    json.writeTo(out);
+}
+
+void printVsStatus(std::ostream &out, VsStatus &status, bool compact) {
+    StatTimer timer(VsStat::Output);
+    JsonWriter json(compact);
+    json.raw("{").newline();
+    json.key("sinks");
+    writeVsNodeVector(json, status.sinks, "sink");
+    json.raw(",").newline().key("sources");
+    writeVsNodeVector(json, status.sources, "source");
+    json.raw(",").newline().key("streams");
+    writeVsNodeVector(json, status.streams, "stream");
+
+    if (status.defaultSink != nullptr) {
+        json.raw(",").newline().key("defaultSink").string(status.defaultSink);
+    }
+    if (status.defaultSource != nullptr) {
+        json.raw(",").newline().key("defaultSource").string(status.defaultSource);
+    }
+
+    json.newline().raw("}");
+    json.writeTo(out);
+}
+
+VsBatchOperation parseBatchOperation(std::string line, StringArena &strings) {
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+
+    std::vector<std::string> fields = splitFields(line);
+    VsBatchOperation operation;
+    operation.id = strings.copy(fields.size() > 1 ? fromUtf8(fields[1]) : std::wstring());
+
+    const std::string &type = fields[0];
+    if (type == "getVolumeInfo" && fields.size() == 2) {
+        operation.type = VsBatchOperationType::GetVolumeInfo;
+    } else if (type == "setVolume" && fields.size() == 3) {
+        operation.type = VsBatchOperationType::SetVolume;
+        try {
+            operation.volume = std::stoi(fields[2]);
+        } catch (const std::exception &) {
+            operation.volume = -1;
+        }
+        if (operation.volume < 0 || operation.volume > 100) {
+            operation.error = "Volume must be between 0 and 100";
+        }
+    } else if (type == "setMuted" && fields.size() == 3) {
+        operation.type = VsBatchOperationType::SetMuted;
+        operation.muted = fields[2] == "1";
+        if (fields[2] != "1" && fields[2] != "0") {
+            operation.error = "Mute must be 1 or 0";
+        }
+    } else {
+        operation.type = VsBatchOperationType::GetVolumeInfo;
+        operation.error = "Invalid operation";
+    }
+
+    return operation;
+}
+
+void writeBatchOperation(JsonWriter &json, VsBatchOperation &operation) {
+    json.raw("{").newline();
+    json.indent().key("id").string(operation.id).raw(",").newline();
+    json.indent().key("ok").boolean(operation.error == nullptr);
+
+    if (operation.error != nullptr) {
+        json.raw(",").newline().indent().key("error").string(operation.error);
+    } else if (operation.type == VsBatchOperationType::GetVolumeInfo) {
+        json.raw(",").newline().indent().key("volume").number(operation.volume);
+        json.raw(",").newline().indent().key("muted").boolean(operation.muted);
+    }
+
+    json.newline().raw("}");
+}
+
+int runBatch(const std::vector<std::string> &args, std::istream &in, std::ostream &out, bool compact) {
+    // Without a count the operations are read until the end of the input
+    long count = -1;
+    if (args.size() > 2 && (!parseInteger(args[2], count) || count < 0)) {
+        std::cerr << "Count must be a non-negative integer" << std::endl;
+        printUsage(out, args[0]);
+        return 1;
+    }
+
+    std::vector<VsBatchOperation> operations;
+    StringArena strings;
+    std::string line;
+    while ((count < 0 || (long) operations.size() < count) && std::getline(in, line)) {
+        operations.push_back(parseBatchOperation(line, strings));
+    }
+
+    applyBatch(operations);
+
+    JsonWriter json(compact);
+    json.raw("[").newline();
+    for (size_t i = 0; i < operations.size(); i++) {
+        if (i > 0) json.raw(",").newline();
+        writeBatchOperation(json, operations[i]);
+    }
+    if (!operations.empty()) json.newline();
+    json.raw("]");
+    json.writeTo(out);
+
+    return 0;
+}
+
+// Ramp
+void writeRampReport(JsonWriter &json, const std::string &id, const RampReport &report) {
+    json.raw("{").newline();
+    json.indent().key("id").string(id.c_str()).raw(",").newline();
+    json.indent().key("completed").boolean(report.completed).raw(",").newline();
+    if (report.error != nullptr) {
+        json.indent().key("error").string(report.error).raw(",").newline();
+    }
+    json.indent().key("volume").number(report.volume).raw(",").newline();
+    json.indent().key("steps").number((int) report.steps).raw(",").newline();
+    json.indent().key("elapsedMs").number((int) (report.elapsed.count() / 1000)).raw(",").newline();
+    json.indent().key("maxJitterUs").number((int) report.maxJitter.count()).raw(",").newline();
+    json.indent().key("meanJitterUs").number((int) report.meanJitter.count()).raw(",").newline();
+
+    // Steps per bucket, the last one without a bound
+    json.indent().key("jitterHistogram").raw("[");
+    for (size_t i = 0; i < report.jitterHistogram.size(); i++) {
+        if (i > 0) json.raw(",");
+        json.raw("{");
+        if (i < RAMP_JITTER_BUCKETS_US.size()) {
+            json.key("underUs").number((int) RAMP_JITTER_BUCKETS_US[i]).raw(",");
+        }
+        json.key("steps").number((int) report.jitterHistogram[i]).raw("}");
+    }
+    json.raw("]").newline().raw("}");
+}
+
+int startRampCommand(const std::vector<std::string> &args, std::ostream &out, bool compact, const CommandDone &done) {
+    const std::string &program = args[0];
+    if (args.size() < 5) {
+        std::cerr << "Missing ID, volume and duration arguments" << std::endl;
+        printUsage(out, program);
+        return 1;
+    }
+
+    RampOptions options;
+    long target;
+    if (!parseInteger(args[3], target) || target < 0 || target > 100) {
+        std::cerr << "Volume must be between 0 and 100" << std::endl;
+        printUsage(out, program);
+        return 1;
+    }
+    options.target = (int) target;
+
+    long duration;
+    if (!parseInteger(args[4], duration) || duration < 0) {
+        std::cerr << "Duration must not be negative" << std::endl;
+        printUsage(out, program);
+        return 1;
+    }
+    options.duration = std::chrono::milliseconds(duration);
+
+    const std::string curve = args.size() > 5 ? args[5] : "linear";
+    if (curve != "linear" && curve != "db") {
+        std::cerr << "Curve must be linear or db" << std::endl;
+        printUsage(out, program);
+        return 1;
+    }
+    options.curve = curve == "db" ? RampCurve::Decibel : RampCurve::Linear;
+
+    std::wstring id = fromUtf8(args[2]);
+    VsVolumeControl *control = openVolumeControl(&id[0]);
+    if (control == nullptr) {
+        std::cerr << "Failed to find node by ID" << std::endl;
+        return 1;
+    }
+
+    std::string utf8Id = args[2];
+    startRamp(id, control, options, [utf8Id, compact, done](const RampReport &report) {
+        JsonWriter json(compact);
+        writeRampReport(json, utf8Id, report);
+
+        std::ostringstream output;
+        json.writeTo(output);
+        if (report.error != nullptr) {
+            done(1, output.str(), std::string(report.error) + "\n");
+        } else {
+            done(0, output.str(), "");
+        }
+    });
+    return 0;
+}
+
+// Start the ramp and wait for its end, for the single commands
+int runRamp(const std::vector<std::string> &args, std::ostream &out, bool compact) {
+    std::mutex mutex;
+    std::condition_variable ended;
+    bool hasEnded = false;
+    int code = 0;
+    std::string output;
+    std::string error;
+
+    int startCode = startRampCommand(args, out, compact, [&](int rampCode, const std::string &rampOutput,
+                                                             const std::string &rampError) {
+        std::lock_guard<std::mutex> lock(mutex);
+        code = rampCode;
+        output = rampOutput;
+        error = rampError;
+        hasEnded = true;
+        ended.notify_all();
+    });
+    if (startCode != 0) return startCode;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!ended.wait_for(lock, std::chrono::seconds(1), [&hasEnded] { return hasEnded; })) {
+    }
+
+    out << output;
+    std::cerr << error;
+    return code;
+}
+
+bool removeCompactOption(std::vector<std::string> &args) {
+    if (args.size() < 2 || args[1] != COMPACT_OPTION) return false;
+
+    args.erase(args.begin() + 1);
+    return true;
+}
+
+int runCommand(const std::vector<std::string> &args, std::istream &in, std::ostream &out) {
+    if (args.size() > 1 && args[1] == COMPACT_OPTION) {
+        std::vector<std::string> commandArgs(args);
+        removeCompactOption(commandArgs);
+        return runCommand(commandArgs, in, out, true);
+    }
+
+    return runCommand(args, in, out, false);
+}
+
+int runCommand(const std::vector<std::string> &args, std::istream &in, std::ostream &out, bool compact) {
+    const std::string &program = args[0];
+    if (args.size() < 2) {
+        printUsage(out, program);
+        return 1;
+    }
+
+    const std::string &command = args[1];
+
+    if (command == "getGlobalVolume") {
+        out << getGlobalVolume() << std::endl;
+    } else if (command == "setGlobalVolume") {
+        if (args.size() < 3) {
+            out << "Missing volume argument" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        int volume = std::stoi(args[2]);
+        if (volume < 0 || volume > 100) {
+            out << "Volume must be between 0 and 100" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        setGlobalVolume(volume);
+    } else if (command == "isGlobalMuted") {
+        out << isGlobalMuted() << std::endl;
+    } else if (command == "setGlobalMuted") {
+        if (args.size() < 3) {
+            out << "Missing mute argument" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        const std::string &muteStr = args[2];
+        if (muteStr != "1" && muteStr != "0") {
+            out << "Mute must be 1 or 0" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        setGlobalMuted(muteStr == "1");
+    } else if (command == "getSinks") {
+        std::vector<VsNode> nodes;
+        StringArena strings;
+        getVsNodeOfType(&nodes, strings, eRender);
+        printVsNodeVector(out, nodes, "sink", compact);
+    } else if (command == "getSources") {
+        std::vector<VsNode> nodes;
+        StringArena strings;
+        getVsNodeOfType(&nodes, strings, eCapture);
+        printVsNodeVector(out, nodes, "source", compact);
+    } else if (command == "getStreams") {
+        std::vector<VsNode> nodes;
+        StringArena strings;
+        getStreams(&nodes, strings);
+        printVsNodeVector(out, nodes, "stream", compact);
+    } else if (command == "getStatus") {
+        VsStatus status;
+        getStatus(&status);
+        printVsStatus(out, status, compact);
+        clearVsStatus(status);
+    } else if (command == "getVolumeById") {
+        if (args.size() < 3) {
+            std::cerr << "Missing ID argument" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        std::wstring id = fromUtf8(args[2]);
+
+        out << getVolumeById(&id[0]) << std::endl;
+    } else if (command == "setVolumeById") {
+        if (args.size() < 4) {
+            out << "Missing ID and volume arguments" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        std::wstring id = fromUtf8(args[2]);
+
+        int volume = std::stoi(args[3]);
+        if (volume < 0 || volume > 100) {
+            std::cerr << "Volume must be between 0 and 100" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        setVolumeById(&id[0], volume);
+    } else if (command == "isMutedById") {
+        if (args.size() < 3) {
+            std::cerr << "Missing ID argument" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        std::wstring id = fromUtf8(args[2]);
+
+        out << isMutedById(&id[0]) << std::endl;
+    } else if (command == "setMutedById") {
+        if (args.size() < 4) {
+            out << "Missing ID and mute arguments" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        std::wstring id = fromUtf8(args[2]);
+
+        const std::string &muteStr = args[3];
+        if (muteStr != "1" && muteStr != "0") {
+            out << "Mute must be 1 or 0" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        setMutedById(&id[0], muteStr == "1");
+    } else if (command == "setStreamDestination") {
+        if (args.size() < 4) {
+            std::cerr << "Missing ID and destination ID arguments" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        std::wstring id = fromUtf8(args[2]);
+        std::wstring destinationId = fromUtf8(args[3]);
+
+        setStreamDestination(&id[0], &destinationId[0]);
+    } else if (command == "ramp") {
+        return runRamp(args, out, compact);
+    } else if (command == "getLevels") {
+        long interval = DEFAULT_LEVELS_INTERVAL_MS;
+        if (args.size() > 2 && (!parseInteger(args[2], interval) || interval <= 0)) {
+            std::cerr << "Interval must be positive" << std::endl;
+            printUsage(out, program);
+            return 1;
+        }
+
+        std::vector<VsLevel> levels;
+        StringArena strings;
+        if (!getLevelsOnce(&levels, strings, std::chrono::milliseconds(interval))) {
+            return 1;
+        }
+        printVsLevels(out, levels, compact);
+    } else if (command == "batch") {
+        return runBatch(args, in, out, compact);
+    } else {
+        out << "Unknown command: " << command << std::endl;
+        printUsage(out, program);
+        return 1;
+    }
+
+    return 0;
+}
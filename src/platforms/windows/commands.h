@@ -0,0 +1,55 @@
+#ifndef VSEXEC_COMMANDS_H
+#define VSEXEC_COMMANDS_H
+
+#include "audio.h"
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+void printUsage(std::ostream &out, const std::string &program);
+
+std::vector<std::string> splitFields(const std::string &line);
+
+// Parse a whole argument as a base 10 integer, false when it isn't one or doesn't fit
+bool parseInteger(const std::string &str, long &value);
+
+std::string toString(LPWSTR str);
+
+// Decode UTF-8, e.g. the names given by the Linux servers or the IDs given by Node, invalid bytes become U+FFFD
+std::wstring fromUtf8(const std::string &str);
+
+// Write the status as a JSON document, indented or on a single line when compact
+void printVsStatus(std::ostream &out, VsStatus &status, bool compact);
+
+// Remove the leading --compact option of a command line, true when it was given
+bool removeCompactOption(std::vector<std::string> &args);
+
+/**
+ * Run a single vsExec command.
+ * @param args The command line, args[0] being the program name and args[1] the command, or --compact followed by it
+ * @param in The stream commands read their extra input from, e.g. the batch operations
+ * @param out The stream the command result is written to
+ * @return The exit code of the command, 0 on success
+ */
+int runCommand(const std::vector<std::string> &args, std::istream &in, std::ostream &out);
+
+/**
+ * Run a single vsExec command, without looking for the --compact option.
+ * @param compact Whether the JSON results are written on a single line instead of indented
+ */
+int runCommand(const std::vector<std::string> &args, std::istream &in, std::ostream &out, bool compact);
+
+// Completion of a command answered later, with its exit code, output and error output
+using CommandDone = std::function<void(int code, const std::string &output, const std::string &error)>;
+
+/**
+ * Start a ramp command, answered through done from the ramp thread once the ramp completed or was replaced.
+ * @param args The command line, args[1] being "ramp"
+ * @param out The stream the usage is written to when the arguments are invalid
+ * @return 0 when the ramp started, otherwise the exit code of the command and done is not called
+ */
+int startRampCommand(const std::vector<std::string> &args, std::ostream &out, bool compact, const CommandDone &done);
+
+#endif
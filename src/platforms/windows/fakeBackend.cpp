@@ -0,0 +1,447 @@
+// In-memory audio backend, used to build and test vsExec without WASAPI
+#include "audio.h"
+#include "fakeBackend.h"
+#include "levels.h"
+#include "stats.h"
+#include "taskPool.h"
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+struct FakeNode {
+    std::wstring id;
+    std::wstring name;
+    int volume;
+    bool muted;
+    std::wstring destinationId;
+};
+
+std::vector<FakeNode> fakeSinks;
+std::vector<FakeNode> fakeSources;
+std::vector<FakeNode> fakeStreams;
+// Nodes by ID, the vectors don't change size between initialize and uninitialize
+std::unordered_map<std::wstring, FakeNode *> fakeNodesById;
+// Streams routed to each sink, and to none of them
+std::vector<size_t> fakeSinkStreamCounts;
+size_t fakeUnroutedStreamCount = 0;
+
+size_t getEnvironmentCount(const char *name) {
+    const char *value = std::getenv(name);
+    return value == nullptr ? 0 : std::strtoul(value, nullptr, 10);
+}
+
+FakeBackendOptions getFakeBackendOptionsFromEnvironment() {
+    FakeBackendOptions options;
+    options.sinkCount = getEnvironmentCount("VS_FAKE_SINKS");
+    options.sourceCount = getEnvironmentCount("VS_FAKE_SOURCES");
+    options.streamCount = getEnvironmentCount("VS_FAKE_STREAMS");
+    options.latency = std::chrono::microseconds(getEnvironmentCount("VS_FAKE_LATENCY_US"));
+    return options;
+}
+
+FakeBackendOptions fakeOptions = getFakeBackendOptionsFromEnvironment();
+
+void configureFakeBackend(const FakeBackendOptions &options) {
+    fakeOptions = options;
+}
+
+// Wait as long as the given number of round trips to the audio service
+void simulateLatency(size_t roundTrips = 1) {
+    if (fakeOptions.latency.count() > 0) {
+        std::this_thread::sleep_for(fakeOptions.latency * roundTrips);
+    }
+}
+
+// Round trips of an enumeration walking the devices on the enumeration pool as WASAPI does: one for the call, then
+// one per device and one per stream of a sink, waited for in the task of the device
+void simulateEnumerationLatency(bool withSinks, bool withSources, bool withStreams) {
+    StatTimer timer(withSinks || withSources ? VsStat::Devices : VsStat::Sessions);
+    if (fakeOptions.latency.count() == 0) return;
+
+    simulateLatency(1 + (withStreams ? fakeUnroutedStreamCount : 0));
+
+    size_t sinkCount = withSinks || withStreams ? fakeSinks.size() : 0;
+    size_t sourceCount = withSources ? fakeSources.size() : 0;
+    getEnumerationPool().run(sinkCount + sourceCount, [=](size_t i) {
+        if (i >= sinkCount) {
+            simulateLatency();
+        } else {
+            simulateLatency((withSinks ? 1 : 0) + (withStreams ? fakeSinkStreamCounts[i] : 0));
+        }
+    });
+}
+
+// Events of the changes made while watching, the fake backend has no external notifications
+std::mutex fakeEventsMutex;
+std::condition_variable fakeEventsChanged;
+std::vector<VsEvent> fakeEvents;
+bool fakeWatching = false;
+
+void initializeFixture() {
+    fakeSinks = {
+            {L"{0.0.0.00000000}.{sink-speakers}",   L"Speakers",   50, false, L""},
+            {L"{0.0.0.00000000}.{sink-headphones}", L"Headphones", 30, false, L""},
+    };
+    fakeSources = {
+            {L"{0.0.1.00000000}.{source-microphone}", L"Microphone", 80, false, L""},
+    };
+    fakeStreams = {
+            {L"{0.0.0.00000000}.{sink-speakers}|\\Device\\app.exe%b{stream-1}", L"App", 100, false,
+             L"{0.0.0.00000000}.{sink-speakers}"},
+            {L"{0.0.0.00000000}.{sink-headphones}|\\Device\\player.exe%b{stream-2}", L"Player", 60, true,
+             L"{0.0.0.00000000}.{sink-headphones}"},
+    };
+}
+
+void generateFakeNodes() {
+    for (size_t i = 0; i < fakeOptions.sinkCount; i++) {
+        fakeSinks.push_back({L"{0.0.0.00000000}.{sink-" + std::to_wstring(i) + L"}", L"Sink " + std::to_wstring(i),
+                             50, false, L""});
+    }
+    for (size_t i = 0; i < fakeOptions.sourceCount; i++) {
+        fakeSources.push_back({L"{0.0.1.00000000}.{source-" + std::to_wstring(i) + L"}",
+                               L"Source " + std::to_wstring(i), 80, false, L""});
+    }
+    for (size_t i = 0; i < fakeOptions.streamCount; i++) {
+        // Same shape as the WASAPI session instance identifiers
+        std::wstring sinkId = fakeSinks.empty() ? L"" : fakeSinks[i % fakeSinks.size()].id;
+        fakeStreams.push_back({sinkId + L"|\\Device\\HarddiskVolume3\\Program Files\\App" + std::to_wstring(i) +
+                               L"\\app.exe%b{stream-" + std::to_wstring(i) + L"}", L"App " + std::to_wstring(i),
+                               (int) (i % 101), i % 2 == 1, sinkId});
+    }
+}
+
+void initialize() {
+    if (fakeOptions.sinkCount > 0 || fakeOptions.sourceCount > 0 || fakeOptions.streamCount > 0) {
+        generateFakeNodes();
+    } else {
+        initializeFixture();
+    }
+
+    for (std::vector<FakeNode> *fakeNodes: {&fakeSinks, &fakeSources, &fakeStreams}) {
+        for (FakeNode &fakeNode: *fakeNodes) {
+            fakeNodesById[fakeNode.id] = &fakeNode;
+        }
+    }
+
+    fakeSinkStreamCounts.assign(fakeSinks.size(), 0);
+    for (FakeNode &fakeStream: fakeStreams) {
+        auto sink = fakeNodesById.find(fakeStream.destinationId);
+        if (sink != fakeNodesById.end() && sink->second >= fakeSinks.data() &&
+            sink->second < fakeSinks.data() + fakeSinks.size()) {
+            fakeSinkStreamCounts[sink->second - fakeSinks.data()]++;
+        } else {
+            fakeUnroutedStreamCount++;
+        }
+    }
+}
+
+void uninitialize() {
+    releaseEnumerationPool();
+    fakeSinkStreamCounts.clear();
+    fakeUnroutedStreamCount = 0;
+    fakeNodesById.clear();
+    fakeSinks.clear();
+    fakeSources.clear();
+    fakeStreams.clear();
+}
+
+void initializeThread() {
+}
+
+void clearRequestState() {
+}
+
+void enableChangeTracking() {
+}
+
+FakeNode *getFakeNodeById(LPWSTR id) {
+    auto fakeNode = fakeNodesById.find(id);
+    return fakeNode == fakeNodesById.end() ? nullptr : fakeNode->second;
+}
+
+// The strings go to the arena, or on the heap for event nodes when it is null
+void toVsNodes(std::vector<VsNode> *nodes, std::vector<FakeNode> &fakeNodes, bool hasDefault, StringArena *strings) {
+    for (size_t i = 0; i < fakeNodes.size(); i++) {
+        FakeNode &fakeNode = fakeNodes[i];
+
+        VsNode node;
+        node.id = copyVsString(strings, fakeNode.id);
+        node.name = copyVsString(strings, fakeNode.name);
+        node.volume = fakeNode.volume;
+        node.muted = fakeNode.muted;
+        node.isDefault = hasDefault && i == 0;
+        node.destinationId = fakeNode.destinationId.empty() ? nullptr : copyVsString(strings, fakeNode.destinationId);
+        nodes->push_back(node);
+    }
+}
+
+const char *getFakeNodeType(FakeNode *fakeNode) {
+    if (!fakeSinks.empty() && fakeNode >= &fakeSinks.front() && fakeNode <= &fakeSinks.back()) return "sink";
+    if (!fakeSources.empty() && fakeNode >= &fakeSources.front() && fakeNode <= &fakeSources.back()) return "source";
+    return "stream";
+}
+
+void notifyChanged(FakeNode *fakeNode) {
+    std::lock_guard<std::mutex> lock(fakeEventsMutex);
+    if (!fakeWatching) return;
+
+    std::vector<FakeNode> changed = {*fakeNode};
+    std::vector<VsNode> nodes;
+    toVsNodes(&nodes, changed, false, nullptr);
+    nodes[0].isDefault = (!fakeSinks.empty() && fakeNode == &fakeSinks[0]) ||
+                         (!fakeSources.empty() && fakeNode == &fakeSources[0]);
+
+    fakeEvents.push_back({VsEventType::Changed, getFakeNodeType(fakeNode), nodes[0]});
+    fakeEventsChanged.notify_all();
+}
+
+// Default device functions, the first sink is the default one
+int getGlobalVolume() {
+    simulateLatency();
+    return fakeSinks.empty() ? 0 : fakeSinks[0].volume;
+}
+
+void setGlobalVolume(int volume) {
+    simulateLatency();
+    if (fakeSinks.empty()) return;
+    fakeSinks[0].volume = volume;
+    notifyChanged(&fakeSinks[0]);
+}
+
+bool isGlobalMuted() {
+    simulateLatency();
+    return !fakeSinks.empty() && fakeSinks[0].muted;
+}
+
+void setGlobalMuted(bool mute) {
+    simulateLatency();
+    if (fakeSinks.empty()) return;
+    fakeSinks[0].muted = mute;
+    notifyChanged(&fakeSinks[0]);
+}
+
+// Get VsNode functions
+void getVsNodeOfType(std::vector<VsNode> *nodes, StringArena &strings, EDataFlow dataFlow) {
+    simulateEnumerationLatency(dataFlow != eCapture, dataFlow == eCapture, false);
+    toVsNodes(nodes, dataFlow == eCapture ? fakeSources : fakeSinks, true, &strings);
+}
+
+void getStreams(std::vector<VsNode> *nodes, StringArena &strings) {
+    simulateEnumerationLatency(false, false, true);
+    toVsNodes(nodes, fakeStreams, false, &strings);
+}
+
+void getStatus(VsStatus *status) {
+    simulateEnumerationLatency(true, true, true);
+    toVsNodes(&status->sinks, fakeSinks, true, &status->strings);
+    toVsNodes(&status->sources, fakeSources, true, &status->strings);
+    toVsNodes(&status->streams, fakeStreams, false, &status->strings);
+
+    if (!fakeSinks.empty()) {
+        status->defaultSink = status->strings.copy(fakeSinks[0].id);
+    }
+    if (!fakeSources.empty()) {
+        status->defaultSource = status->strings.copy(fakeSources[0].id);
+    }
+}
+
+int getVolumeById(LPWSTR id) {
+    simulateLatency();
+    FakeNode *fakeNode = getFakeNodeById(id);
+    if (fakeNode != nullptr) {
+        return fakeNode->volume;
+    }
+
+    std::cerr << "Failed to get volume by ID" << std::endl;
+    return 0;
+}
+
+void setVolumeById(LPWSTR id, int volume) {
+    simulateLatency();
+    FakeNode *fakeNode = getFakeNodeById(id);
+    if (fakeNode != nullptr) {
+        fakeNode->volume = volume;
+        notifyChanged(fakeNode);
+        return;
+    }
+
+    std::cerr << "Failed to set volume by ID" << std::endl;
+}
+
+bool isMutedById(LPWSTR id) {
+    simulateLatency();
+    FakeNode *fakeNode = getFakeNodeById(id);
+    if (fakeNode != nullptr) {
+        return fakeNode->muted;
+    }
+
+    std::cerr << "Failed to get mute state by ID" << std::endl;
+    return false;
+}
+
+void setMutedById(LPWSTR id, bool mute) {
+    simulateLatency();
+    FakeNode *fakeNode = getFakeNodeById(id);
+    if (fakeNode != nullptr) {
+        fakeNode->muted = mute;
+        notifyChanged(fakeNode);
+        return;
+    }
+
+    std::cerr << "Failed to set mute state by ID" << std::endl;
+}
+
+void setStreamDestination(LPWSTR id, LPWSTR destinationId) {
+    simulateLatency();
+    FakeNode *fakeNode = getFakeNodeById(id);
+    FakeNode *destination = getFakeNodeById(destinationId);
+    if (fakeNode == nullptr || std::string(getFakeNodeType(fakeNode)) != "stream" || destination == nullptr ||
+        std::string(getFakeNodeType(destination)) != "sink") {
+        std::cerr << "Failed to set stream destination" << std::endl;
+        return;
+    }
+
+    fakeNode->destinationId = destination->id;
+    notifyChanged(fakeNode);
+}
+
+void applyBatch(std::vector<VsBatchOperation> &operations) {
+    // The IDs are resolved at once, then each operation is a call of its own
+    simulateLatency(1 + operations.size());
+    for (VsBatchOperation &operation: operations) {
+        if (operation.error != nullptr) continue;
+
+        FakeNode *fakeNode = getFakeNodeById(operation.id);
+        if (fakeNode == nullptr) {
+            operation.error = "Node not found";
+            continue;
+        }
+
+        switch (operation.type) {
+            case VsBatchOperationType::GetVolumeInfo:
+                operation.volume = fakeNode->volume;
+                operation.muted = fakeNode->muted;
+                break;
+            case VsBatchOperationType::SetVolume:
+                fakeNode->volume = operation.volume;
+                notifyChanged(fakeNode);
+                break;
+            case VsBatchOperationType::SetMuted:
+                fakeNode->muted = operation.muted;
+                notifyChanged(fakeNode);
+                break;
+        }
+    }
+}
+
+// Volume control functions
+struct VsVolumeControl {
+    FakeNode *fakeNode;
+};
+
+VsVolumeControl *openVolumeControl(LPWSTR id) {
+    simulateLatency();
+    FakeNode *fakeNode = getFakeNodeById(id);
+    return fakeNode == nullptr ? nullptr : new VsVolumeControl{fakeNode};
+}
+
+void closeVolumeControl(VsVolumeControl *control) {
+    delete control;
+}
+
+bool getControlLevel(VsVolumeControl *control, float &level) {
+    level = (float) control->fakeNode->volume / 100;
+    return true;
+}
+
+bool setControlLevel(VsVolumeControl *control, float level) {
+    simulateLatency();
+    int volume = (int) std::lround(level * 100);
+    if (volume != control->fakeNode->volume) {
+        control->fakeNode->volume = volume;
+        notifyChanged(control->fakeNode);
+    }
+    return true;
+}
+
+// Level functions, every node plays a sine at its volume, synthesized for the time since the previous read
+const int FAKE_LEVEL_SAMPLE_RATE = 8000;
+const double FAKE_LEVEL_FREQUENCY = 440;
+const double FAKE_LEVEL_PI = 3.14159265358979323846;
+
+bool fakeMetering = false;
+std::chrono::steady_clock::time_point fakeLevelsRead;
+size_t fakeLevelPhase = 0;
+std::vector<float> fakeLevelSamples;
+
+bool openLevelMeters() {
+    if (!fakeMetering) {
+        fakeMetering = true;
+        fakeLevelsRead = std::chrono::steady_clock::now();
+    }
+    return true;
+}
+
+void readLevels(std::vector<VsLevel> *levels, StringArena &strings) {
+    if (!fakeMetering) return;
+
+    // Up to a second of samples, the sine being the same for every node only its amplitude differs
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - fakeLevelsRead).count();
+    auto sampleCount = (size_t) std::min<long long>(elapsed * FAKE_LEVEL_SAMPLE_RATE / 1000000,
+                                                    FAKE_LEVEL_SAMPLE_RATE);
+    fakeLevelsRead = now;
+
+    fakeLevelSamples.resize(sampleCount);
+    for (size_t i = 0; i < sampleCount; i++) {
+        double time = (double) (fakeLevelPhase + i) / FAKE_LEVEL_SAMPLE_RATE;
+        fakeLevelSamples[i] = (float) std::sin(2 * FAKE_LEVEL_PI * FAKE_LEVEL_FREQUENCY * time);
+    }
+    fakeLevelPhase = (fakeLevelPhase + sampleCount) % FAKE_LEVEL_SAMPLE_RATE;
+
+    LevelAccumulator accumulator;
+    accumulator.add(fakeLevelSamples.data(), fakeLevelSamples.size());
+
+    for (std::vector<FakeNode> *fakeNodes: {&fakeSinks, &fakeSources, &fakeStreams}) {
+        for (FakeNode &fakeNode: *fakeNodes) {
+            float amplitude = fakeNode.muted ? 0 : (float) fakeNode.volume / 100;
+            levels->push_back({getFakeNodeType(&fakeNode), copyVsString(&strings, fakeNode.id),
+                               accumulator.peak * amplitude, accumulator.getRms() * amplitude});
+        }
+    }
+}
+
+void closeLevelMeters() {
+    fakeMetering = false;
+    fakeLevelPhase = 0;
+}
+
+// Watch functions
+bool startWatch() {
+    std::lock_guard<std::mutex> lock(fakeEventsMutex);
+    fakeWatching = true;
+    return true;
+}
+
+bool waitForEvents(std::vector<VsEvent> &events, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(fakeEventsMutex);
+    fakeEventsChanged.wait_for(lock, std::chrono::milliseconds(timeoutMs), []() { return !fakeEvents.empty(); });
+
+    events.insert(events.end(), fakeEvents.begin(), fakeEvents.end());
+    fakeEvents.clear();
+    return true;
+}
+
+void stopWatch() {
+    std::lock_guard<std::mutex> lock(fakeEventsMutex);
+    fakeWatching = false;
+    clearVsEvents(fakeEvents);
+}
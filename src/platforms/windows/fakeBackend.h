@@ -0,0 +1,28 @@
+#ifndef VSEXEC_FAKE_BACKEND_H
+#define VSEXEC_FAKE_BACKEND_H
+
+#include <chrono>
+#include <cstddef>
+
+/**
+ * Shape of the in-memory backend, read by initialize.
+ *
+ * Without any count the backend holds a small fixture of two sinks, a microphone and two streams. With counts it
+ * generates that many synthetic nodes instead, the streams spread over the sinks, to profile the core against systems
+ * far busier than a real one.
+ */
+struct FakeBackendOptions {
+    size_t sinkCount = 0;
+    size_t sourceCount = 0;
+    size_t streamCount = 0;
+    // Cost of a round trip to the audio service: paid once per backend call and once per node enumerated
+    std::chrono::microseconds latency{0};
+};
+
+// Options taken from VS_FAKE_SINKS, VS_FAKE_SOURCES, VS_FAKE_STREAMS and VS_FAKE_LATENCY_US, the defaults otherwise
+FakeBackendOptions getFakeBackendOptionsFromEnvironment();
+
+// Replace the options used by the next initialize, the environment ones are used until then
+void configureFakeBackend(const FakeBackendOptions &options);
+
+#endif
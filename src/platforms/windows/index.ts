@@ -1,23 +1,167 @@
-import { PlatformImplementation, Status, VsNode, VsStreamNode } from '@/types';
+import {
+  BatchOperation,
+  BatchResult,
+  LevelsListener,
+  NodeLevel,
+  PlatformImplementation,
+  RampCurve,
+  RampResult,
+  Status,
+  VolumeInfo,
+  VsNode,
+  VsStreamNode,
+} from '@/types';
 import { throwCompatibilityError } from '@/utils/errors';
 import ToElectronPath from '@/utils/toEletcronPath';
 import { execCommand } from '@/utils/commands';
 import { join } from 'path';
+import { VsExecServer, VsExecServerError } from '@/utils/vsExecServer';
+import { VsExecWatcher } from '@/utils/vsExecWatcher';
+import { applyBatchWrites, getBatchIds, resolveBatchResults, toBatchInput } from '@/utils/batch';
+import { withAddon } from '@/utils/addon';
+import { getRampArgs, rampWithSteps, validateRamp } from '@/utils/ramp';
+import { getLevelsArgs, VsExecLevelWatchers } from '@/utils/levels';
+import { countParsedBytes } from '@/utils/metrics';
+import { VsExecCapabilities } from '@/utils/vsExecCapabilities';
+import { createWatch, Emit, KeepAlive, NodeStates, StopWatch } from '@/utils/watch';
 
 const EXE_NAME = 'vsExec.exe';
+const EXE_PATH = ToElectronPath(join(__dirname, EXE_NAME));
+// Executables without the watch mode are polled, faster right after a change and slower while nothing changes
+const POLL_MIN_INTERVAL = 500;
+const POLL_MAX_INTERVAL = 4000;
 
-function execVsCmd(args: string[]) {
-  return execCommand(
-    ToElectronPath(join(__dirname, EXE_NAME)),
-    args,
-  ).catch((err) => {
+const capabilities = new VsExecCapabilities(EXE_PATH);
+const server = new VsExecServer(EXE_PATH);
+const watcher = new VsExecWatcher(EXE_PATH);
+const levelWatchers = new VsExecLevelWatchers(EXE_PATH);
+
+function runVsCmd(args: string[], input?: string[]) {
+  // Like the server, failures of the setters are only reported on the error output
+  const oneShot = () => execCommand(EXE_PATH, args, {
+    input: input?.map((line) => line + '\n').join(''),
+    failOnStderr: true,
+  });
+  if (!server.isSupported()) return oneShot();
+
+  // Fall back to a one-shot process when the server died or the executable doesn't support it.
+  // Executables with the serve mode also write their JSON on a single line, cheaper to parse
+  return server.request(['--compact', ...args], input).catch((err) => {
+    if (err instanceof VsExecServerError) return oneShot();
+    throw err;
+  });
+}
+
+function execVsCmd(args: string[], input?: string[]) {
+  return runVsCmd(args, input).then((output) => {
+    countParsedBytes('vsExec', output);
+    return output;
+  }, (err) => {
     console.error(`Failed to execute vsExec.exe with args: ${args.join(' ')}`);
     console.error(err);
     throw new Error('Failed to execute vsExec.exe');
   });
 }
 
-export const windows: PlatformImplementation = {
+// Executables older than getStatus list each type of node with its own command
+async function getStatusByType(): Promise<Status> {
+  const [sinksStr, sourcesStr, streamsStr] = await Promise.all([
+    execVsCmd(['getSinks']),
+    execVsCmd(['getSources']),
+    execVsCmd(['getStreams']),
+  ]);
+  try {
+    const sinks = JSON.parse(sinksStr) as VsNode[];
+    const sources = JSON.parse(sourcesStr) as VsNode[];
+    const streams = JSON.parse(streamsStr) as VsStreamNode[];
+
+    return {
+      sinks,
+      sources,
+      streams,
+      defaultSink: sinks.find((sink) => sink.isDefault)?.id,
+      defaultSource: sources.find((source) => source.isDefault)?.id,
+    };
+  } catch (e) {
+    console.error(streamsStr);
+    throw new Error('Failed to get status');
+  }
+}
+
+// Executables older than batch apply each operation with its own command
+async function applyBatchOneByOne(operations: BatchOperation[]) {
+  const nodes = new Map<string, VolumeInfo>();
+  await Promise.all(getBatchIds(operations).map(async (id) => {
+    try {
+      nodes.set(id, await windowsExec.getNodeVolumeInfoById(id));
+    } catch (e) {
+      // Not found, reported in the results
+    }
+  }));
+
+  const errors = await applyBatchWrites(operations, nodes, windowsExec.setNodeVolumeById, windowsExec.setNodeMutedById);
+
+  return resolveBatchResults(operations, nodes, errors);
+}
+
+function pollStatus(emit: Emit, keepAlive: KeepAlive): StopWatch {
+  const states = new NodeStates();
+  let interval = POLL_MIN_INTERVAL;
+  let stopped = false;
+  let timer: NodeJS.Timeout | null = null;
+  let polled = false;
+
+  const poll = async () => {
+    keepAlive.release(timer);
+    try {
+      const status = await windowsExec.getStatus();
+      if (!polled) {
+        // Only the changes after the first reading are emitted
+        states.reset(status);
+        polled = true;
+      }
+
+      let changed = false;
+      states.updateStatus(status, (event) => {
+        changed = true;
+        emit(event);
+      });
+      interval = changed ? POLL_MIN_INTERVAL : Math.min(interval * 2, POLL_MAX_INTERVAL);
+    } catch (e) {
+      console.error(e);
+      interval = POLL_MAX_INTERVAL;
+    }
+
+    if (!stopped) timer = keepAlive.hold(setTimeout(poll, interval));
+  };
+
+  poll();
+
+  return () => {
+    stopped = true;
+    if (timer) clearTimeout(timer);
+    keepAlive.release(timer);
+  };
+}
+
+// The watch mode is only started once the usage of the executable lists it, older executables print their usage
+// instead of events
+function startWatch(emit: Emit, keepAlive: KeepAlive): StopWatch {
+  let stop: StopWatch | null = null;
+  let stopped = false;
+
+  capabilities.supports('watch').then((supported) => {
+    if (!stopped) stop = supported ? watcher.watch(emit, keepAlive) : pollStatus(emit, keepAlive);
+  });
+
+  return () => {
+    stopped = true;
+    stop?.();
+  };
+}
+
+// vsExec implementation, used as is when the native addon isn't built
+export const windowsExec: PlatformImplementation = {
   getPlatformCompatibility: () => ({
     status: true,
     listStreams: true,
@@ -28,6 +172,10 @@ export const windows: PlatformImplementation = {
     setSourceVolume: true,
     getStreamDestination: true,
     setStreamDestination: false,
+    watch: true,
+    // Older executables are polled
+    watchEvents: capabilities.has('watch'),
+    levels: levelWatchers.isSupported() && !capabilities.isMissing('getLevels') && !capabilities.isMissing('levels'),
   }),
   async getGlobalVolume() {
     const res = await execVsCmd(['getGlobalVolume']);
@@ -48,29 +196,16 @@ export const windows: PlatformImplementation = {
   async setGlobalMuted(muted: boolean) {
     await execVsCmd(['setGlobalMuted', muted ? '1' : '0']);
   },
-  async getStatus() {
-    const sinksStr = await execVsCmd(['getSinks']);
-    const sourcesStr = await execVsCmd(['getSources']);
-    const streamsStr = await execVsCmd(['getStreams']);
-    try {
-      const sinks = JSON.parse(sinksStr) as VsNode[];
-      const sources = JSON.parse(sourcesStr) as VsNode[];
-      const streams = JSON.parse(streamsStr) as VsStreamNode[];
-
-      const status: Status = {
-        sinks,
-        sources,
-        streams,
-
-        defaultSink: sinks.find((sink: any) => sink.isDefault)?.id,
-        defaultSource: sources.find((source: any) => source.isDefault)?.id,
-      };
-
-      return status;
-    } catch (e) {
-      console.error(streamsStr);
-      throw new Error('Failed to get status');
-    }
+  getStatus() {
+    return capabilities.run('getStatus', async () => {
+      const statusStr = await execVsCmd(['getStatus']);
+      try {
+        return JSON.parse(statusStr) as Status;
+      } catch (e) {
+        console.error(statusStr);
+        throw new Error('Failed to get status');
+      }
+    }, getStatusByType);
   },
   async getNodeVolumeInfoById(id: string) {
     const volumeStr = await execVsCmd(['getVolumeById', id]);
@@ -95,4 +230,55 @@ export const windows: PlatformImplementation = {
     await execVsCmd(['setMutedById', id, muted ? '1' : '0']);
   },
   setStreamDestination: throwCompatibilityError,
-};
\ No newline at end of file
+  applyBatch(operations: BatchOperation[]) {
+    return capabilities.run('batch', async () => {
+      const resultsStr = await execVsCmd(['batch', operations.length.toString()], toBatchInput(operations));
+      try {
+        return JSON.parse(resultsStr) as BatchResult[];
+      } catch (e) {
+        console.error(resultsStr);
+        throw new Error('Failed to apply batch');
+      }
+    }, () => applyBatchOneByOne(operations));
+  },
+  async rampNodeVolume(id: string, volume: number, durationMs: number, curve: RampCurve = 'linear') {
+    validateRamp(volume, durationMs, curve);
+
+    return capabilities.run('ramp', async () => {
+      // Answered once the ramp ended, the server keeps answering the other requests meanwhile
+      const resultStr = await execVsCmd(getRampArgs(id, volume, durationMs, curve));
+      try {
+        return JSON.parse(resultStr) as RampResult;
+      } catch (e) {
+        console.error(resultStr);
+        throw new Error('Failed to ramp volume');
+      }
+    }, () => rampWithSteps(
+      id, volume, durationMs, curve,
+      async (id) => (await windowsExec.getNodeVolumeInfoById(id)).volume,
+      windowsExec.setNodeVolumeById,
+    ));
+  },
+  watch: createWatch(startWatch),
+  getLevels(intervalMs?: number) {
+    const args = getLevelsArgs(intervalMs);
+
+    // Not metered by older executables
+    return capabilities.run('getLevels', async () => {
+      const levelsStr = await execVsCmd(args);
+      try {
+        return JSON.parse(levelsStr) as NodeLevel[];
+      } catch (e) {
+        console.error(levelsStr);
+        throw new Error('Failed to get levels');
+      }
+    }, async () => throwCompatibilityError());
+  },
+  watchLevels(listener: LevelsListener, rateHz?: number) {
+    if (capabilities.isMissing('levels')) throwCompatibilityError();
+
+    return levelWatchers.watch(listener, rateHz);
+  },
+};
+
+export const windows = withAddon(windowsExec, 'wasapi');
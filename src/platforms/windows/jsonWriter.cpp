@@ -0,0 +1,192 @@
+#include "jsonWriter.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+void appendCodePoint(std::string &out, unsigned long codePoint) {
+    if (codePoint < 0x80) {
+        out += (char) codePoint;
+    } else if (codePoint < 0x800) {
+        out += (char) (0xC0 | (codePoint >> 6));
+        out += (char) (0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += (char) (0xE0 | (codePoint >> 12));
+        out += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char) (0x80 | (codePoint & 0x3F));
+    } else {
+        out += (char) (0xF0 | (codePoint >> 18));
+        out += (char) (0x80 | ((codePoint >> 12) & 0x3F));
+        out += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char) (0x80 | (codePoint & 0x3F));
+    }
+}
+
+// Decode the code point at c, moving c past a surrogate pair
+unsigned long nextCodePoint(LPWSTR &c) {
+    unsigned long codePoint = (unsigned long) *c;
+    if (codePoint >= 0xD800 && codePoint <= 0xDBFF && c[1] >= 0xDC00 && c[1] <= 0xDFFF) {
+        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + ((unsigned long) c[1] - 0xDC00);
+        c++;
+    } else if ((codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF) {
+        // Not encodable, e.g. a truncated pair in a process description
+        codePoint = 0xFFFD;
+    }
+
+    return codePoint;
+}
+
+void appendUtf8(std::string &out, LPWSTR str) {
+    for (LPWSTR c = str; *c != 0; c++) {
+        appendCodePoint(out, nextCodePoint(c));
+    }
+}
+
+const char HEX_DIGITS[] = "0123456789abcdef";
+
+void appendEscaped(std::string &out, unsigned long codePoint) {
+    switch (codePoint) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (codePoint < 0x20) {
+                out += "\\u00";
+                out += HEX_DIGITS[codePoint >> 4];
+                out += HEX_DIGITS[codePoint & 0xF];
+            } else {
+                appendCodePoint(out, codePoint);
+            }
+    }
+}
+
+JsonWriter::JsonWriter(bool compact) : compact(compact) {
+    // Most documents are a few nodes, the status of a busy system fits without growing
+    buffer.reserve(4096);
+}
+
+bool JsonWriter::isCompact() const {
+    return compact;
+}
+
+JsonWriter &JsonWriter::raw(const char *json) {
+    buffer += json;
+    return *this;
+}
+
+JsonWriter &JsonWriter::newline() {
+    if (!compact) buffer += '\n';
+    return *this;
+}
+
+JsonWriter &JsonWriter::indent() {
+    if (!compact) buffer += "  ";
+    return *this;
+}
+
+JsonWriter &JsonWriter::key(const char *name) {
+    // Field names are literals of the protocol, never in need of escaping
+    buffer += '"';
+    buffer += name;
+    buffer += compact ? "\":" : "\": ";
+    return *this;
+}
+
+// Printable ASCII written as is, the bulk of the IDs and names
+inline bool isPlainAscii(WCHAR c) {
+    return c >= 0x20 && c < 0x80 && c != '"' && c != '\\';
+}
+
+JsonWriter &JsonWriter::string(LPWSTR str) {
+    buffer += '"';
+    for (LPWSTR c = str; *c != 0;) {
+        LPWSTR run = c;
+        while (isPlainAscii(*c)) {
+            c++;
+        }
+
+        if (c != run) {
+            // Copied at once instead of growing the buffer character by character
+            size_t size = buffer.size();
+            buffer.resize(size + (c - run));
+            std::copy(run, c, buffer.begin() + (std::string::difference_type) size);
+        }
+        if (*c != 0) {
+            appendEscaped(buffer, nextCodePoint(c));
+            c++;
+        }
+    }
+    buffer += '"';
+    return *this;
+}
+
+JsonWriter &JsonWriter::string(const char *str) {
+    // Already UTF-8, only the ASCII characters need escaping
+    buffer += '"';
+    for (const char *c = str; *c != 0; c++) {
+        if ((unsigned char) *c < 0x80) {
+            appendEscaped(buffer, (unsigned char) *c);
+        } else {
+            buffer += *c;
+        }
+    }
+    buffer += '"';
+    return *this;
+}
+
+JsonWriter &JsonWriter::number(int value) {
+    char digits[16];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+    return *this;
+}
+
+JsonWriter &JsonWriter::decimal(double value) {
+    // In thousandths, so only integers are formatted: no locale and no shortest representation search
+    long long thousandths = std::llround(value * 1000);
+    if (thousandths < 0) {
+        buffer += '-';
+        thousandths = -thousandths;
+    }
+
+    char digits[24];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), thousandths / 1000);
+    buffer.append(digits, result.ptr);
+
+    char fraction[4] = {'.', (char) ('0' + thousandths / 100 % 10), (char) ('0' + thousandths / 10 % 10),
+                        (char) ('0' + thousandths % 10)};
+    buffer.append(fraction, sizeof(fraction));
+    return *this;
+}
+
+JsonWriter &JsonWriter::boolean(bool value) {
+    buffer += value ? "true" : "false";
+    return *this;
+}
+
+const std::string &JsonWriter::str() const {
+    return buffer;
+}
+
+void JsonWriter::writeTo(std::ostream &out) {
+    buffer += '\n';
+    out.write(buffer.data(), (std::streamsize) buffer.size());
+    buffer.pop_back();
+}
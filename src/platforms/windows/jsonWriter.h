@@ -0,0 +1,48 @@
+#ifndef VSEXEC_JSON_WRITER_H
+#define VSEXEC_JSON_WRITER_H
+
+#include "audio.h"
+#include <ostream>
+#include <string>
+
+// Append a wide string as UTF-8, from UTF-16 on Windows and UTF-32 elsewhere, lone surrogates become U+FFFD
+void appendUtf8(std::string &out, LPWSTR str);
+
+/**
+ * Builds a JSON document in memory, so it is written to the output at once instead of a write per field.
+ *
+ * The structure is written by the caller with raw(), newline() and indent(), the latter two being dropped in compact
+ * mode so a document fits on a single line (NDJSON). Strings are escaped and encoded to UTF-8 in a single pass.
+ */
+class JsonWriter {
+public:
+    explicit JsonWriter(bool compact = false);
+
+    bool isCompact() const;
+
+    // JSON syntax written as is, e.g. "{" or ","
+    JsonWriter &raw(const char *json);
+    // A line break, omitted in compact mode
+    JsonWriter &newline();
+    // The indentation of an object field, omitted in compact mode
+    JsonWriter &indent();
+    // A quoted field name and its colon
+    JsonWriter &key(const char *name);
+    JsonWriter &string(LPWSTR str);
+    JsonWriter &string(const char *str);
+    JsonWriter &number(int value);
+    // A number with three decimals, e.g. a level
+    JsonWriter &decimal(double value);
+    JsonWriter &boolean(bool value);
+
+    const std::string &str() const;
+
+    // Write the document followed by a line break in a single write, flushing is left to the caller
+    void writeTo(std::ostream &out);
+
+private:
+    std::string buffer;
+    bool compact;
+};
+
+#endif
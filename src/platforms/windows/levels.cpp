@@ -0,0 +1,206 @@
+#include "levels.h"
+#include "jsonWriter.h"
+#include "stats.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VS_LEVELS_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define VS_LEVELS_NEON
+#endif
+
+// The meters of the nodes added or removed meanwhile are opened or closed at this interval
+const std::chrono::seconds LEVEL_METERS_REFRESH(1);
+
+// Accumulator
+void addSamplesScalar(LevelAccumulator &accumulator, const float *samples, size_t count) {
+    float peak = accumulator.peak;
+    double sumSquares = 0;
+    for (size_t i = 0; i < count; i++) {
+        peak = std::max(peak, std::fabs(samples[i]));
+        sumSquares += samples[i] * samples[i];
+    }
+
+    accumulator.peak = peak;
+    accumulator.sumSquares += sumSquares;
+    accumulator.sampleCount += count;
+}
+
+void LevelAccumulator::add(const float *samples, size_t count) {
+    size_t i = 0;
+    float lanes[4];
+
+    // Two vectors of each, so consecutive blocks don't wait for each other
+#if defined(VS_LEVELS_SSE2)
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 peaks0 = _mm_setzero_ps();
+    __m128 peaks1 = _mm_setzero_ps();
+    __m128 squares0 = _mm_setzero_ps();
+    __m128 squares1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        __m128 block0 = _mm_loadu_ps(samples + i);
+        __m128 block1 = _mm_loadu_ps(samples + i + 4);
+        peaks0 = _mm_max_ps(peaks0, _mm_and_ps(block0, absMask));
+        peaks1 = _mm_max_ps(peaks1, _mm_and_ps(block1, absMask));
+        squares0 = _mm_add_ps(squares0, _mm_mul_ps(block0, block0));
+        squares1 = _mm_add_ps(squares1, _mm_mul_ps(block1, block1));
+    }
+
+    _mm_storeu_ps(lanes, _mm_max_ps(peaks0, peaks1));
+    peak = std::max({peak, lanes[0], lanes[1], lanes[2], lanes[3]});
+    _mm_storeu_ps(lanes, _mm_add_ps(squares0, squares1));
+    sumSquares += (double) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(VS_LEVELS_NEON)
+    float32x4_t peaks0 = vdupq_n_f32(0);
+    float32x4_t peaks1 = vdupq_n_f32(0);
+    float32x4_t squares0 = vdupq_n_f32(0);
+    float32x4_t squares1 = vdupq_n_f32(0);
+    for (; i + 8 <= count; i += 8) {
+        float32x4_t block0 = vld1q_f32(samples + i);
+        float32x4_t block1 = vld1q_f32(samples + i + 4);
+        peaks0 = vmaxq_f32(peaks0, vabsq_f32(block0));
+        peaks1 = vmaxq_f32(peaks1, vabsq_f32(block1));
+        squares0 = vmlaq_f32(squares0, block0, block0);
+        squares1 = vmlaq_f32(squares1, block1, block1);
+    }
+
+    vst1q_f32(lanes, vmaxq_f32(peaks0, peaks1));
+    peak = std::max({peak, lanes[0], lanes[1], lanes[2], lanes[3]});
+    vst1q_f32(lanes, vaddq_f32(squares0, squares1));
+    sumSquares += (double) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+    (void) lanes;
+#endif
+
+    sampleCount += i;
+    addSamplesScalar(*this, samples + i, count - i);
+}
+
+float LevelAccumulator::getRms() const {
+    return sampleCount == 0 ? 0 : (float) std::sqrt(sumSquares / (double) sampleCount);
+}
+
+void LevelAccumulator::reset() {
+    peak = 0;
+    sumSquares = 0;
+    sampleCount = 0;
+}
+
+// Output
+// A level per line even when indented, the separators losing their space in compact mode
+void writeVsLevel(JsonWriter &json, const VsLevel &level) {
+    const char *separator = json.isCompact() ? "," : ", ";
+    json.raw("{").key("type").string(level.nodeType);
+    json.raw(separator).key("id").string(level.id);
+    json.raw(separator).key("peak").decimal(level.peak);
+    if (level.rms >= 0) {
+        json.raw(separator).key("rms").decimal(level.rms);
+    }
+    json.raw("}");
+}
+
+void printVsLevels(std::ostream &out, const std::vector<VsLevel> &levels, bool compact) {
+    StatTimer timer(VsStat::Output);
+    JsonWriter json(compact);
+    json.raw("[").newline();
+    for (size_t i = 0; i < levels.size(); i++) {
+        if (i > 0) json.raw(",").newline();
+        json.indent();
+        writeVsLevel(json, levels[i]);
+    }
+    if (!levels.empty()) json.newline();
+    json.raw("]");
+    json.writeTo(out);
+}
+
+bool getLevelsOnce(std::vector<VsLevel> *levels, StringArena &strings, std::chrono::milliseconds interval) {
+    if (!openLevelMeters()) {
+        closeLevelMeters();
+        return false;
+    }
+
+    std::this_thread::sleep_for(interval);
+    readLevels(levels, strings);
+    closeLevelMeters();
+    return true;
+}
+
+int watchLevels(std::istream &in, std::ostream &out, int rate) {
+    if (!openLevelMeters()) {
+        closeLevelMeters();
+        return 1;
+    }
+
+    // Only the end of the input matters, read it on the side as the watch does
+    auto inputClosed = std::make_shared<std::atomic<bool>>(false);
+    std::thread reader([&in, inputClosed]() {
+        std::string line;
+        while (std::getline(in, line)) {
+        }
+        *inputClosed = true;
+    });
+
+    using Clock = std::chrono::steady_clock;
+    auto interval = std::chrono::microseconds(1000000 / std::max(1, std::min(rate, MAX_LEVEL_RATE)));
+    Clock::time_point nextTick = Clock::now() + interval;
+    Clock::time_point nextRefresh = Clock::now() + LEVEL_METERS_REFRESH;
+
+    int code = 0;
+    // Kept across the ticks, so a tick doesn't allocate once they have grown
+    std::vector<VsLevel> levels;
+    StringArena strings;
+    while (!*inputClosed) {
+        std::this_thread::sleep_until(nextTick);
+        Clock::time_point now = Clock::now();
+        // Ticks missed while the process was stalled are skipped instead of written in a burst
+        nextTick = std::max(nextTick + interval, now);
+
+        if (now >= nextRefresh) {
+            nextRefresh = now + LEVEL_METERS_REFRESH;
+            if (!openLevelMeters()) {
+                code = 1;
+                break;
+            }
+        }
+
+        levels.clear();
+        strings.clear();
+        readLevels(&levels, strings);
+
+        // A single line whatever the mode, as the watch events
+        JsonWriter json;
+        json.raw("{").key("levels").raw("[");
+        for (size_t i = 0; i < levels.size(); i++) {
+            if (i > 0) json.raw(", ");
+            writeVsLevel(json, levels[i]);
+        }
+        json.raw("]}");
+        json.writeTo(out);
+        out.flush();
+
+        // The reading process is gone
+        if (!out) {
+            code = 1;
+            break;
+        }
+    }
+
+    closeLevelMeters();
+
+    if (*inputClosed) {
+        reader.join();
+    } else {
+        // Still blocked on the input, which lives as long as the process
+        reader.detach();
+    }
+
+    return code;
+}
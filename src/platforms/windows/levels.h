@@ -0,0 +1,61 @@
+#ifndef VSEXEC_LEVELS_H
+#define VSEXEC_LEVELS_H
+
+#include "audio.h"
+#include <chrono>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+/*
+ * Levels protocol
+ *
+ * The levels command writes the levels of every node as a single JSON line per tick, until its input is closed:
+ *   {"levels": [{"type": "<sink|source|stream>", "id": "...", "peak": 0.512, "rms": 0.301}, ...]}
+ *
+ * The levels go from 0 to 1 and cover the samples since the previous line. rms is omitted by the backends metering
+ * peaks only (WASAPI). The meters follow the added and removed nodes once a second.
+ */
+
+// Interval of the getLevels command
+const int DEFAULT_LEVELS_INTERVAL_MS = 100;
+// Lines per second of the levels command
+const int DEFAULT_LEVEL_RATE = 30;
+const int MAX_LEVEL_RATE = 120;
+
+// Peak and sum of squares of blocks of float samples, e.g. the PCM recorded from a monitor source
+struct LevelAccumulator {
+    float peak = 0;
+    double sumSquares = 0;
+    size_t sampleCount = 0;
+
+    // Add a block of samples, four at a time with SSE2 or NEON when available
+    void add(const float *samples, size_t count);
+    // Zero without any sample
+    float getRms() const;
+    void reset();
+};
+
+// Same as LevelAccumulator::add one sample at a time, the reference of the tests and benchmarks
+void addSamplesScalar(LevelAccumulator &accumulator, const float *samples, size_t count);
+
+// Write the levels as a JSON array, indented or on a single line when compact
+void printVsLevels(std::ostream &out, const std::vector<VsLevel> &levels, bool compact);
+
+/**
+ * Read the levels once, the meters being opened for a single interval.
+ * @return false when the meters can't be opened, the error being reported on std::cerr
+ */
+bool getLevelsOnce(std::vector<VsLevel> *levels, StringArena &strings, std::chrono::milliseconds interval);
+
+/**
+ * Stream the levels of every node until the input is closed.
+ * @param in The stream whose end stops the levels, its content is ignored
+ * @param out The stream the levels are written to
+ * @param rate The number of lines per second, up to MAX_LEVEL_RATE
+ * @return The exit code of the process
+ */
+int watchLevels(std::istream &in, std::ostream &out, int rate);
+
+#endif
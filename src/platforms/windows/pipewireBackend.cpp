@@ -0,0 +1,893 @@
+// PipeWire backend, keeps the registry nodes, their Props, the links and the default nodes up to date through libpipewire
+#include "audio.h"
+#include "commands.h"
+#include <pipewire/pipewire.h>
+#include <pipewire/extensions/metadata.h>
+#include <spa/param/props.h>
+#include <spa/param/route.h>
+#include <spa/pod/builder.h>
+#include <spa/pod/iter.h>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <cwchar>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+// Same limit as SPA_AUDIO_MAX_CHANNELS
+#define PIPEWIRE_MAX_CHANNELS 64
+
+enum class PipewireNodeType {
+    Sink,
+    Source,
+    Stream,
+};
+
+struct PipewireNode {
+    uint32_t id;
+    PipewireNodeType type;
+    // node.name, matched against the default nodes
+    std::string name;
+    std::string description;
+    std::string serial;
+    // Device and route device of the nodes backed by a card, their volume is set on the device route
+    uint32_t deviceId = SPA_ID_INVALID;
+    int32_t routeDevice = -1;
+    std::vector<float> volumes;
+    bool muted = false;
+    pw_proxy *proxy = nullptr;
+    spa_hook listener;
+};
+
+struct PipewireRoute {
+    int32_t index;
+    int32_t device;
+};
+
+struct PipewireDevice {
+    uint32_t id;
+    // Routes by route device, replaced as the device sends them
+    std::map<int32_t, PipewireRoute> routes;
+    pw_proxy *proxy = nullptr;
+    spa_hook listener;
+};
+
+struct PipewireLink {
+    uint32_t outputNode;
+    uint32_t inputNode;
+};
+
+pw_loop *loop = nullptr;
+pw_context *context = nullptr;
+pw_core *core = nullptr;
+pw_registry *registry = nullptr;
+pw_metadata *defaultMetadata = nullptr;
+spa_hook coreListener;
+spa_hook registryListener;
+spa_hook metadataListener;
+
+std::map<uint32_t, std::unique_ptr<PipewireNode>> pipewireNodes;
+std::map<uint32_t, std::unique_ptr<PipewireDevice>> pipewireDevices;
+std::map<uint32_t, PipewireLink> pipewireLinks;
+std::string defaultSinkName;
+std::string defaultSourceName;
+
+int syncSeq = 0;
+bool synced = false;
+bool connectionLost = false;
+// Set by every registry, param and metadata event, checked by the watch
+bool pipewireChanged = false;
+
+// Last state reported by the watch, by node
+struct WatchedNode {
+    PipewireNodeType type;
+    std::string description;
+    int volume;
+    bool muted;
+    uint32_t destination;
+};
+
+std::map<uint32_t, WatchedNode> watchedNodes;
+uint32_t watchedDefaultSink = SPA_ID_INVALID;
+uint32_t watchedDefaultSource = SPA_ID_INVALID;
+
+// Utils
+LPWSTR toLPWSTR(const std::wstring &str) {
+    LPWSTR_FROM_WSTRING(lp, str);
+    return lp;
+}
+
+LPWSTR idToLPWSTR(uint32_t id) {
+    return toLPWSTR(std::to_wstring(id));
+}
+
+const char *getDictValue(const spa_dict *props, const char *key, const char *fallback = nullptr) {
+    const char *value = props != nullptr ? spa_dict_lookup(props, key) : nullptr;
+    return value != nullptr ? value : fallback;
+}
+
+const char *getNodeType(PipewireNodeType type) {
+    switch (type) {
+        case PipewireNodeType::Sink:
+            return "sink";
+        case PipewireNodeType::Source:
+            return "source";
+        default:
+            return "stream";
+    }
+}
+
+// Channel volumes are linear, shown with the same cubic scale as wpctl and the desktop mixers
+int toPercent(const std::vector<float> &volumes) {
+    if (volumes.empty()) return 0;
+
+    float sum = 0;
+    for (float volume: volumes) {
+        sum += volume;
+    }
+    return (int) std::lround(std::cbrt(sum / volumes.size()) * 100);
+}
+
+float fromPercent(int volume) {
+    float cubic = volume / 100.0f;
+    return cubic * cubic * cubic;
+}
+
+// The value of a default node metadata property, e.g. {"name":"alsa_output.pci-0000_00_1f.3.analog-stereo"}
+std::string parseDefaultName(const char *value) {
+    if (value == nullptr) return "";
+
+    std::string json(value);
+    size_t key = json.find("\"name\"");
+    if (key == std::string::npos) return "";
+    size_t start = json.find('"', json.find(':', key));
+    size_t end = start != std::string::npos ? json.find('"', start + 1) : std::string::npos;
+    if (end == std::string::npos) return "";
+
+    return json.substr(start + 1, end - start - 1);
+}
+
+bool parseId(LPWSTR id, uint32_t &result) {
+    wchar_t *end;
+    unsigned long value = std::wcstoul(id, &end, 10);
+    if (end == id || *end != 0 || value >= SPA_ID_INVALID) return false;
+
+    result = (uint32_t) value;
+    return true;
+}
+
+void parseProps(PipewireNode *node, const spa_pod *param) {
+    if (param == nullptr || !spa_pod_is_object(param)) return;
+
+    const spa_pod_prop *prop;
+    const spa_pod_object *object = (const spa_pod_object *) param;
+    SPA_POD_OBJECT_FOREACH(object, prop) {
+        if (prop->key == SPA_PROP_mute) {
+            bool muted;
+            if (spa_pod_get_bool(&prop->value, &muted) == 0) {
+                node->muted = muted;
+            }
+        } else if (prop->key == SPA_PROP_channelVolumes) {
+            float volumes[PIPEWIRE_MAX_CHANNELS];
+            uint32_t count = spa_pod_copy_array(&prop->value, SPA_TYPE_Float, volumes, PIPEWIRE_MAX_CHANNELS);
+            if (count > 0) {
+                node->volumes.assign(volumes, volumes + count);
+            }
+        }
+    }
+}
+
+void parseRoute(PipewireDevice *device, const spa_pod *param) {
+    if (param == nullptr || !spa_pod_is_object(param)) return;
+
+    PipewireRoute route = {-1, -1};
+    const spa_pod_prop *prop;
+    const spa_pod_object *object = (const spa_pod_object *) param;
+    SPA_POD_OBJECT_FOREACH(object, prop) {
+        if (prop->key == SPA_PARAM_ROUTE_index) {
+            spa_pod_get_int(&prop->value, &route.index);
+        } else if (prop->key == SPA_PARAM_ROUTE_device) {
+            spa_pod_get_int(&prop->value, &route.device);
+        }
+    }
+
+    if (route.index >= 0 && route.device >= 0) {
+        device->routes[route.device] = route;
+    }
+}
+
+// Events
+void onCoreDone(void *, uint32_t id, int seq) {
+    if (id == PW_ID_CORE && seq == syncSeq) {
+        synced = true;
+    }
+}
+
+void onCoreError(void *, uint32_t id, int, int res, const char *message) {
+    if (id == PW_ID_CORE && res == -EPIPE) {
+        connectionLost = true;
+    }
+    std::cerr << "PipeWire error: " << (message != nullptr ? message : "unknown") << std::endl;
+}
+
+const pw_core_events coreEvents = {
+        .version = PW_VERSION_CORE_EVENTS,
+        .done = onCoreDone,
+        .error = onCoreError,
+};
+
+void onNodeInfo(void *data, const pw_node_info *info) {
+    auto node = (PipewireNode *) data;
+    if ((info->change_mask & PW_NODE_CHANGE_MASK_PROPS) == 0) return;
+
+    // The global properties are a subset, the descriptive ones come with the node info
+    const spa_dict *props = info->props;
+    node->name = getDictValue(props, PW_KEY_NODE_NAME, "");
+    node->description = node->type == PipewireNodeType::Stream
+                        ? getDictValue(props, PW_KEY_APP_NAME, getDictValue(props, PW_KEY_NODE_NAME, ""))
+                        : getDictValue(props, PW_KEY_NODE_DESCRIPTION,
+                                       getDictValue(props, PW_KEY_NODE_NICK, node->name.c_str()));
+    node->serial = getDictValue(props, PW_KEY_OBJECT_SERIAL, "");
+
+    const char *deviceId = getDictValue(props, PW_KEY_DEVICE_ID);
+    const char *routeDevice = getDictValue(props, "card.profile.device");
+    node->deviceId = deviceId != nullptr ? (uint32_t) std::stoul(deviceId) : SPA_ID_INVALID;
+    node->routeDevice = routeDevice != nullptr ? std::stoi(routeDevice) : -1;
+    pipewireChanged = true;
+}
+
+void onNodeParam(void *data, int, uint32_t id, uint32_t, uint32_t, const spa_pod *param) {
+    if (id != SPA_PARAM_Props) return;
+
+    parseProps((PipewireNode *) data, param);
+    pipewireChanged = true;
+}
+
+const pw_node_events nodeEvents = {
+        .version = PW_VERSION_NODE_EVENTS,
+        .info = onNodeInfo,
+        .param = onNodeParam,
+};
+
+void onDeviceParam(void *data, int, uint32_t id, uint32_t, uint32_t, const spa_pod *param) {
+    if (id != SPA_PARAM_Route) return;
+
+    parseRoute((PipewireDevice *) data, param);
+}
+
+const pw_device_events deviceEvents = {
+        .version = PW_VERSION_DEVICE_EVENTS,
+        .param = onDeviceParam,
+};
+
+int onMetadataProperty(void *, uint32_t subject, const char *key, const char *, const char *value) {
+    if (subject != PW_ID_CORE) return 0;
+
+    if (key == nullptr) {
+        defaultSinkName.clear();
+        defaultSourceName.clear();
+    } else if (std::strcmp(key, "default.audio.sink") == 0) {
+        defaultSinkName = parseDefaultName(value);
+    } else if (std::strcmp(key, "default.audio.source") == 0) {
+        defaultSourceName = parseDefaultName(value);
+    } else {
+        return 0;
+    }
+
+    pipewireChanged = true;
+    return 0;
+}
+
+const pw_metadata_events metadataEvents = {
+        .version = PW_VERSION_METADATA_EVENTS,
+        .property = onMetadataProperty,
+};
+
+void onRegistryGlobal(void *, uint32_t id, uint32_t, const char *type, uint32_t, const spa_dict *props) {
+    if (std::strcmp(type, PW_TYPE_INTERFACE_Node) == 0) {
+        const char *mediaClass = getDictValue(props, PW_KEY_MEDIA_CLASS, "");
+        PipewireNodeType nodeType;
+        if (std::strcmp(mediaClass, "Audio/Sink") == 0) {
+            nodeType = PipewireNodeType::Sink;
+        } else if (std::strcmp(mediaClass, "Audio/Source") == 0) {
+            nodeType = PipewireNodeType::Source;
+        } else if (std::strcmp(mediaClass, "Stream/Output/Audio") == 0 ||
+                   std::strcmp(mediaClass, "Stream/Input/Audio") == 0) {
+            nodeType = PipewireNodeType::Stream;
+        } else {
+            return;
+        }
+
+        auto node = std::make_unique<PipewireNode>();
+        node->id = id;
+        node->type = nodeType;
+        node->name = getDictValue(props, PW_KEY_NODE_NAME, "");
+        node->description = node->name;
+        node->proxy = (pw_proxy *) pw_registry_bind(registry, id, type, PW_VERSION_NODE, 0);
+        if (node->proxy == nullptr) return;
+
+        // Subscribed, the Props are sent now and on every change
+        uint32_t params[] = {SPA_PARAM_Props};
+        pw_node_add_listener((pw_node *) node->proxy, &node->listener, &nodeEvents, node.get());
+        pw_node_subscribe_params((pw_node *) node->proxy, params, 1);
+        pipewireNodes[id] = std::move(node);
+    } else if (std::strcmp(type, PW_TYPE_INTERFACE_Device) == 0) {
+        if (std::strcmp(getDictValue(props, PW_KEY_MEDIA_CLASS, ""), "Audio/Device") != 0) return;
+
+        auto device = std::make_unique<PipewireDevice>();
+        device->id = id;
+        device->proxy = (pw_proxy *) pw_registry_bind(registry, id, type, PW_VERSION_DEVICE, 0);
+        if (device->proxy == nullptr) return;
+
+        uint32_t params[] = {SPA_PARAM_Route};
+        pw_device_add_listener((pw_device *) device->proxy, &device->listener, &deviceEvents, device.get());
+        pw_device_subscribe_params((pw_device *) device->proxy, params, 1);
+        pipewireDevices[id] = std::move(device);
+    } else if (std::strcmp(type, PW_TYPE_INTERFACE_Link) == 0) {
+        const char *outputNode = getDictValue(props, PW_KEY_LINK_OUTPUT_NODE);
+        const char *inputNode = getDictValue(props, PW_KEY_LINK_INPUT_NODE);
+        if (outputNode == nullptr || inputNode == nullptr) return;
+
+        pipewireLinks[id] = {(uint32_t) std::stoul(outputNode), (uint32_t) std::stoul(inputNode)};
+    } else if (std::strcmp(type, PW_TYPE_INTERFACE_Metadata) == 0) {
+        if (defaultMetadata != nullptr || std::strcmp(getDictValue(props, PW_KEY_METADATA_NAME, ""), "default") != 0) {
+            return;
+        }
+
+        defaultMetadata = (pw_metadata *) pw_registry_bind(registry, id, type, PW_VERSION_METADATA, 0);
+        if (defaultMetadata != nullptr) {
+            pw_metadata_add_listener(defaultMetadata, &metadataListener, &metadataEvents, nullptr);
+        }
+    } else {
+        return;
+    }
+
+    pipewireChanged = true;
+}
+
+void onRegistryGlobalRemove(void *, uint32_t id) {
+    auto node = pipewireNodes.find(id);
+    if (node != pipewireNodes.end()) {
+        spa_hook_remove(&node->second->listener);
+        pw_proxy_destroy(node->second->proxy);
+        pipewireNodes.erase(node);
+    }
+
+    auto device = pipewireDevices.find(id);
+    if (device != pipewireDevices.end()) {
+        spa_hook_remove(&device->second->listener);
+        pw_proxy_destroy(device->second->proxy);
+        pipewireDevices.erase(device);
+    }
+
+    pipewireLinks.erase(id);
+    pipewireChanged = true;
+}
+
+const pw_registry_events registryEvents = {
+        .version = PW_VERSION_REGISTRY_EVENTS,
+        .global = onRegistryGlobal,
+        .global_remove = onRegistryGlobalRemove,
+};
+
+// Wait for the server to handle everything sent so far, and for the events it sent meanwhile
+bool roundtrip() {
+    if (core == nullptr || connectionLost) {
+        std::cerr << "Not connected to the PipeWire server" << std::endl;
+        return false;
+    }
+
+    synced = false;
+    syncSeq = pw_core_sync(core, PW_ID_CORE, syncSeq);
+    while (!synced) {
+        int result = pw_loop_iterate(loop, -1);
+        if (connectionLost || (result < 0 && result != -EINTR)) {
+            std::cerr << "Lost the connection to the PipeWire server" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Queries
+PipewireNode *getNodeById(LPWSTR id) {
+    uint32_t nodeId;
+    if (!parseId(id, nodeId)) return nullptr;
+
+    auto node = pipewireNodes.find(nodeId);
+    return node != pipewireNodes.end() ? node->second.get() : nullptr;
+}
+
+PipewireNode *getDefaultNode(PipewireNodeType type) {
+    const std::string &name = type == PipewireNodeType::Sink ? defaultSinkName : defaultSourceName;
+    for (auto &node: pipewireNodes) {
+        if (node.second->type == type && node.second->name == name) return node.second.get();
+    }
+
+    return nullptr;
+}
+
+// The sink a playback stream is linked to, or the source a capture stream records from
+uint32_t getDestination(const PipewireNode *node) {
+    if (node->type != PipewireNodeType::Stream) return SPA_ID_INVALID;
+
+    for (auto &link: pipewireLinks) {
+        uint32_t peer = link.second.outputNode == node->id ? link.second.inputNode
+                                                           : link.second.inputNode == node->id ? link.second.outputNode
+                                                                                               : SPA_ID_INVALID;
+        auto peerNode = pipewireNodes.find(peer);
+        if (peerNode != pipewireNodes.end() && peerNode->second->type != PipewireNodeType::Stream) return peer;
+    }
+
+    return SPA_ID_INVALID;
+}
+
+// Updates
+PipewireRoute *getRoute(const PipewireNode *node, PipewireDevice *&device) {
+    auto found = pipewireDevices.find(node->deviceId);
+    if (found == pipewireDevices.end() || node->routeDevice < 0) return nullptr;
+
+    auto route = found->second->routes.find(node->routeDevice);
+    if (route == found->second->routes.end()) return nullptr;
+
+    device = found->second.get();
+    return &route->second;
+}
+
+const spa_pod *buildProps(spa_pod_builder *builder, uint32_t id, const std::vector<float> *volumes,
+                          const bool *muted) {
+    spa_pod_frame frame;
+    spa_pod_builder_push_object(builder, &frame, SPA_TYPE_OBJECT_Props, id);
+    if (volumes != nullptr) {
+        spa_pod_builder_prop(builder, SPA_PROP_channelVolumes, 0);
+        spa_pod_builder_array(builder, sizeof(float), SPA_TYPE_Float, volumes->size(), volumes->data());
+    }
+    if (muted != nullptr) {
+        spa_pod_builder_prop(builder, SPA_PROP_mute, 0);
+        spa_pod_builder_bool(builder, *muted);
+    }
+    return (const spa_pod *) spa_pod_builder_pop(builder, &frame);
+}
+
+// Card nodes are changed through their device route so the volume is applied to the hardware and saved,
+// the other nodes through their own Props
+bool setNodeProps(PipewireNode *node, const std::vector<float> *volumes, const bool *muted) {
+    uint8_t buffer[1024];
+    spa_pod_builder builder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+
+    PipewireDevice *device = nullptr;
+    PipewireRoute *route = getRoute(node, device);
+    if (route != nullptr) {
+        spa_pod_frame frame;
+        spa_pod_builder_push_object(&builder, &frame, SPA_TYPE_OBJECT_ParamRoute, SPA_PARAM_Route);
+        spa_pod_builder_prop(&builder, SPA_PARAM_ROUTE_index, 0);
+        spa_pod_builder_int(&builder, route->index);
+        spa_pod_builder_prop(&builder, SPA_PARAM_ROUTE_device, 0);
+        spa_pod_builder_int(&builder, route->device);
+        spa_pod_builder_prop(&builder, SPA_PARAM_ROUTE_props, 0);
+        buildProps(&builder, SPA_PARAM_Route, volumes, muted);
+        spa_pod_builder_prop(&builder, SPA_PARAM_ROUTE_save, 0);
+        spa_pod_builder_bool(&builder, true);
+        auto param = (const spa_pod *) spa_pod_builder_pop(&builder, &frame);
+
+        pw_device_set_param((pw_device *) device->proxy, SPA_PARAM_Route, 0, param);
+    } else {
+        const spa_pod *param = buildProps(&builder, SPA_PARAM_Props, volumes, muted);
+
+        pw_node_set_param((pw_node *) node->proxy, SPA_PARAM_Props, 0, param);
+    }
+
+    if (!roundtrip()) return false;
+
+    // The Props event may follow later, the next commands already see the new values
+    if (volumes != nullptr) node->volumes = *volumes;
+    if (muted != nullptr) node->muted = *muted;
+    return true;
+}
+
+bool setNodeVolume(PipewireNode *node, int volume) {
+    // Every channel gets the same volume, a node without Props yet is assumed to be stereo
+    std::vector<float> volumes(node->volumes.empty() ? 2 : node->volumes.size(), fromPercent(volume));
+    return setNodeProps(node, &volumes, nullptr);
+}
+
+bool setNodeMuted(PipewireNode *node, bool mute) {
+    return setNodeProps(node, nullptr, &mute);
+}
+
+// VsNode conversion, the strings go to the arena, or on the heap for event nodes when it is null
+VsNode toVsNode(const PipewireNode *node, StringArena *strings) {
+    uint32_t destination = getDestination(node);
+
+    VsNode vsNode;
+    vsNode.id = copyVsString(strings, std::to_wstring(node->id));
+    vsNode.name = copyVsString(strings, fromUtf8(node->description));
+    vsNode.volume = toPercent(node->volumes);
+    vsNode.muted = node->muted;
+    vsNode.isDefault = (node->type == PipewireNodeType::Sink && node->name == defaultSinkName) ||
+                       (node->type == PipewireNodeType::Source && node->name == defaultSourceName);
+    vsNode.destinationId =
+            destination != SPA_ID_INVALID ? copyVsString(strings, std::to_wstring(destination)) : nullptr;
+    return vsNode;
+}
+
+void toVsNodes(std::vector<VsNode> *vsNodes, PipewireNodeType type, StringArena &strings) {
+    for (auto &node: pipewireNodes) {
+        if (node.second->type == type) {
+            vsNodes->push_back(toVsNode(node.second.get(), &strings));
+        }
+    }
+}
+
+// Lifecycle
+void initialize() {
+    pw_init(nullptr, nullptr);
+
+    loop = pw_loop_new(nullptr);
+    context = loop != nullptr ? pw_context_new(loop, nullptr, 0) : nullptr;
+    core = context != nullptr ? pw_context_connect(context, nullptr, 0) : nullptr;
+    if (core == nullptr) {
+        std::cerr << "Failed to connect to the PipeWire server" << std::endl;
+        return;
+    }
+
+    pw_loop_enter(loop);
+    pw_core_add_listener(core, &coreListener, &coreEvents, nullptr);
+    registry = pw_core_get_registry(core, PW_VERSION_REGISTRY, 0);
+    pw_registry_add_listener(registry, &registryListener, &registryEvents, nullptr);
+
+    // The first roundtrip lists the globals and binds them, the second one brings their info, params and metadata
+    if (roundtrip()) {
+        roundtrip();
+    }
+}
+
+void uninitialize() {
+    for (auto &node: pipewireNodes) {
+        spa_hook_remove(&node.second->listener);
+        pw_proxy_destroy(node.second->proxy);
+    }
+    pipewireNodes.clear();
+    for (auto &device: pipewireDevices) {
+        spa_hook_remove(&device.second->listener);
+        pw_proxy_destroy(device.second->proxy);
+    }
+    pipewireDevices.clear();
+    pipewireLinks.clear();
+
+    if (defaultMetadata != nullptr) {
+        spa_hook_remove(&metadataListener);
+        pw_proxy_destroy((pw_proxy *) defaultMetadata);
+        defaultMetadata = nullptr;
+    }
+    if (registry != nullptr) {
+        spa_hook_remove(&registryListener);
+        pw_proxy_destroy((pw_proxy *) registry);
+        registry = nullptr;
+    }
+    if (core != nullptr) {
+        spa_hook_remove(&coreListener);
+        pw_core_disconnect(core);
+        core = nullptr;
+    }
+    if (context != nullptr) {
+        pw_context_destroy(context);
+        context = nullptr;
+    }
+    if (loop != nullptr) {
+        pw_loop_leave(loop);
+        pw_loop_destroy(loop);
+        loop = nullptr;
+    }
+
+    pw_deinit();
+}
+
+void initializeThread() {
+}
+
+void clearRequestState() {
+}
+
+void enableChangeTracking() {
+    // The registry is followed for the whole process, each command only waits for the pending events
+}
+
+// Default device functions
+int getGlobalVolume() {
+    PipewireNode *node = roundtrip() ? getDefaultNode(PipewireNodeType::Sink) : nullptr;
+    if (node != nullptr) {
+        return toPercent(node->volumes);
+    }
+
+    std::cerr << "Failed to get default sink" << std::endl;
+    return -1;
+}
+
+void setGlobalVolume(int volume) {
+    PipewireNode *node = roundtrip() ? getDefaultNode(PipewireNodeType::Sink) : nullptr;
+    if (node == nullptr) {
+        std::cerr << "Failed to get default sink" << std::endl;
+        return;
+    }
+
+    if (!setNodeVolume(node, volume)) {
+        std::cerr << "Failed to set volume" << std::endl;
+    }
+}
+
+bool isGlobalMuted() {
+    PipewireNode *node = roundtrip() ? getDefaultNode(PipewireNodeType::Sink) : nullptr;
+    if (node != nullptr) {
+        return node->muted;
+    }
+
+    std::cerr << "Failed to get default sink" << std::endl;
+    return false;
+}
+
+void setGlobalMuted(bool mute) {
+    PipewireNode *node = roundtrip() ? getDefaultNode(PipewireNodeType::Sink) : nullptr;
+    if (node == nullptr) {
+        std::cerr << "Failed to get default sink" << std::endl;
+        return;
+    }
+
+    if (!setNodeMuted(node, mute)) {
+        std::cerr << "Failed to set mute state" << std::endl;
+    }
+}
+
+// Get VsNode functions
+void getVsNodeOfType(std::vector<VsNode> *nodes, StringArena &strings, EDataFlow dataFlow) {
+    if (!roundtrip()) return;
+
+    toVsNodes(nodes, dataFlow == eCapture ? PipewireNodeType::Source : PipewireNodeType::Sink, strings);
+}
+
+void getStreams(std::vector<VsNode> *nodes, StringArena &strings) {
+    if (!roundtrip()) return;
+
+    toVsNodes(nodes, PipewireNodeType::Stream, strings);
+}
+
+void getStatus(VsStatus *status) {
+    if (!roundtrip()) return;
+
+    toVsNodes(&status->sinks, PipewireNodeType::Sink, status->strings);
+    toVsNodes(&status->sources, PipewireNodeType::Source, status->strings);
+    toVsNodes(&status->streams, PipewireNodeType::Stream, status->strings);
+
+    PipewireNode *defaultSink = getDefaultNode(PipewireNodeType::Sink);
+    PipewireNode *defaultSource = getDefaultNode(PipewireNodeType::Source);
+    status->defaultSink = defaultSink != nullptr ? status->strings.copy(std::to_wstring(defaultSink->id)) : nullptr;
+    status->defaultSource =
+            defaultSource != nullptr ? status->strings.copy(std::to_wstring(defaultSource->id)) : nullptr;
+}
+
+// By ID functions
+int getVolumeById(LPWSTR id) {
+    PipewireNode *node = roundtrip() ? getNodeById(id) : nullptr;
+    if (node != nullptr) {
+        return toPercent(node->volumes);
+    }
+
+    std::cerr << "Failed to get volume by ID" << std::endl;
+    return -1;
+}
+
+void setVolumeById(LPWSTR id, int volume) {
+    PipewireNode *node = roundtrip() ? getNodeById(id) : nullptr;
+    if (node != nullptr && setNodeVolume(node, volume)) return;
+
+    std::cerr << "Failed to set volume by ID" << std::endl;
+}
+
+bool isMutedById(LPWSTR id) {
+    PipewireNode *node = roundtrip() ? getNodeById(id) : nullptr;
+    if (node != nullptr) {
+        return node->muted;
+    }
+
+    std::cerr << "Failed to get mute state by ID" << std::endl;
+    return false;
+}
+
+void setMutedById(LPWSTR id, bool mute) {
+    PipewireNode *node = roundtrip() ? getNodeById(id) : nullptr;
+    if (node != nullptr && setNodeMuted(node, mute)) return;
+
+    std::cerr << "Failed to set mute state by ID" << std::endl;
+}
+
+void setStreamDestination(LPWSTR id, LPWSTR destinationId) {
+    PipewireNode *node = roundtrip() ? getNodeById(id) : nullptr;
+    PipewireNode *destination = getNodeById(destinationId);
+    if (node == nullptr || node->type != PipewireNodeType::Stream || destination == nullptr ||
+        destination->type == PipewireNodeType::Stream || defaultMetadata == nullptr) {
+        std::cerr << "Failed to set stream destination" << std::endl;
+        return;
+    }
+
+    // The session manager moves the stream to its target, target.node is kept for the older ones
+    std::string targetNode = std::to_string(destination->id);
+    if (!destination->serial.empty()) {
+        pw_metadata_set_property(defaultMetadata, node->id, "target.object", "Spa:Id", destination->serial.c_str());
+    }
+    pw_metadata_set_property(defaultMetadata, node->id, "target.node", "Spa:Id", targetNode.c_str());
+    if (!roundtrip()) {
+        std::cerr << "Failed to set stream destination" << std::endl;
+    }
+}
+
+void applyBatch(std::vector<VsBatchOperation> &operations) {
+    bool listed = roundtrip();
+
+    for (VsBatchOperation &operation: operations) {
+        if (operation.error != nullptr) continue;
+
+        PipewireNode *node = listed ? getNodeById(operation.id) : nullptr;
+        if (node == nullptr) {
+            operation.error = "Node not found";
+            continue;
+        }
+
+        switch (operation.type) {
+            case VsBatchOperationType::GetVolumeInfo:
+                operation.volume = toPercent(node->volumes);
+                operation.muted = node->muted;
+                break;
+            case VsBatchOperationType::SetVolume:
+                if (!setNodeVolume(node, operation.volume)) {
+                    operation.error = "Failed to set volume";
+                }
+                break;
+            case VsBatchOperationType::SetMuted:
+                if (!setNodeMuted(node, operation.muted)) {
+                    operation.error = "Failed to set mute state";
+                }
+                break;
+        }
+    }
+}
+
+// Volume control functions, the node is looked up again by each step since it may be removed meanwhile
+struct VsVolumeControl {
+    uint32_t nodeId;
+};
+
+VsVolumeControl *openVolumeControl(LPWSTR id) {
+    PipewireNode *node = core != nullptr && !connectionLost && roundtrip() ? getNodeById(id) : nullptr;
+    return node == nullptr ? nullptr : new VsVolumeControl{node->id};
+}
+
+void closeVolumeControl(VsVolumeControl *control) {
+    delete control;
+}
+
+bool getControlLevel(VsVolumeControl *control, float &level) {
+    auto node = pipewireNodes.find(control->nodeId);
+    if (node == pipewireNodes.end() || node->second->volumes.empty()) return false;
+
+    float sum = 0;
+    for (float volume: node->second->volumes) {
+        sum += volume;
+    }
+    level = std::cbrt(sum / node->second->volumes.size());
+    return true;
+}
+
+bool setControlLevel(VsVolumeControl *control, float level) {
+    auto node = pipewireNodes.find(control->nodeId);
+    if (core == nullptr || connectionLost || node == pipewireNodes.end()) return false;
+
+    // Same cubic scale as the percents
+    std::vector<float> volumes(node->second->volumes.empty() ? 2 : node->second->volumes.size(),
+                               level * level * level);
+    return setNodeProps(node->second.get(), &volumes, nullptr);
+}
+
+// Level functions, the PipeWire backend has no meters: vsPulse meters PipeWire through pipewire-pulse
+bool openLevelMeters() {
+    std::cerr << "Levels are not supported by the PipeWire backend, use vsPulse" << std::endl;
+    return false;
+}
+
+void readLevels(std::vector<VsLevel> *, StringArena &) {
+}
+
+void closeLevelMeters() {
+}
+
+// Watch functions
+WatchedNode toWatchedNode(const PipewireNode *node) {
+    return {node->type, node->description, toPercent(node->volumes), node->muted, getDestination(node)};
+}
+
+bool isSameNode(const WatchedNode &a, const WatchedNode &b) {
+    return a.description == b.description && a.volume == b.volume && a.muted == b.muted &&
+           a.destination == b.destination;
+}
+
+void pushIdEvent(std::vector<VsEvent> &events, VsEventType type, PipewireNodeType nodeType, uint32_t id) {
+    VsEvent event = {type, getNodeType(nodeType), {}};
+    event.node.id = id != SPA_ID_INVALID ? idToLPWSTR(id) : nullptr;
+    event.node.name = nullptr;
+    event.node.destinationId = nullptr;
+    events.push_back(event);
+}
+
+void watchDefaultChange(std::vector<VsEvent> &events, PipewireNodeType type, uint32_t &watchedDefault) {
+    PipewireNode *node = getDefaultNode(type);
+    uint32_t id = node != nullptr ? node->id : SPA_ID_INVALID;
+    if (id == watchedDefault) return;
+
+    watchedDefault = id;
+    pushIdEvent(events, VsEventType::DefaultChanged, type, id);
+}
+
+// Compare the nodes with the last reported state, the registry is small enough to do it on every change
+void watchChanges(std::vector<VsEvent> &events, bool report) {
+    for (auto watched = watchedNodes.begin(); watched != watchedNodes.end();) {
+        if (pipewireNodes.count(watched->first) == 0) {
+            if (report) pushIdEvent(events, VsEventType::Removed, watched->second.type, watched->first);
+            watched = watchedNodes.erase(watched);
+        } else {
+            watched++;
+        }
+    }
+
+    for (auto &entry: pipewireNodes) {
+        PipewireNode *node = entry.second.get();
+        WatchedNode current = toWatchedNode(node);
+        auto watched = watchedNodes.find(node->id);
+        if (watched != watchedNodes.end() && isSameNode(watched->second, current)) continue;
+
+        VsEventType type = watched == watchedNodes.end() ? VsEventType::Added : VsEventType::Changed;
+        watchedNodes[node->id] = current;
+        if (report) events.push_back({type, getNodeType(node->type), toVsNode(node, nullptr)});
+    }
+
+    if (report) {
+        watchDefaultChange(events, PipewireNodeType::Sink, watchedDefaultSink);
+        watchDefaultChange(events, PipewireNodeType::Source, watchedDefaultSource);
+    }
+}
+
+bool startWatch() {
+    if (!roundtrip()) return false;
+
+    std::vector<VsEvent> events;
+    watchChanges(events, false);
+    PipewireNode *defaultSink = getDefaultNode(PipewireNodeType::Sink);
+    PipewireNode *defaultSource = getDefaultNode(PipewireNodeType::Source);
+    watchedDefaultSink = defaultSink != nullptr ? defaultSink->id : SPA_ID_INVALID;
+    watchedDefaultSource = defaultSource != nullptr ? defaultSource->id : SPA_ID_INVALID;
+    pipewireChanged = false;
+    return true;
+}
+
+bool waitForEvents(std::vector<VsEvent> &events, int timeoutMs) {
+    int result = pw_loop_iterate(loop, timeoutMs);
+    if (connectionLost || (result < 0 && result != -EINTR)) {
+        std::cerr << "Lost the connection to the PipeWire server" << std::endl;
+        return false;
+    }
+    if (!pipewireChanged) return true;
+
+    // Bound nodes and devices send their info and params on the next roundtrip, wait for them before comparing
+    if (!roundtrip()) return false;
+    pipewireChanged = false;
+
+    watchChanges(events, true);
+    return !connectionLost;
+}
+
+void stopWatch() {
+    watchedNodes.clear();
+    watchedDefaultSink = SPA_ID_INVALID;
+    watchedDefaultSource = SPA_ID_INVALID;
+}
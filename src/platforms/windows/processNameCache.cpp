@@ -0,0 +1,198 @@
+#include "processNameCache.h"
+#include "commands.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const uint32_t PROCESS_NAME_CACHE_MAGIC = 0x4E505356; // "VSPN"
+const uint32_t PROCESS_NAME_CACHE_VERSION = 1;
+// Slots looked at from the one of the process ID, the first is overwritten when they are all taken
+const size_t PROCESS_NAME_PROBES = 4;
+
+struct ProcessNameHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotSize;
+};
+
+// Fixed size, so the table can be shared as is between processes
+struct ProcessNameSlot {
+    uint32_t processId;
+    uint32_t nameLength;
+    uint64_t creationTime;
+    uint64_t pathHash;
+    // Written last, a slot being written by another process doesn't match it and reads as empty
+    uint64_t checksum;
+    // UTF-8, longer names are not cached
+    char name[96];
+};
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325) {
+    // FNV-1a
+    auto bytes = (const unsigned char *) data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3;
+    }
+    return hash;
+}
+
+uint64_t getSlotChecksum(const ProcessNameSlot &slot) {
+    uint64_t hash = hashBytes(&slot.processId, sizeof(slot.processId));
+    hash = hashBytes(&slot.nameLength, sizeof(slot.nameLength), hash);
+    hash = hashBytes(&slot.creationTime, sizeof(slot.creationTime), hash);
+    hash = hashBytes(&slot.pathHash, sizeof(slot.pathHash), hash);
+    return hashBytes(slot.name, slot.nameLength < sizeof(slot.name) ? slot.nameLength : sizeof(slot.name), hash);
+}
+
+uint64_t hashPath(const std::wstring &imagePath) {
+    return hashBytes(imagePath.data(), imagePath.size() * sizeof(wchar_t));
+}
+
+// Map the file, sized for the table, null when it can't be
+char *mapTableFile(const std::string &path, size_t size) {
+#ifdef _WIN32
+    std::wstring pathW = fromUtf8(path);
+    HANDLE file = CreateFileW(pathW.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+    // The mapping grows the file to its size, the view keeps the mapping alive once both handles are closed
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, 0, (DWORD) size, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) return nullptr;
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    CloseHandle(mapping);
+    return (char *) view;
+#else
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd == -1) return nullptr;
+
+    struct stat info {};
+    if (fstat(fd, &info) == -1 || ((size_t) info.st_size < size && ftruncate(fd, (off_t) size) == -1)) {
+        close(fd);
+        return nullptr;
+    }
+
+    void *view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return view == MAP_FAILED ? nullptr : (char *) view;
+#endif
+}
+
+void unmapTableFile(char *table, size_t size) {
+#ifdef _WIN32
+    UnmapViewOfFile(table);
+#else
+    munmap(table, size);
+#endif
+}
+
+ProcessNameCache::ProcessNameCache(const std::string &path, size_t slotCount) : slotCount(slotCount) {
+    tableSize = sizeof(ProcessNameHeader) + slotCount * sizeof(ProcessNameSlot);
+    if (!path.empty()) {
+        table = mapTableFile(path, tableSize);
+    }
+    persistent = table != nullptr;
+    if (!persistent) {
+        table = new char[tableSize];
+        std::memset(table, 0, tableSize);
+    }
+
+    // A new file, or one written with another layout
+    auto header = (ProcessNameHeader *) table;
+    if (header->magic != PROCESS_NAME_CACHE_MAGIC || header->version != PROCESS_NAME_CACHE_VERSION ||
+        header->slotCount != slotCount || header->slotSize != sizeof(ProcessNameSlot)) {
+        std::memset(table, 0, tableSize);
+        *header = {PROCESS_NAME_CACHE_MAGIC, PROCESS_NAME_CACHE_VERSION, (uint32_t) slotCount,
+                   (uint32_t) sizeof(ProcessNameSlot)};
+    }
+}
+
+ProcessNameCache::~ProcessNameCache() {
+    if (persistent) {
+        unmapTableFile(table, tableSize);
+    } else {
+        delete[] table;
+    }
+}
+
+bool ProcessNameCache::isPersistent() const {
+    return persistent;
+}
+
+ProcessNameSlot *ProcessNameCache::getSlots() const {
+    return (ProcessNameSlot *) (table + sizeof(ProcessNameHeader));
+}
+
+size_t ProcessNameCache::getFirstSlot(uint32_t processId) const {
+    return (size_t) (hashBytes(&processId, sizeof(processId)) % slotCount);
+}
+
+bool ProcessNameCache::find(uint32_t processId, uint64_t creationTime, const std::wstring &imagePath,
+                            std::wstring &name) const {
+    ProcessNameSlot *slots = getSlots();
+    size_t first = getFirstSlot(processId);
+    for (size_t probe = 0; probe < PROCESS_NAME_PROBES; probe++) {
+        // Copied first, another process may be writing it
+        ProcessNameSlot slot = slots[(first + probe) % slotCount];
+        if (slot.processId != processId || slot.nameLength > sizeof(slot.name) ||
+            slot.checksum != getSlotChecksum(slot)) {
+            continue;
+        }
+
+        // The process ID was reused by another process
+        if (slot.creationTime != creationTime || slot.pathHash != hashPath(imagePath)) return false;
+
+        name = fromUtf8(std::string(slot.name, slot.nameLength));
+        return true;
+    }
+
+    return false;
+}
+
+void ProcessNameCache::insert(uint32_t processId, uint64_t creationTime, const std::wstring &imagePath,
+                              const std::wstring &name) {
+    std::wstring nameCopy = name;
+    std::string nameUtf8 = toString(&nameCopy[0]);
+    if (nameUtf8.size() > sizeof(ProcessNameSlot::name)) return;
+
+    // The entry of the same process ID if any, stale or not, else a free slot, else the first one
+    ProcessNameSlot *slots = getSlots();
+    size_t first = getFirstSlot(processId);
+    ProcessNameSlot *target = nullptr;
+    for (size_t probe = 0; probe < PROCESS_NAME_PROBES && target == nullptr; probe++) {
+        ProcessNameSlot &slot = slots[(first + probe) % slotCount];
+        if (slot.processId == processId) target = &slot;
+    }
+    for (size_t probe = 0; probe < PROCESS_NAME_PROBES && target == nullptr; probe++) {
+        ProcessNameSlot &slot = slots[(first + probe) % slotCount];
+        if (slot.processId == 0) target = &slot;
+    }
+    if (target == nullptr) target = &slots[first];
+
+    ProcessNameSlot slot{};
+    slot.processId = processId;
+    slot.nameLength = (uint32_t) nameUtf8.size();
+    slot.creationTime = creationTime;
+    slot.pathHash = hashPath(imagePath);
+    std::memcpy(slot.name, nameUtf8.data(), nameUtf8.size());
+    slot.checksum = getSlotChecksum(slot);
+
+    // Readers of the other processes skip the slot until its checksum matches again
+    target->checksum = 0;
+    target->processId = slot.processId;
+    target->nameLength = slot.nameLength;
+    target->creationTime = slot.creationTime;
+    target->pathHash = slot.pathHash;
+    std::memcpy(target->name, slot.name, sizeof(slot.name));
+    target->checksum = slot.checksum;
+}
@@ -0,0 +1,48 @@
+#ifndef VSEXEC_PROCESS_NAME_CACHE_H
+#define VSEXEC_PROCESS_NAME_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct ProcessNameSlot;
+
+/**
+ * Display names of the processes owning the audio sessions, resolved from their version resources.
+ *
+ * Entries are keyed by process ID, creation time and image path: a reused process ID has another creation time, so its
+ * entry is stale and replaced instead of naming the new process. The table lives in a small memory-mapped file shared
+ * by every vsExec, so one-shot invocations don't read the version resources again; the serve mode keeps it mapped.
+ * When the file can't be mapped the table is held in memory only.
+ */
+class ProcessNameCache {
+public:
+    /**
+     * @param path The file holding the table, created when missing or invalid, empty for a memory only cache
+     * @param slotCount The number of names the table holds
+     */
+    explicit ProcessNameCache(const std::string &path, size_t slotCount = 1024);
+    ~ProcessNameCache();
+
+    ProcessNameCache(const ProcessNameCache &) = delete;
+    ProcessNameCache &operator=(const ProcessNameCache &) = delete;
+
+    // Whether the table is backed by the file
+    bool isPersistent() const;
+
+    // Get the name stored for the process, false when it is unknown or stale
+    bool find(uint32_t processId, uint64_t creationTime, const std::wstring &imagePath, std::wstring &name) const;
+    // Store the name of the process, replacing a stale entry of the same process ID
+    void insert(uint32_t processId, uint64_t creationTime, const std::wstring &imagePath, const std::wstring &name);
+
+private:
+    ProcessNameSlot *getSlots() const;
+    size_t getFirstSlot(uint32_t processId) const;
+
+    char *table = nullptr;
+    size_t tableSize = 0;
+    size_t slotCount;
+    bool persistent = false;
+};
+
+#endif
@@ -0,0 +1,850 @@
+// PulseAudio backend, talks to the server (PulseAudio or pipewire-pulse) through the libpulse asynchronous API
+#include "audio.h"
+#include "commands.h"
+#include "levels.h"
+#include <pulse/pulseaudio.h>
+#include <cmath>
+#include <cwchar>
+#include <iostream>
+#include <map>
+#include <string>
+
+enum class PulseNodeType {
+    Sink,
+    Source,
+    SinkInput,
+};
+
+struct PulseNode {
+    PulseNodeType type;
+    uint32_t index;
+    // Server name, matched against the default sink and source names
+    std::string name;
+    std::string description;
+    pa_cvolume volume;
+    bool muted;
+    // Sink of a sink input, PA_INVALID_INDEX otherwise
+    uint32_t sink;
+    // Monitor source of a sink, PA_INVALID_INDEX otherwise
+    uint32_t monitorSource;
+};
+
+struct PulseDefaults {
+    std::string sink;
+    std::string source;
+};
+
+pa_mainloop *mainloop = nullptr;
+pa_context *context = nullptr;
+
+// Subscription events received while watching, handled by waitForEvents
+struct PulseChange {
+    pa_subscription_event_type_t facility;
+    pa_subscription_event_type_t kind;
+    uint32_t index;
+};
+
+bool pulseWatching = false;
+std::vector<PulseChange> pendingChanges;
+std::map<std::pair<PulseNodeType, uint32_t>, PulseNode> watchedNodes;
+PulseDefaults watchedDefaults;
+
+// Utils
+LPWSTR toLPWSTR(const std::wstring &str) {
+    LPWSTR_FROM_WSTRING(lp, str);
+    return lp;
+}
+
+bool parseIndex(LPWSTR id, uint32_t &index) {
+    wchar_t *end;
+    unsigned long value = std::wcstoul(id, &end, 10);
+    if (end == id || *end != 0 || value >= PA_INVALID_INDEX) return false;
+
+    index = (uint32_t) value;
+    return true;
+}
+
+const char *getNodeType(PulseNodeType type) {
+    switch (type) {
+        case PulseNodeType::Sink:
+            return "sink";
+        case PulseNodeType::Source:
+            return "source";
+        default:
+            return "stream";
+    }
+}
+
+int toPercent(const pa_cvolume &volume) {
+    return (int) std::lround(pa_cvolume_avg(&volume) * 100.0 / PA_VOLUME_NORM);
+}
+
+bool isReady() {
+    if (context != nullptr && pa_context_get_state(context) == PA_CONTEXT_READY) return true;
+
+    std::cerr << "Not connected to the PulseAudio server" << std::endl;
+    return false;
+}
+
+// Run the main loop until the operation is done, then release it
+void completeOperation(pa_operation *operation) {
+    while (pa_operation_get_state(operation) == PA_OPERATION_RUNNING) {
+        if (pa_mainloop_iterate(mainloop, 1, nullptr) < 0) {
+            pa_operation_cancel(operation);
+            break;
+        }
+    }
+    pa_operation_unref(operation);
+}
+
+// Run the main loop until all the operations are done, false if one of them could not be started
+bool waitForOperations(std::initializer_list<pa_operation *> operations) {
+    bool started = true;
+    for (pa_operation *operation: operations) {
+        if (operation == nullptr) {
+            std::cerr << "Failed to start operation: " << pa_strerror(pa_context_errno(context)) << std::endl;
+            started = false;
+            continue;
+        }
+
+        completeOperation(operation);
+    }
+
+    return started;
+}
+
+bool waitForOperation(pa_operation *operation) {
+    return waitForOperations({operation});
+}
+
+// Callbacks
+void successCallback(pa_context *, int success, void *userdata) {
+    *(bool *) userdata = success != 0;
+}
+
+void sinkInfoCallback(pa_context *, const pa_sink_info *info, int eol, void *userdata) {
+    if (eol != 0 || info == nullptr) return;
+
+    auto nodes = (std::vector<PulseNode> *) userdata;
+    nodes->push_back({PulseNodeType::Sink, info->index, info->name, info->description ? info->description : info->name,
+                      info->volume, info->mute != 0, PA_INVALID_INDEX, info->monitor_source});
+}
+
+void sourceInfoCallback(pa_context *, const pa_source_info *info, int eol, void *userdata) {
+    if (eol != 0 || info == nullptr) return;
+
+    auto nodes = (std::vector<PulseNode> *) userdata;
+    nodes->push_back({PulseNodeType::Source, info->index, info->name,
+                      info->description ? info->description : info->name, info->volume, info->mute != 0,
+                      PA_INVALID_INDEX, PA_INVALID_INDEX});
+}
+
+void sinkInputInfoCallback(pa_context *, const pa_sink_input_info *info, int eol, void *userdata) {
+    if (eol != 0 || info == nullptr) return;
+
+    // Same name as pactl shows, the application name when there is one
+    const char *applicationName = pa_proplist_gets(info->proplist, PA_PROP_APPLICATION_NAME);
+    std::string name = info->name ? info->name : "";
+
+    auto nodes = (std::vector<PulseNode> *) userdata;
+    nodes->push_back({PulseNodeType::SinkInput, info->index, name, applicationName ? applicationName : name,
+                      info->volume, info->mute != 0, info->sink, PA_INVALID_INDEX});
+}
+
+void serverInfoCallback(pa_context *, const pa_server_info *info, void *userdata) {
+    if (info == nullptr) return;
+
+    auto defaults = (PulseDefaults *) userdata;
+    defaults->sink = info->default_sink_name ? info->default_sink_name : "";
+    defaults->source = info->default_source_name ? info->default_source_name : "";
+}
+
+void subscribeCallback(pa_context *, pa_subscription_event_type_t type, uint32_t index, void *) {
+    if (!pulseWatching) return;
+
+    pendingChanges.push_back({(pa_subscription_event_type_t) (type & PA_SUBSCRIPTION_EVENT_FACILITY_MASK),
+                              (pa_subscription_event_type_t) (type & PA_SUBSCRIPTION_EVENT_TYPE_MASK), index});
+}
+
+// Queries
+bool listNodes(std::vector<PulseNode> &sinks, std::vector<PulseNode> &sources, std::vector<PulseNode> &sinkInputs,
+               PulseDefaults &defaults) {
+    if (!isReady()) return false;
+
+    // Sent at once, the answers come back in a single round trip
+    return waitForOperations({
+            pa_context_get_sink_info_list(context, sinkInfoCallback, &sinks),
+            pa_context_get_source_info_list(context, sourceInfoCallback, &sources),
+            pa_context_get_sink_input_info_list(context, sinkInputInfoCallback, &sinkInputs),
+            pa_context_get_server_info(context, serverInfoCallback, &defaults),
+    });
+}
+
+bool getNodeByIndex(PulseNodeType type, uint32_t index, PulseNode &node) {
+    std::vector<PulseNode> nodes;
+    pa_operation *operation;
+    switch (type) {
+        case PulseNodeType::Sink:
+            operation = pa_context_get_sink_info_by_index(context, index, sinkInfoCallback, &nodes);
+            break;
+        case PulseNodeType::Source:
+            operation = pa_context_get_source_info_by_index(context, index, sourceInfoCallback, &nodes);
+            break;
+        default:
+            operation = pa_context_get_sink_input_info(context, index, sinkInputInfoCallback, &nodes);
+            break;
+    }
+
+    if (!waitForOperation(operation) || nodes.empty()) return false;
+
+    node = nodes[0];
+    return true;
+}
+
+// Sinks, sources then sink inputs, in the order pactl based lookups used
+bool getNodeById(LPWSTR id, PulseNode &node) {
+    uint32_t index;
+    if (!isReady() || !parseIndex(id, index)) return false;
+
+    for (PulseNodeType type: {PulseNodeType::Sink, PulseNodeType::Source, PulseNodeType::SinkInput}) {
+        if (getNodeByIndex(type, index, node)) return true;
+    }
+
+    return false;
+}
+
+bool getDefaultSink(PulseNode &node) {
+    if (!isReady()) return false;
+
+    // Resolved by the server, no need to fetch the server info first
+    std::vector<PulseNode> nodes;
+    if (!waitForOperation(pa_context_get_sink_info_by_name(context, "@DEFAULT_SINK@", sinkInfoCallback, &nodes)) ||
+        nodes.empty()) {
+        return false;
+    }
+
+    node = nodes[0];
+    return true;
+}
+
+// Updates
+// Null when the operation can't be started
+pa_operation *startSetNodeVolume(const PulseNode &node, const pa_cvolume &cvolume, bool *success) {
+    switch (node.type) {
+        case PulseNodeType::Sink:
+            return pa_context_set_sink_volume_by_index(context, node.index, &cvolume, successCallback, success);
+        case PulseNodeType::Source:
+            return pa_context_set_source_volume_by_index(context, node.index, &cvolume, successCallback, success);
+        default:
+            return pa_context_set_sink_input_volume(context, node.index, &cvolume, successCallback, success);
+    }
+}
+
+bool setNodeVolume(PulseNode &node, int volume) {
+    if (node.volume.channels == 0) {
+        std::cerr << "Node has no volume" << std::endl;
+        return false;
+    }
+
+    // Every channel gets the same volume, as pactl does with a percentage
+    pa_cvolume cvolume = node.volume;
+    pa_cvolume_set(&cvolume, node.volume.channels, (pa_volume_t) std::lround(volume * (double) PA_VOLUME_NORM / 100));
+
+    bool success = false;
+    if (!waitForOperation(startSetNodeVolume(node, cvolume, &success)) || !success) return false;
+
+    node.volume = cvolume;
+    return true;
+}
+
+bool setNodeMuted(PulseNode &node, bool mute) {
+    bool success = false;
+    pa_operation *operation;
+    switch (node.type) {
+        case PulseNodeType::Sink:
+            operation = pa_context_set_sink_mute_by_index(context, node.index, mute, successCallback, &success);
+            break;
+        case PulseNodeType::Source:
+            operation = pa_context_set_source_mute_by_index(context, node.index, mute, successCallback, &success);
+            break;
+        default:
+            operation = pa_context_set_sink_input_mute(context, node.index, mute, successCallback, &success);
+            break;
+    }
+
+    if (!waitForOperation(operation) || !success) return false;
+
+    node.muted = mute;
+    return true;
+}
+
+// VsNode conversion, the strings go to the arena, or on the heap for event nodes when it is null
+VsNode toVsNode(const PulseNode &node, const PulseDefaults &defaults, StringArena *strings) {
+    VsNode vsNode;
+    vsNode.id = copyVsString(strings, std::to_wstring(node.index));
+    vsNode.name = copyVsString(strings, fromUtf8(node.description));
+    vsNode.volume = toPercent(node.volume);
+    vsNode.muted = node.muted;
+    vsNode.isDefault = (node.type == PulseNodeType::Sink && node.name == defaults.sink) ||
+                       (node.type == PulseNodeType::Source && node.name == defaults.source);
+    vsNode.destinationId = node.sink != PA_INVALID_INDEX ? copyVsString(strings, std::to_wstring(node.sink)) : nullptr;
+    return vsNode;
+}
+
+void toVsNodes(std::vector<VsNode> *vsNodes, const std::vector<PulseNode> &nodes, const PulseDefaults &defaults,
+               StringArena &strings) {
+    for (const PulseNode &node: nodes) {
+        vsNodes->push_back(toVsNode(node, defaults, &strings));
+    }
+}
+
+LPWSTR findDefaultId(const std::vector<PulseNode> &nodes, const std::string &name, StringArena &strings) {
+    for (const PulseNode &node: nodes) {
+        if (node.name == name) return strings.copy(std::to_wstring(node.index));
+    }
+
+    return nullptr;
+}
+
+// Lifecycle
+void initialize() {
+    mainloop = pa_mainloop_new();
+    context = pa_context_new(pa_mainloop_get_api(mainloop), "vsExec");
+    pa_context_set_subscribe_callback(context, subscribeCallback, nullptr);
+
+    if (pa_context_connect(context, nullptr, PA_CONTEXT_NOFLAGS, nullptr) < 0) {
+        std::cerr << "Failed to connect to the PulseAudio server: " << pa_strerror(pa_context_errno(context))
+                  << std::endl;
+        return;
+    }
+
+    pa_context_state_t state;
+    while ((state = pa_context_get_state(context)) != PA_CONTEXT_READY) {
+        if (!PA_CONTEXT_IS_GOOD(state) || pa_mainloop_iterate(mainloop, 1, nullptr) < 0) {
+            std::cerr << "Failed to connect to the PulseAudio server: " << pa_strerror(pa_context_errno(context))
+                      << std::endl;
+            return;
+        }
+    }
+}
+
+void uninitialize() {
+    if (context != nullptr) {
+        pa_context_disconnect(context);
+        pa_context_unref(context);
+        context = nullptr;
+    }
+    if (mainloop != nullptr) {
+        pa_mainloop_free(mainloop);
+        mainloop = nullptr;
+    }
+}
+
+void initializeThread() {
+}
+
+void clearRequestState() {
+}
+
+void enableChangeTracking() {
+    // Nothing is cached between commands, every query goes to the server
+}
+
+// Default device functions
+int getGlobalVolume() {
+    PulseNode node;
+    if (getDefaultSink(node)) {
+        return toPercent(node.volume);
+    }
+
+    std::cerr << "Failed to get default sink" << std::endl;
+    return -1;
+}
+
+void setGlobalVolume(int volume) {
+    PulseNode node;
+    if (!getDefaultSink(node)) {
+        std::cerr << "Failed to get default sink" << std::endl;
+        return;
+    }
+
+    if (!setNodeVolume(node, volume)) {
+        std::cerr << "Failed to set volume" << std::endl;
+    }
+}
+
+bool isGlobalMuted() {
+    PulseNode node;
+    if (getDefaultSink(node)) {
+        return node.muted;
+    }
+
+    std::cerr << "Failed to get default sink" << std::endl;
+    return false;
+}
+
+void setGlobalMuted(bool mute) {
+    PulseNode node;
+    if (!getDefaultSink(node)) {
+        std::cerr << "Failed to get default sink" << std::endl;
+        return;
+    }
+
+    if (!setNodeMuted(node, mute)) {
+        std::cerr << "Failed to set mute state" << std::endl;
+    }
+}
+
+// Get VsNode functions
+void getVsNodeOfType(std::vector<VsNode> *nodes, StringArena &strings, EDataFlow dataFlow) {
+    if (!isReady()) return;
+
+    std::vector<PulseNode> devices;
+    PulseDefaults defaults;
+    bool listed = dataFlow == eCapture
+                  ? waitForOperations({pa_context_get_source_info_list(context, sourceInfoCallback, &devices),
+                                       pa_context_get_server_info(context, serverInfoCallback, &defaults)})
+                  : waitForOperations({pa_context_get_sink_info_list(context, sinkInfoCallback, &devices),
+                                       pa_context_get_server_info(context, serverInfoCallback, &defaults)});
+    if (!listed) return;
+
+    toVsNodes(nodes, devices, defaults, strings);
+}
+
+void getStreams(std::vector<VsNode> *nodes, StringArena &strings) {
+    if (!isReady()) return;
+
+    std::vector<PulseNode> sinkInputs;
+    if (!waitForOperation(pa_context_get_sink_input_info_list(context, sinkInputInfoCallback, &sinkInputs))) return;
+
+    toVsNodes(nodes, sinkInputs, PulseDefaults(), strings);
+}
+
+void getStatus(VsStatus *status) {
+    std::vector<PulseNode> sinks;
+    std::vector<PulseNode> sources;
+    std::vector<PulseNode> sinkInputs;
+    PulseDefaults defaults;
+    if (!listNodes(sinks, sources, sinkInputs, defaults)) return;
+
+    toVsNodes(&status->sinks, sinks, defaults, status->strings);
+    toVsNodes(&status->sources, sources, defaults, status->strings);
+    toVsNodes(&status->streams, sinkInputs, defaults, status->strings);
+    status->defaultSink = findDefaultId(sinks, defaults.sink, status->strings);
+    status->defaultSource = findDefaultId(sources, defaults.source, status->strings);
+}
+
+// By ID functions
+int getVolumeById(LPWSTR id) {
+    PulseNode node;
+    if (getNodeById(id, node)) {
+        return toPercent(node.volume);
+    }
+
+    std::cerr << "Failed to get volume by ID" << std::endl;
+    return -1;
+}
+
+void setVolumeById(LPWSTR id, int volume) {
+    PulseNode node;
+    if (getNodeById(id, node) && setNodeVolume(node, volume)) return;
+
+    std::cerr << "Failed to set volume by ID" << std::endl;
+}
+
+bool isMutedById(LPWSTR id) {
+    PulseNode node;
+    if (getNodeById(id, node)) {
+        return node.muted;
+    }
+
+    std::cerr << "Failed to get mute state by ID" << std::endl;
+    return false;
+}
+
+void setMutedById(LPWSTR id, bool mute) {
+    PulseNode node;
+    if (getNodeById(id, node) && setNodeMuted(node, mute)) return;
+
+    std::cerr << "Failed to set mute state by ID" << std::endl;
+}
+
+void setStreamDestination(LPWSTR id, LPWSTR destinationId) {
+    uint32_t index;
+    uint32_t sinkIndex;
+    bool success = false;
+    if (isReady() && parseIndex(id, index) && parseIndex(destinationId, sinkIndex) &&
+        waitForOperation(pa_context_move_sink_input_by_index(context, index, sinkIndex, successCallback, &success)) &&
+        success) {
+        return;
+    }
+
+    std::cerr << "Failed to set stream destination" << std::endl;
+}
+
+void applyBatch(std::vector<VsBatchOperation> &operations) {
+    std::vector<PulseNode> sinks;
+    std::vector<PulseNode> sources;
+    std::vector<PulseNode> sinkInputs;
+    PulseDefaults defaults;
+    bool listed = listNodes(sinks, sources, sinkInputs, defaults);
+
+    // A single listing resolves every ID, with the same precedence as getNodeById
+    std::map<std::wstring, PulseNode *> nodes;
+    for (std::vector<PulseNode> *list: {&sinkInputs, &sources, &sinks}) {
+        for (PulseNode &node: *list) {
+            nodes[std::to_wstring(node.index)] = &node;
+        }
+    }
+
+    for (VsBatchOperation &operation: operations) {
+        if (operation.error != nullptr) continue;
+
+        auto found = nodes.find(operation.id);
+        if (!listed || found == nodes.end()) {
+            operation.error = "Node not found";
+            continue;
+        }
+
+        PulseNode &node = *found->second;
+        switch (operation.type) {
+            case VsBatchOperationType::GetVolumeInfo:
+                operation.volume = toPercent(node.volume);
+                operation.muted = node.muted;
+                break;
+            case VsBatchOperationType::SetVolume:
+                if (!setNodeVolume(node, operation.volume)) {
+                    operation.error = "Failed to set volume";
+                }
+                break;
+            case VsBatchOperationType::SetMuted:
+                if (!setNodeMuted(node, operation.muted)) {
+                    operation.error = "Failed to set mute state";
+                }
+                break;
+        }
+    }
+}
+
+// Volume control functions, the ramps set the volume of a node fetched once
+struct VsVolumeControl {
+    PulseNode node;
+};
+
+VsVolumeControl *openVolumeControl(LPWSTR id) {
+    PulseNode node;
+    if (!getNodeById(id, node)) return nullptr;
+
+    return new VsVolumeControl{node};
+}
+
+void closeVolumeControl(VsVolumeControl *control) {
+    delete control;
+}
+
+bool getControlLevel(VsVolumeControl *control, float &level) {
+    level = (float) pa_cvolume_avg(&control->node.volume) / PA_VOLUME_NORM;
+    return true;
+}
+
+bool setControlLevel(VsVolumeControl *control, float level) {
+    PulseNode &node = control->node;
+    if (context == nullptr || pa_context_get_state(context) != PA_CONTEXT_READY || node.volume.channels == 0) {
+        return false;
+    }
+
+    pa_cvolume cvolume = node.volume;
+    pa_cvolume_set(&cvolume, node.volume.channels, (pa_volume_t) std::lround(level * (double) PA_VOLUME_NORM));
+
+    bool success = false;
+    pa_operation *operation = startSetNodeVolume(node, cvolume, &success);
+    if (operation == nullptr) return false;
+
+    completeOperation(operation);
+    if (!success) return false;
+
+    node.volume = cvolume;
+    return true;
+}
+
+// Level functions, a record stream per node on the monitor of its sink, the samples metered as they arrive
+// Mono, the server mixes the channels down, at a rate enough for meters
+const uint32_t LEVEL_SAMPLE_RATE = 8000;
+// Samples are delivered every 10 ms, several times per line of the levels
+const pa_usec_t LEVEL_FRAGMENT_USEC = 10000;
+
+struct PulseMeter {
+    pa_stream *stream;
+    LevelAccumulator accumulator;
+    // Cleared before each refresh, the streams of the nodes left unseen are disconnected
+    bool seen;
+};
+
+// The map keeps the meters in place, their accumulators are the userdata of the read callbacks
+std::map<std::pair<PulseNodeType, uint32_t>, PulseMeter> levelMeters;
+
+void levelReadCallback(pa_stream *stream, size_t, void *userdata) {
+    auto accumulator = (LevelAccumulator *) userdata;
+
+    while (pa_stream_readable_size(stream) > 0) {
+        const void *data;
+        size_t bytes;
+        if (pa_stream_peek(stream, &data, &bytes) < 0 || bytes == 0) return;
+
+        // No data for a hole in the stream, it is dropped all the same
+        if (data != nullptr) {
+            accumulator->add((const float *) data, bytes / sizeof(float));
+        }
+        pa_stream_drop(stream);
+    }
+}
+
+void releaseLevelMeter(PulseMeter &meter) {
+    pa_stream_set_read_callback(meter.stream, nullptr, nullptr);
+    pa_stream_disconnect(meter.stream);
+    pa_stream_unref(meter.stream);
+}
+
+// Keep the meter of a node seen again, or connect its stream to the source, restricted to a sink input when given
+void refreshLevelMeter(PulseNodeType type, uint32_t index, uint32_t source, uint32_t sinkInput) {
+    auto key = std::make_pair(type, index);
+    auto levelMeter = levelMeters.find(key);
+    if (levelMeter != levelMeters.end()) {
+        levelMeter->second.seen = true;
+        return;
+    }
+    if (source == PA_INVALID_INDEX) return;
+
+    pa_sample_spec sampleSpec = {PA_SAMPLE_FLOAT32NE, LEVEL_SAMPLE_RATE, 1};
+    pa_stream *stream = pa_stream_new(context, "Levels", &sampleSpec, nullptr);
+    if (stream == nullptr) {
+        std::cerr << "Failed to create stream: " << pa_strerror(pa_context_errno(context)) << std::endl;
+        return;
+    }
+    if (sinkInput != PA_INVALID_INDEX) {
+        pa_stream_set_monitor_stream(stream, sinkInput);
+    }
+
+    PulseMeter &meter = levelMeters[key];
+    meter.stream = stream;
+    meter.seen = true;
+    pa_stream_set_read_callback(stream, levelReadCallback, &meter.accumulator);
+
+    pa_buffer_attr bufferAttr;
+    bufferAttr.maxlength = (uint32_t) -1;
+    bufferAttr.tlength = (uint32_t) -1;
+    bufferAttr.prebuf = (uint32_t) -1;
+    bufferAttr.minreq = (uint32_t) -1;
+    bufferAttr.fragsize = (uint32_t) pa_usec_to_bytes(LEVEL_FRAGMENT_USEC, &sampleSpec);
+
+    // The source is named by its index, the meters must neither follow a moved stream nor keep a device awake
+    auto flags = (pa_stream_flags_t) (PA_STREAM_DONT_MOVE | PA_STREAM_ADJUST_LATENCY |
+                                      PA_STREAM_DONT_INHIBIT_AUTO_SUSPEND);
+    if (pa_stream_connect_record(stream, std::to_string(source).c_str(), &bufferAttr, flags) < 0) {
+        std::cerr << "Failed to connect stream: " << pa_strerror(pa_context_errno(context)) << std::endl;
+        releaseLevelMeter(meter);
+        levelMeters.erase(key);
+    }
+}
+
+bool openLevelMeters() {
+    std::vector<PulseNode> sinks, sources, sinkInputs;
+    PulseDefaults defaults;
+    if (!listNodes(sinks, sources, sinkInputs, defaults)) return false;
+
+    for (auto &levelMeter: levelMeters) {
+        levelMeter.second.seen = false;
+    }
+
+    std::map<uint32_t, uint32_t> monitorSources;
+    for (const PulseNode &sink: sinks) {
+        monitorSources[sink.index] = sink.monitorSource;
+        refreshLevelMeter(PulseNodeType::Sink, sink.index, sink.monitorSource, PA_INVALID_INDEX);
+    }
+    for (const PulseNode &source: sources) {
+        refreshLevelMeter(PulseNodeType::Source, source.index, source.index, PA_INVALID_INDEX);
+    }
+    for (const PulseNode &sinkInput: sinkInputs) {
+        auto monitorSource = monitorSources.find(sinkInput.sink);
+        if (monitorSource == monitorSources.end()) continue;
+
+        refreshLevelMeter(PulseNodeType::SinkInput, sinkInput.index, monitorSource->second, sinkInput.index);
+    }
+
+    for (auto levelMeter = levelMeters.begin(); levelMeter != levelMeters.end();) {
+        if (levelMeter->second.seen) {
+            ++levelMeter;
+            continue;
+        }
+
+        releaseLevelMeter(levelMeter->second);
+        levelMeter = levelMeters.erase(levelMeter);
+    }
+
+    return true;
+}
+
+void readLevels(std::vector<VsLevel> *levels, StringArena &strings) {
+    if (!isReady()) return;
+
+    // Take the samples already received, without waiting for more
+    while (pa_mainloop_iterate(mainloop, 0, nullptr) > 0) {
+    }
+
+    for (auto &levelMeter: levelMeters) {
+        PulseMeter &meter = levelMeter.second;
+        // A node removed meanwhile fails its stream, it is dropped by the next refresh
+        pa_stream_state_t state = pa_stream_get_state(meter.stream);
+        if (state == PA_STREAM_FAILED || state == PA_STREAM_TERMINATED) continue;
+
+        levels->push_back({getNodeType(levelMeter.first.first), strings.copy(std::to_wstring(levelMeter.first.second)),
+                           meter.accumulator.peak, meter.accumulator.getRms()});
+        meter.accumulator.reset();
+    }
+}
+
+void closeLevelMeters() {
+    for (auto &levelMeter: levelMeters) {
+        releaseLevelMeter(levelMeter.second);
+    }
+    levelMeters.clear();
+
+    if (context != nullptr && pa_context_get_state(context) == PA_CONTEXT_READY) {
+        while (pa_mainloop_iterate(mainloop, 0, nullptr) > 0) {
+        }
+    }
+}
+
+// Watch functions
+bool isSameNode(const PulseNode &a, const PulseNode &b) {
+    return a.description == b.description && toPercent(a.volume) == toPercent(b.volume) && a.muted == b.muted &&
+           a.sink == b.sink;
+}
+
+void pushIdEvent(std::vector<VsEvent> &events, VsEventType type, PulseNodeType nodeType, LPWSTR id) {
+    VsEvent event = {type, getNodeType(nodeType), {}};
+    event.node.id = id;
+    event.node.name = nullptr;
+    event.node.destinationId = nullptr;
+    events.push_back(event);
+}
+
+void watchDefaultChange(std::vector<VsEvent> &events, PulseNodeType type, const std::string &previous,
+                        const std::string &current) {
+    if (previous == current) return;
+
+    LPWSTR id = nullptr;
+    for (auto &watched: watchedNodes) {
+        if (watched.first.first == type && watched.second.name == current) {
+            id = toLPWSTR(std::to_wstring(watched.second.index));
+        }
+    }
+    pushIdEvent(events, VsEventType::DefaultChanged, type, id);
+}
+
+void watchNodeChange(std::vector<VsEvent> &events, PulseNodeType type, uint32_t index, bool removed) {
+    auto key = std::make_pair(type, index);
+    auto watched = watchedNodes.find(key);
+
+    PulseNode node;
+    if (removed || !getNodeByIndex(type, index, node)) {
+        if (watched == watchedNodes.end()) return;
+
+        watchedNodes.erase(watched);
+        pushIdEvent(events, VsEventType::Removed, type, toLPWSTR(std::to_wstring(index)));
+        return;
+    }
+
+    if (watched != watchedNodes.end() && isSameNode(watched->second, node)) return;
+
+    VsEventType eventType = watched == watchedNodes.end() ? VsEventType::Added : VsEventType::Changed;
+    watchedNodes[key] = node;
+    events.push_back({eventType, getNodeType(type), toVsNode(node, watchedDefaults, nullptr)});
+}
+
+bool startWatch() {
+    if (!isReady()) return false;
+
+    bool success = false;
+    pa_subscription_mask_t mask = (pa_subscription_mask_t) (PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SOURCE |
+                                                            PA_SUBSCRIPTION_MASK_SINK_INPUT |
+                                                            PA_SUBSCRIPTION_MASK_SERVER);
+    pulseWatching = true;
+    if (!waitForOperation(pa_context_subscribe(context, mask, successCallback, &success)) || !success) {
+        std::cerr << "Failed to subscribe to the PulseAudio events" << std::endl;
+        pulseWatching = false;
+        return false;
+    }
+
+    // Subscribed first, so no change is missed between the listing and the first events
+    std::vector<PulseNode> sinks;
+    std::vector<PulseNode> sources;
+    std::vector<PulseNode> sinkInputs;
+    if (!listNodes(sinks, sources, sinkInputs, watchedDefaults)) return false;
+
+    for (std::vector<PulseNode> *list: {&sinks, &sources, &sinkInputs}) {
+        for (PulseNode &node: *list) {
+            watchedNodes[std::make_pair(node.type, node.index)] = node;
+        }
+    }
+
+    return true;
+}
+
+bool waitForEvents(std::vector<VsEvent> &events, int timeoutMs) {
+    if (!isReady()) return false;
+
+    if (pendingChanges.empty()) {
+        if (pa_mainloop_prepare(mainloop, timeoutMs * 1000) < 0 || pa_mainloop_poll(mainloop) < 0 ||
+            pa_mainloop_dispatch(mainloop) < 0) {
+            std::cerr << "Lost the connection to the PulseAudio server" << std::endl;
+            return false;
+        }
+    }
+    // Take everything already received, a burst of changes is handled at once
+    while (pa_mainloop_iterate(mainloop, 0, nullptr) > 0) {
+    }
+
+    // Queries below run the main loop, changes received meanwhile wait for the next call
+    std::vector<PulseChange> changes;
+    changes.swap(pendingChanges);
+
+    for (const PulseChange &change: changes) {
+        bool removed = change.kind == PA_SUBSCRIPTION_EVENT_REMOVE;
+        switch (change.facility) {
+            case PA_SUBSCRIPTION_EVENT_SINK:
+                watchNodeChange(events, PulseNodeType::Sink, change.index, removed);
+                break;
+            case PA_SUBSCRIPTION_EVENT_SOURCE:
+                watchNodeChange(events, PulseNodeType::Source, change.index, removed);
+                break;
+            case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
+                watchNodeChange(events, PulseNodeType::SinkInput, change.index, removed);
+                break;
+            case PA_SUBSCRIPTION_EVENT_SERVER: {
+                PulseDefaults defaults;
+                if (!waitForOperation(pa_context_get_server_info(context, serverInfoCallback, &defaults))) break;
+
+                watchDefaultChange(events, PulseNodeType::Sink, watchedDefaults.sink, defaults.sink);
+                watchDefaultChange(events, PulseNodeType::Source, watchedDefaults.source, defaults.source);
+                watchedDefaults = defaults;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
+
+void stopWatch() {
+    pulseWatching = false;
+    pendingChanges.clear();
+    watchedNodes.clear();
+    watchedDefaults = PulseDefaults();
+
+    if (isReady()) {
+        waitForOperation(pa_context_subscribe(context, PA_SUBSCRIPTION_MASK_NULL, nullptr, nullptr));
+    }
+}
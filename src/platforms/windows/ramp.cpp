@@ -0,0 +1,271 @@
+#include "ramp.h"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+using RampClock = std::chrono::steady_clock;
+
+// Lowest level of the decibel curve, -60 dB: silence itself is only set by the last step
+const float RAMP_DECIBEL_FLOOR = 0.001f;
+
+struct Ramp {
+    std::wstring id;
+    VsVolumeControl *control;
+    RampOptions options;
+    std::function<void(const RampReport &)> done;
+    float from;
+    float to;
+    RampClock::time_point start;
+    size_t stepCount;
+    // Last step set, 0 before the first one
+    size_t step = 0;
+    bool failed = false;
+    long long totalJitterUs = 0;
+    RampReport report;
+};
+
+// Waits until a deadline, through a high resolution waitable timer on Windows where the sleeps are rounded up to the
+// 15.6 ms ticks of the system timer
+class RampTimer {
+public:
+    RampTimer() {
+#ifdef _WIN32
+        // Windows 10 1803 and later, the other versions fall back to the sleep
+        timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+    }
+
+    ~RampTimer() {
+#ifdef _WIN32
+        if (timer != nullptr) CloseHandle(timer);
+#endif
+    }
+
+    RampTimer(const RampTimer &) = delete;
+    RampTimer &operator=(const RampTimer &) = delete;
+
+    void waitUntil(RampClock::time_point deadline) {
+#ifdef _WIN32
+        auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - RampClock::now());
+        if (remaining.count() <= 0) return;
+
+        if (timer != nullptr) {
+            // Relative due time, in 100 ns units
+            LARGE_INTEGER dueTime;
+            dueTime.QuadPart = -(LONGLONG) (remaining.count() / 100);
+            if (SetWaitableTimer(timer, &dueTime, 0, nullptr, nullptr, FALSE)) {
+                WaitForSingleObject(timer, INFINITE);
+                return;
+            }
+        }
+#endif
+        std::this_thread::sleep_until(deadline);
+    }
+
+private:
+#ifdef _WIN32
+    HANDLE timer = nullptr;
+#endif
+};
+
+// Ramps of the nodes by ID, only the ramp thread sets their steps and destroys them
+std::mutex rampMutex;
+std::condition_variable rampsChanged;
+std::thread rampThread;
+std::unordered_map<std::wstring, std::unique_ptr<Ramp>> runningRamps;
+// Replaced by a newer ramp of their node, closed and reported by the ramp thread
+std::vector<std::unique_ptr<Ramp>> replacedRamps;
+bool stoppingRamps = false;
+
+float getRampLevel(float from, float to, double progress, RampCurve curve) {
+    if (progress <= 0) return from;
+    if (progress >= 1 || from == to) return to;
+
+    if (curve == RampCurve::Linear) {
+        return (float) (from + (to - from) * progress);
+    }
+
+    // Geometric between the levels, so the same number of decibels per step
+    double low = std::max(from, RAMP_DECIBEL_FLOOR);
+    double high = std::max(to, RAMP_DECIBEL_FLOOR);
+    return (float) (low * std::pow(high / low, progress));
+}
+
+// Scheduled from the start, so a late step doesn't delay the next ones
+RampClock::time_point getStepTime(const Ramp &ramp, size_t step) {
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(ramp.options.duration);
+    return ramp.start + duration * (long long) step / (long long) ramp.stepCount;
+}
+
+void recordJitter(Ramp &ramp, std::chrono::microseconds jitter) {
+    RampReport &report = ramp.report;
+    size_t bucket = 0;
+    while (bucket < RAMP_JITTER_BUCKETS_US.size() && jitter.count() >= RAMP_JITTER_BUCKETS_US[bucket]) {
+        bucket++;
+    }
+
+    report.jitterHistogram[bucket]++;
+    report.maxJitter = std::max(report.maxJitter, jitter);
+    ramp.totalJitterUs += jitter.count();
+    report.meanJitter = std::chrono::microseconds(ramp.totalJitterUs / (long long) (report.steps + 1));
+}
+
+// Called with the backend mutex held
+void applyStep(Ramp &ramp) {
+    RampClock::time_point now = RampClock::now();
+
+    // A late thread sets the step due now instead of catching up with the missed ones
+    size_t step = ramp.step + 1;
+    while (step < ramp.stepCount && getStepTime(ramp, step + 1) <= now) {
+        step++;
+    }
+
+    float level = getRampLevel(ramp.from, ramp.to, (double) step / (double) ramp.stepCount, ramp.options.curve);
+    if (!setControlLevel(ramp.control, level)) {
+        ramp.failed = true;
+        ramp.report.error = "Failed to set volume";
+        return;
+    }
+
+    recordJitter(ramp, std::chrono::duration_cast<std::chrono::microseconds>(now - getStepTime(ramp, step)));
+    ramp.step = step;
+    ramp.report.steps++;
+    ramp.report.volume = (int) std::lround(level * 100);
+}
+
+void runRamps() {
+    initializeThread();
+    RampTimer timer;
+
+    std::unique_lock<std::mutex> lock(rampMutex);
+    while (true) {
+        // Steps due now, the others are waited for
+        RampClock::time_point now = RampClock::now();
+        RampClock::time_point next = RampClock::time_point::max();
+        std::vector<Ramp *> dueRamps;
+        for (auto &entry: runningRamps) {
+            RampClock::time_point stepTime = getStepTime(*entry.second, entry.second->step + 1);
+            if (stepTime <= now) {
+                dueRamps.push_back(entry.second.get());
+            } else {
+                next = std::min(next, stepTime);
+            }
+        }
+
+        if (!dueRamps.empty()) {
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> backendLock(getBackendMutex());
+                for (Ramp *ramp: dueRamps) {
+                    applyStep(*ramp);
+                }
+            }
+            lock.lock();
+        }
+
+        // Ramps to close and report: the replaced ones, the ended ones, and all of them when stopping
+        std::vector<std::unique_ptr<Ramp>> endedRamps = std::move(replacedRamps);
+        replacedRamps.clear();
+        for (auto entry = runningRamps.begin(); entry != runningRamps.end();) {
+            Ramp &ramp = *entry->second;
+            bool ended = ramp.failed || ramp.step == ramp.stepCount;
+            if (ended) {
+                ramp.report.completed = !ramp.failed;
+            }
+
+            if (ended || stoppingRamps) {
+                endedRamps.push_back(std::move(entry->second));
+                entry = runningRamps.erase(entry);
+            } else {
+                entry++;
+            }
+        }
+
+        if (!endedRamps.empty()) {
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> backendLock(getBackendMutex());
+                for (std::unique_ptr<Ramp> &ramp: endedRamps) {
+                    closeVolumeControl(ramp->control);
+                }
+            }
+            for (std::unique_ptr<Ramp> &ramp: endedRamps) {
+                ramp->report.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                        RampClock::now() - ramp->start);
+                ramp->done(ramp->report);
+            }
+            lock.lock();
+            continue;
+        }
+
+        if (stoppingRamps) return;
+
+        if (runningRamps.empty()) {
+            rampsChanged.wait_for(lock, std::chrono::seconds(1), [] {
+                return stoppingRamps || !runningRamps.empty() || !replacedRamps.empty();
+            });
+        } else if (dueRamps.empty()) {
+            // A ramp started meanwhile waits for the end of the current interval at most
+            lock.unlock();
+            timer.waitUntil(next);
+            lock.lock();
+        }
+    }
+}
+
+void startRamp(const std::wstring &id, VsVolumeControl *control, const RampOptions &options,
+               const std::function<void(const RampReport &)> &done) {
+    std::unique_ptr<Ramp> ramp(new Ramp());
+    ramp->id = id;
+    ramp->control = control;
+    ramp->options = options;
+    ramp->done = done;
+    ramp->to = (float) options.target / 100;
+    // From the target when the current level can't be read, the ramp then sets it at once
+    if (!getControlLevel(control, ramp->from)) {
+        ramp->from = ramp->to;
+    }
+    ramp->report.volume = (int) std::lround(ramp->from * 100);
+
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(options.duration);
+    long long interval = std::max<long long>(options.stepInterval.count(), 1);
+    ramp->stepCount = (size_t) std::max<long long>((duration.count() + interval - 1) / interval, 1);
+    ramp->start = RampClock::now();
+
+    std::lock_guard<std::mutex> lock(rampMutex);
+    std::unique_ptr<Ramp> &running = runningRamps[id];
+    if (running != nullptr) {
+        replacedRamps.push_back(std::move(running));
+    }
+    running = std::move(ramp);
+
+    if (!rampThread.joinable()) {
+        rampThread = std::thread(runRamps);
+    }
+    rampsChanged.notify_all();
+}
+
+void stopRamps() {
+    {
+        std::lock_guard<std::mutex> lock(rampMutex);
+        if (!rampThread.joinable()) return;
+        stoppingRamps = true;
+    }
+    rampsChanged.notify_all();
+
+    rampThread.join();
+    stoppingRamps = false;
+}
@@ -0,0 +1,69 @@
+#ifndef VSEXEC_RAMP_H
+#define VSEXEC_RAMP_H
+
+#include "audio.h"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+/*
+ * Volume ramps
+ *
+ * A ramp resolves its node once, then sets its level from a dedicated thread at a fixed step interval, 10 ms by
+ * default, until the target is reached. The steps are scheduled from the start of the ramp, so a late step doesn't
+ * delay the following ones, and how late each step was set is reported as a histogram.
+ *
+ * The ramp thread takes the backend mutex for each step, the other threads sharing the backend must hold it as well.
+ */
+
+enum class RampCurve {
+    // Straight line between the volumes
+    Linear,
+    // Straight line in decibels, heard as an even fade, from or to silence through -60 dB
+    Decibel,
+};
+
+struct RampOptions {
+    // Volume reached at the end, from 0 to 100
+    int target = 0;
+    std::chrono::milliseconds duration{0};
+    RampCurve curve = RampCurve::Linear;
+    std::chrono::microseconds stepInterval{10000};
+};
+
+// Upper bounds of the jitter histogram buckets, the last bucket holds the steps later than all of them
+const std::array<long, 6> RAMP_JITTER_BUCKETS_US = {100, 250, 500, 1000, 2000, 5000};
+
+struct RampReport {
+    // False when the ramp was replaced by another one on the same node, stopped, or a step failed
+    bool completed = false;
+    // Set when a step failed
+    const char *error = nullptr;
+    // Last volume set, from 0 to 100
+    int volume = 0;
+    size_t steps = 0;
+    std::chrono::microseconds elapsed{0};
+    // How late the steps were set against their schedule
+    std::chrono::microseconds maxJitter{0};
+    std::chrono::microseconds meanJitter{0};
+    std::array<size_t, RAMP_JITTER_BUCKETS_US.size() + 1> jitterHistogram{};
+};
+
+// Level of a ramp between two levels from 0 to 1, at a progress from 0 to 1
+float getRampLevel(float from, float to, double progress, RampCurve curve);
+
+/**
+ * Start a ramp, replacing the one running on the same node.
+ * @param id The node ID, the ramps of the same ID replace each other
+ * @param control The volume control of the node, owned and closed by the ramp
+ * @param done Called from the ramp thread once the ramp completed, was replaced or stopped
+ */
+void startRamp(const std::wstring &id, VsVolumeControl *control, const RampOptions &options,
+               const std::function<void(const RampReport &)> &done);
+
+// Stop the running ramps and their thread, without holding the backend mutex: the ramps close their controls
+void stopRamps();
+
+#endif
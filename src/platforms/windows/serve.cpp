@@ -0,0 +1,79 @@
+#include "serve.h"
+#include "commands.h"
+#include "audio.h"
+#include "ramp.h"
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+void writeResponse(std::ostream &out, const std::string &requestId, int code, const std::string &output,
+                   const std::string &error) {
+    out << requestId << '\t' << code << '\t' << output.size() << '\t' << error.size() << '\n';
+    out << output << error;
+    out.flush();
+}
+
+int serve(const std::string &program, std::istream &in, std::ostream &out) {
+    std::string line;
+    // The ramps are answered from the ramp thread once they end, while the next requests are served
+    std::mutex outputMutex;
+
+    // The process lives across requests, so its caches must follow the device and session changes
+    enableChangeTracking();
+
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        std::vector<std::string> fields = splitFields(line);
+        std::string requestId = fields[0];
+        fields[0] = program;
+        bool compact = removeCompactOption(fields);
+
+        std::ostringstream output;
+        std::ostringstream error;
+        int code;
+        bool answeredLater = false;
+        {
+            // The steps of the ramps share the backend
+            std::lock_guard<std::mutex> backendLock(getBackendMutex());
+
+            // Backend errors are reported on std::cerr, capture them so they are sent back with the request
+            std::streambuf *cerrBuffer = std::cerr.rdbuf(error.rdbuf());
+
+            try {
+                if (fields.size() > 1 && fields[1] == "ramp") {
+                    code = startRampCommand(fields, output, compact,
+                                            [&out, &outputMutex, requestId](int rampCode, const std::string &rampOutput,
+                                                                            const std::string &rampError) {
+                                                std::lock_guard<std::mutex> lock(outputMutex);
+                                                writeResponse(out, requestId, rampCode, rampOutput, rampError);
+                                            });
+                    answeredLater = code == 0;
+                } else {
+                    code = runCommand(fields, in, output, compact);
+                }
+            } catch (const std::exception &e) {
+                error << e.what() << std::endl;
+                code = 1;
+            }
+
+            std::cerr.rdbuf(cerrBuffer);
+            clearRequestState();
+        }
+
+        if (!answeredLater) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            writeResponse(out, requestId, code, output.str(), error.str());
+        }
+    }
+
+    // The ramps still running are answered as not completed
+    stopRamps();
+    return 0;
+}
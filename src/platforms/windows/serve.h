@@ -0,0 +1,34 @@
+#ifndef VSEXEC_SERVE_H
+#define VSEXEC_SERVE_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+/*
+ * Serve protocol
+ *
+ * Requests are read one per line, fields separated by tabs:
+ *   <requestId>\t<command>\t<arg>...\n
+ *
+ * Each request is answered with a header line followed by the raw command output and error output:
+ *   <requestId>\t<exitCode>\t<outputBytes>\t<errorBytes>\n<output><error>
+ *
+ * A command reading extra input, like batch, reads its lines right after its request line.
+ * Requests are answered in the order they are received, except the ramps which are answered once they end while the
+ * next requests are served. The request ID is only echoed back.
+ */
+
+void writeResponse(std::ostream &out, const std::string &requestId, int code, const std::string &output,
+                   const std::string &error);
+
+/**
+ * Answer requests from the input until it is closed.
+ * @param program The program name, used in usage messages
+ * @param in The stream requests are read from
+ * @param out The stream responses are written to
+ * @return The exit code of the process
+ */
+int serve(const std::string &program, std::istream &in, std::ostream &out);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef VSEXEC_SESSION_INDEX_H
+#define VSEXEC_SESSION_INDEX_H
+
+#include <string>
+#include <unordered_map>
+
+/**
+ * Sessions by ID, built from a full enumeration then kept up to date incrementally.
+ * The index doesn't own the sessions, the release function given to erase and clear is called on removed ones.
+ */
+template<typename Session>
+class SessionIndex {
+public:
+    // Whether the index holds a full enumeration, false until markBuilt and after clear
+    bool isBuilt() const {
+        return built;
+    }
+
+    void markBuilt() {
+        built = true;
+    }
+
+    size_t size() const {
+        return sessions.size();
+    }
+
+    Session *find(const std::wstring &id) {
+        auto session = sessions.find(id);
+        return session != sessions.end() ? &session->second : nullptr;
+    }
+
+    template<typename Fn>
+    void forEach(Fn fn) {
+        for (auto &session: sessions) {
+            fn(session.first, session.second);
+        }
+    }
+
+    template<typename Release>
+    void insert(const std::wstring &id, const Session &session, Release release) {
+        auto inserted = sessions.insert({id, session});
+        if (!inserted.second) {
+            release(inserted.first->second);
+            inserted.first->second = session;
+        }
+    }
+
+    template<typename Release>
+    void erase(const std::wstring &id, Release release) {
+        auto session = sessions.find(id);
+        if (session == sessions.end()) return;
+
+        release(session->second);
+        sessions.erase(session);
+    }
+
+    template<typename Release>
+    void clear(Release release) {
+        for (auto &session: sessions) {
+            release(session.second);
+        }
+        sessions.clear();
+        built = false;
+    }
+
+private:
+    std::unordered_map<std::wstring, Session> sessions;
+    bool built = false;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "stats.h"
+#include "jsonWriter.h"
+#include <atomic>
+#include <cstdint>
+
+struct PhaseStat {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> nanoseconds{0};
+};
+
+// In the order of VsStat
+const char *STAT_NAMES[] = {"initialize", "enumerator", "devices", "sessions", "processName", "output"};
+
+std::atomic<bool> statsEnabled{false};
+PhaseStat phaseStats[static_cast<int>(VsStat::Count)];
+
+void enableStats() {
+    statsEnabled = true;
+}
+
+bool areStatsEnabled() {
+    return statsEnabled.load(std::memory_order_relaxed);
+}
+
+void addStat(VsStat stat, std::chrono::steady_clock::duration elapsed) {
+    PhaseStat &phase = phaseStats[static_cast<int>(stat)];
+    phase.calls.fetch_add(1, std::memory_order_relaxed);
+    phase.nanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                                std::memory_order_relaxed);
+}
+
+void resetStats() {
+    for (PhaseStat &phase : phaseStats) {
+        phase.calls = 0;
+        phase.nanoseconds = 0;
+    }
+}
+
+void printStats(std::ostream &out) {
+    JsonWriter json(true);
+    json.raw("{").key("stats").raw("{");
+    for (int i = 0; i < static_cast<int>(VsStat::Count); i++) {
+        if (i > 0) json.raw(",");
+        json.key(STAT_NAMES[i]).raw("{")
+            .key("calls").number(static_cast<int>(phaseStats[i].calls.load()))
+            .raw(",").key("us").number(static_cast<int>(phaseStats[i].nanoseconds.load() / 1000))
+            .raw("}");
+    }
+    json.raw("}}");
+    json.writeTo(out);
+    out.flush();
+}
+
+StatTimer::StatTimer(VsStat stat) : stat(stat), enabled(areStatsEnabled()) {
+    if (enabled) start = std::chrono::steady_clock::now();
+}
+
+StatTimer::~StatTimer() {
+    if (enabled) addStat(stat, std::chrono::steady_clock::now() - start);
+}
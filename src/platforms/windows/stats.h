@@ -0,0 +1,43 @@
+#ifndef VSEXEC_STATS_H
+#define VSEXEC_STATS_H
+
+#include <chrono>
+#include <ostream>
+
+// Phases of a run timed with the --stats option
+enum class VsStat {
+    Initialize,
+    Enumerator,
+    Devices,
+    Sessions,
+    ProcessName,
+    Output,
+    Count,
+};
+
+// Off by default, the timers don't read the clock until then
+void enableStats();
+bool areStatsEnabled();
+void addStat(VsStat stat, std::chrono::steady_clock::duration elapsed);
+void resetStats();
+// A JSON record of the calls and total microseconds of every phase, on a single line
+void printStats(std::ostream &out);
+
+/**
+ * Add the time spent in its scope to a phase when the stats are enabled. Safe from the enumeration pool threads.
+ */
+class StatTimer {
+public:
+    explicit StatTimer(VsStat stat);
+    ~StatTimer();
+
+    StatTimer(const StatTimer &) = delete;
+    StatTimer &operator=(const StatTimer &) = delete;
+
+private:
+    VsStat stat;
+    bool enabled;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "stringArena.h"
+#include <algorithm>
+
+StringArena::StringArena(size_t blockSize) : blockSize(blockSize) {
+}
+
+wchar_t *StringArena::allocate(size_t length) {
+    if (blocks.empty() || blocks.back().size - used < length) {
+        // Strings longer than a block get one of their own
+        size_t size = std::max(blockSize, length);
+        blocks.push_back({std::unique_ptr<wchar_t[]>(new wchar_t[size]), size});
+        used = 0;
+    }
+
+    wchar_t *str = blocks.back().data.get() + used;
+    used += length;
+    return str;
+}
+
+wchar_t *StringArena::copy(const wchar_t *str, size_t length) {
+    wchar_t *copy = allocate(length + 1);
+    std::copy(str, str + length, copy);
+    copy[length] = 0;
+    return copy;
+}
+
+wchar_t *StringArena::copy(const wchar_t *str) {
+    if (str == nullptr) return nullptr;
+
+    size_t length = 0;
+    while (str[length] != 0) {
+        length++;
+    }
+    return copy(str, length);
+}
+
+wchar_t *StringArena::copy(const std::wstring &str) {
+    return copy(str.data(), str.size());
+}
+
+void StringArena::clear() {
+    if (blocks.size() > 1) {
+        // Merged into a block of the whole size, the next enumeration is usually about as large
+        size_t capacity = getCapacity();
+        blocks.clear();
+        blocks.push_back({std::unique_ptr<wchar_t[]>(new wchar_t[capacity]), capacity});
+    }
+    used = 0;
+}
+
+size_t StringArena::getCapacity() const {
+    size_t capacity = 0;
+    for (const Block &block: blocks) {
+        capacity += block.size;
+    }
+    return capacity;
+}
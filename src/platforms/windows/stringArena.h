@@ -0,0 +1,51 @@
+#ifndef VSEXEC_STRING_ARENA_H
+#define VSEXEC_STRING_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Storage of the strings of one enumeration, e.g. the IDs and names of a status. The strings are wide ones, the
+ * LPWSTR of the audio API.
+ *
+ * Strings are appended to large blocks instead of being allocated one by one, and they are all freed at once by
+ * clear() or the destructor. After a clear the arena keeps a single block as large as everything it held, so the next
+ * enumeration of the same system doesn't allocate at all.
+ */
+class StringArena {
+public:
+    explicit StringArena(size_t blockSize = 4096);
+
+    StringArena(const StringArena &) = delete;
+    StringArena &operator=(const StringArena &) = delete;
+    StringArena(StringArena &&) = default;
+    StringArena &operator=(StringArena &&) = default;
+
+    // Copy a null terminated string, null stays null
+    wchar_t *copy(const wchar_t *str);
+    wchar_t *copy(const wchar_t *str, size_t length);
+    wchar_t *copy(const std::wstring &str);
+
+    // Free every string at once, the pointers given so far are dangling afterward
+    void clear();
+
+    // Characters reserved by the blocks, used or not
+    size_t getCapacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<wchar_t[]> data;
+        size_t size;
+    };
+
+    wchar_t *allocate(size_t length);
+
+    std::vector<Block> blocks;
+    // Characters used in the last block
+    size_t used = 0;
+    size_t blockSize;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "taskPool.h"
+#include "audio.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+
+const size_t DEFAULT_ENUMERATION_THREADS = 4;
+
+// Forwards to another buffer a line at a time under a lock, so the tasks can write to std::cerr at the same time
+// without mixing their messages. std::cerr flushes after every insertion, only the complete lines are written though.
+class LockedStreamBuffer : public std::streambuf {
+public:
+    explicit LockedStreamBuffer(std::streambuf *target) : target(target) {
+    }
+
+    // Write what the calling thread left without a line end
+    void writePending() {
+        writeLines(getPendingLine().size());
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+
+        std::string &line = getPendingLine();
+        line += (char) c;
+        if (c == '\n') writeLines(line.size());
+        return c;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override {
+        std::string &line = getPendingLine();
+        line.append(s, (size_t) n);
+
+        size_t lineEnd = line.rfind('\n');
+        if (lineEnd != std::string::npos) writeLines(lineEnd + 1);
+        return n;
+    }
+
+    int sync() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return target->pubsync();
+    }
+
+private:
+    // The text written by the calling thread and not forwarded yet
+    static std::string &getPendingLine() {
+        static thread_local std::string line;
+        return line;
+    }
+
+    void writeLines(size_t size) {
+        std::string &line = getPendingLine();
+        std::lock_guard<std::mutex> lock(mutex);
+        target->sputn(line.data(), (std::streamsize) size);
+        line.erase(0, size);
+    }
+
+    std::streambuf *target;
+    std::mutex mutex;
+};
+
+// Same as condition_variable::wait, through wait_for: binaries built by GCC 12 otherwise need its libstdc++ at run time
+template<typename Predicate>
+void waitFor(std::condition_variable &condition, std::unique_lock<std::mutex> &lock, Predicate predicate) {
+    while (!condition.wait_for(lock, std::chrono::seconds(1), predicate)) {
+    }
+}
+
+TaskPool::TaskPool(size_t threadCount, std::function<void()> initializeWorker)
+        : threadCount(threadCount == 0 ? 1 : threadCount), initializeWorker(std::move(initializeWorker)) {
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread &worker: workers) {
+        worker.join();
+    }
+}
+
+size_t TaskPool::getThreadCount() const {
+    return threadCount;
+}
+
+void TaskPool::work() {
+    if (initializeWorker) {
+        initializeWorker();
+    }
+
+    uint64_t seenGeneration = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        waitFor(wake, lock, [this, &seenGeneration] { return stopping || generation != seenGeneration; });
+        if (stopping) return;
+
+        seenGeneration = generation;
+        runTasks(lock);
+    }
+}
+
+// Take the tasks left in the current run one at a time, the lock is released while a task runs
+void TaskPool::runTasks(std::unique_lock<std::mutex> &lock) {
+    while (nextTask < taskCount) {
+        size_t index = nextTask++;
+
+        lock.unlock();
+        (*task)(index);
+        lock.lock();
+
+        if (--pendingTasks == 0) {
+            done.notify_all();
+        }
+    }
+}
+
+void TaskPool::run(size_t count, const std::function<void(size_t)> &task) {
+    if (threadCount == 1 || count <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(runMutex);
+    if (workers.empty()) {
+        for (size_t i = 1; i < threadCount; i++) {
+            workers.emplace_back(&TaskPool::work, this);
+        }
+    }
+
+    // The buffer is swapped while no task runs, serve redirects std::cerr per request
+    LockedStreamBuffer lockedErrors(std::cerr.rdbuf());
+    std::streambuf *errors = std::cerr.rdbuf(&lockedErrors);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        this->task = &task;
+        taskCount = count;
+        nextTask = 0;
+        pendingTasks = count;
+        generation++;
+        wake.notify_all();
+
+        runTasks(lock);
+        waitFor(done, lock, [this] { return pendingTasks == 0; });
+
+        this->task = nullptr;
+        taskCount = 0;
+        nextTask = 0;
+    }
+
+    lockedErrors.writePending();
+    std::cerr.rdbuf(errors);
+}
+
+// Enumeration pool
+std::unique_ptr<TaskPool> enumerationPool;
+size_t enumerationThreads = 0;
+
+size_t getEnumerationThreadsFromEnvironment() {
+    const char *value = std::getenv("VS_ENUMERATION_THREADS");
+    size_t threadCount = value == nullptr ? 0 : std::strtoul(value, nullptr, 10);
+    return threadCount > 0 ? threadCount : DEFAULT_ENUMERATION_THREADS;
+}
+
+TaskPool &getEnumerationPool() {
+    if (enumerationPool == nullptr) {
+        if (enumerationThreads == 0) {
+            enumerationThreads = getEnumerationThreadsFromEnvironment();
+        }
+        enumerationPool.reset(new TaskPool(enumerationThreads, initializeThread));
+    }
+
+    return *enumerationPool;
+}
+
+void setEnumerationThreads(size_t threadCount) {
+    enumerationPool.reset();
+    enumerationThreads = threadCount;
+}
+
+void releaseEnumerationPool() {
+    enumerationPool.reset();
+}
@@ -0,0 +1,62 @@
+#ifndef VSEXEC_TASK_POOL_H
+#define VSEXEC_TASK_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Small pool of threads running the tasks of one call at a time, e.g. one task per device of an enumeration.
+ *
+ * The workers are started by the first run and each is prepared once by initializeWorker, the backend's
+ * initializeThread for the enumerations. The calling thread runs tasks as well. The tasks must not throw, they report
+ * their failures on std::cerr, whose writes are serialized while the tasks run.
+ */
+class TaskPool {
+public:
+    // The thread count includes the calling thread, with 1 the tasks run one after another on it
+    explicit TaskPool(size_t threadCount, std::function<void()> initializeWorker = nullptr);
+    ~TaskPool();
+
+    TaskPool(const TaskPool &) = delete;
+    TaskPool &operator=(const TaskPool &) = delete;
+
+    // Run task(i) for every i below count, return once they are all done
+    void run(size_t count, const std::function<void(size_t)> &task);
+
+    size_t getThreadCount() const;
+
+private:
+    void work();
+    void runTasks(std::unique_lock<std::mutex> &lock);
+
+    size_t threadCount;
+    std::function<void()> initializeWorker;
+    std::vector<std::thread> workers;
+
+    // One run at a time, the tasks of a run are shared through the fields below
+    std::mutex runMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)> *task = nullptr;
+    size_t taskCount = 0;
+    size_t nextTask = 0;
+    size_t pendingTasks = 0;
+    // Incremented by each run, so the workers tell a new run from a spurious wake up
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+// Pool walking the devices of the enumerations, VS_ENUMERATION_THREADS threads (4 by default)
+TaskPool &getEnumerationPool();
+// Replace the enumeration pool, 1 enumerates the devices one after another
+void setEnumerationThreads(size_t threadCount);
+// Stop the workers of the enumeration pool, called by the backend's uninitialize
+void releaseEnumerationPool();
+
+#endif
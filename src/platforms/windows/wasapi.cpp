@@ -0,0 +1,1811 @@
+#include "audio.h"
+#include "comPtr.h"
+#include "commands.h"
+#include "levels.h"
+#include "processNameCache.h"
+#include "sessionIndex.h"
+#include "stats.h"
+#include "taskPool.h"
+#include <iostream>
+#include <string>
+#include <endpointvolume.h>
+#include <initguid.h>
+#include <Functiondiscoverykeys_devpkey.h>
+#include <functional>
+#include <audiopolicy.h>
+#include <winver.h>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+ComPtr<IMMDeviceEnumerator> deviceEnumerator;
+// Set in serve mode, the caches then follow the device and session notifications instead of living for one command
+bool trackChanges = false;
+// Display names of the session processes, shared with the other vsExec processes through a file in the temp directory
+ProcessNameCache *processNameCache = nullptr;
+// The streams of the devices are enumerated from several threads
+SRWLOCK processNameLock = SRWLOCK_INIT;
+
+void clearDeviceCache();
+void clearSessionIndex();
+
+// Notifications reported to the watch, turned into events by the main thread
+enum class WatchNotificationType {
+    VolumeChanged,
+    DeviceChanged,
+    DefaultChanged,
+    SessionsChanged,
+};
+
+struct WatchNotification {
+    WatchNotificationType type;
+    std::wstring id;
+    int volume;
+    bool muted;
+    EDataFlow dataFlow;
+};
+
+SRWLOCK watchLock = SRWLOCK_INIT;
+std::vector<WatchNotification> watchNotifications;
+// Only set while watching
+HANDLE watchSignal = nullptr;
+
+void pushWatchNotification(const WatchNotification &notification) {
+    AcquireSRWLockExclusive(&watchLock);
+    if (watchSignal != nullptr) {
+        watchNotifications.push_back(notification);
+        SetEvent(watchSignal);
+    }
+    ReleaseSRWLockExclusive(&watchLock);
+}
+
+// Utils
+void clearGlobal() {
+    clearSessionIndex();
+    clearDeviceCache();
+    deviceEnumerator.reset();
+}
+
+void initialize() {
+    CoInitialize(nullptr);
+}
+
+void uninitialize() {
+    releaseEnumerationPool();
+    clearGlobal();
+    delete processNameCache;
+    processNameCache = nullptr;
+    CoUninitialize();
+}
+
+void initializeThread() {
+    // Threadpool threads join the multithreaded apartment once, the objects created there can be used from any of them
+    static thread_local bool comInitialized = false;
+    if (!comInitialized) {
+        CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        comInitialized = true;
+    }
+}
+
+void clearRequestState() {
+    // Without notifications nothing tells when the cached devices are outdated
+    if (!trackChanges) {
+        clearDeviceCache();
+    }
+}
+
+ComPtr<ISimpleAudioVolume> toSAV(IAudioSessionControl2 *sessionControl) {
+    HRESULT hr;
+
+    ComPtr<ISimpleAudioVolume> simpleAudioVolume;
+    hr = sessionControl->QueryInterface(__uuidof(ISimpleAudioVolume), simpleAudioVolume.putVoid());
+    if (FAILED(hr)) {
+        std::cerr << "Failed to get simple audio volume from session control" << std::endl;
+        return ComPtr<ISimpleAudioVolume>();
+    }
+
+    return simpleAudioVolume;
+}
+
+ComPtr<IAudioEndpointVolume> toAEV(IMMDevice *device) {
+    HRESULT hr;
+
+    ComPtr<IAudioEndpointVolume> audioEndpointVolume;
+    hr = device->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_INPROC_SERVER, nullptr,
+                          audioEndpointVolume.putVoid());
+    if (FAILED(hr)) {
+        std::cerr << "Failed to activate audio endpoint volume" << std::endl;
+        return ComPtr<IAudioEndpointVolume>();
+    }
+
+    return audioEndpointVolume;
+}
+
+// Get functions
+// The enumerator is kept until uninitialize, the caller doesn't own a reference
+IMMDeviceEnumerator *getDeviceEnumerator() {
+    HRESULT hr;
+
+    if (deviceEnumerator) {
+        return deviceEnumerator.get();
+    }
+
+    // Get the speakers device
+    StatTimer timer(VsStat::Enumerator);
+    hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_INPROC_SERVER, __uuidof(IMMDeviceEnumerator),
+                          deviceEnumerator.putVoid());
+    if (FAILED(hr)) {
+        std::cerr << "Failed to create device enumerator" << std::endl;
+        return nullptr;
+    }
+
+    return deviceEnumerator.get();
+}
+
+bool getDeviceId(IMMDevice *device, std::wstring &id) {
+    CoTaskMemString pwszID;
+    if (FAILED(device->GetId(pwszID.put()))) {
+        std::cerr << "Failed to get device ID" << std::endl;
+        return false;
+    }
+
+    id = pwszID.get();
+    return true;
+}
+
+// Device cache
+// Devices and endpoint volumes by device ID, the IDs of render and capture devices never collide
+struct CachedEndpoint {
+    ComPtr<IMMDevice> device;
+    ComPtr<IAudioEndpointVolume> endpointVolume;
+};
+
+// Default device of an EDataFlow/ERole pair, the device is null when there is none
+struct CachedDefault {
+    bool resolved = false;
+    ComPtr<IMMDevice> device;
+    ComPtr<IAudioEndpointVolume> endpointVolume;
+};
+
+std::unordered_map<std::wstring, CachedEndpoint> endpointCache;
+CachedDefault defaultCache[EDataFlow_enum_count][ERole_enum_count];
+
+// Device changes reported by the notifications, applied to the cache by the main thread on its next access
+SRWLOCK deviceChangesLock = SRWLOCK_INIT;
+std::vector<std::wstring> changedDevices;
+bool defaultsChanged = false;
+bool devicesAdded = false;
+
+class DeviceNotification : public IMMNotificationClient {
+public:
+    ULONG STDMETHODCALLTYPE AddRef() override {
+        return InterlockedIncrement(&refCount);
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override {
+        ULONG count = InterlockedDecrement(&refCount);
+        if (count == 0) {
+            delete this;
+        }
+        return count;
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvInterface) override {
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IMMNotificationClient)) {
+            AddRef();
+            *ppvInterface = (IMMNotificationClient *) this;
+            return S_OK;
+        }
+
+        *ppvInterface = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR pwstrDefaultDeviceId) override {
+        AcquireSRWLockExclusive(&deviceChangesLock);
+        defaultsChanged = true;
+        ReleaseSRWLockExclusive(&deviceChangesLock);
+
+        if (role == eMultimedia) {
+            std::wstring id = pwstrDefaultDeviceId != nullptr ? pwstrDefaultDeviceId : L"";
+            pushWatchNotification({WatchNotificationType::DefaultChanged, id, 0, false, flow});
+        }
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR pwstrDeviceId) override {
+        AcquireSRWLockExclusive(&deviceChangesLock);
+        devicesAdded = true;
+        ReleaseSRWLockExclusive(&deviceChangesLock);
+
+        pushWatchNotification({WatchNotificationType::DeviceChanged, pwstrDeviceId, 0, false, eAll});
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR pwstrDeviceId) override {
+        deviceChanged(pwstrDeviceId);
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState) override {
+        deviceChanged(pwstrDeviceId);
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR pwstrDeviceId, const PROPERTYKEY key) override {
+        return S_OK;
+    }
+
+private:
+    LONG refCount = 1;
+
+    static void deviceChanged(LPCWSTR id) {
+        AcquireSRWLockExclusive(&deviceChangesLock);
+        changedDevices.emplace_back(id);
+        // A device coming back must also bring its sessions back
+        devicesAdded = true;
+        ReleaseSRWLockExclusive(&deviceChangesLock);
+
+        pushWatchNotification({WatchNotificationType::DeviceChanged, id, 0, false, eAll});
+    }
+};
+
+ComPtr<DeviceNotification> deviceNotification;
+
+void clearDefaultCache() {
+    for (auto &roles: defaultCache) {
+        for (CachedDefault &cachedDefault: roles) {
+            cachedDefault = CachedDefault();
+        }
+    }
+}
+
+void clearDeviceCache() {
+    if (deviceNotification) {
+        if (deviceEnumerator) {
+            deviceEnumerator->UnregisterEndpointNotificationCallback(deviceNotification.get());
+        }
+        deviceNotification.reset();
+    }
+
+    endpointCache.clear();
+    clearDefaultCache();
+}
+
+// Drop the cache entries reported outdated by the notifications
+void applyDeviceChanges() {
+    std::vector<std::wstring> changed;
+    AcquireSRWLockExclusive(&deviceChangesLock);
+    changed.swap(changedDevices);
+    bool clearDefaults = defaultsChanged || !changed.empty();
+    defaultsChanged = false;
+    ReleaseSRWLockExclusive(&deviceChangesLock);
+
+    for (const std::wstring &id: changed) {
+        endpointCache.erase(id);
+    }
+    if (clearDefaults) {
+        clearDefaultCache();
+    }
+}
+
+// Whether devices appeared since the last call, their sessions are then missing from the session index
+bool takeDevicesAdded() {
+    AcquireSRWLockExclusive(&deviceChangesLock);
+    bool added = devicesAdded;
+    devicesAdded = false;
+    ReleaseSRWLockExclusive(&deviceChangesLock);
+
+    return added;
+}
+
+void registerDeviceNotification() {
+    IMMDeviceEnumerator *deviceEnumerator = getDeviceEnumerator();
+    if (deviceEnumerator == nullptr || deviceNotification) {
+        return;
+    }
+
+    deviceNotification = ComPtr<DeviceNotification>(new DeviceNotification());
+    if (FAILED(deviceEnumerator->RegisterEndpointNotificationCallback(deviceNotification.get()))) {
+        std::cerr << "Failed to register endpoint notification callback" << std::endl;
+        deviceNotification.reset();
+    }
+}
+
+CachedDefault *getCachedDefault(EDataFlow dataFlow, ERole role) {
+    HRESULT hr;
+
+    if (trackChanges) {
+        applyDeviceChanges();
+    }
+
+    CachedDefault &cachedDefault = defaultCache[dataFlow][role];
+    if (cachedDefault.resolved) {
+        return &cachedDefault;
+    }
+
+    IMMDeviceEnumerator *deviceEnumerator = getDeviceEnumerator();
+    if (deviceEnumerator == nullptr) {
+        return nullptr;
+    }
+
+    // Get default audio endpoint that the system is currently using
+    hr = deviceEnumerator->GetDefaultAudioEndpoint(dataFlow, role, cachedDefault.device.put());
+    if (hr == HRESULT_FROM_WIN32(ERROR_NOT_FOUND)) {
+        // No device of this type, e.g. no microphone plugged in
+        cachedDefault.device.reset();
+        cachedDefault.resolved = true;
+        return &cachedDefault;
+    }
+    if (FAILED(hr)) {
+        std::cerr << "Failed to get default audio endpoint" << std::endl;
+        cachedDefault.device.reset();
+        return nullptr;
+    }
+
+    cachedDefault.resolved = true;
+    return &cachedDefault;
+}
+
+// The cache keeps the ownership of the returned device
+IMMDevice *getDefaultDevice(EDataFlow dataFlow = eRender, ERole role = eMultimedia) {
+    CachedDefault *cachedDefault = getCachedDefault(dataFlow, role);
+    if (cachedDefault == nullptr || !cachedDefault->device) {
+        return nullptr;
+    }
+
+    return cachedDefault->device.get();
+}
+
+// The cache keeps the ownership of the returned endpoint volume
+IAudioEndpointVolume *getDefaultAEV(EDataFlow dataFlow = eRender, ERole role = eMultimedia) {
+    CachedDefault *cachedDefault = getCachedDefault(dataFlow, role);
+    if (cachedDefault == nullptr) {
+        return nullptr;
+    }
+    if (!cachedDefault->device) {
+        std::cerr << "Failed to get default audio endpoint" << std::endl;
+        return nullptr;
+    }
+
+    if (!cachedDefault->endpointVolume) {
+        cachedDefault->endpointVolume = toAEV(cachedDefault->device.get());
+    }
+
+    return cachedDefault->endpointVolume.get();
+}
+
+// Empty when there is no default device
+std::wstring getDefaultDeviceId(EDataFlow dataFlow = eRender, ERole role = eMultimedia) {
+    std::wstring id;
+
+    IMMDevice *device = getDefaultDevice(dataFlow, role);
+    if (device != nullptr) {
+        getDeviceId(device, id);
+    }
+
+    return id;
+}
+
+// The cache keeps the ownership of the returned endpoint
+CachedEndpoint *getCachedEndpoint(LPWSTR id) {
+    HRESULT hr;
+
+    if (trackChanges) {
+        applyDeviceChanges();
+    }
+
+    auto cached = endpointCache.find(id);
+    if (cached != endpointCache.end()) {
+        return &cached->second;
+    }
+
+    IMMDeviceEnumerator *deviceEnumerator = getDeviceEnumerator();
+    if (deviceEnumerator == nullptr) {
+        return nullptr;
+    }
+
+    ComPtr<IMMDevice> device;
+    hr = deviceEnumerator->GetDevice(id, device.put());
+    if (FAILED(hr)) {
+        return nullptr;
+    }
+
+    ComPtr<IAudioEndpointVolume> audioEndpointVolume = toAEV(device.get());
+    if (!audioEndpointVolume) {
+        return nullptr;
+    }
+
+    return &(endpointCache[id] = {device, audioEndpointVolume});
+}
+
+// The friendly name of the device, empty when it has none
+std::wstring getDeviceName(IMMDevice *device) {
+    HRESULT hr;
+
+    ComPtr<IPropertyStore> propertyStore;
+    hr = device->OpenPropertyStore(STGM_READ, propertyStore.put());
+    if (FAILED(hr)) {
+        std::cerr << "Failed to open property store" << std::endl;
+        return L"";
+    }
+
+    PropVariant property;
+    hr = propertyStore->GetValue(PKEY_Device_FriendlyName, property.put());
+    if (FAILED(hr)) {
+        std::cerr << "Failed to get property value" << std::endl;
+        return L"";
+    }
+
+    return property.getString() != nullptr ? property.getString() : L"";
+}
+
+ProcessNameCache &getProcessNameCache() {
+    if (processNameCache == nullptr) {
+        WCHAR tempPath[MAX_PATH + 1];
+        DWORD tempPathSize = GetTempPathW(MAX_PATH + 1, tempPath);
+        std::string path = tempPathSize > 0 ? toString(tempPath) + "vsExecProcessNames.bin" : "";
+        processNameCache = new ProcessNameCache(path);
+    }
+
+    return *processNameCache;
+}
+
+// Product name from the version resource of the executable, the executable name when it has none
+std::wstring readProcessName(const std::wstring &processPath) {
+    std::wstring executableName = processPath.substr(processPath.find_last_of(L'\\') + 1);
+
+    DWORD versionHandle = 0;
+    DWORD versionSize = GetFileVersionInfoSizeW(processPath.c_str(), &versionHandle);
+    if (versionSize == 0) return executableName;
+
+    std::vector<BYTE> versionData(versionSize);
+    if (!GetFileVersionInfoW(processPath.c_str(), versionHandle, versionSize, versionData.data())) {
+        return executableName;
+    }
+
+    LPWSTR productName = nullptr;
+    UINT productNameSize = 0;
+    if (VerQueryValueW(versionData.data(), L"\\StringFileInfo\\040904b0\\ProductName", (LPVOID *) &productName,
+                       &productNameSize) && productNameSize > 0) {
+        // Points into the version data, copied before it is freed
+        return std::wstring(productName);
+    }
+
+    return executableName;
+}
+
+std::wstring getProcessName(DWORD processId) {
+    StatTimer timer(VsStat::ProcessName);
+    std::wstring name = L"Unknown";
+
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (hProcess) {
+        WCHAR processPath[MAX_PATH];
+        DWORD pathSize = sizeof(processPath) / sizeof(processPath[0]);
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+
+        if (QueryFullProcessImageNameW(hProcess, 0, processPath, &pathSize) &&
+            GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTime, &userTime)) {
+            std::wstring path(processPath, pathSize);
+            uint64_t creation = ((uint64_t) creationTime.dwHighDateTime << 32) | creationTime.dwLowDateTime;
+
+            // The version resources are only read once per process, their reading is most of the cost of the streams
+            AcquireSRWLockExclusive(&processNameLock);
+            bool cached = getProcessNameCache().find(processId, creation, path, name);
+            ReleaseSRWLockExclusive(&processNameLock);
+
+            if (!cached) {
+                name = readProcessName(path);
+                AcquireSRWLockExclusive(&processNameLock);
+                getProcessNameCache().insert(processId, creation, path, name);
+                ReleaseSRWLockExclusive(&processNameLock);
+            }
+        }
+
+        CloseHandle(hProcess);
+    }
+
+    return name;
+}
+
+// Mapper, the callbacks borrow the interfaces they are given
+void forEachDevice(const std::function<bool(IMMDevice *)> &callback, EDataFlow dataFlow = eRender) {
+    HRESULT hr;
+
+    IMMDeviceEnumerator *deviceEnumerator = getDeviceEnumerator();
+    if (deviceEnumerator == nullptr) {
+        return;
+    }
+
+    // Iterate through all devices
+    ComPtr<IMMDeviceCollection> deviceCollection;
+    UINT deviceCount;
+    {
+        // The callbacks are timed by their own phases
+        StatTimer timer(VsStat::Devices);
+        hr = deviceEnumerator->EnumAudioEndpoints(dataFlow, DEVICE_STATE_ACTIVE, deviceCollection.put());
+        if (FAILED(hr)) {
+            std::cerr << "Failed to enumerate audio endpoints" << std::endl;
+            return;
+        }
+
+        hr = deviceCollection->GetCount(&deviceCount);
+        if (FAILED(hr)) {
+            std::cerr << "Failed to get device count" << std::endl;
+            return;
+        }
+    }
+
+    for (UINT i = 0; i < deviceCount; i++) {
+        ComPtr<IMMDevice> device;
+        hr = deviceCollection->Item(i, device.put());
+        if (FAILED(hr)) {
+            std::cerr << "Failed to get device" << std::endl;
+            return;
+        }
+
+        if (!callback(device.get())) {
+            break;
+        }
+    }
+}
+
+bool forEachSessionOfDevice(IMMDevice *device,
+                            const std::function<bool(IAudioSessionControl2 *, IMMDevice *device)> &callback) {
+    HRESULT hr;
+
+    ComPtr<IAudioSessionManager2> sessionManager;
+    ComPtr<IAudioSessionEnumerator> sessionEnumerator;
+    int sessionCount;
+    {
+        StatTimer timer(VsStat::Sessions);
+        hr = device->Activate(__uuidof(IAudioSessionManager2), CLSCTX_INPROC_SERVER, nullptr,
+                              sessionManager.putVoid());
+        if (FAILED(hr)) {
+            std::cerr << "Failed to activate audio session manager" << std::endl;
+            return false;
+        }
+
+        hr = sessionManager->GetSessionEnumerator(sessionEnumerator.put());
+        if (FAILED(hr)) {
+            std::cerr << "Failed to get session enumerator" << std::endl;
+            return false;
+        }
+
+        hr = sessionEnumerator->GetCount(&sessionCount);
+        if (FAILED(hr)) {
+            std::cerr << "Failed to get session count" << std::endl;
+            return false;
+        }
+    }
+
+    for (int i = 0; i < sessionCount; i++) {
+        ComPtr<IAudioSessionControl> sessionControl;
+        hr = sessionEnumerator->GetSession(i, sessionControl.put());
+        if (FAILED(hr)) {
+            std::cerr << "Failed to get session" << std::endl;
+            return false;
+        }
+
+        ComPtr<IAudioSessionControl2> sessionControl2;
+        hr = sessionControl->QueryInterface(__uuidof(IAudioSessionControl2), sessionControl2.putVoid());
+        if (FAILED(hr)) {
+            std::cerr << "Failed to get session control" << std::endl;
+            return false;
+        }
+
+        if (!callback(sessionControl2.get(), device)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Complex getter functions
+// Session instance identifier, as exposed in the VsNode IDs
+bool getSessionId(IAudioSessionControl2 *sessionControl2, std::wstring &id) {
+    HRESULT hr;
+
+    CoTaskMemString pwszID;
+    hr = sessionControl2->GetSessionInstanceIdentifier(pwszID.put());
+    if (FAILED(hr)) {
+        std::cerr << "Failed to get session instance identifier" << std::endl;
+        return false;
+    }
+
+    id = pwszID.get();
+
+    return true;
+}
+
+// Session instance identifiers are the only IDs containing a '|', endpoint IDs never do
+bool isSessionId(LPWSTR id) {
+    return wcschr(id, L'|') != nullptr;
+}
+
+// Session index
+// Sessions changes reported by the notifications, applied to the index by the main thread on its next lookup
+SRWLOCK sessionChangesLock = SRWLOCK_INIT;
+std::vector<std::pair<ComPtr<IAudioSessionControl>, ComPtr<IMMDevice>>> createdSessions;
+std::vector<std::wstring> expiredSessions;
+
+class SessionEvents : public IAudioSessionEvents {
+public:
+    explicit SessionEvents(std::wstring id) : id(std::move(id)) {
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override {
+        return InterlockedIncrement(&refCount);
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override {
+        ULONG count = InterlockedDecrement(&refCount);
+        if (count == 0) {
+            delete this;
+        }
+        return count;
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvInterface) override {
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IAudioSessionEvents)) {
+            AddRef();
+            *ppvInterface = (IAudioSessionEvents *) this;
+            return S_OK;
+        }
+
+        *ppvInterface = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnStateChanged(AudioSessionState newState) override {
+        if (newState == AudioSessionStateExpired) {
+            expire();
+        }
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnSessionDisconnected(AudioSessionDisconnectReason disconnectReason) override {
+        expire();
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDisplayNameChanged(LPCWSTR newDisplayName, LPCGUID eventContext) override {
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnIconPathChanged(LPCWSTR newIconPath, LPCGUID eventContext) override {
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnSimpleVolumeChanged(float newVolume, BOOL newMute, LPCGUID eventContext) override {
+        pushWatchNotification({WatchNotificationType::VolumeChanged, id, (int) round(newVolume * 100), newMute != FALSE,
+                               eAll});
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnChannelVolumeChanged(DWORD channelCount, float newChannelVolumeArray[],
+                                                     DWORD changedChannel, LPCGUID eventContext) override {
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnGroupingParamChanged(LPCGUID newGroupingParam, LPCGUID eventContext) override {
+        return S_OK;
+    }
+
+private:
+    LONG refCount = 1;
+    std::wstring id;
+
+    void expire() {
+        AcquireSRWLockExclusive(&sessionChangesLock);
+        expiredSessions.push_back(id);
+        ReleaseSRWLockExclusive(&sessionChangesLock);
+
+        pushWatchNotification({WatchNotificationType::SessionsChanged, L"", 0, false, eAll});
+    }
+};
+
+class SessionNotification : public IAudioSessionNotification {
+public:
+    explicit SessionNotification(IMMDevice *device) : device(ComPtr<IMMDevice>::share(device)) {
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override {
+        return InterlockedIncrement(&refCount);
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override {
+        ULONG count = InterlockedDecrement(&refCount);
+        if (count == 0) {
+            delete this;
+        }
+        return count;
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvInterface) override {
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IAudioSessionNotification)) {
+            AddRef();
+            *ppvInterface = (IAudioSessionNotification *) this;
+            return S_OK;
+        }
+
+        *ppvInterface = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnSessionCreated(IAudioSessionControl *newSession) override {
+        AcquireSRWLockExclusive(&sessionChangesLock);
+        createdSessions.emplace_back(ComPtr<IAudioSessionControl>::share(newSession), device);
+        ReleaseSRWLockExclusive(&sessionChangesLock);
+
+        pushWatchNotification({WatchNotificationType::SessionsChanged, L"", 0, false, eAll});
+        return S_OK;
+    }
+
+private:
+    LONG refCount = 1;
+    ComPtr<IMMDevice> device;
+};
+
+struct IndexedSession {
+    ComPtr<IAudioSessionControl2> sessionControl;
+    ComPtr<IMMDevice> device;
+    // Only registered when changes are tracked
+    ComPtr<SessionEvents> events;
+};
+
+SessionIndex<IndexedSession> sessionIndex;
+std::vector<std::pair<ComPtr<IAudioSessionManager2>, ComPtr<SessionNotification>>> sessionNotifications;
+// The references are released with the index entry
+void releaseIndexedSession(IndexedSession &session) {
+    if (session.events) {
+        session.sessionControl->UnregisterAudioSessionNotification(session.events.get());
+    }
+}
+
+void indexSession(IAudioSessionControl2 *sessionControl2, IMMDevice *device) {
+    std::wstring id;
+    if (!getSessionId(sessionControl2, id)) {
+        return;
+    }
+
+    IndexedSession session = {ComPtr<IAudioSessionControl2>::share(sessionControl2), ComPtr<IMMDevice>::share(device),
+                              ComPtr<SessionEvents>()};
+    if (trackChanges) {
+        session.events = ComPtr<SessionEvents>(new SessionEvents(id));
+        if (FAILED(sessionControl2->RegisterAudioSessionNotification(session.events.get()))) {
+            session.events.reset();
+        }
+    }
+
+    sessionIndex.insert(id, session, releaseIndexedSession);
+}
+
+void clearSessionIndex() {
+    sessionIndex.clear(releaseIndexedSession);
+
+    for (auto &notification: sessionNotifications) {
+        notification.first->UnregisterSessionNotification(notification.second.get());
+    }
+    sessionNotifications.clear();
+
+    AcquireSRWLockExclusive(&sessionChangesLock);
+    createdSessions.clear();
+    expiredSessions.clear();
+    ReleaseSRWLockExclusive(&sessionChangesLock);
+}
+
+void buildSessionIndex() {
+    clearSessionIndex();
+
+    auto fn = [](IMMDevice *device) -> bool {
+        if (trackChanges) {
+            // Registered before enumerating the sessions, so no session created in between is missed
+            ComPtr<IAudioSessionManager2> sessionManager;
+            HRESULT hr = device->Activate(__uuidof(IAudioSessionManager2), CLSCTX_INPROC_SERVER, nullptr,
+                                          sessionManager.putVoid());
+            if (SUCCEEDED(hr)) {
+                ComPtr<SessionNotification> notification(new SessionNotification(device));
+                if (SUCCEEDED(sessionManager->RegisterSessionNotification(notification.get()))) {
+                    sessionNotifications.emplace_back(sessionManager, notification);
+                }
+            }
+        }
+
+        auto sessionFn = [](IAudioSessionControl2 *sessionControl2, IMMDevice *device) -> bool {
+            indexSession(sessionControl2, device);
+            return true;
+        };
+
+        return forEachSessionOfDevice(device, sessionFn);
+    };
+
+    forEachDevice(fn, eRender);
+    sessionIndex.markBuilt();
+}
+
+void applySessionChanges() {
+    std::vector<std::pair<ComPtr<IAudioSessionControl>, ComPtr<IMMDevice>>> created;
+    std::vector<std::wstring> expired;
+    AcquireSRWLockExclusive(&sessionChangesLock);
+    created.swap(createdSessions);
+    expired.swap(expiredSessions);
+    ReleaseSRWLockExclusive(&sessionChangesLock);
+
+    for (const std::wstring &id: expired) {
+        sessionIndex.erase(id, releaseIndexedSession);
+    }
+
+    for (auto &session: created) {
+        ComPtr<IAudioSessionControl2> sessionControl2;
+        HRESULT hr = session.first->QueryInterface(__uuidof(IAudioSessionControl2), sessionControl2.putVoid());
+        if (SUCCEEDED(hr)) {
+            indexSession(sessionControl2.get(), session.second.get());
+        }
+    }
+}
+
+void enableChangeTracking() {
+    trackChanges = true;
+    clearSessionIndex();
+    clearDeviceCache();
+    registerDeviceNotification();
+}
+
+ComPtr<IAudioSessionControl2> getSessionById(LPWSTR id) {
+    // Sessions of new or re-enabled devices are only found by a new enumeration
+    if (trackChanges && takeDevicesAdded()) {
+        clearSessionIndex();
+    }
+
+    bool rebuilt = false;
+    if (!sessionIndex.isBuilt()) {
+        buildSessionIndex();
+        rebuilt = true;
+    } else if (trackChanges) {
+        applySessionChanges();
+    }
+
+    IndexedSession *session = sessionIndex.find(id);
+    if (session == nullptr && !rebuilt) {
+        // Sessions notifications may have been missed, look for them once more
+        buildSessionIndex();
+        session = sessionIndex.find(id);
+    }
+    if (session == nullptr) {
+        return ComPtr<IAudioSessionControl2>();
+    }
+
+    return session->sessionControl;
+}
+
+// AudioEndpointVolume functions
+int getVolume(IAudioEndpointVolume *audioEndpointVolume) {
+    if (audioEndpointVolume == nullptr) return 0;
+    HRESULT hr;
+
+    // Get the current volume
+    float volume;
+    hr = audioEndpointVolume->GetMasterVolumeLevelScalar(&volume);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to get master volume level" << std::endl;
+        return 0;
+    }
+
+    return (int) round(volume * 100);
+}
+
+void setVolume(IAudioEndpointVolume *audioEndpointVolume, int volume) {
+    if (audioEndpointVolume == nullptr) return;
+    HRESULT hr;
+
+    // Set the volume
+    hr = audioEndpointVolume->SetMasterVolumeLevelScalar((float) volume / 100, nullptr);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to set master volume level" << std::endl;
+        return;
+    }
+}
+
+bool isMuted(IAudioEndpointVolume *audioEndpointVolume) {
+    if (audioEndpointVolume == nullptr) return false;
+    HRESULT hr;
+
+    // Get the current mute state
+    BOOL mute;
+    hr = audioEndpointVolume->GetMute(&mute);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to get mute state" << std::endl;
+        return false;
+    }
+
+    return mute;
+}
+
+void setMuted(IAudioEndpointVolume *audioEndpointVolume, bool mute) {
+    if (audioEndpointVolume == nullptr) return;
+    HRESULT hr;
+
+    // Set the mute state
+    hr = audioEndpointVolume->SetMute(mute, nullptr);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to set mute state" << std::endl;
+        return;
+    }
+}
+
+ComPtr<IAudioEndpointVolume> getAEVById(LPWSTR id) {
+    if (isSessionId(id)) {
+        return ComPtr<IAudioEndpointVolume>();
+    }
+
+    CachedEndpoint *endpoint = getCachedEndpoint(id);
+    if (endpoint == nullptr) {
+        return ComPtr<IAudioEndpointVolume>();
+    }
+
+    return endpoint->endpointVolume;
+}
+
+// SimpleAudioVolume functions
+int getVolume(ISimpleAudioVolume *simpleAudioVolume) {
+    if (simpleAudioVolume == nullptr) return 0;
+    HRESULT hr;
+
+    // Get the current volume
+    float volume;
+    hr = simpleAudioVolume->GetMasterVolume(&volume);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to get master volume level" << std::endl;
+        return 0;
+    }
+
+    return (int) round(volume * 100);
+}
+
+void setVolume(ISimpleAudioVolume *simpleAudioVolume, int volume) {
+    if (simpleAudioVolume == nullptr) return;
+    HRESULT hr;
+
+    // Set the volume
+    hr = simpleAudioVolume->SetMasterVolume((float) volume / 100, nullptr);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to set master volume level" << std::endl;
+        return;
+    }
+}
+
+bool isMuted(ISimpleAudioVolume *simpleAudioVolume) {
+    if (simpleAudioVolume == nullptr) return false;
+    HRESULT hr;
+
+    // Get the current mute state
+    BOOL mute;
+    hr = simpleAudioVolume->GetMute(&mute);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to get mute state" << std::endl;
+        return false;
+    }
+
+    return mute;
+}
+
+void setMuted(ISimpleAudioVolume *simpleAudioVolume, bool mute) {
+    if (simpleAudioVolume == nullptr) return;
+    HRESULT hr;
+
+    // Set the mute state
+    hr = simpleAudioVolume->SetMute(mute, nullptr);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to set mute state" << std::endl;
+        return;
+    }
+}
+
+ComPtr<ISimpleAudioVolume> getSAVById(LPWSTR id) {
+    ComPtr<IAudioSessionControl2> sessionControl2 = getSessionById(id);
+    if (!sessionControl2) {
+        return ComPtr<ISimpleAudioVolume>();
+    }
+
+    return toSAV(sessionControl2.get());
+}
+
+// Default device functions
+int getGlobalVolume() {
+    return getVolume(getDefaultAEV());
+}
+
+void setGlobalVolume(int volume) {
+    setVolume(getDefaultAEV(), volume);
+}
+
+bool isGlobalMuted() {
+    return isMuted(getDefaultAEV());
+}
+
+void setGlobalMuted(bool mute) {
+    setMuted(getDefaultAEV(), mute);
+}
+
+// Get VsNode functions
+bool deviceToVsNode(IMMDevice *device, const std::wstring &defaultDeviceId, std::vector<VsNode> *nodes,
+                    StringArena &strings) {
+    std::wstring id;
+    if (!getDeviceId(device, id)) {
+        return false;
+    }
+
+    ComPtr<IAudioEndpointVolume> audioEndpointVolume = toAEV(device);
+
+    VsNode node;
+    node.id = strings.copy(id);
+    node.name = strings.copy(getDeviceName(device));
+    node.volume = getVolume(audioEndpointVolume.get());
+    node.muted = isMuted(audioEndpointVolume.get());
+    node.isDefault = id == defaultDeviceId;
+    node.destinationId = nullptr;
+    nodes->push_back(node);
+
+    return true;
+}
+
+bool sessionToVsNode(IAudioSessionControl2 *sessionControl2, LPWSTR deviceId, std::vector<VsNode> *nodes,
+                     StringArena &strings) {
+    HRESULT hr;
+
+    std::wstring id;
+    if (!getSessionId(sessionControl2, id)) {
+        return false;
+    }
+
+    hr = sessionControl2->IsSystemSoundsSession();
+    if (hr == S_OK) {
+        return true;
+    }
+
+    DWORD processId;
+    hr = sessionControl2->GetProcessId(&processId);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to get process ID" << std::endl;
+        return false;
+    }
+
+    ComPtr<ISimpleAudioVolume> simpleAudioVolume = toSAV(sessionControl2);
+
+    VsNode node;
+    node.id = strings.copy(id);
+    node.name = strings.copy(getProcessName(processId));
+    node.volume = getVolume(simpleAudioVolume.get());
+    node.muted = isMuted(simpleAudioVolume.get());
+    node.isDefault = false;
+    node.destinationId = deviceId;
+    nodes->push_back(node);
+
+    return true;
+}
+
+// The device ID must be a string of the arena, it is shared by the streams as their destination ID
+bool getStreamsOfDevice(IMMDevice *device, LPWSTR deviceId, std::vector<VsNode> *nodes, StringArena &strings) {
+    auto fn = [nodes, deviceId, &strings](IAudioSessionControl2 *sessionControl2, IMMDevice *device) -> bool {
+        return sessionToVsNode(sessionControl2, deviceId, nodes, strings);
+    };
+
+    return forEachSessionOfDevice(device, fn);
+}
+
+// Devices of a flow in the order of the enumeration, walked afterward by the enumeration pool
+std::vector<ComPtr<IMMDevice>> getDevices(EDataFlow dataFlow) {
+    std::vector<ComPtr<IMMDevice>> devices;
+    auto fn = [&devices](IMMDevice *device) -> bool {
+        devices.push_back(ComPtr<IMMDevice>::share(device));
+        return true;
+    };
+
+    forEachDevice(fn, dataFlow);
+    return devices;
+}
+
+// Task of one device, run by a worker of the enumeration pool: the devices are free threaded, and everything touched
+// here is either the device's own interfaces or guarded, like the process name cache
+void readDeviceNodes(IMMDevice *device, const std::wstring *defaultDeviceId, bool withStreams, DeviceNodes &result) {
+    LPWSTR deviceId;
+    if (defaultDeviceId != nullptr) {
+        if (!deviceToVsNode(device, *defaultDeviceId, &result.devices, result.strings)) {
+            return;
+        }
+        deviceId = result.devices.back().id;
+    } else {
+        std::wstring id;
+        if (!getDeviceId(device, id)) {
+            return;
+        }
+        deviceId = result.strings.copy(id);
+    }
+
+    result.deviceRead = true;
+    result.streamsRead = withStreams && getStreamsOfDevice(device, deviceId, &result.streams, result.strings);
+}
+
+// Read the devices on the enumeration pool, the default device ID is null when only the streams are wanted
+std::vector<DeviceNodes> readAllDeviceNodes(const std::vector<ComPtr<IMMDevice>> &devices,
+                                            const std::wstring *defaultDeviceId, bool withStreams) {
+    std::vector<DeviceNodes> deviceNodes(devices.size());
+    getEnumerationPool().run(devices.size(), [&devices, defaultDeviceId, withStreams, &deviceNodes](size_t i) {
+        readDeviceNodes(devices[i].get(), defaultDeviceId, withStreams, deviceNodes[i]);
+    });
+    return deviceNodes;
+}
+
+void getVsNodeOfType(std::vector<VsNode> *nodes, StringArena &strings, EDataFlow dataFlow) {
+    std::wstring defaultDeviceId = getDefaultDeviceId(dataFlow);
+
+    std::vector<DeviceNodes> deviceNodes = readAllDeviceNodes(getDevices(dataFlow), &defaultDeviceId, false);
+    mergeDeviceNodes(deviceNodes, nodes, nullptr, strings);
+}
+
+void getStreams(std::vector<VsNode> *nodes, StringArena &strings) {
+    std::vector<DeviceNodes> deviceNodes = readAllDeviceNodes(getDevices(eRender), nullptr, true);
+    mergeDeviceNodes(deviceNodes, nullptr, nodes, strings);
+}
+
+void getStatus(VsStatus *status) {
+    std::wstring defaultSink = getDefaultDeviceId(eRender);
+    std::wstring defaultSource = getDefaultDeviceId(eCapture);
+    status->defaultSink = defaultSink.empty() ? nullptr : status->strings.copy(defaultSink);
+    status->defaultSource = defaultSource.empty() ? nullptr : status->strings.copy(defaultSource);
+
+    // Sinks with their streams and sources in a single run, so a slow device doesn't hold the others
+    std::vector<ComPtr<IMMDevice>> renderDevices = getDevices(eRender);
+    std::vector<ComPtr<IMMDevice>> captureDevices = getDevices(eCapture);
+    std::vector<DeviceNodes> sinkNodes(renderDevices.size());
+    std::vector<DeviceNodes> sourceNodes(captureDevices.size());
+
+    auto fn = [&](size_t i) {
+        if (i < renderDevices.size()) {
+            readDeviceNodes(renderDevices[i].get(), &defaultSink, true, sinkNodes[i]);
+        } else {
+            i -= renderDevices.size();
+            readDeviceNodes(captureDevices[i].get(), &defaultSource, false, sourceNodes[i]);
+        }
+    };
+    getEnumerationPool().run(renderDevices.size() + captureDevices.size(), fn);
+
+    mergeDeviceNodes(sinkNodes, &status->sinks, &status->streams, status->strings);
+    mergeDeviceNodes(sourceNodes, &status->sources, nullptr, status->strings);
+}
+
+int getVolumeById(LPWSTR id) {
+    ComPtr<IAudioEndpointVolume> audioEndpointVolume = getAEVById(id);
+    if (audioEndpointVolume) {
+        return getVolume(audioEndpointVolume.get());
+    }
+
+    ComPtr<ISimpleAudioVolume> simpleAudioVolume = getSAVById(id);
+    if (simpleAudioVolume) {
+        return getVolume(simpleAudioVolume.get());
+    }
+
+    std::cerr << "Failed to get volume by ID" << std::endl;
+    return 0;
+}
+
+void setVolumeById(LPWSTR id, int volume) {
+    ComPtr<IAudioEndpointVolume> audioEndpointVolume = getAEVById(id);
+    if (audioEndpointVolume) {
+        setVolume(audioEndpointVolume.get(), volume);
+        return;
+    }
+
+    ComPtr<ISimpleAudioVolume> simpleAudioVolume = getSAVById(id);
+    if (simpleAudioVolume) {
+        setVolume(simpleAudioVolume.get(), volume);
+        return;
+    }
+
+    std::cerr << "Failed to set volume by ID" << std::endl;
+}
+
+bool isMutedById(LPWSTR id) {
+    ComPtr<IAudioEndpointVolume> audioEndpointVolume = getAEVById(id);
+    if (audioEndpointVolume) {
+        return isMuted(audioEndpointVolume.get());
+    }
+
+    ComPtr<ISimpleAudioVolume> simpleAudioVolume = getSAVById(id);
+    if (simpleAudioVolume) {
+        return isMuted(simpleAudioVolume.get());
+    }
+
+    std::cerr << "Failed to get mute state by ID" << std::endl;
+    return false;
+}
+
+void setMutedById(LPWSTR id, bool mute) {
+    ComPtr<IAudioEndpointVolume> audioEndpointVolume = getAEVById(id);
+    if (audioEndpointVolume) {
+        setMuted(audioEndpointVolume.get(), mute);
+        return;
+    }
+
+    ComPtr<ISimpleAudioVolume> simpleAudioVolume = getSAVById(id);
+    if (simpleAudioVolume) {
+        setMuted(simpleAudioVolume.get(), mute);
+        return;
+    }
+
+    std::cerr << "Failed to set mute state by ID" << std::endl;
+}
+
+void setStreamDestination(LPWSTR id, LPWSTR destinationId) {
+    // Windows routes sessions per application through the settings, there is no API to move them
+    std::cerr << "Setting the stream destination is not supported on Windows" << std::endl;
+}
+
+// Batch functions, failures are reported per operation instead of on std::cerr
+void applyOperation(IAudioEndpointVolume *audioEndpointVolume, VsBatchOperation &operation) {
+    HRESULT hr;
+
+    switch (operation.type) {
+        case VsBatchOperationType::GetVolumeInfo: {
+            float volume;
+            BOOL mute;
+            hr = audioEndpointVolume->GetMasterVolumeLevelScalar(&volume);
+            if (SUCCEEDED(hr)) {
+                hr = audioEndpointVolume->GetMute(&mute);
+            }
+            if (FAILED(hr)) {
+                operation.error = "Failed to get volume info";
+                return;
+            }
+
+            operation.volume = (int) round(volume * 100);
+            operation.muted = mute;
+            break;
+        }
+        case VsBatchOperationType::SetVolume:
+            hr = audioEndpointVolume->SetMasterVolumeLevelScalar((float) operation.volume / 100, nullptr);
+            if (FAILED(hr)) {
+                operation.error = "Failed to set master volume level";
+            }
+            break;
+        case VsBatchOperationType::SetMuted:
+            hr = audioEndpointVolume->SetMute(operation.muted, nullptr);
+            if (FAILED(hr)) {
+                operation.error = "Failed to set mute state";
+            }
+            break;
+    }
+}
+
+void applyOperation(ISimpleAudioVolume *simpleAudioVolume, VsBatchOperation &operation) {
+    HRESULT hr;
+
+    switch (operation.type) {
+        case VsBatchOperationType::GetVolumeInfo: {
+            float volume;
+            BOOL mute;
+            hr = simpleAudioVolume->GetMasterVolume(&volume);
+            if (SUCCEEDED(hr)) {
+                hr = simpleAudioVolume->GetMute(&mute);
+            }
+            if (FAILED(hr)) {
+                operation.error = "Failed to get volume info";
+                return;
+            }
+
+            operation.volume = (int) round(volume * 100);
+            operation.muted = mute;
+            break;
+        }
+        case VsBatchOperationType::SetVolume:
+            hr = simpleAudioVolume->SetMasterVolume((float) operation.volume / 100, nullptr);
+            if (FAILED(hr)) {
+                operation.error = "Failed to set master volume level";
+            }
+            break;
+        case VsBatchOperationType::SetMuted:
+            hr = simpleAudioVolume->SetMute(operation.muted, nullptr);
+            if (FAILED(hr)) {
+                operation.error = "Failed to set mute state";
+            }
+            break;
+    }
+}
+
+void applyBatch(std::vector<VsBatchOperation> &operations) {
+    std::unordered_map<std::wstring, ComPtr<IAudioEndpointVolume>> endpoints;
+    std::unordered_map<std::wstring, ComPtr<ISimpleAudioVolume>> sessions;
+
+    // Endpoints are found directly by the enumerator, sessions by the session index built at most once
+    for (VsBatchOperation &operation: operations) {
+        if (operation.error != nullptr) continue;
+
+        std::wstring id(operation.id);
+        if (endpoints.count(id) > 0 || sessions.count(id) > 0) continue;
+
+        ComPtr<IAudioEndpointVolume> audioEndpointVolume = getAEVById(operation.id);
+        if (audioEndpointVolume) {
+            endpoints[id] = audioEndpointVolume;
+        } else {
+            sessions[id] = getSAVById(operation.id);
+        }
+    }
+
+    for (VsBatchOperation &operation: operations) {
+        if (operation.error != nullptr) continue;
+
+        std::wstring id(operation.id);
+        auto endpoint = endpoints.find(id);
+        if (endpoint != endpoints.end()) {
+            applyOperation(endpoint->second.get(), operation);
+            continue;
+        }
+
+        auto session = sessions.find(id);
+        if (session != sessions.end() && session->second) {
+            applyOperation(session->second.get(), operation);
+            continue;
+        }
+
+        operation.error = "Node not found";
+    }
+}
+
+// Volume control functions, the volume interfaces are free threaded and set from the ramp thread
+struct VsVolumeControl {
+    ComPtr<IAudioEndpointVolume> endpointVolume;
+    ComPtr<ISimpleAudioVolume> simpleAudioVolume;
+};
+
+VsVolumeControl *openVolumeControl(LPWSTR id) {
+    ComPtr<IAudioEndpointVolume> audioEndpointVolume = getAEVById(id);
+    if (audioEndpointVolume) {
+        return new VsVolumeControl{audioEndpointVolume, ComPtr<ISimpleAudioVolume>()};
+    }
+
+    ComPtr<ISimpleAudioVolume> simpleAudioVolume = getSAVById(id);
+    if (simpleAudioVolume) {
+        return new VsVolumeControl{ComPtr<IAudioEndpointVolume>(), simpleAudioVolume};
+    }
+
+    return nullptr;
+}
+
+void closeVolumeControl(VsVolumeControl *control) {
+    delete control;
+}
+
+bool getControlLevel(VsVolumeControl *control, float &level) {
+    if (control->endpointVolume) {
+        return SUCCEEDED(control->endpointVolume->GetMasterVolumeLevelScalar(&level));
+    }
+
+    return SUCCEEDED(control->simpleAudioVolume->GetMasterVolume(&level));
+}
+
+bool setControlLevel(VsVolumeControl *control, float level) {
+    if (control->endpointVolume) {
+        return SUCCEEDED(control->endpointVolume->SetMasterVolumeLevelScalar(level, nullptr));
+    }
+
+    return SUCCEEDED(control->simpleAudioVolume->SetMasterVolume(level, nullptr));
+}
+
+// Level functions, the peak meters are free threaded like the volume interfaces
+// WASAPI meters peaks only, the rms of the levels is left negative
+struct LevelMeter {
+    const char *nodeType;
+    ComPtr<IAudioMeterInformation> audioMeter;
+    // Cleared before each refresh, the meters of the nodes left unseen are released
+    bool seen;
+};
+
+std::unordered_map<std::wstring, LevelMeter> levelMeters;
+
+// Keep the meter of a node seen again, or open it with the given function
+void refreshLevelMeter(const std::wstring &id, const char *nodeType,
+                       const std::function<HRESULT(IAudioMeterInformation **)> &open) {
+    auto levelMeter = levelMeters.find(id);
+    if (levelMeter != levelMeters.end()) {
+        levelMeter->second.seen = true;
+        return;
+    }
+
+    ComPtr<IAudioMeterInformation> audioMeter;
+    if (FAILED(open(audioMeter.put()))) {
+        std::cerr << "Failed to get audio meter" << std::endl;
+        return;
+    }
+
+    levelMeters.emplace(id, LevelMeter{nodeType, audioMeter, true});
+}
+
+bool openLevelMeters() {
+    if (getDeviceEnumerator() == nullptr) {
+        return false;
+    }
+
+    for (auto &levelMeter: levelMeters) {
+        levelMeter.second.seen = false;
+    }
+
+    for (EDataFlow dataFlow: {eRender, eCapture}) {
+        forEachDevice([dataFlow](IMMDevice *device) -> bool {
+            std::wstring id;
+            if (!getDeviceId(device, id)) {
+                return true;
+            }
+
+            refreshLevelMeter(id, dataFlow == eRender ? "sink" : "source", [device](IAudioMeterInformation **meter) {
+                return device->Activate(__uuidof(IAudioMeterInformation), CLSCTX_INPROC_SERVER, nullptr,
+                                        (void **) meter);
+            });
+
+            // The streams are the render sessions, as listed by getStreams
+            if (dataFlow == eRender) {
+                forEachSessionOfDevice(device, [](IAudioSessionControl2 *sessionControl2, IMMDevice *) -> bool {
+                    std::wstring sessionId;
+                    if (sessionControl2->IsSystemSoundsSession() == S_OK || !getSessionId(sessionControl2, sessionId)) {
+                        return true;
+                    }
+
+                    refreshLevelMeter(sessionId, "stream", [sessionControl2](IAudioMeterInformation **meter) {
+                        return sessionControl2->QueryInterface(__uuidof(IAudioMeterInformation), (void **) meter);
+                    });
+                    return true;
+                });
+            }
+
+            return true;
+        }, dataFlow);
+    }
+
+    for (auto levelMeter = levelMeters.begin(); levelMeter != levelMeters.end();) {
+        levelMeter = levelMeter->second.seen ? std::next(levelMeter) : levelMeters.erase(levelMeter);
+    }
+
+    return true;
+}
+
+void readLevels(std::vector<VsLevel> *levels, StringArena &strings) {
+    for (auto &levelMeter: levelMeters) {
+        // The peak of the last period of the audio engine, a node gone meanwhile fails until the next refresh
+        float peak;
+        if (FAILED(levelMeter.second.audioMeter->GetPeakValue(&peak))) {
+            continue;
+        }
+
+        levels->push_back({levelMeter.second.nodeType, strings.copy(levelMeter.first), peak, -1});
+    }
+}
+
+void closeLevelMeters() {
+    levelMeters.clear();
+}
+
+// Watch functions
+class EndpointVolumeCallback : public IAudioEndpointVolumeCallback {
+public:
+    explicit EndpointVolumeCallback(std::wstring id) : id(std::move(id)) {
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override {
+        return InterlockedIncrement(&refCount);
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override {
+        ULONG count = InterlockedDecrement(&refCount);
+        if (count == 0) {
+            delete this;
+        }
+        return count;
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvInterface) override {
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IAudioEndpointVolumeCallback)) {
+            AddRef();
+            *ppvInterface = (IAudioEndpointVolumeCallback *) this;
+            return S_OK;
+        }
+
+        *ppvInterface = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnNotify(PAUDIO_VOLUME_NOTIFICATION_DATA pNotify) override {
+        if (pNotify == nullptr) return E_INVALIDARG;
+
+        pushWatchNotification({WatchNotificationType::VolumeChanged, id, (int) round(pNotify->fMasterVolume * 100),
+                               pNotify->bMuted != FALSE, eAll});
+        return S_OK;
+    }
+
+private:
+    LONG refCount = 1;
+    std::wstring id;
+};
+
+struct WatchedNode {
+    const char *type;
+    std::wstring name;
+    int volume;
+    bool muted;
+    bool isDefault;
+    std::wstring destinationId;
+    // Endpoints only, sessions report their changes through the events registered by the session index
+    ComPtr<IAudioEndpointVolume> endpointVolume;
+    ComPtr<EndpointVolumeCallback> callback;
+};
+
+std::unordered_map<std::wstring, WatchedNode> watchedNodes;
+
+// Event nodes own their strings, freed by clearVsEvents
+LPWSTR copyString(const std::wstring &str) {
+    return copyVsString(nullptr, str);
+}
+
+VsEvent toVsEvent(VsEventType type, const std::wstring &id, const WatchedNode &watchedNode) {
+    VsEvent event;
+    event.type = type;
+    event.nodeType = watchedNode.type;
+    event.node.id = copyString(id);
+    event.node.name = copyString(watchedNode.name);
+    event.node.volume = watchedNode.volume;
+    event.node.muted = watchedNode.muted;
+    event.node.isDefault = watchedNode.isDefault;
+    event.node.destinationId = watchedNode.destinationId.empty() ? nullptr : copyString(watchedNode.destinationId);
+
+    return event;
+}
+
+// The references are released with the watched node
+void unwatchNode(WatchedNode &watchedNode) {
+    if (watchedNode.callback) {
+        watchedNode.endpointVolume->UnregisterControlChangeNotify(watchedNode.callback.get());
+    }
+}
+
+void watchEndpoint(IMMDevice *device, EDataFlow dataFlow, std::vector<VsEvent> *events) {
+    HRESULT hr;
+
+    std::wstring id;
+    if (!getDeviceId(device, id) || watchedNodes.count(id) > 0) {
+        return;
+    }
+
+    ComPtr<IAudioEndpointVolume> audioEndpointVolume = getAEVById(&id[0]);
+    if (!audioEndpointVolume) {
+        return;
+    }
+
+    WatchedNode watchedNode;
+    watchedNode.type = dataFlow == eCapture ? "source" : "sink";
+    watchedNode.name = getDeviceName(device);
+    watchedNode.volume = getVolume(audioEndpointVolume.get());
+    watchedNode.muted = isMuted(audioEndpointVolume.get());
+    watchedNode.isDefault = id == getDefaultDeviceId(dataFlow);
+
+    watchedNode.endpointVolume = audioEndpointVolume;
+    watchedNode.callback = ComPtr<EndpointVolumeCallback>(new EndpointVolumeCallback(id));
+    hr = audioEndpointVolume->RegisterControlChangeNotify(watchedNode.callback.get());
+    if (FAILED(hr)) {
+        std::cerr << "Failed to register endpoint volume callback" << std::endl;
+        watchedNode.callback.reset();
+    }
+
+    watchedNodes[id] = watchedNode;
+    if (events != nullptr) {
+        events->push_back(toVsEvent(VsEventType::Added, id, watchedNode));
+    }
+}
+
+void watchSession(const std::wstring &id, IndexedSession &session, std::vector<VsEvent> *events) {
+    HRESULT hr;
+
+    IAudioSessionControl2 *sessionControl2 = session.sessionControl.get();
+    if (sessionControl2->IsSystemSoundsSession() == S_OK) {
+        return;
+    }
+
+    DWORD processId;
+    hr = sessionControl2->GetProcessId(&processId);
+    if (FAILED(hr)) {
+        std::cerr << "Failed to get process ID" << std::endl;
+        return;
+    }
+
+    std::wstring deviceId;
+    if (!getDeviceId(session.device.get(), deviceId)) {
+        return;
+    }
+
+    ComPtr<ISimpleAudioVolume> simpleAudioVolume = toSAV(sessionControl2);
+
+    WatchedNode watchedNode;
+    watchedNode.type = "stream";
+    watchedNode.name = getProcessName(processId);
+    watchedNode.volume = getVolume(simpleAudioVolume.get());
+    watchedNode.muted = isMuted(simpleAudioVolume.get());
+    watchedNode.isDefault = false;
+    watchedNode.destinationId = deviceId;
+
+    watchedNodes[id] = watchedNode;
+    if (events != nullptr) {
+        events->push_back(toVsEvent(VsEventType::Added, id, watchedNode));
+    }
+}
+
+// Bring the watched streams in line with the session index
+void syncWatchedSessions(std::vector<VsEvent> *events) {
+    if (takeDevicesAdded() || !sessionIndex.isBuilt()) {
+        buildSessionIndex();
+    } else {
+        applySessionChanges();
+    }
+
+    for (auto watched = watchedNodes.begin(); watched != watchedNodes.end();) {
+        if (strcmp(watched->second.type, "stream") != 0 || sessionIndex.find(watched->first) != nullptr) {
+            watched++;
+            continue;
+        }
+
+        if (events != nullptr) {
+            events->push_back(toVsEvent(VsEventType::Removed, watched->first, watched->second));
+        }
+        unwatchNode(watched->second);
+        watched = watchedNodes.erase(watched);
+    }
+
+    sessionIndex.forEach([events](const std::wstring &id, IndexedSession &session) {
+        if (watchedNodes.count(id) == 0) {
+            watchSession(id, session, events);
+        }
+    });
+}
+
+void watchDeviceChange(const std::wstring &id, std::vector<VsEvent> &events) {
+    HRESULT hr;
+
+    IMMDeviceEnumerator *deviceEnumerator = getDeviceEnumerator();
+    if (deviceEnumerator == nullptr) {
+        return;
+    }
+
+    ComPtr<IMMDevice> device;
+    DWORD state = 0;
+    hr = deviceEnumerator->GetDevice(id.c_str(), device.put());
+    if (SUCCEEDED(hr) && FAILED(device->GetState(&state))) {
+        state = 0;
+    }
+
+    auto watched = watchedNodes.find(id);
+    if (state == DEVICE_STATE_ACTIVE && watched == watchedNodes.end()) {
+        ComPtr<IMMEndpoint> endpoint;
+        hr = device->QueryInterface(__uuidof(IMMEndpoint), endpoint.putVoid());
+        if (SUCCEEDED(hr)) {
+            EDataFlow dataFlow;
+            if (SUCCEEDED(endpoint->GetDataFlow(&dataFlow))) {
+                watchEndpoint(device.get(), dataFlow, &events);
+            }
+        }
+    } else if (state != DEVICE_STATE_ACTIVE && watched != watchedNodes.end()) {
+        events.push_back(toVsEvent(VsEventType::Removed, watched->first, watched->second));
+        unwatchNode(watched->second);
+        watchedNodes.erase(watched);
+    }
+}
+
+void watchDefaultChange(const std::wstring &id, EDataFlow dataFlow, std::vector<VsEvent> &events) {
+    const char *type = dataFlow == eCapture ? "source" : "sink";
+    for (auto &watched: watchedNodes) {
+        if (strcmp(watched.second.type, type) == 0) {
+            watched.second.isDefault = watched.first == id;
+        }
+    }
+
+    VsEvent event;
+    event.type = VsEventType::DefaultChanged;
+    event.nodeType = type;
+    event.node = {id.empty() ? nullptr : copyString(id), nullptr, 0, false, false, nullptr};
+    events.push_back(event);
+}
+
+void watchVolumeChange(const WatchNotification &notification, std::vector<VsEvent> &events) {
+    auto watched = watchedNodes.find(notification.id);
+    if (watched == watchedNodes.end()) {
+        return;
+    }
+
+    // Channel volume changes are also notified, only the master volume and the mute are reported
+    WatchedNode &watchedNode = watched->second;
+    if (watchedNode.volume == notification.volume && watchedNode.muted == notification.muted) {
+        return;
+    }
+
+    watchedNode.volume = notification.volume;
+    watchedNode.muted = notification.muted;
+    events.push_back(toVsEvent(VsEventType::Changed, watched->first, watchedNode));
+}
+
+bool startWatch() {
+    // Created before registering anything, so no notification is missed
+    AcquireSRWLockExclusive(&watchLock);
+    watchSignal = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    ReleaseSRWLockExclusive(&watchLock);
+    if (watchSignal == nullptr) {
+        std::cerr << "Failed to create watch event" << std::endl;
+        return false;
+    }
+
+    enableChangeTracking();
+
+    for (EDataFlow dataFlow: {eRender, eCapture}) {
+        auto fn = [dataFlow](IMMDevice *device) -> bool {
+            watchEndpoint(device, dataFlow, nullptr);
+            return true;
+        };
+        forEachDevice(fn, dataFlow);
+    }
+    syncWatchedSessions(nullptr);
+
+    return true;
+}
+
+bool waitForEvents(std::vector<VsEvent> &events, int timeoutMs) {
+    DWORD result = WaitForSingleObject(watchSignal, timeoutMs);
+    if (result == WAIT_FAILED) {
+        std::cerr << "Failed to wait for watch notifications" << std::endl;
+        return false;
+    }
+
+    std::vector<WatchNotification> notifications;
+    AcquireSRWLockExclusive(&watchLock);
+    notifications.swap(watchNotifications);
+    ReleaseSRWLockExclusive(&watchLock);
+
+    bool sessionsChanged = false;
+    for (const WatchNotification &notification: notifications) {
+        switch (notification.type) {
+            case WatchNotificationType::VolumeChanged:
+                watchVolumeChange(notification, events);
+                break;
+            case WatchNotificationType::DeviceChanged:
+                watchDeviceChange(notification.id, events);
+                // The sessions of the device come and go with it
+                sessionsChanged = true;
+                break;
+            case WatchNotificationType::DefaultChanged:
+                watchDefaultChange(notification.id, notification.dataFlow, events);
+                break;
+            case WatchNotificationType::SessionsChanged:
+                sessionsChanged = true;
+                break;
+        }
+    }
+
+    if (sessionsChanged) {
+        syncWatchedSessions(&events);
+    }
+
+    return true;
+}
+
+void stopWatch() {
+    AcquireSRWLockExclusive(&watchLock);
+    if (watchSignal != nullptr) {
+        CloseHandle(watchSignal);
+        watchSignal = nullptr;
+    }
+    watchNotifications.clear();
+    ReleaseSRWLockExclusive(&watchLock);
+
+    for (auto &watched: watchedNodes) {
+        unwatchNode(watched.second);
+    }
+    watchedNodes.clear();
+}
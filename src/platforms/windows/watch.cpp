@@ -0,0 +1,103 @@
+#include "watch.h"
+#include "commands.h"
+#include "jsonWriter.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Long enough to keep the process idle, short enough to notice the closed input quickly
+const int WATCH_WAIT_MS = 500;
+
+void writeVsNodeLine(JsonWriter &json, VsNode &node, const char *type) {
+    json.raw("{").key("type").string(type);
+    json.raw(", ").key("id").string(node.id);
+    json.raw(", ").key("name").string(node.name);
+    json.raw(", ").key("volume").number(node.volume);
+    json.raw(", ").key("muted").boolean(node.muted);
+    json.raw(", ").key("isDefault").boolean(node.isDefault);
+
+    if (node.destinationId != nullptr) {
+        json.raw(", ").key("destinationId").string(node.destinationId);
+    }
+
+    json.raw("}");
+}
+
+void printVsEvent(std::ostream &out, VsEvent &event) {
+    // Events are single lines whatever the mode, the indented writer only adds the space after the colons
+    JsonWriter json;
+    switch (event.type) {
+        case VsEventType::Changed:
+            json.raw("{").key("event").string("changed").raw(", ").key("node");
+            writeVsNodeLine(json, event.node, event.nodeType);
+            json.raw("}");
+            break;
+        case VsEventType::Added:
+            json.raw("{").key("event").string("added").raw(", ").key("node");
+            writeVsNodeLine(json, event.node, event.nodeType);
+            json.raw("}");
+            break;
+        case VsEventType::Removed:
+            json.raw("{").key("event").string("removed").raw(", ").key("type").string(event.nodeType);
+            json.raw(", ").key("id").string(event.node.id).raw("}");
+            break;
+        case VsEventType::DefaultChanged:
+            json.raw("{").key("event").string("defaultChanged").raw(", ").key("type").string(event.nodeType);
+            if (event.node.id != nullptr) {
+                json.raw(", ").key("id").string(event.node.id);
+            }
+            json.raw("}");
+            break;
+    }
+
+    json.writeTo(out);
+}
+
+int watch(std::istream &in, std::ostream &out) {
+    if (!startWatch()) {
+        return 1;
+    }
+
+    // Only the end of the input matters, read it on the side so the backend wait isn't blocked by it
+    auto inputClosed = std::make_shared<std::atomic<bool>>(false);
+    std::thread reader([&in, inputClosed]() {
+        std::string line;
+        while (std::getline(in, line)) {
+        }
+        *inputClosed = true;
+    });
+
+    int code = 0;
+    std::vector<VsEvent> events;
+    while (!*inputClosed) {
+        if (!waitForEvents(events, WATCH_WAIT_MS)) {
+            code = 1;
+            break;
+        }
+
+        for (VsEvent &event: events) {
+            printVsEvent(out, event);
+        }
+        clearVsEvents(events);
+        out.flush();
+
+        // The reading process is gone
+        if (!out) {
+            code = 1;
+            break;
+        }
+    }
+
+    stopWatch();
+
+    if (*inputClosed) {
+        reader.join();
+    } else {
+        // Still blocked on the input, which lives as long as the process
+        reader.detach();
+    }
+
+    return code;
+}
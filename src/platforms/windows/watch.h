@@ -0,0 +1,31 @@
+#ifndef VSEXEC_WATCH_H
+#define VSEXEC_WATCH_H
+
+#include "audio.h"
+#include <istream>
+#include <ostream>
+
+/*
+ * Watch protocol
+ *
+ * Each change is written as a single line JSON event:
+ *   {"event": "changed", "node": {...}}
+ *   {"event": "added", "node": {...}}
+ *   {"event": "removed", "type": "<sink|source|stream>", "id": "..."}
+ *   {"event": "defaultChanged", "type": "<sink|source>", "id": "..."}
+ *
+ * The id of defaultChanged is omitted when there is no default device anymore.
+ * The watch stops when its input is closed, so it doesn't outlive the process reading it.
+ */
+
+void printVsEvent(std::ostream &out, VsEvent &event);
+
+/**
+ * Stream the backend events until the input is closed.
+ * @param in The stream whose end stops the watch, its content is ignored
+ * @param out The stream events are written to
+ * @return The exit code of the process
+ */
+int watch(std::istream &in, std::ostream &out);
+
+#endif
@@ -0,0 +1,123 @@
+import { existsSync, mkdtempSync, rmSync, writeFileSync } from 'fs';
+import { tmpdir } from 'os';
+import { basename, join } from 'path';
+import { PlatformImplementation } from '@/types';
+import {
+  BackendCandidate,
+  BackendSelection,
+  createLazyImplementation,
+  isServerUnreachableError,
+} from '@/utils/backendSelection';
+import { getCommandStats, resetCommandStats } from '@/utils/commands';
+
+describe('Backend selection test', () => {
+  let dir: string;
+  let cachePath: string;
+  let candidates: BackendCandidate[];
+  let writes: string[];
+
+  // The probe of a backend fails while its flag file exists, like a tool whose server doesn't answer
+  const candidate = (name: string, volume: number): BackendCandidate => ({
+    name,
+    command: process.execPath,
+    probeArgs: ['-e', `process.exit(require('fs').existsSync(${JSON.stringify(join(dir, name))}) ? 1 : 0)`],
+    implementation: {
+      getGlobalVolume: async () => {
+        if (existsSync(join(dir, name))) throw new Error('Connection refused');
+        return volume;
+      },
+      setGlobalVolume: async (volume: number) => {
+        if (volume > 100) throw new Error('Volume must be between 0 and 100');
+      },
+      setNodeVolumeById: async (id: string, volume: number) => {
+        if (existsSync(join(dir, name))) throw new Error('Connection refused');
+        writes.push(`${name} ${id} ${volume}`);
+      },
+    } as PlatformImplementation,
+  });
+  const stopServer = (name: string) => writeFileSync(join(dir, name), '');
+  const probes = () => getCommandStats()[basename(process.execPath)]?.runs ?? 0;
+
+  beforeEach(() => {
+    dir = mkdtempSync(join(tmpdir(), 'vs-backend-'));
+    cachePath = join(dir, 'cache', 'backend.json');
+    candidates = [candidate('pulseaudio', 10), candidate('wireplumber', 20), candidate('amixer', 30)];
+    writes = [];
+    resetCommandStats();
+  });
+
+  afterEach(() => rmSync(dir, { recursive: true, force: true }));
+
+  it('should select the first backend whose server answers', async () => {
+    stopServer('pulseaudio');
+    const implementation = createLazyImplementation(new BackendSelection(candidates, cachePath));
+
+    const volumes = await Promise.all([implementation.getGlobalVolume(), implementation.getGlobalVolume()]);
+    expect(volumes).toEqual([20, 20]);
+    expect(probes()).toBe(2);
+  });
+
+  it('should reuse the saved selection without probing', async () => {
+    stopServer('pulseaudio');
+    await createLazyImplementation(new BackendSelection(candidates, cachePath)).getGlobalVolume();
+    resetCommandStats();
+
+    const selection = new BackendSelection(candidates, cachePath);
+    expect(await createLazyImplementation(selection).getGlobalVolume()).toBe(20);
+    expect(selection.getSelected().name).toBe('wireplumber');
+    expect(probes()).toBe(0);
+  });
+
+  it('should fall back to the next backend when the selected one stops answering', async () => {
+    const selection = new BackendSelection(candidates, cachePath);
+    const implementation = createLazyImplementation(selection);
+    expect(await implementation.getGlobalVolume()).toBe(10);
+
+    stopServer('pulseaudio');
+    expect(await implementation.getGlobalVolume()).toBe(20);
+    expect(selection.getSelected().name).toBe('wireplumber');
+  });
+
+  it('should not run the calls taking node IDs again on the next backend', async () => {
+    const selection = new BackendSelection(candidates, cachePath);
+    const implementation = createLazyImplementation(selection);
+    await implementation.setNodeVolumeById('57', 30);
+
+    stopServer('pulseaudio');
+    await expect(implementation.setNodeVolumeById('57', 40)).rejects.toThrow('Connection refused');
+    expect(selection.getSelected().name).toBe('wireplumber');
+    expect(writes).toEqual(['pulseaudio 57 30']);
+
+    // The IDs of the next calls come from the new backend
+    await implementation.setNodeVolumeById('42', 50);
+    expect(writes).toEqual(['pulseaudio 57 30', 'wireplumber 42 50']);
+  });
+
+  it('should use the last backend when no server answers', async () => {
+    candidates.forEach(({ name }) => stopServer(name));
+    const selection = new BackendSelection(candidates, cachePath);
+
+    await expect(createLazyImplementation(selection).getGlobalVolume()).rejects.toThrow('Connection refused');
+    expect(selection.getSelected().name).toBe('amixer');
+  });
+
+  it('should throw the errors of the call itself without probing', async () => {
+    const selection = new BackendSelection(candidates, cachePath);
+    const implementation = createLazyImplementation(selection);
+    await implementation.getGlobalVolume();
+    resetCommandStats();
+
+    await expect(implementation.setGlobalVolume(120)).rejects.toThrow('Volume must be between 0 and 100');
+    expect(selection.getSelected().name).toBe('pulseaudio');
+    expect(probes()).toBe(0);
+  });
+
+  it('should only take the failures to reach the server for an unanswering server', () => {
+    expect(isServerUnreachableError('Connection failure: Connection refused\n')).toBe(true);
+    expect(isServerUnreachableError(new Error('spawn pactl ENOENT'))).toBe(true);
+    expect(isServerUnreachableError('Could not connect to PipeWire\n')).toBe(true);
+    expect(isServerUnreachableError('Connection failure: Timeout\n')).toBe(true);
+    expect(isServerUnreachableError('Failure: No such entity\n')).toBe(false);
+    expect(isServerUnreachableError(new Error('Failed to get node type'))).toBe(false);
+  });
+});
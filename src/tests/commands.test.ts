@@ -0,0 +1,92 @@
+import { basename } from 'path';
+import {
+  execCommand,
+  getCommandStats,
+  mapWithConcurrency,
+  resetCommandStats,
+  setCommandConcurrency,
+  setCommandExecutor,
+} from '@/utils/commands';
+
+describe('Command runner test', () => {
+  const node = process.execPath;
+
+  afterEach(() => {
+    setCommandConcurrency(8);
+    setCommandExecutor(null);
+  });
+
+  it('should pass the arguments as is, without a shell', async () => {
+    const args = ['a b', '"quoted"', '$HOME', '; echo injected'];
+    const stdout = await execCommand(node, ['-e', 'console.log(JSON.stringify(process.argv.slice(1)))', ...args]);
+
+    expect(JSON.parse(stdout)).toEqual(args);
+  });
+
+  it('should fail on the exit code, and on the error output only when asked', async () => {
+    const warn = ['-e', 'console.error("warning"); console.log("ok")'];
+    expect(await execCommand(node, warn)).toBe('ok\n');
+    await expect(execCommand(node, warn, { failOnStderr: true })).rejects.toBe('warning\n');
+    await expect(execCommand(node, ['-e', 'console.error("failed"); process.exit(1)'])).rejects.toBe('failed\n');
+  });
+
+  it('should write the input of the command', async () => {
+    const stdout = await execCommand(node, ['-e', 'process.stdin.pipe(process.stdout)'], { input: 'line\n' });
+
+    expect(stdout).toBe('line\n');
+  });
+
+  it('should run at most the given number of commands at a time', async () => {
+    setCommandConcurrency(2);
+    resetCommandStats();
+
+    // Each command prints when it started and ended
+    const script = 'const start = Date.now(); setTimeout(() => console.log(start, Date.now()), 200)';
+    const outputs = await Promise.all([0, 1, 2, 3, 4].map(() => execCommand(node, ['-e', script])));
+    const spans = outputs.map((stdout) => stdout.trim().split(' ').map(Number));
+    const overlaps = spans.map(([start]) => spans.filter(([from, to]) => from <= start && start < to).length);
+
+    expect(Math.max(...overlaps)).toBeLessThanOrEqual(2);
+    const stats = getCommandStats()[basename(node)];
+    expect(stats.runs).toBe(5);
+    expect(stats.failures).toBe(0);
+    expect(stats.queuedMs).toBeGreaterThan(0);
+    expect(stats.runMs).toBeGreaterThanOrEqual(5 * 200);
+  });
+
+  it('should run the commands through the executor instead of spawning them', async () => {
+    resetCommandStats();
+    const calls: string[] = [];
+    setCommandExecutor(async (cmd, args, { input }) => {
+      calls.push([cmd, ...args, input].join(' '));
+      if (args[0] === 'fail') throw 'Failure: No such entity\n';
+      return 'replayed\n';
+    });
+
+    expect(await execCommand('/usr/bin/pactl', ['info'], { input: 'line' })).toBe('replayed\n');
+    await expect(execCommand('pactl', ['fail'])).rejects.toBe('Failure: No such entity\n');
+    expect(calls).toEqual(['/usr/bin/pactl info line', 'pactl fail ']);
+
+    const stats = getCommandStats().pactl;
+    expect(stats.runs).toBe(2);
+    expect(stats.failures).toBe(1);
+    expect(stats.spawnMs).toBe(0);
+
+    setCommandExecutor(null);
+    expect(await execCommand(process.execPath, ['-e', 'console.log("spawned")'])).toBe('spawned\n');
+  });
+
+  it('should map at most the given number of items at a time', async () => {
+    let running = 0;
+    let maxRunning = 0;
+    const results = await mapWithConcurrency([1, 2, 3, 4, 5, 6], 3, async (item) => {
+      maxRunning = Math.max(maxRunning, ++running);
+      await new Promise((resolve) => setTimeout(resolve, 10));
+      running--;
+      return item * 2;
+    });
+
+    expect(results).toEqual([2, 4, 6, 8, 10, 12]);
+    expect(maxRunning).toBe(3);
+  });
+});
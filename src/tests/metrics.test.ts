@@ -0,0 +1,109 @@
+import { basename } from 'path';
+import { PlatformImplementation } from '@/types';
+import { execCommand } from '@/utils/commands';
+import {
+  countParsedBytes,
+  countProcessStart,
+  getParsedBytes,
+  getProcessStarts,
+  MethodLatencies,
+  setTraceHook,
+  TraceEvent,
+} from '@/utils/metrics';
+
+describe('Metrics test', () => {
+  const sleep = (ms: number) => new Promise((resolve) => setTimeout(resolve, ms));
+
+  let backend: PlatformImplementation;
+
+  beforeEach(() => {
+    backend = {
+      getGlobalVolume: async () => {
+        await sleep(30);
+        return 50;
+      },
+      isGlobalMuted: async () => false,
+      setGlobalVolume: async (volume: number) => {
+        if (volume > 100) throw new Error('Volume must be between 0 and 100');
+      },
+      getPlatformCompatibility: () => ({}),
+    } as unknown as PlatformImplementation;
+  });
+
+  afterEach(() => setTraceHook(null));
+
+  it('should measure the latency of each method in its histogram bucket', async () => {
+    const latencies = new MethodLatencies(backend);
+
+    expect(await latencies.implementation.getGlobalVolume()).toBe(50);
+    expect(await latencies.implementation.isGlobalMuted()).toBe(false);
+    expect(latencies.implementation.getPlatformCompatibility()).toEqual({});
+
+    const metrics = latencies.getMetrics();
+    expect(Object.keys(metrics).sort()).toEqual(['getGlobalVolume', 'getPlatformCompatibility', 'isGlobalMuted']);
+
+    const volume = metrics.getGlobalVolume;
+    expect(volume.calls).toBe(1);
+    expect(volume.failures).toBe(0);
+    expect(volume.maxMs).toBeGreaterThanOrEqual(25);
+    expect(volume.maxMs).toBe(volume.totalMs);
+    // Between 20 and 100 ms, whatever the load of the machine running the test
+    const bucket = volume.histogram.find((bucket) => bucket.calls === 1);
+    expect([50, 100]).toContain(bucket.underMs);
+    expect(volume.histogram.reduce((sum, bucket) => sum + bucket.calls, 0)).toBe(1);
+
+    expect(metrics.isGlobalMuted.histogram.find((bucket) => bucket.calls === 1).underMs).toBeLessThan(20);
+  });
+
+  it('should count the failures and keep their errors', async () => {
+    const latencies = new MethodLatencies(backend);
+
+    await latencies.implementation.setGlobalVolume(20);
+    await expect(latencies.implementation.setGlobalVolume(120)).rejects.toThrow('Volume must be between 0 and 100');
+
+    const metrics = latencies.getMetrics().setGlobalVolume;
+    expect(metrics.calls).toBe(2);
+    expect(metrics.failures).toBe(1);
+  });
+
+  it('should forward the calls, commands, processes and parsed outputs to the trace hook', async () => {
+    const events: TraceEvent[] = [];
+    setTraceHook((event) => events.push(event));
+
+    const latencies = new MethodLatencies(backend);
+    await latencies.implementation.isGlobalMuted();
+    await execCommand(process.execPath, ['-e', '']);
+    countProcessStart('vsExec.exe serve');
+    countParsedBytes('test', 'é\n');
+
+    expect(events.map((event) => event.type)).toEqual(['call', 'command', 'process', 'parse']);
+    expect(events[0]).toMatchObject({ method: 'isGlobalMuted', ok: true });
+    expect(events[1]).toMatchObject({ command: basename(process.execPath), ok: true });
+    expect(events[3]).toEqual({ type: 'parse', format: 'test', bytes: 3 });
+  });
+
+  it('should ignore the errors of the trace hook', async () => {
+    setTraceHook(() => {
+      throw new Error('Tracing failed');
+    });
+    const error = jest.spyOn(console, 'error').mockImplementation(() => undefined);
+
+    const latencies = new MethodLatencies(backend);
+    expect(await latencies.implementation.isGlobalMuted()).toBe(false);
+    expect(error).toHaveBeenCalled();
+
+    error.mockRestore();
+  });
+
+  it('should add up the parsed bytes and process starts', () => {
+    const bytes = getParsedBytes()['pactl json'] ?? 0;
+    const starts = getProcessStarts()['pactl subscribe'] ?? 0;
+
+    countParsedBytes('pactl json', '{"volume":{}}');
+    countParsedBytes('pactl json', '[]');
+    countProcessStart('pactl subscribe');
+
+    expect(getParsedBytes()['pactl json']).toBe(bytes + 15);
+    expect(getProcessStarts()['pactl subscribe']).toBe(starts + 1);
+  });
+});
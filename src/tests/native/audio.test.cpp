@@ -0,0 +1,75 @@
+#include "audio.h"
+#include <gtest/gtest.h>
+
+// Nodes of a device read by its own task, with one stream per name
+DeviceNodes readDevice(const std::wstring &id, const std::vector<std::wstring> &streamNames, bool streamsRead = true) {
+    DeviceNodes device;
+    device.deviceRead = true;
+    device.streamsRead = streamsRead;
+    LPWSTR deviceId = device.strings.copy(id);
+    device.devices.push_back({deviceId, device.strings.copy(L"Device " + id), 50, false, false, nullptr});
+
+    for (const std::wstring &name: streamNames) {
+        device.streams.push_back({device.strings.copy(id + L"|" + name), device.strings.copy(name), 100, false, false,
+                                  deviceId});
+    }
+    return device;
+}
+
+TEST(MergeDeviceNodesTest, KeepsTheOrderOfTheDevices) {
+    std::vector<DeviceNodes> deviceNodes;
+    deviceNodes.push_back(readDevice(L"sink-0", {L"a", L"b"}));
+    deviceNodes.push_back(readDevice(L"sink-1", {}));
+    deviceNodes.push_back(readDevice(L"sink-2", {L"c"}));
+
+    StringArena strings;
+    std::vector<VsNode> devices;
+    std::vector<VsNode> streams;
+    mergeDeviceNodes(deviceNodes, &devices, &streams, strings);
+    deviceNodes.clear();
+
+    ASSERT_EQ(devices.size(), 3u);
+    EXPECT_STREQ(devices[0].id, L"sink-0");
+    EXPECT_STREQ(devices[1].id, L"sink-1");
+    EXPECT_STREQ(devices[2].name, L"Device sink-2");
+
+    ASSERT_EQ(streams.size(), 3u);
+    EXPECT_STREQ(streams[0].id, L"sink-0|a");
+    EXPECT_STREQ(streams[1].id, L"sink-0|b");
+    EXPECT_STREQ(streams[2].id, L"sink-2|c");
+    EXPECT_STREQ(streams[2].destinationId, L"sink-2");
+    // Still a single copy of the device ID for its streams
+    EXPECT_EQ(streams[0].destinationId, streams[1].destinationId);
+}
+
+TEST(MergeDeviceNodesTest, StopsAtTheFirstDeviceThatFailed) {
+    std::vector<DeviceNodes> deviceNodes;
+    deviceNodes.push_back(readDevice(L"sink-0", {L"a"}));
+    deviceNodes.emplace_back();
+    deviceNodes.push_back(readDevice(L"sink-2", {L"b"}));
+
+    StringArena strings;
+    std::vector<VsNode> devices;
+    std::vector<VsNode> streams;
+    mergeDeviceNodes(deviceNodes, &devices, &streams, strings);
+
+    ASSERT_EQ(devices.size(), 1u);
+    ASSERT_EQ(streams.size(), 1u);
+    EXPECT_STREQ(streams[0].id, L"sink-0|a");
+}
+
+TEST(MergeDeviceNodesTest, KeepsTheDevicesAfterTheStreamsFailed) {
+    std::vector<DeviceNodes> deviceNodes;
+    deviceNodes.push_back(readDevice(L"sink-0", {L"a"}, false));
+    deviceNodes.push_back(readDevice(L"sink-1", {L"b"}));
+
+    StringArena strings;
+    std::vector<VsNode> devices;
+    std::vector<VsNode> streams;
+    mergeDeviceNodes(deviceNodes, &devices, &streams, strings);
+
+    // The streams read before the failure are kept, the ones of the next devices are not
+    EXPECT_EQ(devices.size(), 2u);
+    ASSERT_EQ(streams.size(), 1u);
+    EXPECT_STREQ(streams[0].id, L"sink-0|a");
+}
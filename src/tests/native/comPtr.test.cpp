@@ -0,0 +1,80 @@
+#include "comPtr.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+// Counts its references the way a COM object does
+struct CountedObject {
+    unsigned long refCount = 1;
+    bool *destroyed;
+
+    explicit CountedObject(bool *destroyed) : destroyed(destroyed) {
+    }
+
+    unsigned long AddRef() {
+        return ++refCount;
+    }
+
+    unsigned long Release() {
+        unsigned long count = --refCount;
+        if (count == 0) {
+            *destroyed = true;
+            delete this;
+        }
+        return count;
+    }
+};
+
+TEST(ComPtrTest, ReleasesTheAttachedReference) {
+    bool destroyed = false;
+    {
+        ComPtr<CountedObject> object(new CountedObject(&destroyed));
+        EXPECT_TRUE(object);
+        EXPECT_EQ(object->refCount, 1u);
+    }
+
+    EXPECT_TRUE(destroyed);
+}
+
+TEST(ComPtrTest, ReferencesCopiesAndSharedPointers) {
+    bool destroyed = false;
+    auto *raw = new CountedObject(&destroyed);
+    {
+        ComPtr<CountedObject> owner(raw);
+        ComPtr<CountedObject> shared = ComPtr<CountedObject>::share(raw);
+        std::vector<ComPtr<CountedObject>> copies(3, owner);
+        EXPECT_EQ(raw->refCount, 5u);
+
+        ComPtr<CountedObject> moved(std::move(shared));
+        EXPECT_FALSE(shared);
+        EXPECT_EQ(raw->refCount, 5u);
+    }
+
+    EXPECT_TRUE(destroyed);
+}
+
+TEST(ComPtrTest, ReleasesTheFormerInterfaceWhenFilledAgain) {
+    bool firstDestroyed = false;
+    bool secondDestroyed = false;
+    ComPtr<CountedObject> object(new CountedObject(&firstDestroyed));
+
+    // What a COM function does with its out parameter
+    *object.put() = new CountedObject(&secondDestroyed);
+    EXPECT_TRUE(firstDestroyed);
+    EXPECT_FALSE(secondDestroyed);
+
+    object = ComPtr<CountedObject>();
+    EXPECT_TRUE(secondDestroyed);
+}
+
+TEST(ComPtrTest, GivesTheReferenceAwayOnDetach) {
+    bool destroyed = false;
+    CountedObject *raw;
+    {
+        ComPtr<CountedObject> object(new CountedObject(&destroyed));
+        raw = object.detach();
+    }
+
+    EXPECT_FALSE(destroyed);
+    raw->Release();
+    EXPECT_TRUE(destroyed);
+}
@@ -0,0 +1,76 @@
+#include "audio.h"
+#include "fakeBackend.h"
+#include "taskPool.h"
+#include <gtest/gtest.h>
+#include <chrono>
+
+class FakeBackendTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        uninitialize();
+        configureFakeBackend(FakeBackendOptions());
+    }
+};
+
+TEST_F(FakeBackendTest, GeneratesTheConfiguredNodes) {
+    FakeBackendOptions options;
+    options.sinkCount = 3;
+    options.sourceCount = 2;
+    options.streamCount = 2000;
+    configureFakeBackend(options);
+    initialize();
+
+    VsStatus status;
+    getStatus(&status);
+
+    ASSERT_EQ(status.sinks.size(), 3u);
+    EXPECT_EQ(status.sources.size(), 2u);
+    ASSERT_EQ(status.streams.size(), 2000u);
+    EXPECT_EQ(std::wstring(status.defaultSink), L"{0.0.0.00000000}.{sink-0}");
+    // Spread over the sinks
+    EXPECT_EQ(std::wstring(status.streams[4].destinationId), L"{0.0.0.00000000}.{sink-1}");
+
+    LPWSTR lastStream = status.streams.back().id;
+    setVolumeById(lastStream, 12);
+    EXPECT_EQ(getVolumeById(lastStream), 12);
+    clearVsStatus(status);
+}
+
+TEST_F(FakeBackendTest, WaitsForEachRoundTrip) {
+    FakeBackendOptions options;
+    options.sinkCount = 1;
+    options.streamCount = 9;
+    options.latency = std::chrono::milliseconds(2);
+    configureFakeBackend(options);
+    initialize();
+
+    auto start = std::chrono::steady_clock::now();
+    VsStatus status;
+    getStatus(&status);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // One call and ten nodes
+    EXPECT_GE(elapsed, std::chrono::milliseconds(22));
+    clearVsStatus(status);
+}
+
+TEST_F(FakeBackendTest, OverlapsTheRoundTripsOfTheDevices) {
+    FakeBackendOptions options;
+    options.sinkCount = 4;
+    options.latency = std::chrono::milliseconds(10);
+    configureFakeBackend(options);
+    initialize();
+    setEnumerationThreads(4);
+
+    auto start = std::chrono::steady_clock::now();
+    VsStatus status;
+    getStatus(&status);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // One call then the four sinks at once, instead of five round trips in a row
+    EXPECT_GE(elapsed, std::chrono::milliseconds(20));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(45));
+    EXPECT_EQ(status.sinks.size(), 4u);
+    setEnumerationThreads(0);
+    clearVsStatus(status);
+}
@@ -0,0 +1,51 @@
+#include "jsonWriter.h"
+#include <gtest/gtest.h>
+#include <sstream>
+
+TEST(JsonWriterTest, EscapesQuotesBackslashesAndControlCharacters) {
+    WCHAR name[] = {L'"', L'a', L'\\', L'b', L'\n', L'\t', 0x01, 0x1f, 0};
+
+    JsonWriter json;
+    json.string(name);
+
+    EXPECT_EQ(json.str(), "\"\\\"a\\\\b\\n\\t\\u0001\\u001f\"");
+}
+
+TEST(JsonWriterTest, EncodesUtf8AndReplacesLoneSurrogates) {
+    // é, €, U+1F3B5 as a surrogate pair where wchar_t is 16 bits, then a lone high surrogate
+    std::wstring nameW = std::wstring(L"é€") +
+                         (sizeof(WCHAR) == 2 ? std::wstring{(wchar_t) 0xD83C, (wchar_t) 0xDFB5}
+                                             : std::wstring{(wchar_t) 0x1F3B5}) +
+                         std::wstring{(wchar_t) 0xD83C, L'x'};
+    LPWSTR_FROM_WSTRING(name, nameW);
+
+    JsonWriter json;
+    json.string(name);
+
+    EXPECT_EQ(json.str(), "\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x8e\xb5\xef\xbf\xbdx\"");
+    delete[] name;
+}
+
+TEST(JsonWriterTest, DropsTheWhitespaceInCompactMode) {
+    JsonWriter indented;
+    JsonWriter compact(true);
+    for (JsonWriter *json: {&indented, &compact}) {
+        json->raw("{").newline().indent().key("volume").number(42).raw(",").newline();
+        json->indent().key("muted").boolean(false).raw(",").newline();
+        json->indent().key("error").string("Node not found").newline().raw("}");
+    }
+
+    EXPECT_EQ(indented.str(), "{\n  \"volume\": 42,\n  \"muted\": false,\n  \"error\": \"Node not found\"\n}");
+    EXPECT_EQ(compact.str(), "{\"volume\":42,\"muted\":false,\"error\":\"Node not found\"}");
+}
+
+TEST(JsonWriterTest, WritesTheDocumentOnItsOwnLine) {
+    JsonWriter json(true);
+    json.raw("[]");
+
+    std::ostringstream out;
+    json.writeTo(out);
+    json.writeTo(out);
+
+    EXPECT_EQ(out.str(), "[]\n[]\n");
+}
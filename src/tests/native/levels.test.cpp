@@ -0,0 +1,182 @@
+#include "audio.h"
+#include "commands.h"
+#include "jsonWriter.h"
+#include "levels.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Input ending after a delay, so the levels run for a few ticks
+class DelayedEndBuffer : public std::streambuf {
+public:
+    explicit DelayedEndBuffer(std::chrono::milliseconds delay) : delay(delay) {
+    }
+
+protected:
+    int_type underflow() override {
+        std::this_thread::sleep_for(delay);
+        return traits_type::eof();
+    }
+
+private:
+    std::chrono::milliseconds delay;
+};
+
+const VsLevel *findLevel(const std::vector<VsLevel> &levels, const std::wstring &id) {
+    for (const VsLevel &level: levels) {
+        if (id == level.id) return &level;
+    }
+    return nullptr;
+}
+
+}
+
+class LevelsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        initialize();
+    }
+
+    void TearDown() override {
+        uninitialize();
+    }
+};
+
+TEST(LevelAccumulatorTest, MatchesTheScalarKernel) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> sample(-1, 1);
+
+    // Odd lengths leave a tail to the scalar loop after the vectors
+    for (size_t count: {0, 1, 7, 8, 9, 31, 1000, 4099}) {
+        std::vector<float> samples(count);
+        for (float &value: samples) value = sample(random);
+
+        LevelAccumulator vectorized;
+        LevelAccumulator scalar;
+        vectorized.add(samples.data(), samples.size());
+        addSamplesScalar(scalar, samples.data(), samples.size());
+
+        EXPECT_EQ(vectorized.peak, scalar.peak) << count;
+        EXPECT_EQ(vectorized.sampleCount, count);
+        EXPECT_NEAR(vectorized.getRms(), scalar.getRms(), 1e-5) << count;
+    }
+}
+
+TEST(LevelAccumulatorTest, MetersTheNegativeSamples) {
+    std::vector<float> samples = {0.1f, -0.2f, 0.3f, -0.9f, 0.4f, 0, 0.2f, -0.1f, 0.5f};
+
+    LevelAccumulator accumulator;
+    accumulator.add(samples.data(), samples.size());
+
+    EXPECT_FLOAT_EQ(accumulator.peak, 0.9f);
+}
+
+TEST(LevelAccumulatorTest, HasTheRmsOfASine) {
+    // A whole number of periods of a 0.5 amplitude sine
+    std::vector<float> samples(8000);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = 0.5f * (float) std::sin(2 * 3.14159265358979323846 * 440 * (double) i / 8000);
+    }
+
+    LevelAccumulator accumulator;
+    // Across several blocks, as they arrive from a stream
+    accumulator.add(samples.data(), 3001);
+    accumulator.add(samples.data() + 3001, samples.size() - 3001);
+
+    EXPECT_NEAR(accumulator.peak, 0.5f, 1e-3);
+    EXPECT_NEAR(accumulator.getRms(), 0.5f / std::sqrt(2.0f), 1e-4);
+
+    accumulator.reset();
+    EXPECT_EQ(accumulator.peak, 0);
+    EXPECT_EQ(accumulator.getRms(), 0);
+}
+
+TEST(JsonWriterDecimalTest, WritesThreeDecimals) {
+    JsonWriter json(true);
+    json.decimal(0).raw(",").decimal(0.5).raw(",").decimal(0.70710678).raw(",").decimal(1).raw(",").decimal(-0.25);
+
+    EXPECT_EQ(json.str(), "0.000,0.500,0.707,1.000,-0.250");
+}
+
+TEST(PrintVsLevelsTest, OmitsTheMissingRms) {
+    std::wstring sinkW = L"{0.0.0.00000000}.{sink-speakers}";
+    std::wstring streamW = L"{0.0.0.00000000}.{sink-speakers}|app";
+    LPWSTR_FROM_WSTRING(sink, sinkW);
+    LPWSTR_FROM_WSTRING(stream, streamW);
+
+    std::vector<VsLevel> levels = {{"sink", sink, 0.5f, 0.25f}, {"stream", stream, 0.125f, -1}};
+    std::ostringstream indented;
+    std::ostringstream compact;
+    printVsLevels(indented, levels, false);
+    printVsLevels(compact, levels, true);
+
+    EXPECT_EQ(indented.str(),
+              "[\n  {\"type\": \"sink\", \"id\": \"{0.0.0.00000000}.{sink-speakers}\", \"peak\": 0.500, \"rms\": 0.250},\n"
+              "  {\"type\": \"stream\", \"id\": \"{0.0.0.00000000}.{sink-speakers}|app\", \"peak\": 0.125}\n]\n");
+    EXPECT_EQ(compact.str(),
+              "[{\"type\":\"sink\",\"id\":\"{0.0.0.00000000}.{sink-speakers}\",\"peak\":0.500,\"rms\":0.250},"
+              "{\"type\":\"stream\",\"id\":\"{0.0.0.00000000}.{sink-speakers}|app\",\"peak\":0.125}]\n");
+
+    delete[] sink;
+    delete[] stream;
+}
+
+TEST_F(LevelsTest, FollowTheVolumeAndTheMute) {
+    std::vector<VsLevel> levels;
+    StringArena strings;
+    ASSERT_TRUE(getLevelsOnce(&levels, strings, std::chrono::milliseconds(50)));
+
+    // Speakers at 50, microphone at 80, the player stream is muted
+    const VsLevel *speakers = findLevel(levels, L"{0.0.0.00000000}.{sink-speakers}");
+    const VsLevel *microphone = findLevel(levels, L"{0.0.1.00000000}.{source-microphone}");
+    const VsLevel *player = findLevel(levels, L"{0.0.0.00000000}.{sink-headphones}|\\Device\\player.exe%b{stream-2}");
+    ASSERT_NE(speakers, nullptr);
+    ASSERT_NE(microphone, nullptr);
+    ASSERT_NE(player, nullptr);
+    EXPECT_EQ(levels.size(), 5u);
+
+    EXPECT_STREQ(speakers->nodeType, "sink");
+    EXPECT_NEAR(speakers->peak, 0.5f, 0.01f);
+    EXPECT_NEAR(speakers->rms, 0.5f / std::sqrt(2.0f), 0.01f);
+    EXPECT_STREQ(microphone->nodeType, "source");
+    EXPECT_NEAR(microphone->peak, 0.8f, 0.01f);
+    EXPECT_STREQ(player->nodeType, "stream");
+    EXPECT_EQ(player->peak, 0);
+    EXPECT_EQ(player->rms, 0);
+}
+
+TEST_F(LevelsTest, AreWrittenAsLinesUntilTheInputIsClosed) {
+    DelayedEndBuffer buffer(std::chrono::milliseconds(200));
+    std::istream in(&buffer);
+    std::ostringstream out;
+
+    EXPECT_EQ(watchLevels(in, out, 50), 0);
+
+    // About 10 ticks at 50 Hz, each a single line with every node
+    std::istringstream lines(out.str());
+    std::string line;
+    size_t lineCount = 0;
+    while (std::getline(lines, line)) {
+        lineCount++;
+        EXPECT_EQ(line.rfind("{\"levels\": [{\"type\": \"sink\", \"id\": \"{0.0.0.00000000}.{sink-speakers}\", ", 0), 0u);
+        EXPECT_NE(line.find("\"rms\": "), std::string::npos);
+    }
+    EXPECT_GE(lineCount, 3u);
+    EXPECT_LE(lineCount, 12u);
+}
+
+TEST_F(LevelsTest, RejectsInvalidIntervalsWithTheUsage) {
+    for (const std::string interval : {"often", "50ms", "0"}) {
+        std::istringstream in;
+        std::ostringstream out;
+
+        EXPECT_EQ(runCommand({"vsExec", "getLevels", interval}, in, out), 1);
+        EXPECT_EQ(out.str().rfind("Usage: vsExec", 0), 0u);
+    }
+}
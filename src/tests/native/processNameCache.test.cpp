@@ -0,0 +1,122 @@
+#include "processNameCache.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+
+class ProcessNameCacheTest : public testing::Test {
+protected:
+    void SetUp() override {
+        path = testing::TempDir() + "vsExecProcessNames." +
+               testing::UnitTest::GetInstance()->current_test_info()->name() + ".bin";
+        std::remove(path.c_str());
+    }
+
+    void TearDown() override {
+        std::remove(path.c_str());
+    }
+
+    std::string path;
+};
+
+TEST_F(ProcessNameCacheTest, FindsTheInsertedName) {
+    ProcessNameCache cache("");
+    std::wstring name;
+
+    EXPECT_FALSE(cache.find(1234, 100, L"C:\\Apps\\player.exe", name));
+    cache.insert(1234, 100, L"C:\\Apps\\player.exe", L"Mëdia Player");
+
+    ASSERT_TRUE(cache.find(1234, 100, L"C:\\Apps\\player.exe", name));
+    EXPECT_EQ(name, L"Mëdia Player");
+    EXPECT_FALSE(cache.isPersistent());
+}
+
+TEST_F(ProcessNameCacheTest, IgnoresTheEntryOfAReusedProcessId) {
+    ProcessNameCache cache("");
+    std::wstring name;
+    cache.insert(1234, 100, L"C:\\Apps\\player.exe", L"Player");
+
+    EXPECT_FALSE(cache.find(1234, 200, L"C:\\Apps\\player.exe", name));
+    EXPECT_FALSE(cache.find(1234, 100, L"C:\\Apps\\browser.exe", name));
+
+    cache.insert(1234, 200, L"C:\\Apps\\browser.exe", L"Browser");
+    ASSERT_TRUE(cache.find(1234, 200, L"C:\\Apps\\browser.exe", name));
+    EXPECT_EQ(name, L"Browser");
+    EXPECT_FALSE(cache.find(1234, 100, L"C:\\Apps\\player.exe", name));
+}
+
+TEST_F(ProcessNameCacheTest, KeepsCollidingProcessesApart) {
+    // Every process lands on one of the two slots
+    ProcessNameCache cache("", 2);
+    std::wstring name;
+    cache.insert(1, 100, L"a.exe", L"A");
+    cache.insert(2, 100, L"b.exe", L"B");
+
+    ASSERT_TRUE(cache.find(1, 100, L"a.exe", name));
+    EXPECT_EQ(name, L"A");
+    ASSERT_TRUE(cache.find(2, 100, L"b.exe", name));
+    EXPECT_EQ(name, L"B");
+
+    // A third one replaces one of them instead of failing
+    cache.insert(3, 100, L"c.exe", L"C");
+    ASSERT_TRUE(cache.find(3, 100, L"c.exe", name));
+    EXPECT_EQ(name, L"C");
+}
+
+TEST_F(ProcessNameCacheTest, SkipsNamesLongerThanASlot) {
+    ProcessNameCache cache("");
+    std::wstring name;
+    cache.insert(1234, 100, L"player.exe", std::wstring(200, L'a'));
+
+    EXPECT_FALSE(cache.find(1234, 100, L"player.exe", name));
+}
+
+TEST_F(ProcessNameCacheTest, PersistsTheNamesAcrossInstances) {
+    {
+        ProcessNameCache cache(path);
+        ASSERT_TRUE(cache.isPersistent());
+        cache.insert(1234, 100, L"C:\\Apps\\player.exe", L"Player");
+    }
+
+    ProcessNameCache cache(path);
+    std::wstring name;
+    ASSERT_TRUE(cache.find(1234, 100, L"C:\\Apps\\player.exe", name));
+    EXPECT_EQ(name, L"Player");
+}
+
+TEST_F(ProcessNameCacheTest, SharesTheNamesBetweenOpenInstances) {
+    ProcessNameCache writer(path);
+    ProcessNameCache reader(path);
+    std::wstring name;
+
+    writer.insert(1234, 100, L"player.exe", L"Player");
+
+    ASSERT_TRUE(reader.find(1234, 100, L"player.exe", name));
+    EXPECT_EQ(name, L"Player");
+}
+
+TEST_F(ProcessNameCacheTest, ResetsAFileOfAnotherLayout) {
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << std::string(4096, 'x');
+    }
+    {
+        ProcessNameCache cache(path);
+        std::wstring name;
+        EXPECT_FALSE(cache.find(0x78787878, 0x7878787878787878, L"", name));
+        cache.insert(1234, 100, L"player.exe", L"Player");
+    }
+
+    // Another slot count is another layout as well
+    ProcessNameCache cache(path, 16);
+    std::wstring name;
+    EXPECT_FALSE(cache.find(1234, 100, L"player.exe", name));
+}
+
+TEST_F(ProcessNameCacheTest, FallsBackToMemoryWhenTheFileCantBeOpened) {
+    ProcessNameCache cache(testing::TempDir() + "missing/directory/vsExecProcessNames.bin");
+    std::wstring name;
+
+    EXPECT_FALSE(cache.isPersistent());
+    cache.insert(1234, 100, L"player.exe", L"Player");
+    EXPECT_TRUE(cache.find(1234, 100, L"player.exe", name));
+}
@@ -0,0 +1,169 @@
+#include "audio.h"
+#include "commands.h"
+#include "ramp.h"
+#include "serve.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+
+const std::wstring SPEAKERS_ID = L"{0.0.0.00000000}.{sink-speakers}";
+
+// Reports of the ramps as they end, from the ramp thread
+class RampReports {
+public:
+    std::function<void(const RampReport &)> add() {
+        return [this](const RampReport &report) {
+            std::lock_guard<std::mutex> lock(mutex);
+            reports.push_back(report);
+            changed.notify_all();
+        };
+    }
+
+    std::vector<RampReport> waitFor(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        EXPECT_TRUE(changed.wait_for(lock, std::chrono::seconds(10), [this, count] { return reports.size() >= count; }));
+        return reports;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<RampReport> reports;
+};
+
+class RampTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        initialize();
+    }
+
+    void TearDown() override {
+        stopRamps();
+        uninitialize();
+    }
+
+    static RampOptions getOptions(int target, long long durationMs) {
+        RampOptions options;
+        options.target = target;
+        options.duration = std::chrono::milliseconds(durationMs);
+        options.stepInterval = std::chrono::milliseconds(2);
+        return options;
+    }
+
+    void start(const RampOptions &options, RampReports &reports) {
+        std::wstring id = SPEAKERS_ID;
+        VsVolumeControl *control = openVolumeControl(&id[0]);
+        ASSERT_NE(control, nullptr);
+        startRamp(id, control, options, reports.add());
+    }
+
+    int getSpeakersVolume() {
+        std::lock_guard<std::mutex> lock(getBackendMutex());
+        std::wstring id = SPEAKERS_ID;
+        return getVolumeById(&id[0]);
+    }
+};
+
+TEST(RampLevelTest, IsLinearBetweenTheLevels) {
+    EXPECT_FLOAT_EQ(getRampLevel(0.2f, 0.6f, 0, RampCurve::Linear), 0.2f);
+    EXPECT_FLOAT_EQ(getRampLevel(0.2f, 0.6f, 0.25, RampCurve::Linear), 0.3f);
+    EXPECT_FLOAT_EQ(getRampLevel(0.2f, 0.6f, 1, RampCurve::Linear), 0.6f);
+}
+
+TEST(RampLevelTest, IsEvenInDecibels) {
+    // -40 dB to 0 dB, -20 dB halfway
+    EXPECT_NEAR(getRampLevel(0.01f, 1, 0.5, RampCurve::Decibel), 0.1f, 1e-6);
+    EXPECT_NEAR(getRampLevel(1, 0.01f, 0.75, RampCurve::Decibel), 0.0316228f, 1e-6);
+    EXPECT_FLOAT_EQ(getRampLevel(0.5f, 0.5f, 0.5, RampCurve::Decibel), 0.5f);
+}
+
+TEST(RampLevelTest, ReachesSilenceAtTheEndOnly) {
+    EXPECT_NEAR(getRampLevel(1, 0, 0.5, RampCurve::Decibel), std::sqrt(0.001f), 1e-6);
+    EXPECT_FLOAT_EQ(getRampLevel(1, 0, 1, RampCurve::Decibel), 0);
+    EXPECT_NEAR(getRampLevel(0, 1, 0.5, RampCurve::Decibel), std::sqrt(0.001f), 1e-6);
+}
+
+TEST_F(RampTest, ReachesTheTarget) {
+    RampReports reports;
+    start(getOptions(80, 40), reports);
+
+    std::vector<RampReport> ended = reports.waitFor(1);
+    ASSERT_EQ(ended.size(), 1u);
+    EXPECT_TRUE(ended[0].completed);
+    EXPECT_EQ(ended[0].error, nullptr);
+    EXPECT_EQ(ended[0].volume, 80);
+    EXPECT_EQ(getSpeakersVolume(), 80);
+    EXPECT_GE(ended[0].elapsed, std::chrono::milliseconds(40));
+}
+
+TEST_F(RampTest, CountsEveryStepInTheJitterHistogram) {
+    RampReports reports;
+    start(getOptions(10, 40), reports);
+
+    RampReport report = reports.waitFor(1)[0];
+    EXPECT_GT(report.steps, 0u);
+    EXPECT_LE(report.steps, 20u);
+    EXPECT_EQ(std::accumulate(report.jitterHistogram.begin(), report.jitterHistogram.end(), (size_t) 0), report.steps);
+    EXPECT_LE(report.meanJitter, report.maxJitter);
+}
+
+TEST_F(RampTest, ReplacesTheRunningRampOfTheNode) {
+    RampReports reports;
+    start(getOptions(100, 10000), reports);
+    start(getOptions(5, 0), reports);
+
+    std::vector<RampReport> ended = reports.waitFor(2);
+    ASSERT_EQ(ended.size(), 2u);
+    // The replaced ramp is reported first, then the new one sets its target at once
+    EXPECT_FALSE(ended[0].completed);
+    EXPECT_TRUE(ended[1].completed);
+    EXPECT_EQ(ended[1].volume, 5);
+    EXPECT_EQ(getSpeakersVolume(), 5);
+}
+
+TEST_F(RampTest, StopsTheRunningRamps) {
+    RampReports reports;
+    start(getOptions(100, 10000), reports);
+    stopRamps();
+
+    std::vector<RampReport> ended = reports.waitFor(1);
+    ASSERT_EQ(ended.size(), 1u);
+    EXPECT_FALSE(ended[0].completed);
+    EXPECT_LT(ended[0].elapsed, std::chrono::seconds(10));
+}
+
+TEST_F(RampTest, IsAnsweredByServeOnceItEnds) {
+    std::istringstream in("1\tramp\t{0.0.0.00000000}.{sink-headphones}\t20\t0\tdb\n"
+                          "2\t--compact\tramp\t{0.0.0.00000000}.{sink-speakers}\t90\t10000\n"
+                          "3\tramp\tunknown\t20\t0\n");
+    std::ostringstream out;
+    EXPECT_EQ(serve("vsExec", in, out), 0);
+
+    // The ramp of the headphones ends at once, the one of the speakers is still running when the input is closed
+    std::string responses = out.str();
+    EXPECT_NE(responses.find("3\t1\t0\t26\nFailed to find node by ID\n"), std::string::npos);
+    EXPECT_NE(responses.find("\"completed\": true,\n  \"volume\": 20,"), std::string::npos);
+    EXPECT_NE(responses.find("\"completed\":false,"), std::string::npos);
+    EXPECT_NE(responses.find("\n2\t0\t"), std::string::npos);
+}
+
+TEST_F(RampTest, RejectsInvalidNumbersWithTheUsage) {
+    const std::string id = "{0.0.0.00000000}.{sink-speakers}";
+    const std::vector<std::vector<std::string>> invalid = {
+            {"vsExec", "ramp", id, "loud", "100"},
+            {"vsExec", "ramp", id, "50x", "100"},
+            {"vsExec", "ramp", id, "50", "soon"},
+            {"vsExec", "ramp", id, "50", "-1"},
+    };
+
+    for (const std::vector<std::string> &args : invalid) {
+        std::ostringstream out;
+        EXPECT_EQ(startRampCommand(args, out, false, [](int, const std::string &, const std::string &) {
+            ADD_FAILURE() << "The ramp started";
+        }), 1);
+        EXPECT_EQ(out.str().rfind("Usage: vsExec", 0), 0u);
+    }
+}
@@ -0,0 +1,209 @@
+#include "audio.h"
+#include "commands.h"
+#include "serve.h"
+#include <gtest/gtest.h>
+#include <sstream>
+
+struct Response {
+    std::string requestId;
+    int code;
+    std::string output;
+    std::string error;
+};
+
+std::vector<Response> readResponses(const std::string &raw) {
+    std::vector<Response> responses;
+    std::istringstream in(raw);
+    std::string header;
+
+    while (std::getline(in, header)) {
+        std::vector<std::string> fields = splitFields(header);
+        EXPECT_EQ(fields.size(), 4u);
+
+        Response response;
+        response.requestId = fields[0];
+        response.code = std::stoi(fields[1]);
+        response.output.resize(std::stoul(fields[2]));
+        response.error.resize(std::stoul(fields[3]));
+        in.read(&response.output[0], (std::streamsize) response.output.size());
+        in.read(&response.error[0], (std::streamsize) response.error.size());
+        responses.push_back(response);
+    }
+
+    return responses;
+}
+
+std::vector<Response> serveRequests(const std::string &requests) {
+    std::istringstream in(requests);
+    std::ostringstream out;
+    EXPECT_EQ(serve("vsExec", in, out), 0);
+
+    return readResponses(out.str());
+}
+
+class ServeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        initialize();
+    }
+
+    void TearDown() override {
+        uninitialize();
+    }
+};
+
+TEST(SplitFieldsTest, SplitsOnTabsOnly) {
+    std::vector<std::string> fields = splitFields("7\tsetVolumeById\t{0}|C:\\Program Files\\app.exe\t20");
+
+    ASSERT_EQ(fields.size(), 4u);
+    EXPECT_EQ(fields[0], "7");
+    EXPECT_EQ(fields[1], "setVolumeById");
+    EXPECT_EQ(fields[2], "{0}|C:\\Program Files\\app.exe");
+    EXPECT_EQ(fields[3], "20");
+}
+
+TEST_F(ServeTest, AnswersPipelinedRequestsInOrder) {
+    std::vector<Response> responses = serveRequests(
+            "1\tsetGlobalVolume\t42\n"
+            "2\tgetGlobalVolume\n"
+            "3\tsetGlobalMuted\t1\n"
+            "4\tisGlobalMuted\n");
+
+    ASSERT_EQ(responses.size(), 4u);
+    EXPECT_EQ(responses[0].requestId, "1");
+    EXPECT_EQ(responses[0].code, 0);
+    EXPECT_EQ(responses[0].output, "");
+    EXPECT_EQ(responses[1].requestId, "2");
+    EXPECT_EQ(responses[1].output, "42\n");
+    EXPECT_EQ(responses[3].requestId, "4");
+    EXPECT_EQ(responses[3].output, "1\n");
+}
+
+TEST_F(ServeTest, KeepsMultilineOutputInOneResponse) {
+    std::vector<Response> responses = serveRequests("a\tgetSinks\nb\tgetStreams\n");
+
+    ASSERT_EQ(responses.size(), 2u);
+    EXPECT_EQ(responses[0].code, 0);
+    EXPECT_NE(responses[0].output.find("\"name\": \"Speakers\""), std::string::npos);
+    EXPECT_NE(responses[0].output.find("\"name\": \"Headphones\""), std::string::npos);
+    EXPECT_NE(responses[1].output.find("\"destinationId\""), std::string::npos);
+}
+
+TEST(ParseIntegerTest, RejectsPartialAndOutOfRangeNumbers) {
+    long value = 0;
+
+    EXPECT_TRUE(parseInteger("-42", value));
+    EXPECT_EQ(value, -42);
+    EXPECT_FALSE(parseInteger("", value));
+    EXPECT_FALSE(parseInteger("abc", value));
+    EXPECT_FALSE(parseInteger("12abc", value));
+    EXPECT_FALSE(parseInteger("99999999999999999999", value));
+}
+
+TEST_F(ServeTest, ReportsBackendErrorsWithTheRequest) {
+    std::vector<Response> responses = serveRequests("1\tgetVolumeById\tunknown\n2\tgetGlobalVolume\n");
+
+    ASSERT_EQ(responses.size(), 2u);
+    EXPECT_EQ(responses[0].error, "Failed to get volume by ID\n");
+    EXPECT_EQ(responses[1].error, "");
+}
+
+TEST_F(ServeTest, SurvivesInvalidRequests) {
+    std::vector<Response> responses = serveRequests(
+            "1\tunknownCommand\n"
+            "\n"
+            "2\tsetGlobalVolume\tnot-a-number\n"
+            "3\tgetGlobalVolume\r\n");
+
+    ASSERT_EQ(responses.size(), 3u);
+    EXPECT_EQ(responses[0].code, 1);
+    EXPECT_EQ(responses[0].output.rfind("Unknown command: unknownCommand", 0), 0u);
+    EXPECT_EQ(responses[1].code, 1);
+    EXPECT_NE(responses[1].error, "");
+    EXPECT_EQ(responses[2].requestId, "3");
+    EXPECT_EQ(responses[2].code, 0);
+}
+
+TEST_F(ServeTest, RejectsInvalidBatchCountsWithTheUsage) {
+    for (const std::string count : {"two", "2x", "-1"}) {
+        std::istringstream in("getVolumeInfo\tx\n");
+        std::ostringstream out;
+
+        // Run as a one-shot command, where nothing catches the exceptions
+        EXPECT_EQ(runCommand({"vsExec", "batch", count}, in, out), 1);
+        EXPECT_EQ(out.str().rfind("Usage: vsExec", 0), 0u);
+    }
+}
+
+TEST_F(ServeTest, ReturnsTheWholeStatusInOneResponse) {
+    std::vector<Response> responses = serveRequests("1\tgetStatus\n");
+
+    ASSERT_EQ(responses.size(), 1u);
+    const std::string &status = responses[0].output;
+    EXPECT_EQ(responses[0].code, 0);
+    EXPECT_NE(status.find("\"sinks\": ["), std::string::npos);
+    EXPECT_NE(status.find("\"sources\": ["), std::string::npos);
+    EXPECT_NE(status.find("\"streams\": ["), std::string::npos);
+    EXPECT_NE(status.find("\"type\": \"stream\""), std::string::npos);
+    EXPECT_NE(status.find("\"defaultSink\": \"{0.0.0.00000000}.{sink-speakers}\""), std::string::npos);
+    EXPECT_NE(status.find("\"defaultSource\": \"{0.0.1.00000000}.{source-microphone}\""), std::string::npos);
+}
+
+TEST_F(ServeTest, WritesCompactStatusOnOneLine) {
+    std::vector<Response> responses = serveRequests("1\t--compact\tgetStatus\n"
+                                                    "2\t--compact\tbatch\t1\ngetVolumeInfo\tx\n");
+
+    ASSERT_EQ(responses.size(), 2u);
+    const std::string &status = responses[0].output;
+    EXPECT_EQ(responses[0].code, 0);
+    EXPECT_EQ(status.find('\n'), status.size() - 1);
+    EXPECT_EQ(status.rfind("{\"sinks\":[{\"type\":\"sink\",", 0), 0u);
+    // Session IDs keep their backslashes, escaped in the JSON only
+    EXPECT_NE(status.find("\"id\":\"{0.0.0.00000000}.{sink-speakers}|\\\\Device\\\\app.exe%b{stream-1}\""),
+              std::string::npos);
+    EXPECT_EQ(responses[1].output, "[{\"id\":\"x\",\"ok\":false,\"error\":\"Node not found\"}]\n");
+}
+
+TEST_F(ServeTest, AppliesBatchOperationsInOrder) {
+    std::vector<Response> responses = serveRequests(
+            "1\tbatch\t5\n"
+            "setVolume\t{0.0.0.00000000}.{sink-headphones}\t12\n"
+            "getVolumeInfo\t{0.0.0.00000000}.{sink-headphones}\n"
+            "setMuted\t{0.0.1.00000000}.{source-microphone}\t1\n"
+            "setVolume\tunknown\t10\n"
+            "setVolume\t{0.0.0.00000000}.{sink-speakers}\t101\n"
+            "2\tisMutedById\t{0.0.1.00000000}.{source-microphone}\n");
+
+    ASSERT_EQ(responses.size(), 2u);
+    const std::string &results = responses[0].output;
+    EXPECT_EQ(responses[0].code, 0);
+    EXPECT_EQ(responses[0].error, "");
+    EXPECT_NE(results.find("\"ok\": true,\n  \"volume\": 12,\n  \"muted\": false"), std::string::npos);
+    EXPECT_NE(results.find("\"id\": \"unknown\",\n  \"ok\": false,\n  \"error\": \"Node not found\""),
+              std::string::npos);
+    EXPECT_NE(results.find("\"error\": \"Volume must be between 0 and 100\""), std::string::npos);
+    EXPECT_EQ(responses[1].requestId, "2");
+    EXPECT_EQ(responses[1].output, "1\n");
+}
+
+TEST_F(ServeTest, MovesStreamsBetweenSinks) {
+    std::vector<Response> responses = serveRequests(
+            "1\tsetStreamDestination\t{0.0.0.00000000}.{sink-speakers}|\\Device\\app.exe%b{stream-1}\t"
+            "{0.0.0.00000000}.{sink-headphones}\n"
+            "2\tsetStreamDestination\t{0.0.0.00000000}.{sink-speakers}|\\Device\\app.exe%b{stream-1}\tunknown\n"
+            "3\tgetStreams\n");
+
+    ASSERT_EQ(responses.size(), 3u);
+    EXPECT_EQ(responses[0].error, "");
+    EXPECT_EQ(responses[1].error, "Failed to set stream destination\n");
+    EXPECT_NE(responses[2].output.find("\"name\": \"App\",\n  \"volume\": 100,\n  \"muted\": false,\n"
+                                       "  \"isDefault\": false,\n"
+                                       "  \"destinationId\": \"{0.0.0.00000000}.{sink-headphones}\""),
+              std::string::npos);
+}
+
+TEST(ToStringTest, EncodesUtf8) {
+    WCHAR name[] = {L'H', 0xe9, L'l', 0x20ac, 0};
+
+    EXPECT_EQ(toString(name), "H\xc3\xa9l\xe2\x82\xac");
+}
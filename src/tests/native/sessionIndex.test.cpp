@@ -0,0 +1,68 @@
+#include "sessionIndex.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace {
+
+struct FakeSession {
+    int value;
+};
+
+struct ReleaseRecorder {
+    std::vector<int> *released;
+
+    void operator()(FakeSession &session) const {
+        released->push_back(session.value);
+    }
+};
+
+}
+
+TEST(SessionIndexTest, FindsInsertedSessions) {
+    SessionIndex<FakeSession> index;
+    std::vector<int> released;
+    ReleaseRecorder release{&released};
+
+    index.insert(L"a", {1}, release);
+    index.insert(L"b", {2}, release);
+
+    ASSERT_NE(index.find(L"a"), nullptr);
+    EXPECT_EQ(index.find(L"a")->value, 1);
+    EXPECT_EQ(index.find(L"b")->value, 2);
+    EXPECT_EQ(index.find(L"c"), nullptr);
+    EXPECT_EQ(index.size(), 2u);
+    EXPECT_TRUE(released.empty());
+}
+
+TEST(SessionIndexTest, ReleasesReplacedAndErasedSessions) {
+    SessionIndex<FakeSession> index;
+    std::vector<int> released;
+    ReleaseRecorder release{&released};
+
+    index.insert(L"a", {1}, release);
+    index.insert(L"a", {2}, release);
+    EXPECT_EQ(index.find(L"a")->value, 2);
+    EXPECT_EQ(released, std::vector<int>({1}));
+
+    index.erase(L"a", release);
+    index.erase(L"missing", release);
+    EXPECT_EQ(index.find(L"a"), nullptr);
+    EXPECT_EQ(released, std::vector<int>({1, 2}));
+}
+
+TEST(SessionIndexTest, ClearReleasesEverythingAndResetsBuilt) {
+    SessionIndex<FakeSession> index;
+    std::vector<int> released;
+    ReleaseRecorder release{&released};
+
+    EXPECT_FALSE(index.isBuilt());
+    index.insert(L"a", {1}, release);
+    index.insert(L"b", {2}, release);
+    index.markBuilt();
+    EXPECT_TRUE(index.isBuilt());
+
+    index.clear(release);
+    EXPECT_FALSE(index.isBuilt());
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_EQ(released.size(), 2u);
+}
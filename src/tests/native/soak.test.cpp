@@ -0,0 +1,101 @@
+#include "audio.h"
+#include "commands.h"
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+// Long-running helpers (serve, watch, the addon) enumerate for hours: a leak of a few strings per enumeration shows up
+// as a resident set growing with the iterations. VS_SOAK_ITERATIONS changes the number of enumerations.
+
+namespace {
+
+long getIterations(long defaultIterations) {
+    const char *value = std::getenv("VS_SOAK_ITERATIONS");
+    return value == nullptr ? defaultIterations : std::strtol(value, nullptr, 10);
+}
+
+// Resident set in kB, 0 when it can't be read
+long getResidentKb() {
+    std::ifstream statm("/proc/self/statm");
+    long size = 0;
+    long resident = 0;
+    if (!(statm >> size >> resident)) return 0;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Run the function once to reach the steady state, then the given times, and give the resident set growth in kB
+template<typename Fn>
+long getResidentGrowthKb(long iterations, Fn fn) {
+    for (long i = 0; i < 1000; i++) {
+        fn();
+    }
+
+    long before = getResidentKb();
+    for (long i = 0; i < iterations; i++) {
+        fn();
+    }
+    return getResidentKb() - before;
+}
+
+}
+
+class SoakTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+#ifdef __SANITIZE_ADDRESS__
+        GTEST_SKIP() << "AddressSanitizer holds the freed memory back, the resident set grows anyway";
+#endif
+        if (getResidentKb() == 0) GTEST_SKIP() << "The resident set size can't be read on this platform";
+        initialize();
+    }
+
+    void TearDown() override {
+        uninitialize();
+    }
+};
+
+TEST_F(SoakTest, KeepsTheResidentSetFlatOverAMillionEnumerations) {
+    long growth = getResidentGrowthKb(getIterations(1000000), []() {
+        VsStatus status;
+        getStatus(&status);
+
+        std::vector<VsNode> streams;
+        StringArena strings;
+        getStreams(&streams, strings);
+    });
+
+    // A single string leaked per enumeration would be tens of MB
+    EXPECT_LT(growth, 1024);
+}
+
+TEST_F(SoakTest, KeepsTheResidentSetFlatWhenReusingTheStatus) {
+    VsStatus status;
+    long growth = getResidentGrowthKb(getIterations(1000000), [&status]() {
+        getStatus(&status);
+        clearVsStatus(status);
+    });
+
+    EXPECT_LT(growth, 1024);
+}
+
+TEST_F(SoakTest, KeepsTheResidentSetFlatOverCommandsAndEvents) {
+    std::wstring speakers = L"{0.0.0.00000000}.{sink-speakers}";
+    std::vector<std::string> args = {"vsExec", "--compact", "getStatus"};
+    std::istringstream in;
+    ASSERT_TRUE(startWatch());
+
+    long growth = getResidentGrowthKb(getIterations(1000000) / 10, [&]() {
+        std::ostringstream out;
+        runCommand(args, in, out);
+
+        setVolumeById(&speakers[0], 40);
+        std::vector<VsEvent> events;
+        waitForEvents(events, 0);
+        clearVsEvents(events);
+    });
+    stopWatch();
+
+    EXPECT_LT(growth, 1024);
+}
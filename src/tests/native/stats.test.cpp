@@ -0,0 +1,66 @@
+#include "stats.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+TEST(StatsTest, TimersOnlyCountOnceEnabled) {
+    resetStats();
+    {
+        StatTimer timer(VsStat::Devices);
+    }
+
+    std::ostringstream disabled;
+    printStats(disabled);
+    EXPECT_NE(disabled.str().find("\"devices\":{\"calls\":0,\"us\":0}"), std::string::npos);
+
+    enableStats();
+    EXPECT_TRUE(areStatsEnabled());
+    {
+        StatTimer timer(VsStat::Devices);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    std::ostringstream enabled;
+    printStats(enabled);
+    EXPECT_NE(enabled.str().find("\"devices\":{\"calls\":1,\"us\":"), std::string::npos);
+    EXPECT_EQ(enabled.str().find("\"devices\":{\"calls\":1,\"us\":0}"), std::string::npos);
+}
+
+TEST(StatsTest, PrintsEveryPhaseOnOneLine) {
+    resetStats();
+    addStat(VsStat::Initialize, std::chrono::microseconds(1500));
+    addStat(VsStat::ProcessName, std::chrono::microseconds(20));
+    addStat(VsStat::ProcessName, std::chrono::microseconds(30));
+
+    std::ostringstream out;
+    printStats(out);
+    EXPECT_EQ(out.str(), "{\"stats\":{"
+                         "\"initialize\":{\"calls\":1,\"us\":1500},"
+                         "\"enumerator\":{\"calls\":0,\"us\":0},"
+                         "\"devices\":{\"calls\":0,\"us\":0},"
+                         "\"sessions\":{\"calls\":0,\"us\":0},"
+                         "\"processName\":{\"calls\":2,\"us\":50},"
+                         "\"output\":{\"calls\":0,\"us\":0}}}\n");
+}
+
+TEST(StatsTest, CountsTheTimersOfEveryThread) {
+    resetStats();
+    enableStats();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([]() {
+            for (int j = 0; j < 1000; j++) {
+                StatTimer timer(VsStat::Sessions);
+            }
+        });
+    }
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    std::ostringstream out;
+    printStats(out);
+    EXPECT_NE(out.str().find("\"sessions\":{\"calls\":4000,"), std::string::npos);
+}
@@ -0,0 +1,47 @@
+#include "stringArena.h"
+#include <gtest/gtest.h>
+
+TEST(StringArenaTest, CopiesTheStrings) {
+    StringArena strings(8);
+    std::wstring name = L"Speakers";
+
+    wchar_t *id = strings.copy(L"sink-0");
+    wchar_t *copy = strings.copy(name);
+    name[0] = L'X';
+
+    EXPECT_STREQ(id, L"sink-0");
+    EXPECT_STREQ(copy, L"Speakers");
+    EXPECT_STREQ(strings.copy(L"", 0), L"");
+    EXPECT_EQ(strings.copy((const wchar_t *) nullptr), nullptr);
+}
+
+TEST(StringArenaTest, GivesLongStringsABlockOfTheirOwn) {
+    StringArena strings(8);
+    std::wstring longId(100, L'a');
+
+    wchar_t *first = strings.copy(L"ab");
+    wchar_t *second = strings.copy(longId);
+    wchar_t *third = strings.copy(L"cd");
+
+    EXPECT_STREQ(first, L"ab");
+    EXPECT_EQ(std::wstring(second), longId);
+    EXPECT_STREQ(third, L"cd");
+    EXPECT_EQ(strings.getCapacity(), 8u + 101u + 8u);
+}
+
+TEST(StringArenaTest, KeepsItsCapacityForTheNextEnumeration) {
+    StringArena strings(16);
+    for (int i = 0; i < 100; i++) {
+        strings.copy(L"{0.0.0.00000000}.{sink-" + std::to_wstring(i) + L"}");
+    }
+    size_t capacity = strings.getCapacity();
+
+    strings.clear();
+    EXPECT_EQ(strings.getCapacity(), capacity);
+
+    // The same strings fit in the merged block
+    for (int i = 0; i < 100; i++) {
+        strings.copy(L"{0.0.0.00000000}.{sink-" + std::to_wstring(i) + L"}");
+    }
+    EXPECT_EQ(strings.getCapacity(), capacity);
+}
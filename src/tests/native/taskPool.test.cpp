@@ -0,0 +1,77 @@
+#include "taskPool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+TEST(TaskPoolTest, RunsEveryTaskOnce) {
+    TaskPool pool(4);
+    std::vector<std::atomic<int>> runs(100);
+
+    for (int round = 0; round < 10; round++) {
+        pool.run(runs.size(), [&runs](size_t i) { runs[i]++; });
+    }
+
+    for (std::atomic<int> &count: runs) {
+        EXPECT_EQ(count, 10);
+    }
+}
+
+TEST(TaskPoolTest, RunsTheTasksAtTheSameTime) {
+    TaskPool pool(4);
+    std::atomic<int> running{0};
+    std::atomic<int> maxRunning{0};
+
+    pool.run(8, [&running, &maxRunning](size_t) {
+        int now = ++running;
+        int max = maxRunning;
+        while (now > max && !maxRunning.compare_exchange_weak(max, now)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        running--;
+    });
+
+    EXPECT_GT(maxRunning, 1);
+    EXPECT_LE(maxRunning, 4);
+}
+
+TEST(TaskPoolTest, RunsOnTheCallingThreadAlone) {
+    TaskPool pool(1);
+    std::set<std::thread::id> threads;
+
+    pool.run(4, [&threads](size_t) { threads.insert(std::this_thread::get_id()); });
+
+    ASSERT_EQ(threads.size(), 1u);
+    EXPECT_EQ(*threads.begin(), std::this_thread::get_id());
+}
+
+TEST(TaskPoolTest, InitializesEachWorkerOnce) {
+    std::atomic<int> initialized{0};
+    {
+        TaskPool pool(3, [&initialized] { initialized++; });
+        for (int round = 0; round < 5; round++) {
+            pool.run(6, [](size_t) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+        }
+    }
+
+    // The calling thread is prepared by the caller
+    EXPECT_EQ(initialized, 2);
+}
+
+TEST(TaskPoolTest, KeepsTheErrorsOfConcurrentTasks) {
+    TaskPool pool(4);
+    std::ostringstream errors;
+    std::streambuf *cerrBuffer = std::cerr.rdbuf(errors.rdbuf());
+
+    pool.run(40, [](size_t) { std::cerr << "Failed to get device" << std::endl; });
+
+    std::cerr.rdbuf(cerrBuffer);
+    std::string line;
+    int lines = 0;
+    for (std::istringstream in(errors.str()); std::getline(in, line); lines++) {
+        EXPECT_EQ(line, "Failed to get device");
+    }
+    EXPECT_EQ(lines, 40);
+}
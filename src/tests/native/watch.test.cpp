@@ -0,0 +1,76 @@
+#include "audio.h"
+#include "watch.h"
+#include <gtest/gtest.h>
+#include <sstream>
+
+class WatchTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        initialize();
+    }
+
+    void TearDown() override {
+        uninitialize();
+    }
+};
+
+TEST_F(WatchTest, QueuesChangesMadeWhileWatching) {
+    std::wstring speakersW = L"{0.0.0.00000000}.{sink-speakers}";
+    std::wstring microphoneW = L"{0.0.1.00000000}.{source-microphone}";
+    LPWSTR_FROM_WSTRING(speakers, speakersW);
+    LPWSTR_FROM_WSTRING(microphone, microphoneW);
+
+    setVolumeById(speakers, 10);
+    ASSERT_TRUE(startWatch());
+    setVolumeById(speakers, 20);
+    setMutedById(microphone, true);
+
+    std::vector<VsEvent> events;
+    ASSERT_TRUE(waitForEvents(events, 0));
+    stopWatch();
+
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0].type, VsEventType::Changed);
+    EXPECT_STREQ(events[0].nodeType, "sink");
+    EXPECT_EQ(std::wstring(events[0].node.id), speakersW);
+    EXPECT_EQ(events[0].node.volume, 20);
+    EXPECT_TRUE(events[0].node.isDefault);
+    EXPECT_STREQ(events[1].nodeType, "source");
+    EXPECT_TRUE(events[1].node.muted);
+
+    clearVsEvents(events);
+    delete[] speakers;
+    delete[] microphone;
+}
+
+TEST_F(WatchTest, PrintsOneEventPerLine) {
+    std::wstring idW = L"{0.0.0.00000000}.{sink-headphones}";
+    std::wstring nameW = L"Headphones";
+    LPWSTR_FROM_WSTRING(id, idW);
+    LPWSTR_FROM_WSTRING(name, nameW);
+
+    std::ostringstream out;
+    VsEvent changed = {VsEventType::Changed, "sink", {id, name, 30, true, false, nullptr}};
+    VsEvent removed = {VsEventType::Removed, "sink", {id, nullptr, 0, false, false, nullptr}};
+    VsEvent noDefault = {VsEventType::DefaultChanged, "source", {nullptr, nullptr, 0, false, false, nullptr}};
+    printVsEvent(out, changed);
+    printVsEvent(out, removed);
+    printVsEvent(out, noDefault);
+
+    EXPECT_EQ(out.str(),
+              "{\"event\": \"changed\", \"node\": {\"type\": \"sink\", \"id\": \"{0.0.0.00000000}.{sink-headphones}\", "
+              "\"name\": \"Headphones\", \"volume\": 30, \"muted\": true, \"isDefault\": false}}\n"
+              "{\"event\": \"removed\", \"type\": \"sink\", \"id\": \"{0.0.0.00000000}.{sink-headphones}\"}\n"
+              "{\"event\": \"defaultChanged\", \"type\": \"source\"}\n");
+
+    delete[] id;
+    delete[] name;
+}
+
+TEST_F(WatchTest, StopsWhenTheInputIsClosed) {
+    std::istringstream in("");
+    std::ostringstream out;
+
+    EXPECT_EQ(watch(in, out), 0);
+    EXPECT_EQ(out.str(), "");
+}
@@ -84,6 +84,69 @@ describe('Volume status test', () => {
     await testControlOnNode(sources[0]);
   });
 
+  it('should apply a batch of operations on a sink', async () => {
+    if (!doTestStatus || !volumeControl.getPlatformCompatibility().listSinks || !volumeControl.getPlatformCompatibility().setSinkVolume) return;
+    const status = await volumeControl.getStatus();
+    const sink = status.sinks[0];
+
+    expect(sink).toBeDefined(); // Please have a sink before running this test
+
+    const newVolume = 20 == sink.volume ? 50 : 20;
+    const results = await volumeControl.applyBatch([
+      { op: 'setVolume', id: sink.id, volume: newVolume },
+      { op: 'getVolumeInfo', id: sink.id },
+      { op: 'setVolume', id: 'unknown-node', volume: 10 },
+      { op: 'setVolume', id: sink.id, volume: sink.volume },
+    ]);
+
+    expect(results.map(result => result.ok)).toEqual([true, true, false, true]);
+    expect(results[1].volume).toBe(newVolume);
+    expect((await volumeControl.getNodeVolumeInfoById(sink.id)).volume).toBe(sink.volume);
+  });
+
+  it('should ramp the volume of a sink', async () => {
+    if (!doTestStatus || !volumeControl.getPlatformCompatibility().listSinks || !volumeControl.getPlatformCompatibility().setSinkVolume) return;
+    const status = await volumeControl.getStatus();
+    const sink = status.sinks[0];
+
+    expect(sink).toBeDefined(); // Please have a sink before running this test
+
+    // The first ramp is replaced by the second one before its end
+    const newVolume = 20 == sink.volume ? 50 : 20;
+    const replaced = volumeControl.rampNodeVolume(sink.id, 100, 2000);
+    const result = await volumeControl.rampNodeVolume(sink.id, newVolume, 200, 'db');
+
+    expect((await replaced).completed).toBe(false);
+    expect(result.completed).toBe(true);
+    expect(result.volume).toBe(newVolume);
+    expect(result.jitterHistogram.reduce((steps, bucket) => steps + bucket.steps, 0)).toBe(result.steps);
+    expect((await volumeControl.getNodeVolumeInfoById(sink.id)).volume).toBe(newVolume);
+
+    await volumeControl.setNodeVolumeById(sink.id, sink.volume);
+  });
+
+  it('should meter the levels of the nodes', async () => {
+    if (!doTestStatus || !volumeControl.getPlatformCompatibility().levels) return;
+    const status = await volumeControl.getStatus();
+
+    const levels = await volumeControl.getLevels(200);
+    expect(levels.length).toBeGreaterThan(0);
+    expect(levels.every((level) => level.peak >= 0 && level.peak <= 1)).toBe(true);
+    const sinkIds = status.sinks.map((sink) => sink.id);
+    expect(levels.some((level) => level.type === 'sink' && sinkIds.includes(level.id))).toBe(true);
+
+    // A single helper process for every node, one call per tick
+    const ticks = await new Promise<number>((resolve) => {
+      let count = 0;
+      const unwatch = volumeControl.watchLevels(() => count++, 50);
+      setTimeout(() => {
+        unwatch();
+        resolve(count);
+      }, 1000);
+    });
+    expect(ticks).toBeGreaterThan(10);
+  });
+
   afterAll(async () => {
     await volumeControl.setGlobalMuted(oldMuted);
   });
@@ -0,0 +1,107 @@
+import { VsNodeTypes } from '@/types';
+import { ListedNode, NodeTypeCache } from '@/utils/nodeTypeCache';
+
+describe('Node type cache test', () => {
+  let listings: Record<string, ListedNode[]>;
+  let listed: VsNodeTypes[];
+  let cache: NodeTypeCache;
+
+  beforeEach(() => {
+    listings = { sink: [{ id: '1' }], source: [{ id: '1' }, { id: '2' }], stream: [{ id: '7' }] };
+    listed = [];
+    cache = new NodeTypeCache(['sink', 'source', 'stream'], async (type) => {
+      listed.push(type);
+      return listings[type];
+    });
+  });
+
+  it('should list the types once, then resolve from the cache', async () => {
+    expect(await cache.resolve('7')).toEqual({ type: 'stream' });
+    expect(await cache.resolve('2')).toEqual({ type: 'source' });
+    // Shared by a sink and a source, the sink comes first
+    expect(await cache.resolve('1')).toEqual({ type: 'sink' });
+
+    expect(listed).toEqual(['sink', 'source', 'stream']);
+    expect(cache.getStats()).toEqual({ hits: 2, misses: 1 });
+  });
+
+  it('should list the types again on a miss', async () => {
+    cache.fill('sink', [{ id: '1', name: 'Speakers' }]);
+    cache.fill('source', []);
+    cache.fill('stream', []);
+    expect(await cache.resolve('1')).toEqual({ type: 'sink', name: 'Speakers' });
+
+    expect(await cache.resolve('7')).toEqual({ type: 'stream' });
+    expect(await cache.resolve('8')).toBeNull();
+    expect(listed.length).toBe(6);
+  });
+
+  it('should not trust the types after an invalidated one', async () => {
+    cache.fill('sink', []);
+    cache.fill('source', [{ id: '1' }]);
+    cache.fill('stream', []);
+    cache.invalidate('sink');
+
+    expect(cache.get('1')).toBeUndefined();
+    expect(await cache.resolve('1')).toEqual({ type: 'sink' });
+  });
+
+  it('should resolve again once when the cached type fails', async () => {
+    cache.fill('sink', []);
+    cache.fill('source', []);
+    cache.fill('stream', [{ id: '1' }]);
+
+    const types: VsNodeTypes[] = [];
+    const result = await cache.run('1', async (type) => {
+      types.push(type);
+      if (type === 'stream') throw new Error('No such entity');
+      return type;
+    });
+
+    expect(types).toEqual(['stream', 'sink']);
+    expect(result).toBe('sink');
+  });
+
+  it('should only list the failed type again when the node isn\'t found', async () => {
+    cache.fill('sink', []);
+    cache.fill('source', [{ id: '2' }]);
+    // The source was removed, its ID reused by a stream already listed
+    cache.fill('stream', [{ id: '2' }]);
+    listings.source = [];
+
+    const types: VsNodeTypes[] = [];
+    const result = await cache.run('2', async (type) => {
+      types.push(type);
+      if (type === 'source') throw new Error('Failure: No such entity');
+      return type;
+    });
+
+    expect(result).toBe('stream');
+    expect(types).toEqual(['source', 'stream']);
+    expect(listed).toEqual(['source']);
+  });
+
+  it('should throw the other errors as is, without listing anything', async () => {
+    cache.fill('sink', [{ id: '1' }]);
+    cache.fill('source', []);
+    cache.fill('stream', []);
+    const error = new Error('Volume must be between 0 and 100');
+
+    await expect(cache.run('1', () => Promise.reject(error))).rejects.toBe(error);
+    expect(listed).toEqual([]);
+    expect(cache.get('1')).toEqual({ type: 'sink' });
+  });
+
+  it('should throw the original error when the node is found nowhere', async () => {
+    cache.fill('sink', [{ id: '9' }]);
+    cache.fill('source', []);
+    cache.fill('stream', []);
+    listings.sink = [];
+    listings.source = [];
+    listings.stream = [];
+
+    await expect(cache.run('9', () => Promise.reject('Failure: No such entity')))
+      .rejects.toBe('Failure: No such entity');
+    expect(listed.sort()).toEqual(['sink', 'sink', 'source', 'stream']);
+  });
+});
@@ -0,0 +1,43 @@
+import { fromPactlDevices, fromPactlSinkInputs, getPactlVolume, isPactlFormatUnsupported } from '@/utils/pactlJson';
+
+describe('pactl JSON output test', () => {
+  const volume = (...percents: number[]) => Object.fromEntries(
+    percents.map((percent, i) => [`channel-${i}`, { value_percent: `${percent}%` }]),
+  );
+
+  it('should average the channel volumes', () => {
+    expect(getPactlVolume(volume(40, 45))).toBe(43);
+    expect(getPactlVolume(volume(100))).toBe(100);
+    expect(getPactlVolume({})).toBe(0);
+  });
+
+  it('should convert the devices and mark the default one', () => {
+    const sinks = fromPactlDevices('sink', [
+      { index: 1, name: 'null', description: 'Null Output', mute: true, volume: volume(40, 40) },
+      { index: 2, name: 'hdmi', mute: false, volume: volume(80, 80) },
+    ], 'hdmi');
+
+    expect(sinks).toEqual([
+      { type: 'sink', id: '1', name: 'Null Output', volume: 40, muted: true, isDefault: false },
+      { type: 'sink', id: '2', name: 'hdmi', volume: 80, muted: false, isDefault: true },
+    ]);
+  });
+
+  it('should convert the sink inputs with their destination', () => {
+    const streams = fromPactlSinkInputs([
+      { index: 7, sink: 1, mute: false, volume: volume(50, 50), properties: { 'application.name': 'Firefox' } },
+      { index: 8, sink: 2, mute: true, volume: volume(20, 20), properties: { 'media.name': 'Sine' } },
+    ]);
+
+    expect(streams).toEqual([
+      { type: 'stream', id: '7', name: 'Firefox', volume: 50, muted: false, isDefault: false, destinationId: '1' },
+      { type: 'stream', id: '8', name: 'Sine', volume: 20, muted: true, isDefault: false, destinationId: '2' },
+    ]);
+  });
+
+  it('should recognize a pactl without the format option', () => {
+    expect(isPactlFormatUnsupported("pactl: invalid option -- 'f'")).toBe(true);
+    expect(isPactlFormatUnsupported("pactl: unrecognized option '--format'")).toBe(true);
+    expect(isPactlFormatUnsupported('Connection failure: Connection refused')).toBe(false);
+  });
+});
@@ -0,0 +1,43 @@
+import { createReplayExecutor, FIXTURE_SIZES, loadFixture } from '@/benchmarks/fixtures';
+import { Status } from '@/types';
+import { setCommandExecutor } from '@/utils/commands';
+import { getJsonStatus, getTextStatus } from '@/platforms/linux/pulseaudio';
+import { linuxWireplumber } from '@/platforms/linux/wireplumber';
+import { linuxAmixer } from '@/platforms/linux/amixer';
+import { windowsExec } from '@/platforms/windows';
+
+// The status of every backend from the recorded outputs, without any audio system
+describe('Fixture replay test', () => {
+  afterEach(() => setCommandExecutor(null));
+
+  for (const size of FIXTURE_SIZES) {
+    it(`should read the status of every backend from ${size} replayed nodes`, async () => {
+      const fixture = loadFixture(size);
+      setCommandExecutor(createReplayExecutor(fixture));
+
+      const expectStatus = (status: Status) => {
+        expect(status.sinks.length).toBe(fixture.counts.sinks);
+        expect(status.sources.length).toBe(fixture.counts.sources);
+        expect(status.streams.length).toBe(fixture.counts.streams);
+        expect(status.defaultSink).toBe(status.sinks[0].id);
+        expect(status.defaultSource).toBe(status.sources[0].id);
+        expect(status.sinks.filter((sink) => sink.isDefault).length).toBe(1);
+      };
+
+      const jsonStatus = await getJsonStatus();
+      expectStatus(jsonStatus);
+      expectStatus(await getTextStatus());
+      expectStatus(await linuxWireplumber.getStatus());
+      expectStatus(await windowsExec.getStatus());
+      const sinkIds = new Set(jsonStatus.sinks.map((sink) => sink.id));
+      expect(jsonStatus.streams.every((stream) => sinkIds.has(stream.destinationId))).toBe(true);
+      expect(await linuxAmixer.getGlobalVolume()).toBe(40);
+    });
+  }
+
+  it('should fail the commands without a recorded output', async () => {
+    setCommandExecutor(createReplayExecutor(loadFixture(5)));
+
+    await expect(linuxAmixer.setGlobalVolume(20)).rejects.toBe('No recorded output for: amixer set Master 20%');
+  });
+});
@@ -0,0 +1,173 @@
+import {
+  PlatformCompatibility,
+  PlatformImplementation,
+  Status,
+  VsEvent,
+  VsStreamNode,
+  WatchListener,
+  WatchOptions,
+} from '@/types';
+import { StatusCache } from '@/utils/statusCache';
+
+describe('Status cache test', () => {
+  let status: Status;
+  let calls: string[];
+  let emit: WatchListener;
+  let watchEvents: boolean;
+  let watches: (WatchOptions | undefined)[];
+  let cache: StatusCache;
+  let volumeControl: PlatformImplementation;
+
+  const tick = () => new Promise((resolve) => setTimeout(resolve, 10));
+
+  beforeEach(() => {
+    status = {
+      sinks: [{ type: 'sink', id: '1', name: 'Speakers', volume: 40, muted: false, isDefault: true }],
+      sources: [{ type: 'source', id: '1', name: 'Microphone', volume: 60, muted: false, isDefault: true }],
+      streams: [{ type: 'stream', id: '7', name: 'Firefox', volume: 50, muted: false, isDefault: false }],
+      defaultSink: '1',
+      defaultSource: '1',
+    };
+    calls = [];
+    watchEvents = false;
+    watches = [];
+
+    const backend = {
+      getPlatformCompatibility: () => ({ watch: true, watchEvents }) as PlatformCompatibility,
+      getStatus: async () => {
+        calls.push('getStatus');
+        await tick();
+        return structuredClone(status);
+      },
+      getNodeVolumeInfoById: async (id: string) => {
+        calls.push(`getNodeVolumeInfoById ${id}`);
+        await tick();
+        const node = [...status.sinks, ...status.sources, ...status.streams].find((node) => node.id === id);
+        return { volume: node.volume, muted: node.muted };
+      },
+      setNodeVolumeById: async (id: string, volume: number) => {
+        calls.push(`setNodeVolumeById ${id}`);
+        status.streams.find((node) => node.id === id).volume = volume;
+      },
+      setStreamDestination: async (id: string, destinationId: string) => {
+        calls.push(`setStreamDestination ${id}`);
+        status.streams.find((node) => node.id === id).destinationId = destinationId;
+      },
+      setGlobalVolume: async (volume: number) => {
+        calls.push('setGlobalVolume');
+        status.sinks[0].volume = volume;
+      },
+      watch: (listener: WatchListener, options?: WatchOptions) => {
+        emit = listener;
+        watches.push(options);
+        return () => {};
+      },
+    } as PlatformImplementation;
+    cache = new StatusCache(backend, 1000);
+    volumeControl = cache.implementation;
+  });
+
+  it('should share the concurrent reads', async () => {
+    const [first, second] = await Promise.all([volumeControl.getStatus(), volumeControl.getStatus()]);
+    const volumes = await Promise.all(['7', '7'].map((id) => volumeControl.getNodeVolumeInfoById(id)));
+
+    expect(first).toEqual(status);
+    expect(second).toEqual(status);
+    expect(volumes).toEqual([{ volume: 50, muted: false }, { volume: 50, muted: false }]);
+    expect(calls).toEqual(['getStatus']);
+    expect(cache.getStats()).toEqual({ hits: 2, misses: 1, shared: 1 });
+  });
+
+  it('should answer the node reads from the status, in the order of the types', async () => {
+    await volumeControl.getStatus();
+
+    expect(await volumeControl.getNodeVolumeInfoById('1')).toEqual({ volume: 40, muted: false });
+    expect(calls).toEqual(['getStatus']);
+  });
+
+  it('should read again once the status is too old', async () => {
+    cache.setMaxAge(0);
+    await volumeControl.getStatus();
+    await tick();
+    await volumeControl.getNodeVolumeInfoById('7');
+
+    expect(calls).toEqual(['getStatus', 'getNodeVolumeInfoById 7']);
+  });
+
+  it('should update the status after a write', async () => {
+    await volumeControl.getStatus();
+    await volumeControl.setNodeVolumeById('7', 80);
+
+    expect(await volumeControl.getNodeVolumeInfoById('7')).toEqual({ volume: 80, muted: false });
+    expect((await volumeControl.getStatus()).streams[0].volume).toBe(80);
+    expect(calls).toEqual(['getStatus', 'setNodeVolumeById 7']);
+
+    // The global volume may not be the volume of a node, the status is read again
+    await volumeControl.setGlobalVolume(10);
+    expect((await volumeControl.getStatus()).sinks[0].volume).toBe(10);
+    expect(calls.at(-1)).toBe('getStatus');
+  });
+
+  it('should only set the destination of the stream sharing its ID with a sink', async () => {
+    const stream = { type: 'stream', id: '1', name: 'mpv', volume: 100, muted: false, isDefault: false } as const;
+    status.streams.push({ ...stream, destinationId: '1' });
+    await volumeControl.getStatus();
+    await volumeControl.setStreamDestination('1', '2');
+
+    const cached = await volumeControl.getStatus();
+    expect(cached.streams.find((node) => node.id === '1').destinationId).toBe('2');
+    expect((cached.sinks[0] as VsStreamNode).destinationId).toBeUndefined();
+    expect(calls).toEqual(['getStatus', 'setStreamDestination 1']);
+  });
+
+  it('should not share a read started before a write', async () => {
+    const before = volumeControl.getStatus();
+    await volumeControl.setNodeVolumeById('7', 80);
+    const after = volumeControl.getStatus();
+
+    expect((await after).streams[0].volume).toBe(80);
+    await before;
+    expect(calls.filter((call) => call === 'getStatus').length).toBe(2);
+  });
+
+  it('should apply the events of the watches', async () => {
+    const events: VsEvent[] = [];
+    volumeControl.watch((event) => events.push(event));
+    await volumeControl.getStatus();
+
+    emit({ event: 'changed', node: { ...status.streams[0], volume: 30 } });
+    const added = { type: 'stream', id: '8', name: 'mpv', volume: 100, muted: true, isDefault: false } as const;
+    emit({ event: 'added', node: added });
+    emit({ event: 'removed', type: 'source', id: '1' });
+
+    const cached = await volumeControl.getStatus();
+    expect(cached.streams.map((node) => [node.id, node.volume])).toEqual([['7', 30], ['8', 100]]);
+    expect(cached.sources).toEqual([]);
+    expect(await volumeControl.getNodeVolumeInfoById('1')).toEqual({ volume: 40, muted: false });
+    expect(events.length).toBe(3);
+    expect(calls).toEqual(['getStatus']);
+  });
+
+  it('should watch the backend in the background, and read again after its events', async () => {
+    watchEvents = true;
+    await volumeControl.getStatus();
+    await volumeControl.getNodeVolumeInfoById('7');
+    expect(watches).toEqual([{ keepAlive: false }]);
+
+    // Changed by another application
+    status.streams[0].volume = 20;
+    emit({ event: 'changed', node: { ...status.streams[0] } });
+
+    expect(await volumeControl.getNodeVolumeInfoById('7')).toEqual({ volume: 20, muted: false });
+    expect(calls).toEqual(['getStatus', 'getNodeVolumeInfoById 7']);
+    expect(watches.length).toBe(1);
+  });
+
+  it('should not start a polling watch of the backend', async () => {
+    await volumeControl.getStatus();
+    await volumeControl.getNodeVolumeInfoById('7');
+
+    expect(watches).toEqual([]);
+    expect(calls).toEqual(['getStatus']);
+  });
+});
@@ -0,0 +1,194 @@
+import { VsEvent } from '@/types';
+import { CommandExecutor, execCommand, setCommandExecutor } from '@/utils/commands';
+import { CompatibilityError } from '@/utils/errors';
+import { getProcessStarts } from '@/utils/metrics';
+import { VsExecCapabilities } from '@/utils/vsExecCapabilities';
+import { windowsExec } from '@/platforms/windows';
+
+// Usage and outputs of the vsExec.exe shipped before getStatus, batch, ramp, levels, watch and serve
+const OLD_USAGE = [
+  'Usage: vsExec.exe [command] [args...]',
+  '',
+  'Commands:',
+  '  getGlobalVolume - Get the global volume',
+  '  getSinks - Get the sinks',
+  '  getSources - Get the sources',
+  '  getStreams - Get the streams',
+  '  getVolumeById [id] - Get the volume of a device by its ID',
+  '  setVolumeById [id] [volume] - Set the volume of a device by its ID, volume must be between 0 and 100',
+  '  isMutedById [id] - Check if a device by its ID is muted',
+  '  setMutedById [id] [mute] - Set the mute of a device by its ID, mute must be 1 or 0',
+].join('\n') + '\n';
+
+const OLD_OUTPUTS: Record<string, string> = {
+  getSources: JSON.stringify([
+    { type: 'source', id: 'mic', name: 'Mic', volume: 80, muted: true, isDefault: true },
+  ]),
+  getStreams: JSON.stringify([
+    { type: 'stream', id: '1234', name: 'Player', volume: 100, muted: false, destinationId: 'speakers' },
+  ]),
+};
+
+describe('vsExec capabilities test', () => {
+  let calls: string[];
+  let volumes: Map<string, { volume: number, muted: boolean }>;
+
+  const oldVsExec: CommandExecutor = async (cmd, args, { ignoreExitCode }) => {
+    calls.push(args.join(' '));
+    const [command, id, value] = args;
+    const node = volumes.get(id);
+
+    if (args.length === 0 && ignoreExitCode) return OLD_USAGE;
+    if (command === 'getSinks') {
+      const speakers = volumes.get('speakers');
+      return JSON.stringify([{ type: 'sink', id: 'speakers', name: 'Speakers', ...speakers, isDefault: true }]);
+    }
+    if (command in OLD_OUTPUTS) return OLD_OUTPUTS[command];
+    if (command === 'getVolumeById') return `${node?.volume ?? -1}\n`;
+    if (command === 'isMutedById') return node ? `${node.muted ? 1 : 0}\n` : '-1\n';
+    if (command === 'setVolumeById' && node) {
+      node.volume = Number(value);
+      return '';
+    }
+    if (command === 'setMutedById' && node) {
+      node.muted = value === '1';
+      return '';
+    }
+    throw `Command failed: ${cmd} ${args.join(' ')}\n`;
+  };
+
+  beforeEach(() => {
+    calls = [];
+    volumes = new Map([['speakers', { volume: 40, muted: false }], ['mic', { volume: 80, muted: true }]]);
+    jest.spyOn(console, 'error').mockImplementation(() => undefined);
+  });
+
+  afterEach(() => {
+    setCommandExecutor(null);
+    jest.restoreAllMocks();
+  });
+
+  it('should read the commands from the usage, once', async () => {
+    setCommandExecutor(oldVsExec);
+    const capabilities = new VsExecCapabilities('vsExec.exe');
+
+    expect(capabilities.isMissing('getStatus')).toBe(false);
+    expect(await capabilities.supports('getSinks')).toBe(true);
+    expect(await capabilities.supports('getStatus')).toBe(false);
+    expect(capabilities.isMissing('getStatus')).toBe(true);
+    expect(calls).toEqual(['']);
+  });
+
+  it('should tell the commands known to be supported once the usage is read in the background', async () => {
+    setCommandExecutor(oldVsExec);
+    const capabilities = new VsExecCapabilities('vsExec.exe');
+
+    expect(capabilities.has('getSinks')).toBe(false);
+    await capabilities.supports('getSinks');
+    expect(capabilities.has('getSinks')).toBe(true);
+    expect(capabilities.has('watch')).toBe(false);
+    expect(calls).toEqual(['']);
+  });
+
+  it('should fall back only when the command is missing, and rethrow the errors of the others', async () => {
+    setCommandExecutor(oldVsExec);
+    const capabilities = new VsExecCapabilities('vsExec.exe');
+    const fail = (message: string) => () => Promise.reject(new Error(message));
+
+    expect(await capabilities.run('getStatus', fail('Unknown command'), async () => 'fallback')).toBe('fallback');
+    await expect(capabilities.run('getSinks', fail('Access denied'), async () => 'fallback'))
+      .rejects.toThrow('Access denied');
+    // Known to be missing, not tried again
+    expect(await capabilities.run('getStatus', fail('Unknown command'), async () => 'fallback')).toBe('fallback');
+    expect(calls).toEqual(['']);
+  });
+
+  it('should rethrow the errors when the usage can\'t be read', async () => {
+    setCommandExecutor(async () => {
+      throw 'spawn vsExec.exe ENOENT';
+    });
+    const capabilities = new VsExecCapabilities('vsExec.exe');
+
+    await expect(capabilities.run('getStatus', () => Promise.reject(new Error('Missing')), async () => 'fallback'))
+      .rejects.toThrow('Missing');
+    expect(capabilities.isMissing('getStatus')).toBe(false);
+  });
+
+  it('should resolve with the output of a failed command when asked', async () => {
+    const usage = ['-e', 'console.log("  getStatus - Get the status"); process.exit(1)'];
+
+    await expect(execCommand(process.execPath, usage)).rejects.toBeDefined();
+    expect(await execCommand(process.execPath, usage, { ignoreExitCode: true })).toBe('  getStatus - Get the status\n');
+    await expect(execCommand('missing-command', [], { ignoreExitCode: true })).rejects.toBeDefined();
+  });
+
+  it('should read the status of an old vsExec type by type', async () => {
+    setCommandExecutor(oldVsExec);
+
+    const status = await windowsExec.getStatus();
+    expect(status.sinks.map((sink) => sink.id)).toEqual(['speakers']);
+    expect(status.streams[0]).toMatchObject({ id: '1234', destinationId: 'speakers' });
+    expect(status.defaultSink).toBe('speakers');
+    expect(status.defaultSource).toBe('mic');
+
+    calls = [];
+    await windowsExec.getStatus();
+    expect(calls.sort()).toEqual(['getSinks', 'getSources', 'getStreams']);
+  });
+
+  it('should apply the batches of an old vsExec one operation at a time', async () => {
+    setCommandExecutor(oldVsExec);
+
+    const results = await windowsExec.applyBatch([
+      { op: 'setVolume', id: 'speakers', volume: 25 },
+      { op: 'getVolumeInfo', id: 'speakers' },
+      { op: 'setMuted', id: 'mic', muted: false },
+      { op: 'setVolume', id: 'unknown', volume: 10 },
+      { op: 'setVolume', id: 'mic', volume: 101 },
+    ]);
+
+    expect(results).toEqual([
+      { id: 'speakers', ok: true },
+      { id: 'speakers', ok: true, volume: 25, muted: false },
+      { id: 'mic', ok: true },
+      { id: 'unknown', ok: false, error: 'Node not found' },
+      { id: 'mic', ok: false, error: 'Volume must be between 0 and 100' },
+    ]);
+    expect(volumes.get('speakers')).toEqual({ volume: 25, muted: false });
+    expect(volumes.get('mic')).toEqual({ volume: 80, muted: false });
+  });
+
+  it('should ramp the volume of an old vsExec step by step', async () => {
+    setCommandExecutor(oldVsExec);
+
+    const result = await windowsExec.rampNodeVolume('speakers', 60, 100);
+    expect(result).toMatchObject({ id: 'speakers', completed: true, volume: 60 });
+    expect(volumes.get('speakers').volume).toBe(60);
+    expect(calls).toContain('setVolumeById speakers 60');
+  });
+
+  it('should report the levels of an old vsExec as not compatible', async () => {
+    setCommandExecutor(oldVsExec);
+
+    await expect(windowsExec.getLevels()).rejects.toThrow(CompatibilityError);
+    expect(windowsExec.getPlatformCompatibility().levels).toBe(false);
+    expect(() => windowsExec.watchLevels(() => undefined)).toThrow(CompatibilityError);
+  });
+
+  it('should poll the status of an old vsExec instead of watching it', async () => {
+    setCommandExecutor(oldVsExec);
+    const events: VsEvent[] = [];
+
+    const unwatch = windowsExec.watch((event) => events.push(event));
+    await new Promise((resolve) => setTimeout(resolve, 200));
+    volumes.get('speakers').volume = 70;
+    await new Promise((resolve) => setTimeout(resolve, 1500));
+    unwatch();
+
+    expect(events).toEqual([{
+      event: 'changed',
+      node: { type: 'sink', id: 'speakers', name: 'Speakers', volume: 70, muted: false, isDefault: true },
+    }]);
+    expect(getProcessStarts()['vsExec.exe watch']).toBeUndefined();
+  });
+});
@@ -0,0 +1,56 @@
+import { volumeControl } from '@/index';
+import { VsEvent } from '@/types';
+import { createWatch } from '@/utils/watch';
+
+// On Linux, a throwaway server with a virtual sink is enough:
+// pulseaudio --daemonize --exit-idle-time=-1 && pactl load-module module-null-sink
+describe('Watch test', () => {
+  const doTestWatch = volumeControl.getPlatformCompatibility().watch;
+
+  it('should be told about a sink volume change', async () => {
+    if (!doTestWatch || !volumeControl.getPlatformCompatibility().listSinks) return;
+    const status = await volumeControl.getStatus();
+    const sink = status.sinks[0];
+
+    expect(sink).toBeDefined(); // Please have a sink before running this test
+
+    const newVolume = 20 == sink.volume ? 50 : 20;
+    const events: VsEvent[] = [];
+    const changed = new Promise<void>((resolve) => {
+      const unwatch = volumeControl.watch((event) => {
+        events.push(event);
+        if (event.event === 'changed' && event.node.id === sink.id && event.node.volume === newVolume) {
+          unwatch();
+          resolve();
+        }
+      });
+    });
+
+    // Give the watch process the time to register its notifications
+    await new Promise((resolve) => setTimeout(resolve, 500));
+    await volumeControl.setNodeVolumeById(sink.id, newVolume);
+    await changed;
+
+    await volumeControl.setNodeVolumeById(sink.id, sink.volume);
+    expect(events.length).toBeGreaterThan(0);
+  });
+
+  it('should keep the process alive while a listener isn\'t watching in the background', () => {
+    let referenced: boolean | null = null;
+    let started = 0;
+    const watch = createWatch((emit, keepAlive) => {
+      started++;
+      const handle = keepAlive.hold({ ref: () => referenced = true, unref: () => referenced = false });
+      return () => keepAlive.release(handle);
+    });
+
+    const unwatchBackground = watch(() => undefined, { keepAlive: false });
+    expect(referenced).toBe(false);
+    const unwatch = watch(() => undefined);
+    expect(referenced).toBe(true);
+    unwatch();
+    expect(referenced).toBe(false);
+    unwatchBackground();
+    expect(started).toBe(1);
+  });
+});
@@ -0,0 +1,113 @@
+import { basename } from 'path';
+import { BatchOperation, PlatformImplementation } from '@/types';
+import { execCommand, getCommandStats, resetCommandStats } from '@/utils/commands';
+import { WriteCoalescer } from '@/utils/writeCoalescer';
+
+describe('Write coalescer test', () => {
+  let volumes: Map<string, number>;
+  let muted: Map<string, boolean>;
+  let calls: string[];
+  let backend: PlatformImplementation;
+
+  // Each write runs a process, like pactl or wpctl, so it takes a few milliseconds and its spawns can be counted
+  const spawn = () => execCommand(process.execPath, ['-e', '']);
+  const spawns = () => getCommandStats()[basename(process.execPath)]?.runs ?? 0;
+
+  beforeEach(() => {
+    volumes = new Map();
+    muted = new Map();
+    calls = [];
+    resetCommandStats();
+    backend = {
+      setNodeVolumeById: async (id: string, volume: number) => {
+        calls.push(`volume ${id} ${volume}`);
+        await spawn();
+        volumes.set(id, volume);
+      },
+      setNodeMutedById: async (id: string, value: boolean) => {
+        calls.push(`muted ${id} ${value}`);
+        await spawn();
+        muted.set(id, value);
+      },
+      setGlobalVolume: async (volume: number) => {
+        calls.push(`global ${volume}`);
+        await spawn();
+        volumes.set('global', volume);
+      },
+      applyBatch: async (operations: BatchOperation[]) => {
+        calls.push(`batch ${operations.length}`);
+        await spawn();
+        for (const operation of operations) {
+          if (operation.op === 'setVolume') volumes.set(operation.id, operation.volume);
+          if (operation.op === 'setMuted') muted.set(operation.id, operation.muted);
+        }
+        return operations.map((operation) => ({ id: operation.id, ok: true }));
+      },
+    } as PlatformImplementation;
+  });
+
+  it('should apply the last of 1000 rapid sets with a bounded number of spawns', async () => {
+    const volumeControl = new WriteCoalescer(backend).implementation;
+
+    // A slider dragged back and forth, a few changes per event loop turn
+    const sets: Promise<void>[] = [];
+    for (let i = 0; i < 1000; i++) {
+      sets.push(volumeControl.setNodeVolumeById('7', i % 101));
+      sets.push(volumeControl.setGlobalVolume(100 - (i % 101)));
+      if (i % 10 === 9) await new Promise((resolve) => setImmediate(resolve));
+    }
+    await Promise.all(sets);
+
+    expect(volumes.get('7')).toBe(999 % 101);
+    expect(volumes.get('global')).toBe(100 - (999 % 101));
+    // At most one write per node in flight, each write waiting for the previous one
+    expect(spawns()).toBeLessThanOrEqual(50);
+    expect(spawns()).toBe(calls.length);
+  });
+
+  it('should resolve the replaced sets once the newer value is applied', async () => {
+    const volumeControl = new WriteCoalescer(backend).implementation;
+
+    const first = volumeControl.setNodeVolumeById('7', 10);
+    await Promise.resolve();
+    const second = volumeControl.setNodeVolumeById('7', 20);
+    const third = volumeControl.setNodeVolumeById('7', 30);
+    await first;
+    expect(volumes.get('7')).toBe(10);
+
+    await Promise.all([second, third]);
+    expect(volumes.get('7')).toBe(30);
+    expect(calls).toEqual(['volume 7 10', 'volume 7 30']);
+  });
+
+  it('should merge the volume and the mute of a node when the backend batches them', async () => {
+    const volumeControl = new WriteCoalescer(backend, true).implementation;
+
+    await Promise.all([volumeControl.setNodeVolumeById('7', 40), volumeControl.setNodeMutedById('7', true)]);
+    expect(calls).toEqual(['batch 2']);
+    expect([volumes.get('7'), muted.get('7')]).toEqual([40, true]);
+
+    const separateControl = new WriteCoalescer(backend).implementation;
+    await Promise.all([separateControl.setNodeVolumeById('7', 50), separateControl.setNodeMutedById('7', false)]);
+    expect(calls.slice(1)).toEqual(['volume 7 50', 'muted 7 false']);
+  });
+
+  it('should reject the sets of a failed write only', async () => {
+    const volumeControl = new WriteCoalescer({
+      ...backend,
+      setNodeVolumeById: async (id: string, volume: number) => {
+        if (volume === 10) throw new Error('Failed to set volume');
+        volumes.set(id, volume);
+      },
+    }).implementation;
+
+    await expect(volumeControl.setNodeVolumeById('7', 101)).rejects.toThrow('Volume must be between 0 and 100');
+    const failed = volumeControl.setNodeVolumeById('7', 10);
+    await Promise.resolve();
+    const applied = volumeControl.setNodeVolumeById('7', 20);
+
+    await expect(failed).rejects.toThrow('Failed to set volume');
+    await applied;
+    expect(volumes.get('7')).toBe(20);
+  });
+});
@@ -8,6 +8,11 @@ export type GetNodeVolumeInfoById = (id: string) => Promise<VolumeInfo>;
 export type SetNodeVolumeById = (id: string, volume: number) => Promise<void>;
 export type SetNodeMutedById = (id: string, muted: boolean) => Promise<void>;
 export type SetStreamDestination = (id: string, destinationId: string) => Promise<void>;
+export type ApplyBatch = (operations: BatchOperation[]) => Promise<BatchResult[]>;
+export type RampNodeVolume = (id: string, volume: number, durationMs: number, curve?: RampCurve) => Promise<RampResult>;
+export type Watch = (listener: WatchListener, options?: WatchOptions) => Unwatch;
+export type GetLevels = (intervalMs?: number) => Promise<NodeLevel[]>;
+export type WatchLevels = (listener: LevelsListener, rateHz?: number) => Unwatch;
 
 export interface PlatformImplementation {
   /**
@@ -69,6 +74,46 @@ export interface PlatformImplementation {
    * @returns {Promise<void>} A promise that resolves when the destination has been set.
    */
   setStreamDestination: SetStreamDestination;
+  /**
+   * Apply several get/set operations at once, resolving their nodes together.
+   * The operations are applied in order, a failing operation doesn't stop the following ones.
+   * @param {BatchOperation[]} operations The operations to apply.
+   * @returns {Promise<BatchResult[]>} A promise that resolves to the result of each operation, in the same order.
+   */
+  applyBatch: ApplyBatch;
+  /**
+   * Fade the volume of a node from its current volume, the node being resolved once for all the steps.
+   * A new ramp of the same node replaces the running one, which then resolves with `completed: false`.
+   * @param {string} id The id of the node.
+   * @param {number} volume The volume reached at the end, from 0 to 100.
+   * @param {number} durationMs The duration of the ramp in milliseconds.
+   * @param {RampCurve} curve 'linear' (default) or 'db' for an even fade in decibels.
+   * @returns {Promise<RampResult>} A promise that resolves once the ramp ended, with how late its steps were set.
+   */
+  rampNodeVolume: RampNodeVolume;
+  /**
+   * Listen to the volume, mute, node and default device changes instead of polling the status.
+   * A single watch process is shared by all the listeners and stopped with the last one.
+   * @param {WatchListener} listener Called with each change.
+   * @param {WatchOptions} options Whether the watch keeps the process alive.
+   * @returns {Unwatch} A function that removes the listener.
+   */
+  watch: Watch;
+  /**
+   * Get the levels of every node once, metered over a short interval.
+   * @param {number} intervalMs The interval the levels are metered over, 100 ms by default.
+   * @returns {Promise<NodeLevel[]>} A promise that resolves to the level of each node.
+   */
+  getLevels: GetLevels;
+  /**
+   * Listen to the levels of every node, e.g. for VU meters.
+   * A single process meters all the nodes at a given rate, shared by the listeners of this rate and stopped with the
+   * last one.
+   * @param {LevelsListener} listener Called with the levels of every node, rateHz times per second.
+   * @param {number} rateHz The number of calls per second, 30 by default, up to 120.
+   * @returns {Unwatch} A function that removes the listener.
+   */
+  watchLevels: WatchLevels;
 }
 
 export type PlatformCompatibility = {
@@ -81,6 +126,10 @@ export type PlatformCompatibility = {
   setSourceVolume: boolean;
   getStreamDestination: boolean;
   setStreamDestination: boolean;
+  watch: boolean;
+  // Whether the changes are pushed by the server, false when watch polls them
+  watchEvents: boolean;
+  levels: boolean;
 }
 
 export type VolumeInfo = {
@@ -116,4 +165,62 @@ export type StreamStatus = {
   streams: VsStreamNode[];
 };
 
-export type Status = SinkStatus & SourceStatus & StreamStatus;
\ No newline at end of file
+export type Status = SinkStatus & SourceStatus & StreamStatus;
+
+export type BatchOperation =
+  | { op: 'getVolumeInfo'; id: string; }
+  | { op: 'setVolume'; id: string; volume: number; }
+  | { op: 'setMuted'; id: string; muted: boolean; };
+
+export type BatchResult = {
+  id: string;
+  ok: boolean;
+  error?: string;
+} & Partial<VolumeInfo>;
+
+export type RampCurve = 'linear' | 'db';
+
+export type RampJitterBucket = {
+  // Upper bound of the bucket, missing on the last one
+  underUs?: number;
+  steps: number;
+};
+
+export type RampResult = {
+  id: string;
+  // False when the ramp was replaced by another one on the same node
+  completed: boolean;
+  volume: number;
+  steps: number;
+  elapsedMs: number;
+  maxJitterUs: number;
+  meanJitterUs: number;
+  jitterHistogram: RampJitterBucket[];
+};
+
+export type VsEvent =
+  | { event: 'changed'; node: VsNode | VsStreamNode; }
+  | { event: 'added'; node: VsNode | VsStreamNode; }
+  | { event: 'removed'; type: VsNodeTypes; id: string; }
+  | { event: 'defaultChanged'; type: 'sink' | 'source'; id?: string; };
+
+export type WatchListener = (event: VsEvent) => void;
+
+export type WatchOptions = {
+  // Whether the watch keeps the process alive, true by default. Background watches, like the one of the status cache,
+  // leave the process free to exit.
+  keepAlive?: boolean;
+};
+
+export type Unwatch = () => void;
+
+export type NodeLevel = {
+  type: VsNodeTypes;
+  id: string;
+  // From 0 to 1, over the samples since the previous levels
+  peak: number;
+  // From 0 to 1, missing when the backend only meters peaks (WASAPI)
+  rms?: number;
+};
+
+export type LevelsListener = (levels: NodeLevel[]) => void;
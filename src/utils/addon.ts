@@ -0,0 +1,83 @@
+import { join } from 'path';
+import { BatchOperation, BatchResult, PlatformImplementation, RampCurve, RampResult, Status, VolumeInfo } from '@/types';
+import ToElectronPath from '@/utils/toEletcronPath';
+
+/**
+ * Native addon built from src/platforms/windows with node-gyp, running the audio backend in the Node process.
+ * The calls run on the libuv threadpool and return the values directly, without any process or output parsing.
+ */
+export type VsAddon = {
+  // Backend the addon was built with, e.g. 'wasapi' or 'pulse'
+  backend: string;
+  getGlobalVolume(): Promise<number>;
+  setGlobalVolume(volume: number): Promise<void>;
+  isGlobalMuted(): Promise<boolean>;
+  setGlobalMuted(muted: boolean): Promise<void>;
+  getStatus(): Promise<Status>;
+  getNodeVolumeInfoById(id: string): Promise<VolumeInfo>;
+  setNodeVolumeById(id: string, volume: number): Promise<void>;
+  setNodeMutedById(id: string, muted: boolean): Promise<void>;
+  setStreamDestination(id: string, destinationId: string): Promise<void>;
+  applyBatch(operations: BatchOperation[]): Promise<BatchResult[]>;
+  // Resolved from the ramp thread of the addon once the ramp ended
+  rampNodeVolume(id: string, volume: number, durationMs: number, curve?: RampCurve): Promise<RampResult>;
+};
+
+const ADDON_NAME = 'volume_supervisor.node';
+
+// Copied next to the compiled library, or left where node-gyp builds it
+const ADDON_PATHS = [
+  join(__dirname, '..', ADDON_NAME),
+  join(__dirname, '..', '..', 'src', 'platforms', 'windows', 'build', 'Release', ADDON_NAME),
+];
+
+let addon: VsAddon | null | undefined;
+
+/**
+ * Load the native addon once, null when it isn't built or can't be loaded (e.g. missing libpulse).
+ */
+export function loadAddon(): VsAddon | null {
+  if (addon !== undefined) return addon;
+
+  addon = null;
+  for (const path of ADDON_PATHS) {
+    try {
+      addon = require(ToElectronPath(path)) as VsAddon;
+      break;
+    } catch (e) {
+      // Not built there, or not loadable on this system
+    }
+  }
+
+  return addon;
+}
+
+/**
+ * Run the implementation through the addon when it is built with the given backend, and keep the implementation as is
+ * otherwise. Watching stays on the implementation, its helpers already stream the changes.
+ */
+export function withAddon(implementation: PlatformImplementation, backend: string): PlatformImplementation {
+  const vsAddon = loadAddon();
+  if (vsAddon?.backend !== backend) return implementation;
+
+  return {
+    ...implementation,
+    getGlobalVolume: () => vsAddon.getGlobalVolume(),
+    setGlobalVolume: (volume: number) => vsAddon.setGlobalVolume(volume),
+    isGlobalMuted: () => vsAddon.isGlobalMuted(),
+    setGlobalMuted: (muted: boolean) => vsAddon.setGlobalMuted(muted),
+    getStatus: () => vsAddon.getStatus(),
+    getNodeVolumeInfoById: (id: string) => vsAddon.getNodeVolumeInfoById(id),
+    setNodeVolumeById: (id: string, volume: number) => vsAddon.setNodeVolumeById(id, volume),
+    setNodeMutedById: (id: string, muted: boolean) => vsAddon.setNodeMutedById(id, muted),
+    setStreamDestination: implementation.getPlatformCompatibility().setStreamDestination
+      ? (id: string, destinationId: string) => vsAddon.setStreamDestination(id, destinationId)
+      : implementation.setStreamDestination,
+    applyBatch: (operations: BatchOperation[]) => vsAddon.applyBatch(operations),
+    // Addons built before the ramps keep the implementation's
+    rampNodeVolume: vsAddon.rampNodeVolume
+      ? (id: string, volume: number, durationMs: number, curve?: RampCurve) =>
+        vsAddon.rampNodeVolume(id, volume, durationMs, curve)
+      : implementation.rampNodeVolume,
+  };
+}
@@ -0,0 +1,280 @@
+import { accessSync, constants, promises as fs, statSync } from 'fs';
+import { homedir } from 'os';
+import { delimiter, dirname, join } from 'path';
+import {
+  LevelsListener,
+  PlatformCompatibility,
+  PlatformImplementation,
+  Unwatch,
+  WatchListener,
+  WatchOptions,
+} from '@/types';
+import { execCommand } from '@/utils/commands';
+import { CompatibilityError } from '@/utils/errors';
+
+// A server that doesn't answer within this delay is as good as missing
+const PROBE_TIMEOUT = 2000;
+// Failures of a tool that can't reach its server: not installed (spawn ENOENT), refused connection ("Connection
+// failure: Connection refused", "Could not connect to PipeWire") or a server that stopped answering
+const UNREACHABLE_ERROR = /\b(ENOENT|EACCES|ECONNREFUSED|ETIMEDOUT)\b|connect|timed? ?out/i;
+
+export type BackendCandidate = {
+  name: string;
+  // Command line tool of the backend, looked up in the PATH unless it is a path
+  command: string;
+  // Arguments of a cheap query of the tool, only answered when its audio server runs
+  probeArgs: string[];
+  implementation: PlatformImplementation;
+};
+
+type CachedSelection = {
+  backend: string;
+  path: string;
+  mtimeMs: number;
+};
+
+type FoundCommand = {
+  path: string;
+  mtimeMs: number;
+};
+
+/**
+ * File remembering the selected backend between processes, in the user cache directory.
+ */
+export function getBackendCachePath() {
+  return join(process.env.XDG_CACHE_HOME || join(homedir(), '.cache'), 'volume_supervisor', 'backend.json');
+}
+
+/**
+ * Whether a failed call means the server of the backend isn't answering, rather than an error of the call itself
+ * (invalid arguments, node not found).
+ */
+export function isServerUnreachableError(error: unknown) {
+  if (error instanceof CompatibilityError) return false;
+
+  return UNREACHABLE_ERROR.test(error instanceof Error ? error.message : `${error}`);
+}
+
+function getCommandPaths(command: string) {
+  if (command.includes('/')) return [command];
+
+  return (process.env.PATH ?? '').split(delimiter).filter((dir) => dir).map((dir) => join(dir, command));
+}
+
+async function findCommand(command: string): Promise<FoundCommand | null> {
+  for (const path of getCommandPaths(command)) {
+    try {
+      await fs.access(path, constants.X_OK);
+      const stats = await fs.stat(path);
+      if (stats.isFile()) return { path, mtimeMs: stats.mtimeMs };
+    } catch (e) {
+      // Not in this directory
+    }
+  }
+
+  return null;
+}
+
+function hasCommandSync(command: string) {
+  return getCommandPaths(command).some((path) => {
+    try {
+      accessSync(path, constants.X_OK);
+      return statSync(path).isFile();
+    } catch (e) {
+      return false;
+    }
+  });
+}
+
+/**
+ * Select the backend on the first call among candidates in order of preference: the first one whose tool is installed
+ * and whose server answers a probe, or the last one when none does.
+ *
+ * The selection is saved to a cache file, and reused without probing as long as the tool of the backend wasn't
+ * modified. When a call fails because the server isn't answering and the selected backend doesn't answer its probe
+ * anymore, the next answering backend is selected and the call retried once, unless it takes node IDs: these are only
+ * meaningful to the backend that listed them, the failure is then thrown. Other failures are thrown as is. Watches
+ * stay on the backend they started with.
+ */
+export class BackendSelection {
+  private selected: BackendCandidate | null = null;
+  private selecting: Promise<BackendCandidate> | null = null;
+
+  constructor(
+    private readonly candidates: BackendCandidate[],
+    private readonly cachePath: string = getBackendCachePath(),
+  ) {
+  }
+
+  /**
+   * The selected backend, selected first if needed. Concurrent first calls share the same selection.
+   */
+  get(): Promise<BackendCandidate> {
+    if (this.selected) return Promise.resolve(this.selected);
+
+    this.selecting ??= this.select().then((candidate) => {
+      this.selected = candidate;
+      this.selecting = null;
+      return candidate;
+    });
+    return this.selecting;
+  }
+
+  getSelected() {
+    return this.selected;
+  }
+
+  /**
+   * Run a call on the selected backend, on the next answering one if it failed because its server stopped answering.
+   */
+  run<T>(call: (implementation: PlatformImplementation) => Promise<T>): Promise<T> {
+    return this.runOn(call, true);
+  }
+
+  /**
+   * Run a call taking node IDs on the selected backend. The IDs of a backend mean other nodes (or none) on the others,
+   * so when its server stopped answering the next answering backend is only selected for the following calls, and the
+   * failure is thrown.
+   */
+  runOnNodes<T>(call: (implementation: PlatformImplementation) => Promise<T>): Promise<T> {
+    return this.runOn(call, false);
+  }
+
+  /**
+   * Compatibility of the selected backend. Until it is selected, of the first candidate with its tool installed.
+   */
+  getPlatformCompatibility(): PlatformCompatibility {
+    if (this.selected) return this.selected.implementation.getPlatformCompatibility();
+
+    this.get().catch((e) => console.error(e));
+    const guess = this.candidates.find((candidate) => hasCommandSync(candidate.command)) ?? this.candidates.at(-1);
+    return guess.implementation.getPlatformCompatibility();
+  }
+
+  /**
+   * Start a watch on the backend once selected, the returned function stops it whenever it is called.
+   */
+  watch(start: (implementation: PlatformImplementation) => Unwatch): Unwatch {
+    if (this.selected) return start(this.selected.implementation);
+
+    let unwatch: Unwatch | null = null;
+    let stopped = false;
+    this.get().then((candidate) => {
+      if (!stopped) unwatch = start(candidate.implementation);
+    }).catch((e) => console.error(e));
+
+    return () => {
+      stopped = true;
+      unwatch?.();
+    };
+  }
+
+  private async runOn<T>(call: (implementation: PlatformImplementation) => Promise<T>, retry: boolean): Promise<T> {
+    const candidate = await this.get();
+    try {
+      return await call(candidate.implementation);
+    } catch (e) {
+      if (!isServerUnreachableError(e)) throw e;
+
+      const next = await this.reselect(candidate);
+      if (next === candidate || !retry) throw e;
+
+      return call(next.implementation);
+    }
+  }
+
+  private async select(): Promise<BackendCandidate> {
+    const cached = await this.readCache();
+    if (cached) return cached;
+
+    return await this.probeFrom(0) ?? this.candidates.at(-1);
+  }
+
+  // The failed backend is kept when it still answers, the failure then comes from the call itself
+  private async reselect(failed: BackendCandidate): Promise<BackendCandidate> {
+    if (this.selected !== failed) return this.get();
+
+    this.selecting ??= (async () => {
+      if (await this.probe(failed)) return failed;
+
+      const index = this.candidates.indexOf(failed);
+      return await this.probeFrom(index + 1) ?? await this.probeFrom(0, index) ?? failed;
+    })().then((candidate) => {
+      this.selected = candidate;
+      this.selecting = null;
+      return candidate;
+    });
+    return this.selecting;
+  }
+
+  private async probeFrom(start: number, end = this.candidates.length): Promise<BackendCandidate | null> {
+    for (const candidate of this.candidates.slice(start, end)) {
+      if (await this.probe(candidate)) return candidate;
+    }
+
+    return null;
+  }
+
+  private async probe(candidate: BackendCandidate) {
+    const command = await findCommand(candidate.command);
+    if (!command) return false;
+
+    try {
+      await execCommand(command.path, candidate.probeArgs, { timeoutMs: PROBE_TIMEOUT });
+    } catch (e) {
+      return false;
+    }
+
+    await this.writeCache({ backend: candidate.name, ...command });
+    return true;
+  }
+
+  private async readCache(): Promise<BackendCandidate | null> {
+    try {
+      const cached = JSON.parse(await fs.readFile(this.cachePath, 'utf8')) as CachedSelection;
+      const candidate = this.candidates.find((candidate) => candidate.name === cached.backend);
+      const command = candidate && await findCommand(candidate.command);
+
+      return command?.path === cached.path && command.mtimeMs === cached.mtimeMs ? candidate : null;
+    } catch (e) {
+      // No selection saved yet, or from another version
+      return null;
+    }
+  }
+
+  private async writeCache(selection: CachedSelection) {
+    try {
+      await fs.mkdir(dirname(this.cachePath), { recursive: true });
+      await fs.writeFile(this.cachePath, JSON.stringify(selection));
+    } catch (e) {
+      // Selected again by the next process
+    }
+  }
+}
+
+/**
+ * Implementation selecting its backend on the first call, see BackendSelection.
+ */
+export function createLazyImplementation(selection: BackendSelection): PlatformImplementation {
+  return {
+    getPlatformCompatibility: () => selection.getPlatformCompatibility(),
+    getGlobalVolume: () => selection.run((backend) => backend.getGlobalVolume()),
+    setGlobalVolume: (volume) => selection.run((backend) => backend.setGlobalVolume(volume)),
+    isGlobalMuted: () => selection.run((backend) => backend.isGlobalMuted()),
+    setGlobalMuted: (muted) => selection.run((backend) => backend.setGlobalMuted(muted)),
+    getStatus: () => selection.run((backend) => backend.getStatus()),
+    getNodeVolumeInfoById: (id) => selection.runOnNodes((backend) => backend.getNodeVolumeInfoById(id)),
+    setNodeVolumeById: (id, volume) => selection.runOnNodes((backend) => backend.setNodeVolumeById(id, volume)),
+    setNodeMutedById: (id, muted) => selection.runOnNodes((backend) => backend.setNodeMutedById(id, muted)),
+    setStreamDestination: (id, destinationId) =>
+      selection.runOnNodes((backend) => backend.setStreamDestination(id, destinationId)),
+    applyBatch: (operations) => selection.runOnNodes((backend) => backend.applyBatch(operations)),
+    rampNodeVolume: (id, volume, durationMs, curve) =>
+      selection.runOnNodes((backend) => backend.rampNodeVolume(id, volume, durationMs, curve)),
+    watch: (listener: WatchListener, options?: WatchOptions) =>
+      selection.watch((backend) => backend.watch(listener, options)),
+    getLevels: (intervalMs) => selection.run((backend) => backend.getLevels(intervalMs)),
+    watchLevels: (listener: LevelsListener, rateHz?: number) =>
+      selection.watch((backend) => backend.watchLevels(listener, rateHz)),
+  };
+}
@@ -0,0 +1,119 @@
+import { BatchOperation, BatchResult, VolumeInfo } from '@/types';
+
+export type BatchWrite = Partial<VolumeInfo>;
+
+function getOperationError(operation: BatchOperation) {
+  if (operation.op === 'setVolume' && (operation.volume < 0 || operation.volume > 100)) {
+    return 'Volume must be between 0 and 100';
+  }
+
+  return undefined;
+}
+
+/**
+ * Get the distinct node IDs of the operations, in order of first appearance.
+ */
+export function getBatchIds(operations: BatchOperation[]) {
+  return [...new Set(operations.map((operation) => operation.id))];
+}
+
+/**
+ * Collapse the set operations of a batch to the last volume and mute written to each node.
+ */
+export function collapseBatchWrites(operations: BatchOperation[]) {
+  const writes = new Map<string, BatchWrite>();
+
+  for (const operation of operations) {
+    if (operation.op === 'getVolumeInfo' || getOperationError(operation)) continue;
+
+    const write = writes.get(operation.id) ?? {};
+    if (operation.op === 'setVolume') write.volume = operation.volume;
+    if (operation.op === 'setMuted') write.muted = operation.muted;
+    writes.set(operation.id, write);
+  }
+
+  return writes;
+}
+
+/**
+ * Apply the collapsed writes of a batch concurrently, one node at a time.
+ * Mute writes that wouldn't change the node are skipped.
+ * @returns {Promise<Map<string, string>>} The nodes whose writes failed, with their error.
+ */
+export async function applyBatchWrites(
+  operations: BatchOperation[],
+  nodes: Map<string, VolumeInfo>,
+  setVolume: (id: string, volume: number) => Promise<unknown>,
+  setMuted: (id: string, muted: boolean) => Promise<unknown>,
+) {
+  const errors = new Map<string, string>();
+
+  await Promise.all([...collapseBatchWrites(operations)].map(async ([id, write]) => {
+    const node = nodes.get(id);
+    if (!node) return;
+
+    try {
+      if (write.volume !== undefined) await setVolume(id, write.volume);
+      if (write.muted !== undefined && write.muted !== node.muted) await setMuted(id, write.muted);
+    } catch (e) {
+      errors.set(id, `${e}`);
+    }
+  }));
+
+  return errors;
+}
+
+/**
+ * Build the result of each operation as if they were applied in order.
+ * @param {BatchOperation[]} operations The operations of the batch.
+ * @param {Map<string, VolumeInfo>} nodes The state of the nodes before the batch, missing nodes were not found.
+ * @param {Map<string, string>} errors The nodes whose writes failed, with their error.
+ */
+export function resolveBatchResults(
+  operations: BatchOperation[],
+  nodes: Map<string, VolumeInfo>,
+  errors: Map<string, string>,
+): BatchResult[] {
+  const states = new Map<string, VolumeInfo>();
+
+  return operations.map((operation) => {
+    const { id } = operation;
+    const error = getOperationError(operation);
+    if (error) return { id, ok: false, error };
+
+    const node = nodes.get(id);
+    if (!node) return { id, ok: false, error: 'Node not found' };
+
+    if (operation.op !== 'getVolumeInfo' && errors.has(id)) return { id, ok: false, error: errors.get(id) };
+
+    const state = states.get(id) ?? { volume: node.volume, muted: node.muted };
+    states.set(id, state);
+
+    switch (operation.op) {
+      case 'getVolumeInfo':
+        return { id, ok: true, volume: state.volume, muted: state.muted };
+      case 'setVolume':
+        state.volume = operation.volume;
+        return { id, ok: true };
+      case 'setMuted':
+        state.muted = operation.muted;
+        return { id, ok: true };
+    }
+  });
+}
+
+/**
+ * Format the operations as the lines read by the `batch` command of vsExec and vsPulse.
+ */
+export function toBatchInput(operations: BatchOperation[]) {
+  return operations.map((operation) => {
+    switch (operation.op) {
+      case 'getVolumeInfo':
+        return [operation.op, operation.id];
+      case 'setVolume':
+        return [operation.op, operation.id, operation.volume.toString()];
+      case 'setMuted':
+        return [operation.op, operation.id, operation.muted ? '1' : '0'];
+    }
+  }).map((fields) => fields.join('\t'));
+}
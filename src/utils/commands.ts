@@ -1,19 +1,276 @@
-import { ExecException, exec } from 'child_process';
-
-export const execCommand = (cmd: string, args: string[]): Promise<string> =>
-  new Promise((resolve, reject) => {
-    exec(
-      `${cmd} ${
-        args
-          .map(arg => typeof arg === 'string' ? `"${arg}"` : arg)
-          .join(' ')
-      }`,
-      (err: ExecException, stdout: string, stderr: string) => {
-        if (err || stderr) {
-          reject(stderr);
-        } else {
-          resolve(stdout);
-        }
-      },
-    );
-  });
\ No newline at end of file
+import { execFile, spawn } from 'child_process';
+import { basename } from 'path';
+import { performance } from 'perf_hooks';
+import { Socket } from 'net';
+import { countProcessStart, trace } from '@/utils/metrics';
+import { KeepAlive } from '@/utils/watch';
+
+const DEFAULT_COMMAND_CONCURRENCY = 8;
+// Listings of hundreds of nodes go past the default 1 MiB of execFile
+const MAX_OUTPUT_BYTES = 16 * 1024 * 1024;
+
+export type ExecOptions = {
+  // Written to the standard input of the command, which is then closed
+  input?: string;
+  // Fail on any error output, for tools reporting some failures only there (vsExec and the native helpers)
+  failOnStderr?: boolean;
+  // Kill the command and fail once it ran for this long
+  timeoutMs?: number;
+  // Resolve with the output even if the command exits with an error code, e.g. to read the usage printed by a tool
+  ignoreExitCode?: boolean;
+};
+
+/**
+ * Runs a command in place of execFile, resolved with its output or rejected with its error output.
+ */
+export type CommandExecutor = (cmd: string, args: string[], options: ExecOptions) => Promise<string>;
+
+/**
+ * Timings of the runs of a command, summed over its runs, in milliseconds.
+ */
+export type CommandStats = {
+  runs: number;
+  failures: number;
+  // Waiting for a free slot of the queue
+  queuedMs: number;
+  // From the call to execFile to the spawn of the process
+  spawnMs: number;
+  // From the spawn of the process to its exit
+  runMs: number;
+  maxRunMs: number;
+};
+
+/**
+ * Run commands without a shell, at most a given number at a time, the others waiting in order.
+ */
+class CommandRunner {
+  private running = 0;
+  private queue: (() => void)[] = [];
+  private stats = new Map<string, CommandStats>();
+  private executor: CommandExecutor | null = null;
+
+  constructor(private concurrency: number) {
+  }
+
+  setConcurrency(concurrency: number) {
+    if (!Number.isInteger(concurrency) || concurrency < 1) throw new Error('Concurrency must be a positive integer');
+
+    this.concurrency = concurrency;
+    this.next();
+  }
+
+  run(cmd: string, args: string[], options: ExecOptions): Promise<string> {
+    const queuedAt = performance.now();
+
+    return new Promise((resolve, reject) => {
+      this.queue.push(() => this.start(cmd, args, options, queuedAt, resolve, reject));
+      this.next();
+    });
+  }
+
+  setExecutor(executor: CommandExecutor | null) {
+    this.executor = executor;
+  }
+
+  getStats(): Record<string, CommandStats> {
+    return Object.fromEntries([...this.stats].map(([cmd, stats]) => [cmd, { ...stats }]));
+  }
+
+  resetStats() {
+    this.stats.clear();
+  }
+
+  private next() {
+    while (this.running < this.concurrency && this.queue.length > 0) {
+      this.running++;
+      this.queue.shift()();
+    }
+  }
+
+  private start(
+    cmd: string,
+    args: string[],
+    options: ExecOptions,
+    queuedAt: number,
+    resolve: (stdout: string) => void,
+    reject: (stderr: string) => void,
+  ) {
+    const startedAt = performance.now();
+    let spawnedAt: number | null = null;
+
+    const settle = (failed: boolean, output: string) => {
+      const exitedAt = performance.now();
+      // Never spawned, e.g. a missing command
+      spawnedAt ??= exitedAt;
+      this.running--;
+      this.record(cmd, failed, startedAt - queuedAt, spawnedAt - startedAt, exitedAt - spawnedAt);
+      this.next();
+
+      if (failed) {
+        reject(output);
+      } else {
+        resolve(output);
+      }
+    };
+
+    if (this.executor) {
+      // Nothing is spawned, the whole call counts as the run
+      spawnedAt = startedAt;
+      this.executor(cmd, args, options).then((stdout) => settle(false, stdout), (err) => settle(true, err));
+      return;
+    }
+
+    const { input, failOnStderr = false, timeoutMs = 0, ignoreExitCode = false } = options;
+    const execOptions = { maxBuffer: MAX_OUTPUT_BYTES, timeout: timeoutMs, windowsHide: true };
+    const child = execFile(cmd, args, execOptions, (err, stdout, stderr) => {
+      // Exit codes are numbers, the other errors (e.g. ENOENT or a timeout) still fail
+      const exitedWithError = !!err && !(ignoreExitCode && typeof err.code === 'number');
+      const failed = exitedWithError || (failOnStderr && !!stderr);
+      settle(failed, failed ? stderr || err?.message : stdout);
+    });
+    child.once('spawn', () => spawnedAt = performance.now());
+
+    if (input !== undefined) {
+      // The command may exit without reading its input
+      child.stdin.on('error', () => {});
+      child.stdin.end(input);
+    }
+  }
+
+  private record(cmd: string, failed: boolean, queuedMs: number, spawnMs: number, runMs: number) {
+    const name = basename(cmd);
+    let stats = this.stats.get(name);
+    if (!stats) {
+      stats = { runs: 0, failures: 0, queuedMs: 0, spawnMs: 0, runMs: 0, maxRunMs: 0 };
+      this.stats.set(name, stats);
+    }
+
+    stats.runs++;
+    if (failed) stats.failures++;
+    stats.queuedMs += queuedMs;
+    stats.spawnMs += spawnMs;
+    stats.runMs += runMs;
+    stats.maxRunMs = Math.max(stats.maxRunMs, runMs);
+    trace({ type: 'command', command: name, queuedMs, spawnMs, runMs, ok: !failed });
+  }
+}
+
+const runner = new CommandRunner(DEFAULT_COMMAND_CONCURRENCY);
+
+/**
+ * Run a command and get its output. The arguments are passed as is, without a shell.
+ * @param {string} cmd The command to run.
+ * @param {string[]} args The arguments of the command.
+ * @param {ExecOptions} options The input of the command, whether its error output or exit code mean a failure, and its
+ * timeout.
+ * @returns {Promise<string>} The output of the command, rejected with its error output if it exits with an error.
+ */
+export function execCommand(cmd: string, args: string[], options: ExecOptions = {}): Promise<string> {
+  return runner.run(cmd, args, options);
+}
+
+/**
+ * Set how many commands run at the same time, 8 by default. The other commands wait for a free slot.
+ */
+export function setCommandConcurrency(concurrency: number) {
+  runner.setConcurrency(concurrency);
+}
+
+/**
+ * Run the commands through an executor instead of spawning them, e.g. to replay recorded outputs in tests and
+ * benchmarks, or spawn them again with null. The queue and the stats still apply. Long-lived commands are always
+ * spawned.
+ */
+export function setCommandExecutor(executor: CommandExecutor | null) {
+  runner.setExecutor(executor);
+}
+
+/**
+ * Timings of the commands run so far, by command name.
+ */
+export function getCommandStats() {
+  return runner.getStats();
+}
+
+export function resetCommandStats() {
+  runner.resetStats();
+}
+
+/**
+ * Map items through an asynchronous function, at most a given number at a time.
+ */
+export async function mapWithConcurrency<T, R>(items: T[], concurrency: number, fn: (item: T) => Promise<R>) {
+  const results: R[] = new Array(items.length);
+  let nextIndex = 0;
+
+  const work = async () => {
+    while (nextIndex < items.length) {
+      const index = nextIndex++;
+      results[index] = await fn(items[index]);
+    }
+  };
+  await Promise.all(Array.from({ length: Math.min(concurrency, items.length) }, work));
+
+  return results;
+}
+
+/**
+ * Run a long-lived command, e.g. a subscription to the audio server events.
+ * @param {string} cmd The command to run.
+ * @param {string[]} args The arguments of the command.
+ * @param {(line: string) => void} onLine Called with each line of the output.
+ * @param {() => void} onExit Called when the command exits or fails to start, unless it was stopped.
+ * @param {boolean | KeepAlive} keepAlive Whether the command keeps the process alive, false for a background
+ * subscription, or the keep alive of the watch running it.
+ * @returns {() => void} A function that stops the command.
+ */
+export function watchCommand(
+  cmd: string,
+  args: string[],
+  onLine: (line: string) => void,
+  onExit: () => void,
+  keepAlive: boolean | KeepAlive = true,
+) {
+  const child = spawn(cmd, args, { stdio: ['ignore', 'pipe', 'ignore'] });
+  countProcessStart(basename(cmd));
+  const holder = typeof keepAlive === 'boolean' ? new KeepAlive(keepAlive) : keepAlive;
+  const handle = holder.hold({
+    ref: () => {
+      child.ref();
+      (child.stdout as Socket).ref();
+    },
+    unref: () => {
+      child.unref();
+      (child.stdout as Socket).unref();
+    },
+  });
+  let buffer = '';
+  let stopped = false;
+
+  child.stdout.setEncoding('utf8');
+  child.stdout.on('data', (chunk: string) => {
+    buffer += chunk;
+
+    let lineEnd: number;
+    while ((lineEnd = buffer.indexOf('\n')) !== -1) {
+      const line = buffer.slice(0, lineEnd);
+      buffer = buffer.slice(lineEnd + 1);
+      onLine(line);
+    }
+  });
+
+  const exited = () => {
+    holder.release(handle);
+    if (stopped) return;
+    stopped = true;
+    onExit();
+  };
+  child.on('error', exited);
+  child.on('exit', exited);
+
+  return () => {
+    stopped = true;
+    holder.release(handle);
+    child.kill();
+  };
+}
@@ -0,0 +1,51 @@
+import { LevelsListener, NodeLevel, Unwatch } from '@/types';
+import { VsExecWatcher } from '@/utils/vsExecWatcher';
+
+// Same defaults and limit as the native helpers (levels.h)
+const DEFAULT_LEVELS_INTERVAL = 100;
+const DEFAULT_LEVEL_RATE = 30;
+const MAX_LEVEL_RATE = 120;
+
+type LevelsLine = {
+  levels: NodeLevel[];
+};
+
+/**
+ * Arguments of the getLevels command of vsExec and the native helpers.
+ */
+export function getLevelsArgs(intervalMs: number = DEFAULT_LEVELS_INTERVAL) {
+  if (!(intervalMs > 0)) throw new Error('Interval must be positive');
+
+  return ['getLevels', Math.round(intervalMs).toString()];
+}
+
+/**
+ * Share a helper process in `levels` mode per rate between all the listeners of this rate.
+ * Every node is metered by the same process, whatever their number.
+ */
+export class VsExecLevelWatchers {
+  private watchers = new Map<number, VsExecWatcher<LevelsLine>>();
+
+  constructor(private readonly path: string) {
+  }
+
+  /**
+   * Whether the executable supports the levels mode, false once one of its processes printed something else.
+   */
+  isSupported() {
+    return [...this.watchers.values()].every((watcher) => watcher.isSupported());
+  }
+
+  watch(listener: LevelsListener, rateHz: number = DEFAULT_LEVEL_RATE): Unwatch {
+    if (!(rateHz >= 1 && rateHz <= MAX_LEVEL_RATE)) throw new Error(`Rate must be between 1 and ${MAX_LEVEL_RATE}`);
+
+    const rate = Math.round(rateHz);
+    let watcher = this.watchers.get(rate);
+    if (!watcher) {
+      watcher = new VsExecWatcher<LevelsLine>(this.path, ['levels', rate.toString()]);
+      this.watchers.set(rate, watcher);
+    }
+
+    return watcher.watch((line) => listener(line.levels));
+  }
+}
@@ -0,0 +1,145 @@
+import { performance } from 'perf_hooks';
+import { PlatformImplementation } from '@/types';
+
+// Upper bounds of the latency buckets, the last bucket holding the slower calls
+const LATENCY_BUCKETS_MS = [1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000];
+
+export type LatencyBucket = {
+  // Upper bound of the bucket, missing on the last one
+  underMs?: number;
+  calls: number;
+};
+
+export type MethodMetrics = {
+  calls: number;
+  failures: number;
+  totalMs: number;
+  maxMs: number;
+  histogram: LatencyBucket[];
+};
+
+export type TraceEvent =
+  // A call of the public API, from its start to its result
+  | { type: 'call'; method: string; durationMs: number; ok: boolean; }
+  // A run of a command line tool, e.g. pactl or a vsExec process without its server
+  | { type: 'command'; command: string; queuedMs: number; spawnMs: number; runMs: number; ok: boolean; }
+  // A long-lived process started, e.g. a helper server or a subscription
+  | { type: 'process'; command: string; }
+  // An output parsed, by the name of its format
+  | { type: 'parse'; format: string; bytes: number; };
+
+export type TraceHook = (event: TraceEvent) => void;
+
+let traceHook: TraceHook | null = null;
+const processStarts = new Map<string, number>();
+const parsedBytes = new Map<string, number>();
+
+/**
+ * Forward every traced event to a hook, e.g. a tracing system, or stop with null. Its errors are logged and ignored.
+ */
+export function setTraceHook(hook: TraceHook | null) {
+  traceHook = hook;
+}
+
+export function trace(event: TraceEvent) {
+  if (!traceHook) return;
+
+  try {
+    traceHook(event);
+  } catch (e) {
+    console.error(e);
+  }
+}
+
+export function countProcessStart(command: string) {
+  processStarts.set(command, (processStarts.get(command) ?? 0) + 1);
+  trace({ type: 'process', command });
+}
+
+/**
+ * Count the bytes of an output about to be parsed, by the name of its format (e.g. `pactl` or `pactl json`).
+ */
+export function countParsedBytes(format: string, output: string) {
+  const bytes = Buffer.byteLength(output);
+  parsedBytes.set(format, (parsedBytes.get(format) ?? 0) + bytes);
+  trace({ type: 'parse', format, bytes });
+}
+
+export function getProcessStarts(): Record<string, number> {
+  return Object.fromEntries(processStarts);
+}
+
+export function getParsedBytes(): Record<string, number> {
+  return Object.fromEntries(parsedBytes);
+}
+
+function createMethodMetrics(): MethodMetrics {
+  return {
+    calls: 0,
+    failures: 0,
+    totalMs: 0,
+    maxMs: 0,
+    histogram: [...LATENCY_BUCKETS_MS.map((underMs) => ({ underMs, calls: 0 })), { calls: 0 }],
+  };
+}
+
+/**
+ * Latency of every method of an implementation, from the call to the settlement of its promise.
+ */
+export class MethodLatencies {
+  readonly implementation: PlatformImplementation;
+  private methods = new Map<string, MethodMetrics>();
+
+  constructor(implementation: PlatformImplementation) {
+    const measured: Record<string, unknown> = {};
+    for (const [method, fn] of Object.entries(implementation)) {
+      measured[method] = (...args: unknown[]) => this.measure(method, () => fn(...args));
+    }
+    this.implementation = measured as PlatformImplementation;
+  }
+
+  getMetrics(): Record<string, MethodMetrics> {
+    return Object.fromEntries([...this.methods].map(([method, metrics]) => [method, structuredClone(metrics)]));
+  }
+
+  private measure(method: string, call: () => unknown) {
+    const start = performance.now();
+    let result: unknown;
+    try {
+      result = call();
+    } catch (e) {
+      this.record(method, start, false);
+      throw e;
+    }
+
+    if (!(result instanceof Promise)) {
+      this.record(method, start, true);
+      return result;
+    }
+
+    return result.then((value) => {
+      this.record(method, start, true);
+      return value;
+    }, (err) => {
+      this.record(method, start, false);
+      throw err;
+    });
+  }
+
+  private record(method: string, start: number, ok: boolean) {
+    const durationMs = performance.now() - start;
+    let metrics = this.methods.get(method);
+    if (!metrics) {
+      metrics = createMethodMetrics();
+      this.methods.set(method, metrics);
+    }
+
+    metrics.calls++;
+    if (!ok) metrics.failures++;
+    metrics.totalMs += durationMs;
+    metrics.maxMs = Math.max(metrics.maxMs, durationMs);
+    metrics.histogram.find((bucket) => bucket.underMs === undefined || durationMs < bucket.underMs).calls++;
+
+    trace({ type: 'call', method, durationMs, ok });
+  }
+}
@@ -0,0 +1,137 @@
+import { VsNodeTypes } from '@/types';
+
+export type CachedNode = {
+  type: VsNodeTypes;
+  // Display name when the node was filled from a full listing
+  name?: string;
+};
+
+export type ListedNode = {
+  id: string;
+  name?: string;
+};
+
+/**
+ * Whether an error means that no node of the type has the ID: pactl answers "No such entity", the lookups in a listing
+ * fail with "node not found".
+ */
+export function isNodeNotFoundError(error: unknown) {
+  return /No such entity|not found/i.test(error instanceof Error ? error.message : `${error}`);
+}
+
+/**
+ * Type and name of the nodes by ID, filled from the listings so resolving the type of a node is a map lookup.
+ *
+ * A type is known with all its nodes or not at all, so a missing ID is a miss only once every type was listed.
+ * IDs may be shared by several types, the first type of the order wins, as with sequential lookups per type.
+ */
+export class NodeTypeCache {
+  private nodes = new Map<VsNodeTypes, Map<string, string | undefined>>();
+  // Listings in flight, shared by the lookups missing the same type
+  private refreshes = new Map<VsNodeTypes, Promise<void>>();
+  private hits = 0;
+  private misses = 0;
+
+  /**
+   * @param {VsNodeTypes[]} types The types in the order their IDs are resolved.
+   * @param {(type: VsNodeTypes) => Promise<ListedNode[]>} list List every node of a type, as cheaply as possible.
+   * @param {(error: unknown) => boolean} isNotFound Whether an error of an operation means the node has another type.
+   */
+  constructor(
+    private readonly types: VsNodeTypes[],
+    private readonly list: (type: VsNodeTypes) => Promise<ListedNode[]>,
+    private readonly isNotFound: (error: unknown) => boolean = isNodeNotFoundError,
+  ) {
+  }
+
+  /**
+   * Replace the nodes of a type with a fresh listing, e.g. from a status.
+   */
+  fill(type: VsNodeTypes, nodes: ListedNode[]) {
+    this.nodes.set(type, new Map(nodes.map((node) => [node.id, node.name])));
+  }
+
+  /**
+   * Forget the nodes of a type, or of every type, listed again by the next lookup.
+   */
+  invalidate(type?: VsNodeTypes) {
+    if (type) {
+      this.nodes.delete(type);
+    } else {
+      this.nodes.clear();
+    }
+  }
+
+  /**
+   * The cached node, undefined when it isn't known or a type before it has to be listed first.
+   */
+  get(id: string): CachedNode | undefined {
+    for (const type of this.types) {
+      const nodes = this.nodes.get(type);
+      if (!nodes) return undefined;
+      if (nodes.has(id)) return { type, name: nodes.get(id) };
+    }
+
+    return undefined;
+  }
+
+  /**
+   * Resolve a node from the cache, or list the types again once on a miss.
+   * @returns {Promise<CachedNode | null>} The node, null when no type has it.
+   */
+  async resolve(id: string): Promise<CachedNode | null> {
+    const cached = this.get(id);
+    if (cached) {
+      this.hits++;
+      return cached;
+    }
+
+    this.misses++;
+    // Every type is listed again, a known type may be outdated when the node was added meanwhile
+    await Promise.all(this.types.map((type) => this.refresh(type)));
+    return this.get(id) ?? null;
+  }
+
+  /**
+   * Run an operation on a node of the resolved type. A cached type may be outdated (the node was removed, or its ID
+   * reused by another type): when the operation doesn't find the node, that type is listed again for a single retry.
+   * The other errors are thrown as is.
+   */
+  async run<T>(id: string, operation: (type: VsNodeTypes) => Promise<T>): Promise<T> {
+    const cached = this.get(id);
+    let notFound: unknown;
+    if (cached) {
+      this.hits++;
+      try {
+        return await operation(cached.type);
+      } catch (e) {
+        if (!this.isNotFound(e)) throw e;
+        notFound = e;
+        this.invalidate(cached.type);
+        await this.refresh(cached.type);
+      }
+    }
+
+    // The other types are only listed again when the failed one no longer leads to the node
+    const node = this.get(id) ?? await this.resolve(id);
+    if (!node) throw notFound ?? new Error('Failed to get node type');
+
+    return operation(node.type);
+  }
+
+  getStats() {
+    return { hits: this.hits, misses: this.misses };
+  }
+
+  private refresh(type: VsNodeTypes) {
+    let refresh = this.refreshes.get(type);
+    if (!refresh) {
+      refresh = this.list(type)
+        .then((nodes) => this.fill(type, nodes))
+        .finally(() => this.refreshes.delete(type));
+      this.refreshes.set(type, refresh);
+    }
+
+    return refresh;
+  }
+}
@@ -0,0 +1,65 @@
+import { VsNode, VsStreamNode } from '@/types';
+
+// Output of `pactl -f json`, printed by pactl 16 and later (also the pactl used with pipewire-pulse)
+type PactlVolume = Record<string, { value_percent: string }>;
+
+export type PactlInfo = {
+  default_sink_name?: string;
+  default_source_name?: string;
+};
+
+export type PactlDevice = {
+  index: number;
+  name: string;
+  description?: string;
+  mute: boolean;
+  volume: PactlVolume;
+};
+
+export type PactlSinkInput = {
+  index: number;
+  sink: number;
+  mute: boolean;
+  volume: PactlVolume;
+  properties?: Record<string, string>;
+};
+
+/**
+ * Mean of the channel volumes in percent, as computed from the text output.
+ */
+export function getPactlVolume(volume: PactlVolume) {
+  const percents = Object.values(volume ?? {}).map((channel) => Number.parseInt(channel.value_percent, 10));
+  if (percents.length === 0) return 0;
+
+  return Math.round(percents.reduce((a, b) => a + b, 0) / percents.length);
+}
+
+export function fromPactlDevices(type: 'sink' | 'source', devices: PactlDevice[], defaultName?: string): VsNode[] {
+  return devices.map((device) => ({
+    type,
+    id: device.index.toString(),
+    name: device.description ?? device.name,
+    volume: getPactlVolume(device.volume),
+    muted: device.mute,
+    isDefault: device.name === defaultName,
+  }));
+}
+
+export function fromPactlSinkInputs(sinkInputs: PactlSinkInput[]): VsStreamNode[] {
+  return sinkInputs.map((sinkInput) => ({
+    type: 'stream',
+    id: sinkInput.index.toString(),
+    name: sinkInput.properties?.['application.name'] ?? sinkInput.properties?.['media.name'],
+    volume: getPactlVolume(sinkInput.volume),
+    muted: sinkInput.mute,
+    isDefault: false,
+    destinationId: sinkInput.sink.toString(),
+  }));
+}
+
+/**
+ * Whether pactl failed because it doesn't know the format option, i.e. it is older than 16.
+ */
+export function isPactlFormatUnsupported(err: unknown) {
+  return /invalid option|unrecognized option/i.test(String(err));
+}
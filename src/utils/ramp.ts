@@ -0,0 +1,120 @@
+import { RampCurve, RampResult } from '@/types';
+
+// The fallback spawns a command line tool per step, far coarser than the 10 ms steps of the native helpers
+const STEP_INTERVAL = 50;
+// Same buckets as the native ramps, in microseconds
+const JITTER_BUCKETS = [100, 250, 500, 1000, 2000, 5000];
+// Lowest level of the decibel curve, -60 dB: silence itself is only set by the last step
+const DECIBEL_FLOOR = 0.001;
+
+type RunningRamp = {
+  replaced: boolean;
+};
+
+const runningRamps = new Map<string, RunningRamp>();
+
+function sleep(ms: number) {
+  return new Promise((resolve) => setTimeout(resolve, ms));
+}
+
+/**
+ * Check the arguments of a ramp, with the errors of the native helpers.
+ */
+export function validateRamp(volume: number, durationMs: number, curve: RampCurve) {
+  if (volume < 0 || volume > 100) throw new Error('Volume must be between 0 and 100');
+  if (!(durationMs >= 0)) throw new Error('Duration must not be negative');
+  if (curve !== 'linear' && curve !== 'db') throw new Error('Curve must be linear or db');
+}
+
+/**
+ * Arguments of the ramp command of vsExec and the native helpers.
+ */
+export function getRampArgs(id: string, volume: number, durationMs: number, curve: RampCurve) {
+  return ['ramp', id, Math.round(volume).toString(), Math.round(durationMs).toString(), curve];
+}
+
+/**
+ * Level of a ramp between two levels from 0 to 1, at a progress from 0 to 1.
+ */
+export function getRampLevel(from: number, to: number, progress: number, curve: RampCurve) {
+  if (progress <= 0) return from;
+  if (progress >= 1 || from === to) return to;
+
+  if (curve === 'linear') return from + (to - from) * progress;
+
+  // Geometric between the levels, so the same number of decibels per step
+  const low = Math.max(from, DECIBEL_FLOOR);
+  const high = Math.max(to, DECIBEL_FLOOR);
+  return low * Math.pow(high / low, progress);
+}
+
+/**
+ * Ramp the volume of a node from JS, one set per step, for the implementations without a native helper.
+ * The steps are scheduled from the start of the ramp and a late step skips to the one due, as in the helpers.
+ */
+export async function rampWithSteps(
+  id: string,
+  volume: number,
+  durationMs: number,
+  curve: RampCurve,
+  getVolume: (id: string) => Promise<number>,
+  setVolume: (id: string, volume: number) => Promise<unknown>,
+): Promise<RampResult> {
+  validateRamp(volume, durationMs, curve);
+
+  const ramp: RunningRamp = { replaced: false };
+  const running = runningRamps.get(id);
+  if (running) running.replaced = true;
+  runningRamps.set(id, ramp);
+
+  const result: RampResult = {
+    id,
+    completed: false,
+    volume: 0,
+    steps: 0,
+    elapsedMs: 0,
+    maxJitterUs: 0,
+    meanJitterUs: 0,
+    jitterHistogram: [...JITTER_BUCKETS.map((underUs) => ({ underUs, steps: 0 })), { steps: 0 }],
+  };
+
+  const start = performance.now();
+  const stepCount = Math.max(Math.ceil(durationMs / STEP_INTERVAL), 1);
+  const getStepTime = (step: number) => start + durationMs * step / stepCount;
+  let totalJitter = 0;
+
+  try {
+    result.volume = await getVolume(id);
+    const from = result.volume / 100;
+
+    let step = 0;
+    while (step < stepCount && !ramp.replaced) {
+      const wait = getStepTime(step + 1) - performance.now();
+      if (wait > 0) await sleep(wait);
+      if (ramp.replaced) break;
+
+      const now = performance.now();
+      step++;
+      while (step < stepCount && getStepTime(step + 1) <= now) step++;
+
+      // The volumes are whole percents, a step rounding to the current one is not sent
+      const stepVolume = Math.round(getRampLevel(from, volume / 100, step / stepCount, curve) * 100);
+      if (stepVolume !== result.volume) await setVolume(id, stepVolume);
+
+      const jitter = Math.round((now - getStepTime(step)) * 1000);
+      const bucket = JITTER_BUCKETS.findIndex((bound) => jitter < bound);
+      result.jitterHistogram[bucket === -1 ? JITTER_BUCKETS.length : bucket].steps++;
+      result.maxJitterUs = Math.max(result.maxJitterUs, jitter);
+      totalJitter += jitter;
+      result.steps++;
+      result.volume = stepVolume;
+    }
+  } finally {
+    if (runningRamps.get(id) === ramp) runningRamps.delete(id);
+  }
+
+  result.completed = !ramp.replaced;
+  result.elapsedMs = Math.round(performance.now() - start);
+  result.meanJitterUs = result.steps ? Math.round(totalJitter / result.steps) : 0;
+  return result;
+}
@@ -0,0 +1,240 @@
+import { performance } from 'perf_hooks';
+import { PlatformImplementation, Status, VolumeInfo, VsEvent, VsNode, VsNodeTypes, VsStreamNode } from '@/types';
+
+// Long enough for the reads of a single user action, short enough for changes made by other applications
+const DEFAULT_MAX_AGE = 200;
+
+export type StatusCacheStats = {
+  // Answered from the snapshot
+  hits: number;
+  // Read from the backend
+  misses: number;
+  // Joined a read of the backend already in flight
+  shared: number;
+};
+
+type Read<T> = {
+  promise: Promise<T>;
+  generation: number;
+};
+
+function getNodes(status: Status, type: VsNodeTypes): VsNode[] {
+  if (type === 'sink') return status.sinks;
+  if (type === 'source') return status.sources;
+  return status.streams;
+}
+
+// IDs may be shared by several types (pactl), resolved in the same order as the node lookups of the backends
+function findNode(status: Status, id: string): VsNode | undefined {
+  return status.sinks.find((node) => node.id === id) ??
+    status.sources.find((node) => node.id === id) ??
+    status.streams.find((node) => node.id === id);
+}
+
+/**
+ * Share the status and node reads of an implementation between concurrent callers, and answer node reads from the
+ * latest status while it isn't older than the maximum age.
+ *
+ * The snapshot is updated in place by successful writes, and by the events of the watches started through the cache.
+ * When the backend pushes its changes (watchEvents), the cache also watches it in the background after its first read,
+ * without keeping the process alive, and drops the snapshot on each event, so changes made by other applications
+ * aren't answered from it. Polling watches are only started by the user. A write or an event also keeps the reads
+ * started before it from replacing the snapshot, or from being shared with the reads that follow.
+ */
+export class StatusCache {
+  readonly implementation: PlatformImplementation;
+  private snapshot: Status | null = null;
+  private snapshotAt = 0;
+  private generation = 0;
+  private statusRead: Read<Status> | null = null;
+  private nodeReads = new Map<string, Read<VolumeInfo>>();
+  private stats: StatusCacheStats = { hits: 0, misses: 0, shared: 0 };
+  private following = false;
+
+  constructor(private readonly backend: PlatformImplementation, private maxAgeMs = DEFAULT_MAX_AGE) {
+    this.implementation = {
+      ...backend,
+      getStatus: () => this.getStatus(),
+      getNodeVolumeInfoById: (id) => this.getNodeVolumeInfoById(id),
+      setGlobalVolume: (volume) => this.write(() => backend.setGlobalVolume(volume), () => false),
+      setGlobalMuted: (muted) => this.write(() => backend.setGlobalMuted(muted), () => false),
+      setNodeVolumeById: (id, volume) => this.write(
+        () => backend.setNodeVolumeById(id, volume),
+        (status) => this.updateNode(status, id, { volume }),
+      ),
+      setNodeMutedById: (id, muted) => this.write(
+        () => backend.setNodeMutedById(id, muted),
+        (status) => this.updateNode(status, id, { muted }),
+      ),
+      setStreamDestination: (id, destinationId) => this.write(
+        () => backend.setStreamDestination(id, destinationId),
+        // Only streams have a destination, their IDs may be shared by a sink (pactl)
+        (status) => this.updateStream(status, id, { destinationId }),
+      ),
+      applyBatch: (operations) => this.write(() => backend.applyBatch(operations), () => false),
+      rampNodeVolume: (id, volume, durationMs, curve) => this.write(
+        () => backend.rampNodeVolume(id, volume, durationMs, curve),
+        (status, result) => this.updateNode(status, id, { volume: result.volume }),
+      ),
+      watch: (listener, options) => backend.watch((event) => {
+        this.apply(event);
+        listener(event);
+      }, options),
+    };
+  }
+
+  /**
+   * Set how long a status answers the node reads, in milliseconds. With 0, concurrent reads are only shared.
+   */
+  setMaxAge(maxAgeMs: number) {
+    if (!(maxAgeMs >= 0)) throw new Error('Maximum age must be positive or zero');
+
+    this.maxAgeMs = maxAgeMs;
+  }
+
+  getStats(): StatusCacheStats {
+    return { ...this.stats };
+  }
+
+  resetStats() {
+    this.stats = { hits: 0, misses: 0, shared: 0 };
+  }
+
+  invalidate() {
+    this.generation++;
+    this.snapshot = null;
+  }
+
+  // Started after a read of the backend, once it is selected and known to push its changes: a polling watch would
+  // cost more reads than it saves. The watch restarts its source by itself when it dies
+  private follow() {
+    if (this.following) return;
+
+    try {
+      if (!this.backend.getPlatformCompatibility().watchEvents) return;
+      this.following = true;
+      this.backend.watch(() => this.invalidate(), { keepAlive: false });
+    } catch (e) {
+      console.error(e);
+    }
+  }
+
+  private isFresh() {
+    return this.snapshot !== null && performance.now() - this.snapshotAt <= this.maxAgeMs;
+  }
+
+  private async getStatus(): Promise<Status> {
+    if (this.isFresh()) {
+      this.stats.hits++;
+      return structuredClone(this.snapshot);
+    }
+
+    if (this.statusRead?.generation === this.generation) {
+      this.stats.shared++;
+    } else {
+      this.stats.misses++;
+      const generation = this.generation;
+      const promise = this.backend.getStatus().then((status) => {
+        this.follow();
+        if (this.generation === generation) {
+          this.snapshot = status;
+          this.snapshotAt = performance.now();
+        }
+        return status;
+      }).finally(() => {
+        if (this.statusRead?.promise === promise) this.statusRead = null;
+      });
+      this.statusRead = { promise, generation };
+    }
+
+    // Every caller gets its own copy, the snapshot is updated in place
+    return structuredClone(await this.statusRead.promise);
+  }
+
+  private async getNodeVolumeInfoById(id: string): Promise<VolumeInfo> {
+    const node = this.isFresh() ? findNode(this.snapshot, id) : undefined;
+    if (node) {
+      this.stats.hits++;
+      return { volume: node.volume, muted: node.muted };
+    }
+
+    const read = this.nodeReads.get(id);
+    if (read?.generation === this.generation) {
+      this.stats.shared++;
+      return { ...await read.promise };
+    }
+
+    this.stats.misses++;
+    const generation = this.generation;
+    const promise = this.backend.getNodeVolumeInfoById(id).then((volumeInfo) => {
+      this.follow();
+      if (this.generation === generation && this.snapshot) this.updateNode(this.snapshot, id, volumeInfo);
+      return volumeInfo;
+    }).finally(() => {
+      if (this.nodeReads.get(id)?.promise === promise) this.nodeReads.delete(id);
+    });
+    this.nodeReads.set(id, { promise, generation });
+
+    return { ...await promise };
+  }
+
+  /**
+   * Run a write, then update the snapshot with its result, or drop it when the update can't tell the new state.
+   */
+  private async write<T>(write: () => Promise<T>, update: (status: Status, result: T) => boolean): Promise<T> {
+    this.generation++;
+    let result: T;
+    try {
+      result = await write();
+    } catch (e) {
+      // Maybe partly applied
+      this.invalidate();
+      throw e;
+    }
+
+    this.generation++;
+    if (this.snapshot && !update(this.snapshot, result)) this.snapshot = null;
+    return result;
+  }
+
+  private updateNode(status: Status, id: string, values: Partial<VsNode> & { destinationId?: string }) {
+    const node = findNode(status, id);
+    if (!node) return false;
+
+    Object.assign(node, values);
+    return true;
+  }
+
+  private updateStream(status: Status, id: string, values: Partial<VsStreamNode>) {
+    const node = getNodes(status, 'stream').find((node) => node.id === id);
+    if (!node) return false;
+
+    Object.assign(node, values);
+    return true;
+  }
+
+  private apply(event: VsEvent) {
+    this.generation++;
+    if (!this.snapshot) return;
+
+    if (event.event === 'defaultChanged') {
+      for (const node of getNodes(this.snapshot, event.type)) node.isDefault = node.id === event.id;
+      if (event.type === 'sink') this.snapshot.defaultSink = event.id;
+      else this.snapshot.defaultSource = event.id;
+      return;
+    }
+
+    const type = event.event === 'removed' ? event.type : event.node.type;
+    const id = event.event === 'removed' ? event.id : event.node.id;
+    const nodes = getNodes(this.snapshot, type);
+    const index = nodes.findIndex((node) => node.id === id);
+
+    if (event.event === 'removed') {
+      if (index !== -1) nodes.splice(index, 1);
+    } else if (index !== -1) {
+      nodes[index] = { ...event.node };
+    } else {
+      nodes.push({ ...event.node });
+    }
+  }
+}
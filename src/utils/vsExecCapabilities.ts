@@ -0,0 +1,88 @@
+import { execCommand } from '@/utils/commands';
+
+// The usage lists the commands with two spaces of indentation, the operations of batch with four
+const COMMAND_LINE = /^ {2}(\w+)/;
+
+/**
+ * Commands supported by a vsExec executable, read from the usage it prints when run without a command.
+ *
+ * Executables built before a command was added answer it with "Unknown command" and their usage, e.g. the vsExec.exe
+ * shipped by older releases, so the callers fall back to the commands these executables have. The commands are tried
+ * first and the usage only read once one failed, up to date executables only pay for the probe before a long-lived
+ * mode like watch, which prints the usage instead of failing.
+ */
+export class VsExecCapabilities {
+  private probe: Promise<Set<string> | null> | null = null;
+  private commands: Set<string> | null = null;
+
+  constructor(private readonly path: string) {
+  }
+
+  /**
+   * Whether the command is known to be missing, without running the executable.
+   */
+  isMissing(command: string) {
+    return this.commands !== null && !this.commands.has(command);
+  }
+
+  /**
+   * Whether the command is known to be supported, without waiting for the executable. The usage is read in the
+   * background the first time, the command is unknown until then.
+   */
+  has(command: string) {
+    if (!this.probe) {
+      this.probe = this.readCommands();
+      this.probe.then((commands) => {
+        this.commands = commands;
+      });
+    }
+
+    return !!this.commands?.has(command);
+  }
+
+  /**
+   * Whether the executable supports the command, read once from its usage. True when the usage can't be read, so that
+   * the errors of the command are reported as is.
+   */
+  async supports(command: string) {
+    this.probe ??= this.readCommands();
+    this.commands = await this.probe;
+    // Read again next time, e.g. once the executable is installed
+    if (!this.commands) this.probe = null;
+
+    return !this.commands || this.commands.has(command);
+  }
+
+  /**
+   * Run a command, or its fallback when the executable doesn't support it.
+   * @param {string} command The command, as listed by the usage.
+   * @param {() => Promise<T>} run Run the command.
+   * @param {() => Promise<T>} fallback Do the same with older commands.
+   * @returns {Promise<T>} The result of the command or of the fallback, rejected as is if the command is supported.
+   */
+  async run<T>(command: string, run: () => Promise<T>, fallback: () => Promise<T>): Promise<T> {
+    if (this.isMissing(command)) return fallback();
+
+    try {
+      return await run();
+    } catch (e) {
+      if (await this.supports(command)) throw e;
+      return fallback();
+    }
+  }
+
+  private async readCommands() {
+    try {
+      const usage = await execCommand(this.path, [], { ignoreExitCode: true });
+      const commands = new Set<string>();
+      for (const line of usage.split('\n')) {
+        const command = line.match(COMMAND_LINE)?.[1];
+        if (command) commands.add(command);
+      }
+      return commands.size > 0 ? commands : null;
+    } catch (e) {
+      console.error(e);
+      return null;
+    }
+  }
+}
@@ -0,0 +1,93 @@
+import { existsSync } from 'fs';
+import { LevelsListener, Unwatch, Watch, WatchListener, WatchOptions } from '@/types';
+import { CompatibilityError } from '@/utils/errors';
+import { countParsedBytes } from '@/utils/metrics';
+import { VsExecLevelWatchers } from '@/utils/levels';
+import { VsExecServer, VsExecServerError } from '@/utils/vsExecServer';
+import { VsExecWatcher } from '@/utils/vsExecWatcher';
+import { KeepAlive } from '@/utils/watch';
+
+/**
+ * Optional native helper speaking the vsExec protocol, e.g. vsPulse or vsPipewire on Linux.
+ *
+ * Requests go through a single helper process in `serve` mode, and fall back to the command line tools
+ * when the helper is missing or can't be started.
+ */
+export class VsExecHelper {
+  private readonly server: VsExecServer | null;
+  private readonly watcher: VsExecWatcher | null;
+  private readonly levelWatchers: VsExecLevelWatchers | null;
+
+  constructor(path: string) {
+    const exists = existsSync(path);
+    this.server = exists ? new VsExecServer(path) : null;
+    this.watcher = exists ? new VsExecWatcher(path) : null;
+    this.levelWatchers = exists ? new VsExecLevelWatchers(path) : null;
+  }
+
+  /**
+   * Whether requests go through the helper, false when it is missing or once it failed to start.
+   */
+  isAvailable() {
+    return !!this.server?.isSupported();
+  }
+
+  /**
+   * Run a request through the helper, or the fallback when it isn't available.
+   * The error output of a failed helper command is thrown as an Error.
+   */
+  run<T>(request: (server: VsExecServer) => Promise<T>, fallback: () => Promise<T>): Promise<T> {
+    if (!this.isAvailable()) return fallback();
+
+    return request(this.server).catch((err) => {
+      if (err instanceof VsExecServerError) return fallback();
+      if (err instanceof Error) throw err;
+      throw new Error(`${err}`.trim());
+    });
+  }
+
+  /**
+   * Watch through the helper, or the fallback when it isn't available or doesn't support watching.
+   */
+  watch(listener: WatchListener, fallback: Watch, options?: WatchOptions): Unwatch {
+    if (this.isAvailable() && this.watcher.isSupported()) {
+      return this.watcher.watch(listener, new KeepAlive(options?.keepAlive ?? true));
+    }
+
+    return fallback(listener, options);
+  }
+
+  /**
+   * Whether the levels are metered by the helper, the command line tools have no fallback for them.
+   */
+  hasLevels() {
+    return this.isAvailable() && this.levelWatchers.isSupported();
+  }
+
+  /**
+   * Watch the levels through the helper, throws a CompatibilityError when it isn't available.
+   */
+  watchLevels(listener: LevelsListener, rateHz?: number): Unwatch {
+    if (!this.hasLevels()) throw new CompatibilityError();
+
+    return this.levelWatchers.watch(listener, rateHz);
+  }
+}
+
+export async function requestVolume(server: VsExecServer, args: string[]) {
+  const volume = parseInt((await server.request(args)).trim());
+  if (isNaN(volume) || volume === -1) throw new Error('Failed to get volume');
+
+  return volume;
+}
+
+export async function requestJson<T>(server: VsExecServer, args: string[], input?: string[]) {
+  const output = await server.request(['--compact', ...args], input);
+  countParsedBytes('vsExec', output);
+  try {
+    return JSON.parse(output) as T;
+  } catch (e) {
+    console.error(output);
+    throw new Error(`Failed to parse the ${args[0]} output`);
+  }
+}
@@ -0,0 +1,142 @@
+import { ChildProcessWithoutNullStreams, spawn } from 'child_process';
+import { Socket } from 'net';
+import { basename } from 'path';
+import { countProcessStart } from '@/utils/metrics';
+
+type PendingRequest = {
+  resolve: (stdout: string) => void;
+  reject: (err: string | VsExecServerError) => void;
+};
+
+/**
+ * The server process died before answering, the request may or may not have been applied.
+ */
+export class VsExecServerError extends Error {
+  constructor(message: string) {
+    super(message);
+  }
+}
+
+/**
+ * Keep a single vsExec (or vsPulse) process alive in `serve` mode and pipeline requests to it.
+ *
+ * Requests are written as tab separated lines prefixed by an ID, responses come back as
+ * `<id>\t<exitCode>\t<outputBytes>\t<errorBytes>\n` followed by the raw output and error bytes.
+ * The process is restarted on the next request if it dies.
+ */
+export class VsExecServer {
+  private child: ChildProcessWithoutNullStreams | null = null;
+  private buffer = Buffer.alloc(0);
+  private pending = new Map<string, PendingRequest>();
+  private nextId = 1;
+  private answered = false;
+  private supported = true;
+
+  constructor(private readonly path: string) {
+  }
+
+  /**
+   * Whether the executable supports the serve mode, false once a process died without answering anything.
+   */
+  isSupported() {
+    return this.supported;
+  }
+
+  /**
+   * Run a command in the server process.
+   * @param {string[]} args The command and its arguments.
+   * @param {string[]} input Lines read by the command after its request, e.g. batch operations.
+   * @returns {Promise<string>} The output of the command, rejected with its error output if it failed.
+   */
+  request(args: string[], input: string[] = []): Promise<string> {
+    if (args.some((arg) => /[\t\r\n]/.test(arg)) || input.some((line) => /[\r\n]/.test(line))) {
+      return Promise.reject('Arguments can not contain tabs or line breaks');
+    }
+
+    const child = this.getChild();
+    const id = (this.nextId++).toString();
+
+    return new Promise((resolve, reject) => {
+      this.pending.set(id, { resolve, reject });
+      this.updateRef();
+      child.stdin.write([[id, ...args].join('\t'), ...input].map((line) => line + '\n').join(''));
+    });
+  }
+
+  private getChild() {
+    if (this.child) return this.child;
+
+    const child = spawn(this.path, ['serve'], { windowsHide: true });
+    countProcessStart(`${basename(this.path)} serve`);
+    child.stdout.on('data', (chunk: Buffer) => this.onData(child, chunk));
+    child.stderr.on('data', (chunk: Buffer) => console.error(chunk.toString()));
+    child.stdin.on('error', () => this.onExit(child));
+    child.on('error', () => this.onExit(child));
+    child.on('exit', () => this.onExit(child));
+
+    this.child = child;
+    this.buffer = Buffer.alloc(0);
+    this.answered = false;
+    return child;
+  }
+
+  private onData(child: ChildProcessWithoutNullStreams, chunk: Buffer) {
+    if (child !== this.child) return;
+    this.buffer = Buffer.concat([this.buffer, chunk]);
+
+    let headerEnd: number;
+    while ((headerEnd = this.buffer.indexOf('\n')) !== -1) {
+      const [id, code, outputBytes, errorBytes] = this.buffer.toString('utf8', 0, headerEnd).split('\t');
+      const outputStart = headerEnd + 1;
+      const errorStart = outputStart + Number.parseInt(outputBytes, 10);
+      const end = errorStart + Number.parseInt(errorBytes, 10);
+
+      if (!this.pending.has(id) || isNaN(end)) {
+        // Not a serve response, e.g. an older vsExec printing its usage
+        this.onExit(child);
+        child.kill();
+        return;
+      }
+      if (this.buffer.length < end) break;
+
+      const stdout = this.buffer.toString('utf8', outputStart, errorStart);
+      const stderr = this.buffer.toString('utf8', errorStart, end);
+      this.buffer = this.buffer.subarray(end);
+      this.answered = true;
+
+      const request = this.pending.get(id);
+      this.pending.delete(id);
+      if (code !== '0' || stderr) {
+        request.reject(stderr || stdout);
+      } else {
+        request.resolve(stdout);
+      }
+    }
+
+    this.updateRef();
+  }
+
+  private onExit(child: ChildProcessWithoutNullStreams) {
+    if (child !== this.child) return;
+    this.child = null;
+    if (!this.answered) this.supported = false;
+
+    const pending = [...this.pending.values()];
+    this.pending.clear();
+    for (const request of pending) {
+      request.reject(new VsExecServerError('vsExec server exited'));
+    }
+  }
+
+  // Only keep the event loop alive while requests are waiting for an answer
+  private updateRef() {
+    if (!this.child) return;
+
+    const waiting = this.pending.size > 0;
+    for (const stream of [this.child.stdin, this.child.stdout, this.child.stderr]) {
+      const socket = stream as unknown as Socket;
+      if (waiting) socket.ref?.(); else socket.unref?.();
+    }
+    if (waiting) this.child.ref(); else this.child.unref();
+  }
+}
@@ -0,0 +1,157 @@
+import { ChildProcessWithoutNullStreams, spawn } from 'child_process';
+import { Socket } from 'net';
+import { basename } from 'path';
+import { Unwatch, VsEvent } from '@/types';
+import { countProcessStart } from '@/utils/metrics';
+import { KeepAlive } from '@/utils/watch';
+
+const RESTART_DELAY = 1000;
+
+/**
+ * Share a single vsExec (or vsPulse) process in `watch` mode, or another streaming mode like `levels`, between all the
+ * listeners.
+ *
+ * The process prints one JSON event per line and stops when its stdin is closed.
+ * It is started with the first listener, stopped with the last one and restarted if it dies in between. It keeps the
+ * process alive while one of the listeners needs it.
+ */
+export class VsExecWatcher<T = VsEvent> {
+  private child: ChildProcessWithoutNullStreams | null = null;
+  // Whether each listener keeps the process alive
+  private listeners = new Map<(event: T) => void, boolean>();
+  private keepAlive = new KeepAlive();
+  private childHandle: { ref(): void, unref(): void } | null = null;
+  private buffer = '';
+  private restartTimer: NodeJS.Timeout | null = null;
+  private supported = true;
+
+  constructor(private readonly path: string, private readonly args: string[] = ['watch']) {
+  }
+
+  /**
+   * Whether the executable supports the mode, false once it printed something else than events.
+   */
+  isSupported() {
+    return this.supported;
+  }
+
+  /**
+   * @param {(event: T) => void} listener Called with each event.
+   * @param {KeepAlive} keepAlive Whether the listener keeps the process alive, followed as it changes.
+   */
+  watch(listener: (event: T) => void, keepAlive = new KeepAlive()): Unwatch {
+    if (!this.supported) throw new Error(`${basename(this.path)} does not support ${this.args[0]}`);
+
+    const handle = keepAlive.hold({
+      ref: () => this.setKeepAlive(listener, true),
+      unref: () => this.setKeepAlive(listener, false),
+    });
+    this.start();
+
+    return () => {
+      keepAlive.release(handle);
+      this.listeners.delete(listener);
+      if (this.listeners.size === 0) {
+        this.stop();
+      } else {
+        this.updateKeepAlive();
+      }
+    };
+  }
+
+  private setKeepAlive(listener: (event: T) => void, needed: boolean) {
+    this.listeners.set(listener, needed);
+    this.updateKeepAlive();
+  }
+
+  private updateKeepAlive() {
+    this.keepAlive.set([...this.listeners.values()].some((needed) => needed));
+  }
+
+  private start() {
+    if (this.child || this.restartTimer) return;
+
+    const child = spawn(this.path, this.args, { windowsHide: true });
+    countProcessStart(`${basename(this.path)} ${this.args[0]}`);
+    child.stdout.setEncoding('utf8');
+    child.stdout.on('data', (chunk: string) => this.onData(child, chunk));
+    child.stderr.on('data', (chunk: Buffer) => console.error(chunk.toString()));
+    child.stdin.on('error', () => this.onExit(child));
+    child.on('error', () => this.onExit(child));
+    child.on('exit', () => this.onExit(child));
+
+    this.child = child;
+    this.childHandle = this.keepAlive.hold({
+      ref: () => {
+        child.ref();
+        for (const stream of [child.stdin, child.stdout, child.stderr]) (stream as Socket).ref();
+      },
+      unref: () => {
+        child.unref();
+        for (const stream of [child.stdin, child.stdout, child.stderr]) (stream as Socket).unref();
+      },
+    });
+    this.buffer = '';
+  }
+
+  private stop() {
+    if (this.restartTimer) clearTimeout(this.restartTimer);
+    this.keepAlive.release(this.restartTimer);
+    this.restartTimer = null;
+    if (!this.child) return;
+
+    // Closing the input stops the watch
+    const child = this.child;
+    this.child = null;
+    this.keepAlive.release(this.childHandle);
+    this.childHandle = null;
+    child.stdin.end();
+    child.unref();
+  }
+
+  private onData(child: ChildProcessWithoutNullStreams, chunk: string) {
+    if (child !== this.child) return;
+    this.buffer += chunk;
+
+    let lineEnd: number;
+    while ((lineEnd = this.buffer.indexOf('\n')) !== -1) {
+      const line = this.buffer.slice(0, lineEnd).trim();
+      this.buffer = this.buffer.slice(lineEnd + 1);
+      if (!line) continue;
+
+      let event: T;
+      try {
+        event = JSON.parse(line) as T;
+      } catch (e) {
+        // Not an event, e.g. an older vsExec printing its usage
+        console.error(`Unexpected ${basename(this.path)} ${this.args[0]} output: ${line}`);
+        this.supported = false;
+        this.stop();
+        child.kill();
+        return;
+      }
+
+      for (const listener of this.listeners.keys()) {
+        try {
+          listener(event);
+        } catch (e) {
+          console.error(e);
+        }
+      }
+    }
+  }
+
+  private onExit(child: ChildProcessWithoutNullStreams) {
+    if (child !== this.child) return;
+    this.child = null;
+    this.keepAlive.release(this.childHandle);
+    this.childHandle = null;
+
+    if (this.listeners.size === 0 || !this.supported) return;
+    this.restartTimer = this.keepAlive.hold(setTimeout(() => {
+      this.keepAlive.release(this.restartTimer);
+      this.restartTimer = null;
+      if (this.listeners.size > 0) this.start();
+    }, RESTART_DELAY));
+  }
+}
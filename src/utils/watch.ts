@@ -0,0 +1,200 @@
+import { Status, VsEvent, VsNode, VsNodeTypes, VsStreamNode, Watch, WatchListener, WatchOptions } from '@/types';
+
+export type Emit = (event: VsEvent) => void;
+export type StopWatch = () => void;
+
+type Handle = {
+  ref(): unknown;
+  unref(): unknown;
+};
+
+/**
+ * Whether the handles of a watch source (its processes and timers) keep the process alive, as long as one of the
+ * listeners of the source needs it. The handles held are referenced or not as it changes.
+ */
+export class KeepAlive {
+  private handles = new Set<Handle>();
+
+  constructor(private enabled = true) {
+  }
+
+  isEnabled() {
+    return this.enabled;
+  }
+
+  set(enabled: boolean) {
+    if (enabled === this.enabled) return;
+
+    this.enabled = enabled;
+    for (const handle of this.handles) this.apply(handle);
+  }
+
+  /**
+   * Follow a handle until it is released, e.g. once its process exited or its timer fired.
+   */
+  hold<T extends Handle>(handle: T): T {
+    this.handles.add(handle);
+    this.apply(handle);
+    return handle;
+  }
+
+  release(handle: Handle | null) {
+    if (handle) this.handles.delete(handle);
+  }
+
+  private apply(handle: Handle) {
+    if (this.enabled) {
+      handle.ref();
+    } else {
+      handle.unref();
+    }
+  }
+}
+
+/**
+ * Share a single source of events between all the listeners.
+ * The source is started with the first listener and stopped with the last one. It keeps the process alive while one
+ * of the listeners doesn't watch in the background.
+ * @param {(emit: Emit, keepAlive: KeepAlive) => StopWatch} start Start the source, returns the function stopping it.
+ */
+export function createWatch(start: (emit: Emit, keepAlive: KeepAlive) => StopWatch): Watch {
+  // Whether each listener keeps the process alive
+  const listeners = new Map<WatchListener, boolean>();
+  const keepAlive = new KeepAlive();
+  let stop: StopWatch | null = null;
+
+  const emit: Emit = (event) => {
+    for (const listener of listeners.keys()) {
+      try {
+        listener(event);
+      } catch (e) {
+        console.error(e);
+      }
+    }
+  };
+
+  return (listener: WatchListener, options?: WatchOptions) => {
+    listeners.set(listener, options?.keepAlive ?? true);
+    keepAlive.set([...listeners.values()].some((needed) => needed));
+    if (!stop) stop = start(emit, keepAlive);
+
+    return () => {
+      if (!listeners.delete(listener) || !stop) return;
+      if (listeners.size > 0) {
+        keepAlive.set([...listeners.values()].some((needed) => needed));
+        return;
+      }
+
+      const stopSource = stop;
+      stop = null;
+      stopSource();
+    };
+  };
+}
+
+function isSameNode(a: VsNode, b: VsNode) {
+  return a.name === b.name &&
+    a.volume === b.volume &&
+    a.muted === b.muted &&
+    a.isDefault === b.isDefault &&
+    (a as VsStreamNode).destinationId === (b as VsStreamNode).destinationId;
+}
+
+/**
+ * The nodes known by a watch, compared with fresh listings to emit only what changed.
+ * Nodes are keyed by type and ID, since some backends reuse the same IDs for different types.
+ */
+export class NodeStates {
+  private nodes = new Map<string, VsNode>();
+  private defaults: Record<'sink' | 'source', string | undefined> = { sink: undefined, source: undefined };
+
+  has(type: VsNodeTypes, id: string) {
+    return this.nodes.has(`${type}:${id}`);
+  }
+
+  /**
+   * Find a node by ID whatever its type, for backends whose IDs are unique across types.
+   */
+  find(id: string) {
+    return [...this.nodes.values()].find((node) => node.id === id);
+  }
+
+  /**
+   * Replace the known nodes without emitting anything, e.g. with the status read when the watch starts.
+   */
+  reset(status: Status) {
+    this.nodes.clear();
+    this.defaults = { sink: status.defaultSink, source: status.defaultSource };
+    for (const node of [...status.sinks, ...status.sources, ...status.streams]) {
+      this.nodes.set(`${node.type}:${node.id}`, this.withDefault(node));
+    }
+  }
+
+  /**
+   * Compare a whole status with the known nodes.
+   */
+  updateStatus(status: Status, emit: Emit) {
+    this.updateDefault('sink', status.defaultSink, emit);
+    this.updateDefault('source', status.defaultSource, emit);
+    this.update('sink', status.sinks, emit);
+    this.update('source', status.sources, emit);
+    this.update('stream', status.streams, emit);
+  }
+
+  /**
+   * Compare a listing of a type with the known nodes of this type.
+   * @param {VsNodeTypes} type The type of the listed nodes.
+   * @param {VsNode[]} nodes The listed nodes, their isDefault is ignored in favor of the known default.
+   * @param {Emit} emit Called with each change.
+   * @param {Iterable<string>} ids Only compare these nodes, the other nodes of the type are left untouched.
+   */
+  update(type: VsNodeTypes, nodes: VsNode[], emit: Emit, ids?: Iterable<string>) {
+    const listed = new Map(nodes.map((node) => [node.id, node]));
+    const known = [...this.nodes.values()].filter((node) => node.type === type).map((node) => node.id);
+    const scope = new Set(ids ?? [...known, ...listed.keys()]);
+
+    for (const id of scope) {
+      const key = `${type}:${id}`;
+      const previous = this.nodes.get(key);
+      const next = listed.has(id) ? this.withDefault({ ...listed.get(id), type }) : undefined;
+
+      if (!next) {
+        if (!previous) continue;
+        this.nodes.delete(key);
+        emit({ event: 'removed', type, id });
+      } else if (!previous) {
+        this.nodes.set(key, next);
+        emit({ event: 'added', node: next });
+      } else if (!isSameNode(previous, next)) {
+        this.nodes.set(key, next);
+        emit({ event: 'changed', node: next });
+      }
+    }
+  }
+
+  /**
+   * Update the volume and mute of a known node.
+   */
+  updateVolume(type: VsNodeTypes, id: string, volume: number, muted: boolean, emit: Emit) {
+    const previous = this.nodes.get(`${type}:${id}`);
+    if (!previous) return;
+
+    this.update(type, [{ ...previous, volume, muted }], emit, [id]);
+  }
+
+  updateDefault(type: 'sink' | 'source', id: string | undefined, emit: Emit) {
+    if (this.defaults[type] === id) return;
+
+    this.defaults[type] = id;
+    emit({ event: 'defaultChanged', type, id });
+
+    // The previous and new default nodes changed too
+    const nodes = [...this.nodes.values()].filter((node) => node.type === type);
+    this.update(type, nodes, emit, nodes.map((node) => node.id));
+  }
+
+  private withDefault(node: VsNode): VsNode {
+    if (node.type === 'stream') return node;
+    return { ...node, isDefault: this.defaults[node.type] === node.id };
+  }
+}
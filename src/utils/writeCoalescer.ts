@@ -0,0 +1,121 @@
+import { PlatformImplementation } from '@/types';
+
+const GLOBAL_KEY = 'global';
+
+type Waiter = {
+  resolve: () => void;
+  reject: (err: unknown) => void;
+};
+
+type PendingWrite = {
+  // Undefined for the global volume and mute
+  id?: string;
+  volume?: number;
+  muted?: boolean;
+  waiters: Waiter[];
+};
+
+export type WriteCoalescerStats = {
+  // Volume and mute changes asked for
+  requested: number;
+  // Calls to the backend applying them
+  written: number;
+};
+
+function validateVolume(volume: number) {
+  if (volume < 0 || volume > 100) throw new Error('Volume must be between 0 and 100');
+}
+
+/**
+ * Coalesce the volume and mute changes of each node, e.g. the 60 changes per second of a dragged slider.
+ *
+ * A node has at most one write in flight. The changes made meanwhile wait for it, a newer value replacing the waiting
+ * one, and are written together once it finished, so the last value asked for is always the one applied last. Each
+ * change is resolved once the write carrying its value or a newer one is applied.
+ */
+export class WriteCoalescer {
+  readonly implementation: PlatformImplementation;
+  private pending = new Map<string, PendingWrite>();
+  private inFlight = new Set<string>();
+  private stats: WriteCoalescerStats = { requested: 0, written: 0 };
+
+  /**
+   * @param {PlatformImplementation} backend The implementation writing the changes.
+   * @param {boolean} mergeWithBatch Whether a volume and a mute change of a node are written as a single batch, for
+   * the backends applying a batch in one call.
+   */
+  constructor(private readonly backend: PlatformImplementation, private readonly mergeWithBatch = false) {
+    this.implementation = {
+      ...backend,
+      setGlobalVolume: async (volume) => {
+        validateVolume(volume);
+        return this.set(GLOBAL_KEY, undefined, { volume });
+      },
+      setGlobalMuted: (muted) => this.set(GLOBAL_KEY, undefined, { muted }),
+      setNodeVolumeById: async (id, volume) => {
+        validateVolume(volume);
+        return this.set(`node:${id}`, id, { volume });
+      },
+      setNodeMutedById: (id, muted) => this.set(`node:${id}`, id, { muted }),
+    };
+  }
+
+  getStats(): WriteCoalescerStats {
+    return { ...this.stats };
+  }
+
+  private set(key: string, id: string | undefined, values: { volume?: number; muted?: boolean }): Promise<void> {
+    this.stats.requested++;
+
+    let write = this.pending.get(key);
+    if (!write) {
+      write = { id, waiters: [] };
+      this.pending.set(key, write);
+      // Changes made in the same tick are written together
+      if (!this.inFlight.has(key)) queueMicrotask(() => this.flush(key));
+    }
+    Object.assign(write, values);
+
+    return new Promise((resolve, reject) => write.waiters.push({ resolve, reject }));
+  }
+
+  private async flush(key: string) {
+    const write = this.pending.get(key);
+    if (!write) return;
+
+    this.pending.delete(key);
+    this.inFlight.add(key);
+    try {
+      await this.apply(write);
+      for (const waiter of write.waiters) waiter.resolve();
+    } catch (e) {
+      for (const waiter of write.waiters) waiter.reject(e);
+    } finally {
+      this.inFlight.delete(key);
+      // Changes made while the write was in flight
+      if (this.pending.has(key)) this.flush(key);
+    }
+  }
+
+  private async apply({ id, volume, muted }: PendingWrite) {
+    if (id !== undefined && volume !== undefined && muted !== undefined && this.mergeWithBatch) {
+      this.stats.written++;
+      const results = await this.backend.applyBatch([
+        { op: 'setVolume', id, volume },
+        { op: 'setMuted', id, muted },
+      ]);
+      const failed = results.find((result) => !result.ok);
+      if (failed) throw new Error(failed.error ?? 'Failed to apply batch');
+      return;
+    }
+
+    if (volume !== undefined) {
+      this.stats.written++;
+      await (id === undefined ? this.backend.setGlobalVolume(volume) : this.backend.setNodeVolumeById(id, volume));
+    }
+    if (muted !== undefined) {
+      this.stats.written++;
+      await (id === undefined ? this.backend.setGlobalMuted(muted) : this.backend.setNodeMutedById(id, muted));
+    }
+  }
+}